@@ -4439,6 +4439,23 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
   buffer->uri.clear();
   ParseStringProperty(&buffer->uri, err, o, "uri", false, "Buffer");
 
+  // EXT_meshopt_compression fallback buffer without uri: allocate it here as
+  // the destination of decompressed buffer views
+  if (buffer->uri.empty()) {
+    detail::json_const_iterator extIt;
+    if (detail::FindMember(o, "extensions", extIt)) {
+      detail::json_const_iterator meshoptIt;
+      if (detail::FindMember(detail::GetValue(extIt), "EXT_meshopt_compression",
+                             meshoptIt)) {
+        buffer->data.resize(static_cast<size_t>(byteLength), 0);
+        ParseStringProperty(&buffer->name, err, o, "name", false);
+        ParseExtrasAndExtensions(buffer, err, o,
+                                 store_original_json_for_extras_and_extensions);
+        return true;
+      }
+    }
+  }
+
   // having an empty uri for a non embedded image should not be valid
   if (!is_binary && buffer->uri.empty()) {
     if (err) {
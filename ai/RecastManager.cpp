@@ -52,9 +52,10 @@ bool RecastManager::build(osg::Node* node, bool loadingFineLevels)
 {
     MeshCollector collector; osg::Vec2d tStart, tEnd;
     collector.setWeldingVertices(true); collector.setUseGlobalVertices(false);
-    collector.setOnlyVertexAndIndices(true);
+    collector.setOnlyVertexAndIndices(true); collector.setParallelCollecting(true);
     collector.setLoadingFineLevels(loadingFineLevels);
     if (!node) return false; else node->accept(collector);
+    collector.finishCollecting();
     if (collector.getVertices().empty()) return false;
 
     osg::BoundingBoxd worldBounds = collector.getBoundingBox();
@@ -174,7 +174,7 @@ int main(int argc, char** argv)
     if (!scene) { OSG_WARN << "Failed to load scene model" << std::endl; return 1; }
 
     // Add tangent/bi-normal arrays for normal mapping
-    osgVerse::TangentSpaceVisitor tsv; scene->accept(tsv);
+    osgVerse::TangentSpaceVisitor tsv(180.0f, true); scene->accept(tsv); tsv.generate();
     osgVerse::FixedFunctionOptimizer ffo; scene->accept(ffo);
 
     if (arguments.read("--save"))
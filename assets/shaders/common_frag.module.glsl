@@ -6,6 +6,10 @@
 #define HALF_PI 1.5707963267948966
 #endif
 
+#ifndef VERSE_TEX2D
+#define VERSE_TEX2D texture2D
+#endif
+
 ////////////////// COMMON
 
 float VERSE_smoothMin(float a, float b, float k)
@@ -56,6 +60,29 @@ vec3 VERSE_lerpHSV(vec3 hsv1, vec3 hsv2, float rate)
     return vec3(hue, mix(hsv1.yz, hsv2.yz, rate));
 }
 
+vec3 VERSE_convertYUV2RGB(vec3 yuv, bool videoRange)
+{
+    // BT.709, same coefficients as the xxYUV CPU converter for video and full ranges
+    float y = videoRange ? (yuv.x - 0.0625) * 1.1644 : yuv.x;
+    vec2 uv = yuv.yz - vec2(0.5);
+    vec4 k = videoRange ? vec4(1.7927, 0.2132, 0.5329, 2.1124)
+                        : vec4(1.5810, 0.1881, 0.4700, 1.8629);
+    return clamp(vec3(y + k.x * uv.y, y - k.y * uv.x - k.z * uv.y, y + k.w * uv.x), 0.0, 1.0);
+}
+
+vec3 VERSE_sampleNV12(sampler2D tex, vec2 uv, vec2 lumaSize, bool videoRange)
+{
+    // Packed NV12 texture: lumaSize.y rows of Y, then lumaSize.y / 2 rows of interleaved UV
+    float rows = lumaSize.y * 1.5;
+    vec2 lumaCoord = vec2(uv.x, clamp(uv.y, 0.0, 1.0 - 0.5 / lumaSize.y) / 1.5);
+    vec2 chroma = floor(clamp(uv, vec2(0.0), vec2(0.9999)) * lumaSize * 0.5);
+    float chromaRow = (lumaSize.y + chroma.y + 0.5) / rows;
+    float y = VERSE_TEX2D(tex, lumaCoord).r;
+    float u = VERSE_TEX2D(tex, vec2((chroma.x * 2.0 + 0.5) / lumaSize.x, chromaRow)).r;
+    float v = VERSE_TEX2D(tex, vec2((chroma.x * 2.0 + 1.5) / lumaSize.x, chromaRow)).r;
+    return VERSE_convertYUV2RGB(vec3(y, u, v), videoRange);
+}
+
 mat2 VERSE_rotationMatrix2D(float angle)
 {
     float s = sin(angle);
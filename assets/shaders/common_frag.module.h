@@ -6,6 +6,8 @@ vec3 VERSE_convertRGB2HSV(vec3 rgb);
 vec3 VERSE_convertHSV2RGB(vec3 hsv);
 vec3 VERSE_convertHSV2RGB_Smooth(vec3 hsv);
 vec3 VERSE_lerpHSV(vec3 hsv1, vec3 hsv2, float rate);
+vec3 VERSE_convertYUV2RGB(vec3 yuv, bool videoRange);
+vec3 VERSE_sampleNV12(sampler2D tex, vec2 uv, vec2 lumaSize, bool videoRange);
 mat2 VERSE_rotationMatrix2D(float angle);
 mat4 VERSE_rotationMatrix3D(vec3 axis0, float angle);
 vec2 VERSE_rotateVector2(vec2 v, float angle);
@@ -1,4 +1,6 @@
 VERSE_VS_IN vec4 osg_Tangent;
+VERSE_VS_IN vec4 osg_InstanceMatrix0, osg_InstanceMatrix1, osg_InstanceMatrix2, osg_InstanceMatrix3;
+uniform bool InstancedDraw;
 VERSE_SRCIPT_DEF
 #ifdef VERSE_VRMODE
 VERSE_VS_OUT vec4 texCoord0_gs, texCoord1_gs, color_gs;
@@ -10,22 +12,33 @@ VERSE_VS_OUT vec3 eyeNormal, eyeTangent, eyeBinormal;
 
 void main()
 {
+    vec4 vertex = osg_Vertex; vec3 normal = osg_Normal; vec4 tangent = osg_Tangent;
+    if (InstancedDraw)
+    {
+        mat4 instanceMatrix = mat4(osg_InstanceMatrix0, osg_InstanceMatrix1,
+                                   osg_InstanceMatrix2, osg_InstanceMatrix3);
+        mat3 instanceRotation = mat3(instanceMatrix[0].xyz, instanceMatrix[1].xyz,
+                                     instanceMatrix[2].xyz);
+        vertex = instanceMatrix * osg_Vertex; normal = instanceRotation * osg_Normal;
+        tangent.xyz = instanceRotation * osg_Tangent.xyz;
+    }
+
 #ifdef VERSE_VRMODE
-    eyeNormal_gs = normalize(VERSE_MATRIX_N * osg_Normal);
-    eyeTangent_gs = normalize(VERSE_MATRIX_N * osg_Tangent.xyz);
-    eyeBinormal_gs = normalize(VERSE_MATRIX_N * (cross(osg_Normal, osg_Tangent.xyz) * osg_Tangent.w));
+    eyeNormal_gs = normalize(VERSE_MATRIX_N * normal);
+    eyeTangent_gs = normalize(VERSE_MATRIX_N * tangent.xyz);
+    eyeBinormal_gs = normalize(VERSE_MATRIX_N * (cross(normal, tangent.xyz) * tangent.w));
     texCoord0_gs = osg_MultiTexCoord0;
     texCoord1_gs = osg_MultiTexCoord1;
     color_gs = osg_Color;
-    gl_Position = VERSE_MATRIX_MV * osg_Vertex;
+    gl_Position = VERSE_MATRIX_MV * vertex;
 #else
-    eyeNormal = normalize(VERSE_MATRIX_N * osg_Normal);
-    eyeTangent = normalize(VERSE_MATRIX_N * osg_Tangent.xyz);
-    eyeBinormal = normalize(VERSE_MATRIX_N * (cross(osg_Normal, osg_Tangent.xyz) * osg_Tangent.w));
+    eyeNormal = normalize(VERSE_MATRIX_N * normal);
+    eyeTangent = normalize(VERSE_MATRIX_N * tangent.xyz);
+    eyeBinormal = normalize(VERSE_MATRIX_N * (cross(normal, tangent.xyz) * tangent.w));
     texCoord0 = osg_MultiTexCoord0;
     texCoord1 = osg_MultiTexCoord1;
     color = osg_Color;
-    gl_Position = VERSE_MATRIX_MVP * osg_Vertex;
+    gl_Position = VERSE_MATRIX_MVP * vertex;
 #endif
     VERSE_SCRIPT_FUNC(0);
 }
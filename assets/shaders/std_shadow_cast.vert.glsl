@@ -1,3 +1,5 @@
+VERSE_VS_IN vec4 osg_InstanceMatrix0, osg_InstanceMatrix1, osg_InstanceMatrix2, osg_InstanceMatrix3;
+uniform bool InstancedDraw;
 VERSE_SRCIPT_DEF
 #ifdef VERSE_VRMODE
 VERSE_VS_OUT vec4 texCoord0_gs, lightProjVec_gs;
@@ -7,12 +9,19 @@ VERSE_VS_OUT vec4 texCoord0, lightProjVec;
 
 void main()
 {
+    vec4 vertex = osg_Vertex;
+    if (InstancedDraw)
+    {
+        vertex = mat4(osg_InstanceMatrix0, osg_InstanceMatrix1,
+                      osg_InstanceMatrix2, osg_InstanceMatrix3) * osg_Vertex;
+    }
+
 #ifdef VERSE_VRMODE
-    lightProjVec_gs = VERSE_MATRIX_MV * osg_Vertex;
+    lightProjVec_gs = VERSE_MATRIX_MV * vertex;
     texCoord0_gs = osg_MultiTexCoord0;
     gl_Position = lightProjVec_gs;
 #else
-    lightProjVec = VERSE_MATRIX_MVP * osg_Vertex;
+    lightProjVec = VERSE_MATRIX_MVP * vertex;
     texCoord0 = osg_MultiTexCoord0;
     gl_Position = lightProjVec;
 #endif
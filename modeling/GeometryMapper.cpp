@@ -24,7 +24,9 @@ public:
         osg::Matrix matrix;
         if (_matrixStack.size() > 0) matrix = _matrixStack.back();
 
-        osg::Vec3Array* va = static_cast<osg::Vec3Array*>(geom.getVertexArray());
+        osg::Vec3Array* va = dynamic_cast<osg::Vec3Array*>(geom.getVertexArray());
+        if (!va) return;  // quantized (non-float) vertices are ignored
+
         std::map<osg::StateSet*, unsigned int> stateSetCounts;
         for (size_t i = 0; i < va->size(); ++i)
         {
@@ -45,9 +47,9 @@ public:
 
             if (_colors && index < _colors->size())
             {
-                osg::Vec4Array* ca = static_cast<osg::Vec4Array*>(geom.getColorArray());
-                if (!ca)
-                {
+                osg::Vec4Array* ca = dynamic_cast<osg::Vec4Array*>(geom.getColorArray());
+                if (!ca || ca->size() != va->size())
+                {   // replace missing, non-float or overall colors
                     ca = new osg::Vec4Array(va->size());
                     geom.setColorArray(ca); geom.setColorBinding(osg::Geometry::BIND_PER_VERTEX);
                 }
@@ -56,8 +58,9 @@ public:
 
             if (_texcoords && index < _texcoords->size())
             {
-                osg::Vec2Array* ta = static_cast<osg::Vec2Array*>(geom.getTexCoordArray(0));
-                if (!ta) { ta = new osg::Vec2Array(va->size()); geom.setTexCoordArray(0, ta); }
+                osg::Vec2Array* ta = dynamic_cast<osg::Vec2Array*>(geom.getTexCoordArray(0));
+                if (!ta || ta->size() != va->size())
+                { ta = new osg::Vec2Array(va->size()); geom.setTexCoordArray(0, ta); }
                 (*ta)[i] = osg::Vec2((*_texcoords)[index].x(), (*_texcoords)[index].y());
             }
         }
@@ -7,6 +7,8 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <algorithm>
+#include <set>
 #include "GeometryMerger.h"
 #include "Utilities.h"
 #include "Octree.h"
@@ -79,8 +81,10 @@ static void addOctreeNodeToGeometry(const BoundsOctreeNode<GeometryMergeData>& n
         addOctreeNodeToGeometry(children[i], va, ca, de);
 }
 
+typedef std::pair<osg::Geode*, const BoundsOctreeNode<GeometryMergeData>*> OctreeMergeJob;
 static void applyOctreeNode(GeometryMerger* merger, osg::Group* group,
-                            const BoundsOctreeNode<GeometryMergeData>& node)
+                            const BoundsOctreeNode<GeometryMergeData>& node,
+                            std::vector<OctreeMergeJob>& jobs)
 {
     const std::vector<BoundsOctreeNode<GeometryMergeData>>& children = node.getChildren();
     osg::ref_ptr<osg::Group> fineGroup = new osg::Group;
@@ -92,50 +96,92 @@ static void applyOctreeNode(GeometryMerger* merger, osg::Group* group,
             osg::ref_ptr<osg::LOD> childLOD = new osg::LOD;
             childLOD->setCenterMode(osg::LOD::UNION_OF_BOUNDING_SPHERE_AND_USER_DEFINED);
             childLOD->setCenter(child.center); childLOD->setRadius(child.baseLength * 0.5);
-            applyOctreeNode(merger, childLOD.get(), child);
+            applyOctreeNode(merger, childLOD.get(), child, jobs);
             fineGroup->addChild(childLOD.get());
             
         }
         else if (child.hasAnyObjects())
         {
             osg::ref_ptr<osg::Group> childGroup = new osg::Group;
-            applyOctreeNode(merger, childGroup.get(), child);
+            applyOctreeNode(merger, childGroup.get(), child, jobs);
             fineGroup->addChild(childGroup.get());
         }
     }
 
-    // Create rough level child
-    std::vector<BoundsOctreeNode<GeometryMergeData>::OctreeObject> objects = node.getObjects();
+    // Create rough level child, which will be merged later with other cells concurrently
     osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-    if (!objects.empty())
-    {
-        std::vector<GeometryMerger::GeometryPair> geomList;
-        for (size_t i = 0; i < objects.size(); ++i) geomList.push_back(
-            GeometryMerger::GeometryPair(objects[i].object->geometry, objects[i].object->matrix));
-        osg::ref_ptr<osg::Geometry> roughGeom = merger->process(geomList, 0);
-        geode->addDrawable(roughGeom.get());
-
-        if (merger->getSimplifierRatio() > 0.0f)
-        {
-            osgUtil::Simplifier simplifier(merger->getSimplifierRatio());
-            geode->accept(simplifier);
-        }
-    }
+    bool hasObjects = !node.getObjects().empty();
+    if (hasObjects) jobs.push_back(OctreeMergeJob(geode.get(), &node));
 
     // Add LOD/group children
     osg::LOD* lodGroup = dynamic_cast<osg::LOD*>(group);
     if (lodGroup)
     {
-        if (geode->getNumDrawables() > 0) lodGroup->addChild(geode.get(), 0.0f, FLT_MAX);
+        if (hasObjects) lodGroup->addChild(geode.get(), 0.0f, FLT_MAX);
         lodGroup->addChild(fineGroup.get(), 0.0f, node.baseLength * 5.0f);
     }
     else
     {
-        if (geode->getNumDrawables() > 0) group->addChild(geode.get());
+        if (hasObjects) group->addChild(geode.get());
         if (fineGroup->getNumChildren() > 0) group->addChild(fineGroup.get());
     }
 }
 
+/** Geometries of a rough octree cell, with atlas and texture coordinate remapping (x0, y0, w, h)
+    of each geometry; source texcoord arrays are not changed, as they may be shared by cells */
+struct OctreeMergeData
+{
+    std::vector<GeometryMerger::GeometryPair> geomList;
+    std::vector<osg::Vec4> texRemaps;
+    osg::ref_ptr<osg::Image> atlas;
+};
+
+static void applyAtlasTexture(osg::Geometry* geom, osg::Image* atlas)
+{
+    osg::ref_ptr<osg::Texture2D> tex2D = new osg::Texture2D;
+    tex2D->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR_MIPMAP_LINEAR);
+    tex2D->setFilter(osg::Texture2D::MAG_FILTER, osg::Texture2D::LINEAR);
+    tex2D->setResizeNonPowerOfTwoHint(true); tex2D->setImage(atlas);
+    geom->getOrCreateStateSet()->setTextureAttributeAndModes(0, tex2D.get());
+}
+
+static inline osg::Vec2 remapTexCoord(const osg::Vec2& t, const osg::Vec4& r)
+{ return osg::Vec2(t[0] * r[2] + r[0], t[1] * r[3] + r[1]); }
+
+static void transformVertices(const osg::Vec3Array& src, osg::Vec3* dst, const osg::Matrix& m)
+{
+    size_t num = src.size(); if (num == 0) return;
+    if (m.isIdentity()) { memcpy(dst, &src[0], sizeof(osg::Vec3) * num); return; }
+    if (m(0, 3) != 0.0 || m(1, 3) != 0.0 || m(2, 3) != 0.0 || m(3, 3) != 1.0)
+    {   // Projective matrix: keep the homogeneous division of osg::Vec3 * osg::Matrix
+        for (size_t i = 0; i < num; ++i) dst[i] = src[i] * m;
+        return;
+    }
+
+    // Affine matrix in float rows, so the loop can be vectorized by compiler
+    const float m00 = m(0, 0), m01 = m(0, 1), m02 = m(0, 2), m10 = m(1, 0), m11 = m(1, 1),
+                m12 = m(1, 2), m20 = m(2, 0), m21 = m(2, 1), m22 = m(2, 2);
+    const float m30 = m(3, 0), m31 = m(3, 1), m32 = m(3, 2);
+    const float* in = src[0].ptr(); float* out = dst[0].ptr();
+    for (size_t i = 0; i < num; ++i, in += 3, out += 3)
+    {
+        float x = in[0], y = in[1], z = in[2];
+        out[0] = x * m00 + y * m10 + z * m20 + m30;
+        out[1] = x * m01 + y * m11 + z * m21 + m31;
+        out[2] = x * m02 + y * m12 + z * m22 + m32;
+    }
+}
+
+struct CollectTrianglesOperator
+{
+    void operator()(unsigned int i1, unsigned int i2, unsigned int i3)
+    {
+        if (i1 == i2 || i2 == i3 || i1 == i3) return;
+        indices.push_back(i1); indices.push_back(i2); indices.push_back(i3);
+    }
+    std::vector<unsigned int> indices;
+};
+
 struct ResetTrianglesOperator
 {
     ResetTrianglesOperator() : _start(0), _count(0) {}
@@ -172,6 +218,27 @@ osg::Image* GeometryMerger::processAtlas(const std::vector<GeometryPair>& geomLi
     if (size == 0) size = geomList.size() - offset;
     if (geomList.empty()) return NULL;
 
+    // Recompute texture coords
+    size_t end = osg::minimum(offset + size, geomList.size()); std::vector<osg::Vec4> texRemaps;
+    osg::ref_ptr<osg::Image> atlas = createAtlas(geomList, offset, end, maxTextureSize, texRemaps);
+    if (atlas.valid())
+    {
+        for (size_t i = offset; i < end; ++i)
+        {
+            osg::Vec2Array* ta = dynamic_cast<osg::Vec2Array*>(geomList[i].first->getTexCoordArray(0));
+            const osg::Vec4& remap = texRemaps[i - offset]; if (!ta) continue;
+            for (size_t j = 0; j < ta->size(); ++j) (*ta)[j] = remapTexCoord((*ta)[j], remap);
+        }
+    }
+    return atlas.release();
+}
+
+osg::Image* GeometryMerger::createAtlas(const std::vector<GeometryPair>& geomList,
+                                        size_t offset, size_t end, int maxTextureSize,
+                                        std::vector<osg::Vec4>& texRemaps)
+{
+    texRemaps.assign(end > offset ? end - offset : 0, osg::Vec4(0.0f, 0.0f, 1.0f, 1.0f));
+
     // Collect textures and make atlas
     osg::ref_ptr<TexturePacker> packer = new TexturePacker(4096, 4096);
     std::vector<osg::ref_ptr<osg::Image>> images;
@@ -179,7 +246,6 @@ osg::Image* GeometryMerger::processAtlas(const std::vector<GeometryPair>& geomLi
 
     std::map<size_t, size_t> geometryIdMap;
     std::string imageName; int atlasW = 0, atlasH = 0;
-    size_t end = osg::minimum(offset + size, geomList.size());
     for (size_t i = offset; i < end; ++i)
     {
         osg::StateSet* ss = geomList[i].first->getStateSet();
@@ -203,24 +269,14 @@ osg::Image* GeometryMerger::processAtlas(const std::vector<GeometryPair>& geomLi
         packer.get(), imageName + "_all." + ext, maxTextureSize, atlasW, atlasH);
     if (atlas.valid())
     {
-        // Recompute texture coords
         float totalW = (float)atlasW, totalH = (float)atlasH;
-        for (size_t i = offset; i < end; ++i)
+        for (std::map<size_t, size_t>::iterator itr = geometryIdMap.begin();
+             itr != geometryIdMap.end(); ++itr)
         {
-            osg::Geometry* geom = geomList[i].first;
-            osg::Vec2Array* ta = static_cast<osg::Vec2Array*>(geom->getTexCoordArray(0));
-            if (!ta || geometryIdMap.find(i) == geometryIdMap.end()) continue;
-
             int x = 0, y = 0, w = 0, h = 0;
-            if (!packer->getPackingData(geometryIdMap[i], x, y, w, h)) continue;
-
-            float tx0 = (float)x / totalW, tw = (float)w / totalW;
-            float ty0 = (float)y / totalH, th = (float)h / totalH;
-            for (size_t j = 0; j < ta->size(); ++j)
-            {
-                const osg::Vec2& t = (*ta)[j];
-                (*ta)[j] = osg::Vec2(t[0] * tw + tx0, t[1] * th + ty0);
-            }
+            if (!packer->getPackingData(itr->second, x, y, w, h)) continue;
+            texRemaps[itr->first - offset] = osg::Vec4((float)x / totalW, (float)y / totalH,
+                                                       (float)w / totalW, (float)h / totalH);
         }
     }
     return atlas.release();
@@ -244,15 +300,114 @@ osg::Geometry* GeometryMerger::process(const std::vector<GeometryPair>& geomList
         resultGeom = createCombined(geomList, offset, end); break;
     }
 
-    if (resultGeom.valid() && atlas.valid())
+    if (resultGeom.valid() && atlas.valid()) applyAtlasTexture(resultGeom.get(), atlas.get());
+    return resultGeom.release();
+}
+
+std::vector<osg::ref_ptr<osg::Geometry>> GeometryMerger::processPages(
+        const std::vector<GeometryPair>& geomList, size_t offset, size_t size, int maxTextureSize)
+{
+    std::vector<osg::ref_ptr<osg::Geometry>> resultList;
+    if (size == 0) size = geomList.size() - offset;
+    size_t end = osg::minimum(offset + size, geomList.size());
+    if (_method == GPU_BAKING)
+    {
+        osg::ref_ptr<osg::Geometry> geom = process(geomList, offset, size, maxTextureSize);
+        if (geom.valid()) resultList.push_back(geom);
+        return resultList;
+    }
+
+    // Collect textures (shared images are packed only once)
+    osg::ref_ptr<TexturePacker> packer = new TexturePacker(maxTextureSize, maxTextureSize);
+    packer->setPadding(2, true); packer->setAllowRotation(true);
+    std::map<osg::Image*, size_t> imageIdMap; std::map<size_t, size_t> geometryIdMap;
+    for (size_t i = offset; i < end; ++i)
+    {
+        osg::StateSet* ss = geomList[i].first->getStateSet();
+        if (!ss) continue; else if (ss->getNumTextureAttributeLists() == 0) continue;
+
+        osg::Texture2D* tex = dynamic_cast<osg::Texture2D*>(
+            ss->getTextureAttribute(0, osg::StateAttribute::TEXTURE));
+        if (!tex || !tex->getImage()) continue;
+
+        osg::Image* image = tex->getImage();
+        if (imageIdMap.find(image) == imageIdMap.end())
+            imageIdMap[image] = packer->addElement(image);
+        geometryIdMap[i] = imageIdMap[image];
+    }
+
+    size_t numImages = 0;
+    std::vector<osg::ref_ptr<osg::Image>> pages = packer->packPages(numImages, true);
+    std::vector<std::string> pageNames(pages.size());
+
+    // Group geometries by pages and recompute their texture coords. Untextured geometries are
+    // merged together (key = -1), and ones failed to pack are kept alone with own textures
+    std::map<int, std::vector<GeometryPair>> pageGeometries;
+    std::set<osg::Geometry*> remappedGeometries; std::set<size_t> namedElements;
+    for (size_t i = offset; i < end; ++i)
+    {
+        osg::Geometry* geom = geomList[i].first; int key = -1;
+        std::map<size_t, size_t>::iterator itr = geometryIdMap.find(i);
+        if (itr != geometryIdMap.end())
+        {
+            int page = 0, x = 0, y = 0, w = 0, h = 0; bool rotated = false;
+            if (!packer->getPackingData(itr->second, page, x, y, w, h, rotated) ||
+                page >= (int)pages.size() || !pages[page])
+            { pageGeometries[-2 - (int)i].push_back(geomList[i]); continue; }
+
+            osg::Vec2Array* ta = dynamic_cast<osg::Vec2Array*>(geom->getTexCoordArray(0));
+            if (ta && remappedGeometries.find(geom) == remappedGeometries.end())
+            {
+                // A texcoord array shared with other geometries must not be remapped twice
+                if (ta->referenceCount() > 1)
+                {
+                    ta = osg::clone(ta, osg::CopyOp::DEEP_COPY_ALL);
+                    geom->setTexCoordArray(0, ta);
+                }
+
+                float totalW = (float)pages[page]->s(), totalH = (float)pages[page]->t();
+                float tx0 = (float)x / totalW, tw = (float)w / totalW;
+                float ty0 = (float)y / totalH, th = (float)h / totalH;
+                for (size_t j = 0; j < ta->size(); ++j)
+                {
+                    const osg::Vec2 t = (*ta)[j];
+                    if (rotated) (*ta)[j] = osg::Vec2(t[1] * tw + tx0, t[0] * th + ty0);
+                    else (*ta)[j] = osg::Vec2(t[0] * tw + tx0, t[1] * th + ty0);
+                }
+                remappedGeometries.insert(geom);
+            }
+
+            if (namedElements.insert(itr->second).second)
+            {
+                osg::Texture2D* tex = static_cast<osg::Texture2D*>(geom->getStateSet()
+                                    ->getTextureAttribute(0, osg::StateAttribute::TEXTURE));
+                pageNames[page] += osgDB::getStrippedName(tex->getImage()->getFileName()) + ",";
+            }
+            key = page;
+        }
+        pageGeometries[key].push_back(geomList[i]);
+    }
+
+    for (std::map<int, std::vector<GeometryPair>>::iterator itr = pageGeometries.begin();
+         itr != pageGeometries.end(); ++itr)
     {
+        std::vector<GeometryPair>& list = itr->second;
+        osg::ref_ptr<osg::Geometry> resultGeom = (_method == INDIRECT_COMMANDS)
+                                               ? createIndirect(list, 0, list.size())
+                                               : createCombined(list, 0, list.size());
+        if (!resultGeom) continue; else resultList.push_back(resultGeom);
+        if (itr->first < 0) continue;
+
+        osg::Image* atlas = pages[itr->first].get();
+        atlas->setFileName(pageNames[itr->first] + "_page" + std::to_string(itr->first) + ".jpg");
+
         osg::ref_ptr<osg::Texture2D> tex2D = new osg::Texture2D;
         tex2D->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR_MIPMAP_LINEAR);
         tex2D->setFilter(osg::Texture2D::MAG_FILTER, osg::Texture2D::LINEAR);
-        tex2D->setResizeNonPowerOfTwoHint(true); tex2D->setImage(atlas.get());
+        tex2D->setResizeNonPowerOfTwoHint(true); tex2D->setImage(atlas);
         resultGeom->getOrCreateStateSet()->setTextureAttributeAndModes(0, tex2D.get());
     }
-    return resultGeom.release();
+    return resultList;
 }
 
 osg::Node* GeometryMerger::processAsOctree(const std::vector<GeometryPair>& geomList,
@@ -301,7 +456,45 @@ osg::Node* GeometryMerger::processAsOctree(const std::vector<GeometryPair>& geom
     root->setCenterMode(osg::LOD::UNION_OF_BOUNDING_SPHERE_AND_USER_DEFINED);
     root->setCenter(octree.getRoot().center);
     root->setRadius(octree.getRoot().baseLength * 0.5);
-    applyOctreeNode(this, root.get(), octree.getRoot());
+
+    std::vector<OctreeMergeJob> jobs;
+    applyOctreeNode(this, root.get(), octree.getRoot(), jobs);
+
+    // Cells may share images and texcoord arrays, so their atlases are made one by one first
+    int numJobs = (int)jobs.size(); std::vector<OctreeMergeData> mergeData(numJobs);
+    for (int i = 0; i < numJobs; ++i)
+    {
+        const std::vector<BoundsOctreeNode<GeometryMergeData>::OctreeObject>& objects =
+            jobs[i].second->getObjects();
+        OctreeMergeData& md = mergeData[i]; md.geomList.resize(objects.size());
+        for (size_t j = 0; j < objects.size(); ++j) md.geomList[j] =
+            GeometryPair(objects[j].object->geometry, objects[j].object->matrix);
+        if (_method != GPU_BAKING)
+            md.atlas = createAtlas(md.geomList, 0, md.geomList.size(), 4096, md.texRemaps);
+    }
+
+    // Then merge rough level of cells concurrently (GPU baking is kept in one thread)
+#pragma omp parallel for schedule(dynamic, 1) if (_method != GPU_BAKING)
+    for (int i = 0; i < numJobs; ++i)
+    {
+        OctreeMergeData& md = mergeData[i]; osg::ref_ptr<osg::Geometry> roughGeom;
+        if (_method == GPU_BAKING) roughGeom = process(md.geomList, 0);
+        else
+        {
+            roughGeom = (_method == INDIRECT_COMMANDS)
+                      ? createIndirect(md.geomList, 0, md.geomList.size(), &md.texRemaps)
+                      : createCombined(md.geomList, 0, md.geomList.size(), &md.texRemaps);
+            if (roughGeom.valid() && md.atlas.valid())
+                applyAtlasTexture(roughGeom.get(), md.atlas.get());
+        }
+
+        if (roughGeom.valid()) jobs[i].first->addDrawable(roughGeom.get());
+        if (_autoSimplifierRatio > 0.0f)
+        {
+            osgUtil::Simplifier simplifier(_autoSimplifierRatio);
+            jobs[i].first->accept(simplifier);
+        }
+    }
 
     osg::ref_ptr<osg::Image> atlas = processAtlas(geomList, offset, size, maxTextureSize);
     if (root.valid() && atlas.valid())
@@ -316,71 +509,112 @@ osg::Node* GeometryMerger::processAsOctree(const std::vector<GeometryPair>& geom
 }
 
 osg::Geometry* GeometryMerger::createCombined(const std::vector<GeometryPair>& geomList,
-                                              size_t offset, size_t end)
+                                              size_t offset, size_t end,
+                                              const std::vector<osg::Vec4>* texRemaps)
 {
-    osg::ref_ptr<osg::Vec3Array> vaAll = new osg::Vec3Array;
-    osg::ref_ptr<osg::Vec3Array> naAll = new osg::Vec3Array;
-    osg::ref_ptr<osg::Vec4Array> caAll = new osg::Vec4Array;
-    osg::ref_ptr<osg::Vec2Array> taAll = new osg::Vec2Array;
-    osg::ref_ptr<osg::DrawElementsUInt> de = new osg::DrawElementsUInt(GL_TRIANGLES);
+    struct CombinedRange
+    {
+        osg::Vec3Array *va, *na; osg::Vec4Array* ca; osg::Vec2Array* ta;
+        std::vector<unsigned int> indices; size_t vStart, iStart;
+    };
+
+    // Collect triangles of each geometry, then compute exact output sizes
+    int numGeometries = (end > offset) ? (int)(end - offset) : 0;
+    std::vector<CombinedRange> ranges(numGeometries);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < numGeometries; ++i)
+    {
+        osg::Geometry* geom = geomList[offset + i].first; CombinedRange& r = ranges[i];
+        r.va = dynamic_cast<osg::Vec3Array*>(geom->getVertexArray());
+        r.na = dynamic_cast<osg::Vec3Array*>(geom->getNormalArray());
+        r.ca = dynamic_cast<osg::Vec4Array*>(geom->getColorArray());
+        r.ta = dynamic_cast<osg::Vec2Array*>(geom->getTexCoordArray(0));
+        if (!r.va || geom->getNumPrimitiveSets() == 0) { r.va = NULL; continue; }
+
+        osg::TriangleIndexFunctor<CollectTrianglesOperator> functor;
+        geom->accept(functor); r.indices.swap(functor.indices);
+    }
 
     osg::ref_ptr<osg::Geometry> resultGeom = new osg::Geometry;
-    for (size_t i = offset; i < end; ++i)
+    size_t numVertices = 0, numIndices = 0;
+    bool hasNormals = true, hasColors = true, hasTexCoords = true;
+    for (int i = 0; i < numGeometries; ++i)
     {
-        osg::Geometry* geom = geomList[i].first;
-        osg::Vec3Array* va = static_cast<osg::Vec3Array*>(geom->getVertexArray());
-        osg::Vec3Array* na = static_cast<osg::Vec3Array*>(geom->getNormalArray());
-        osg::Vec4Array* ca = static_cast<osg::Vec4Array*>(geom->getColorArray());
-        osg::Vec2Array* ta = static_cast<osg::Vec2Array*>(geom->getTexCoordArray(0));
-        if (!va || geom->getNumPrimitiveSets() == 0) continue;
-
+        CombinedRange& r = ranges[i]; if (!r.va) continue;
+        osg::Geometry* geom = geomList[offset + i].first;
         if (!resultGeom->getStateSet() && geom->getStateSet() != NULL)
         {
             resultGeom->setStateSet(static_cast<osg::StateSet*>(
                 geom->getStateSet()->clone(osg::CopyOp::DEEP_COPY_ALL)));
         }
 
-        osg::TriangleIndexFunctor<ResetTrianglesOperator> functor;
-        functor._de = de.get(); functor._start = vaAll->size();
-        geom->accept(functor);
+        r.vStart = numVertices; r.iStart = numIndices;
+        numVertices += r.va->size(); numIndices += r.indices.size();
+        if (!r.na || r.na->empty()) hasNormals = false;
+        if ((!r.ca || r.ca->empty()) && !_forceColorArray) hasColors = false;
+        if (!r.ta || r.ta->size() < r.va->size()) hasTexCoords = false;
+    }
 
-        osg::Matrix matrix = geomList[i].second; size_t vS = va->size();
-        for (size_t v = 0; v < va->size(); ++v) vaAll->push_back((*va)[v] * matrix);
-        if (ta) taAll->insert(taAll->end(), ta->begin(), ta->end());
-        if (na)
+    osg::ref_ptr<osg::Vec3Array> vaAll = new osg::Vec3Array(numVertices);
+    osg::ref_ptr<osg::Vec3Array> naAll = new osg::Vec3Array(hasNormals ? numVertices : 0);
+    osg::ref_ptr<osg::Vec4Array> caAll = new osg::Vec4Array(hasColors ? numVertices : 0);
+    osg::ref_ptr<osg::Vec2Array> taAll = new osg::Vec2Array(hasTexCoords ? numVertices : 0);
+    osg::ref_ptr<osg::DrawElementsUInt> de = new osg::DrawElementsUInt(GL_TRIANGLES, numIndices);
+
+    // Transform and copy attribute ranges, and rebase indices of each geometry
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < numGeometries; ++i)
+    {
+        const CombinedRange& r = ranges[i]; if (!r.va || r.va->empty()) continue;
+        size_t vS = r.va->size(), vStart = r.vStart;
+        transformVertices(*r.va, &(*vaAll)[vStart], geomList[offset + i].second);
+        if (hasTexCoords && texRemaps != NULL)
         {
-            if (na->size() < vS) naAll->insert(naAll->end(), vS, na->front());
-            else naAll->insert(naAll->end(), na->begin(), na->end());
+            const osg::Vec4& remap = (*texRemaps)[i];
+            for (size_t v = 0; v < vS; ++v) (*taAll)[vStart + v] = remapTexCoord((*r.ta)[v], remap);
         }
-        if (ca)
+        else if (hasTexCoords) memcpy(&(*taAll)[vStart], &(*r.ta)[0], sizeof(osg::Vec2) * vS);
+        if (hasNormals)
         {
-            if (ca->size() < vS) caAll->insert(caAll->end(), vS, ca->front());
-            else caAll->insert(caAll->end(), ca->begin(), ca->end());
+            osg::Vec3Array::iterator itr = naAll->begin() + vStart;
+            if (r.na->size() < vS) std::fill(itr, itr + vS, r.na->front());
+            else memcpy(&(*naAll)[vStart], &(*r.na)[0], sizeof(osg::Vec3) * vS);
         }
-        else if (_forceColorArray)
-            caAll->insert(caAll->end(), vS, osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        if (hasColors)
+        {
+            osg::Vec4Array::iterator itr = caAll->begin() + vStart;
+            if (r.ca && r.ca->size() >= vS)
+                memcpy(&(*caAll)[vStart], &(*r.ca)[0], sizeof(osg::Vec4) * vS);
+            else if (r.ca && !r.ca->empty()) std::fill(itr, itr + vS, r.ca->front());
+            else std::fill(itr, itr + vS, osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        }
+
+        if (r.indices.empty()) continue;
+        unsigned int base = (unsigned int)vStart; GLuint* dst = &(*de)[r.iStart];
+        for (size_t n = 0; n < r.indices.size(); ++n) dst[n] = r.indices[n] + base;
     }
 
     resultGeom->setUseDisplayList(false);
     resultGeom->setUseVertexBufferObjects(true);
     resultGeom->setVertexArray(vaAll.get());
-    if (naAll->size() == vaAll->size())
+    if (hasNormals && !naAll->empty())
     {
         resultGeom->setNormalArray(naAll.get());
         resultGeom->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
     }
-    if (caAll->size() == vaAll->size())
+    if (hasColors && !caAll->empty())
     {
         resultGeom->setColorArray(caAll.get());
         resultGeom->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
     }
-    if (taAll->size() == vaAll->size()) resultGeom->setTexCoordArray(0, taAll.get());
+    if (hasTexCoords && !taAll->empty()) resultGeom->setTexCoordArray(0, taAll.get());
     resultGeom->addPrimitiveSet(de.get());
     return resultGeom.release();
 }
 
 osg::Geometry* GeometryMerger::createIndirect(const std::vector<GeometryPair>& geomList,
-                                              size_t offset, size_t end)
+                                              size_t offset, size_t end,
+                                              const std::vector<osg::Vec4>* texRemaps)
 {
 #if OSG_VERSION_GREATER_THAN(3, 4, 1)
     osg::ref_ptr<osg::Vec3Array> vaAll = new osg::Vec3Array;
@@ -395,10 +629,11 @@ osg::Geometry* GeometryMerger::createIndirect(const std::vector<GeometryPair>& g
     for (size_t i = offset; i < end; ++i)
     {
         osg::Geometry* geom = geomList[i].first;
-        osg::Vec3Array* va = static_cast<osg::Vec3Array*>(geom->getVertexArray());
-        osg::Vec3Array* na = static_cast<osg::Vec3Array*>(geom->getNormalArray());
-        osg::Vec4Array* ca = static_cast<osg::Vec4Array*>(geom->getColorArray());
-        osg::Vec2Array* ta = static_cast<osg::Vec2Array*>(geom->getTexCoordArray(0));
+        // Quantized (non-float) arrays are not supported and will be ignored
+        osg::Vec3Array* va = dynamic_cast<osg::Vec3Array*>(geom->getVertexArray());
+        osg::Vec3Array* na = dynamic_cast<osg::Vec3Array*>(geom->getNormalArray());
+        osg::Vec4Array* ca = dynamic_cast<osg::Vec4Array*>(geom->getColorArray());
+        osg::Vec2Array* ta = dynamic_cast<osg::Vec2Array*>(geom->getTexCoordArray(0));
         if (!va || geom->getNumPrimitiveSets() == 0) continue;
 
         osg::ref_ptr<osg::UserDataContainer> udc = geom->getUserDataContainer();
@@ -427,7 +662,12 @@ osg::Geometry* GeometryMerger::createIndirect(const std::vector<GeometryPair>& g
             bbox.expandBy(vaAll->back());
         }
 
-        if (ta) taAll->insert(taAll->end(), ta->begin(), ta->end());
+        if (ta && texRemaps != NULL)
+        {
+            const osg::Vec4& remap = (*texRemaps)[i - offset];
+            for (size_t v = 0; v < ta->size(); ++v) taAll->push_back(remapTexCoord((*ta)[v], remap));
+        }
+        else if (ta) taAll->insert(taAll->end(), ta->begin(), ta->end());
         if (na)
         {
             if (na->size() < vS) naAll->insert(naAll->end(), vS, na->front());
@@ -53,14 +53,24 @@ namespace osgVerse
         osg::Image* processAtlas(const std::vector<GeometryPair>& geomList, size_t offset,
                                  size_t size = 0, int maxTextureSize = 4096);
 
+        /** Merge geometries into one geometry per atlas page, so that textures exceeding
+            the max atlas size are still batched instead of failing the whole atlas */
+        std::vector<osg::ref_ptr<osg::Geometry>> processPages(
+            const std::vector<GeometryPair>& geomList, size_t offset,
+            size_t size = 0, int maxTextureSize = 4096);
+
     protected:
-        osg::Geometry* createCombined(const std::vector<GeometryPair>& geomList,
-                                      size_t offset, size_t end);
-        osg::Geometry* createIndirect(const std::vector<GeometryPair>& geomList,
-                                      size_t offset, size_t end);
+        /** Texture coordinates are remapped with (x0, y0, w, h) of each geometry if specified */
+        osg::Geometry* createCombined(const std::vector<GeometryPair>& geomList, size_t offset,
+                                      size_t end, const std::vector<osg::Vec4>* texRemaps = NULL);
+        osg::Geometry* createIndirect(const std::vector<GeometryPair>& geomList, size_t offset,
+                                      size_t end, const std::vector<osg::Vec4>* texRemaps = NULL);
         osg::Geometry* createGpuBaking(const std::vector<GeometryPair>& geomList,
                                        size_t offset, size_t end);
 
+        /** Make atlas of [offset, end) geometries, and output their texture coordinate remappings */
+        osg::Image* createAtlas(const std::vector<GeometryPair>& geomList, size_t offset, size_t end,
+                                int maxTextureSize, std::vector<osg::Vec4>& texRemaps);
         osg::Image* createTextureAtlas(TexturePacker* packer, const std::string& fileName,
                                        int maxTextureSize, int& originW, int& originH);
 
@@ -496,6 +496,271 @@ osg::Matrix Coordinate::convertLLAtoNED(const osg::Vec3d& lla, const WGS84& wgs8
     m.setTrans(convertLLAtoECEF(lla, wgs84)); return m;
 }
 
+/* Coordinate: batch conversions */
+
+namespace
+{
+    struct CGCS2000Params
+    { double r[9], t[3], k; bool inverse; };
+
+    struct UTMParams
+    { const Coordinate::UTM* utm; const Coordinate::WGS84* wgs84; };
+
+    // Same as UTM::clenshaw() and UTM::clenshaw2(), with trigonometric values computed once
+    inline double clenshawTrig(const double* a, int size, double sinR, double cosR)
+    {
+        const double* p; double hr, hr1, hr2;
+        for (p = a + size, hr2 = 0., hr1 = *(--p), hr = 0.; a - p;
+             hr2 = hr1, hr1 = hr) { hr = -hr2 + (2. * hr1 * cosR) + *(--p); }
+        return sinR * hr;
+    }
+
+    inline double clenshaw2Trig(const double* a, int size, double sinR, double cosR,
+                                double sinhI, double coshI, double& R, double& I)
+    {
+        const double* p; double hr, hr1, hr2, hi, hi1, hi2;
+        for (p = a + size, hr2 = 0., hi2 = 0., hi1 = 0., hr1 = *(--p), hi1 = 0.,
+             hr = 0., hi = 0.; a - p; hr2 = hr1, hi2 = hi1, hr1 = hr, hi1 = hi)
+        {
+            hr = -hr2 + (2. * hr1 * cosR * coshI) - (-2. * hi1 * sinR * sinhI) + *(--p);
+            hi = -hi2 + (-2. * hr1 * sinR * sinhI) + (2. * hi1 * cosR * coshI);
+        }
+        R = (sinR * coshI * hr) - (cosR * sinhI * hi);
+        I = (sinR * coshI * hi) + (cosR * sinhI * hr);
+        return R;
+    }
+
+    template<typename T>
+    void kernelLLAtoECEF(const T* in, T* out, size_t num, const Coordinate::WGS84& wgs84)
+    {
+        const double radius = wgs84.radiusEquator, e2 = wgs84.eccentricitySq;
+        for (size_t i = 0; i < num; ++i)
+        {
+            const double latitude = in[i * 3], longitude = in[i * 3 + 1], height = in[i * 3 + 2];
+            double sin_latitude = sin(latitude), cos_latitude = cos(latitude);
+            double N = radius / sqrt(1.0 - e2 * sin_latitude * sin_latitude);
+            out[i * 3 + 0] = (T)((N + height) * cos_latitude * cos(longitude));
+            out[i * 3 + 1] = (T)((N + height) * cos_latitude * sin(longitude));
+            out[i * 3 + 2] = (T)((N * (1 - e2) + height) * sin_latitude);
+        }
+    }
+
+    template<typename T>
+    void kernelECEFtoLLA(const T* in, T* out, size_t num, const Coordinate::WGS84& wgs84)
+    {
+        const double re = wgs84.radiusEquator, rp = wgs84.radiusPolar, e2 = wgs84.eccentricitySq;
+        const double eDashSquared = (re * re - rp * rp) / (rp * rp);
+        for (size_t i = 0; i < num; ++i)
+        {
+            const double x = in[i * 3], y = in[i * 3 + 1], z = in[i * 3 + 2];
+            if (x == 0.0 && y == 0.0)
+            {   // Rare cases at poles or center of the earth
+                osg::Vec3d lla = Coordinate::convertECEFtoLLA(osg::Vec3d(x, y, z), wgs84);
+                out[i * 3] = (T)lla[0]; out[i * 3 + 1] = (T)lla[1]; out[i * 3 + 2] = (T)lla[2];
+                continue;
+            }
+
+            double longitude = (x != 0.0) ? atan2(y, x) : (y > 0.0 ? osg::PI_2 : -osg::PI_2);
+            double p = sqrt(x * x + y * y), theta = atan2(z * re, (p * rp));
+            double sin_theta = sin(theta), cos_theta = cos(theta);
+            double latitude = atan((z + eDashSquared * rp * sin_theta * sin_theta * sin_theta) /
+                                   (p - e2 * re * cos_theta * cos_theta * cos_theta));
+
+            double sin_latitude = sin(latitude);
+            double N = re / sqrt(1.0 - e2 * sin_latitude * sin_latitude);
+            out[i * 3 + 0] = (T)latitude; out[i * 3 + 1] = (T)longitude;
+            out[i * 3 + 2] = (T)(p / cos(latitude) - N);
+        }
+    }
+
+    template<typename T>
+    void kernelCGCS2000(const T* in, T* out, size_t num, const CGCS2000Params& c2k)
+    {
+        const double* r = c2k.r;
+        for (size_t i = 0; i < num; ++i)
+        {
+            const double x = in[i * 3], y = in[i * 3 + 1], z = in[i * 3 + 2];
+            double x_rot, y_rot, z_rot;
+            if (c2k.inverse)
+            {
+                x_rot = r[0] * x + r[3] * y + r[6] * z;
+                y_rot = r[1] * x + r[4] * y + r[7] * z;
+                z_rot = r[2] * x + r[5] * y + r[8] * z;
+            }
+            else
+            {
+                x_rot = r[0] * x + r[1] * y + r[2] * z;
+                y_rot = r[3] * x + r[4] * y + r[5] * z;
+                z_rot = r[6] * x + r[7] * y + r[8] * z;
+            }
+            out[i * 3 + 0] = (T)(c2k.k * x_rot + c2k.t[0]);
+            out[i * 3 + 1] = (T)(c2k.k * y_rot + c2k.t[1]);
+            out[i * 3 + 2] = (T)(c2k.k * z_rot + c2k.t[2]);
+        }
+    }
+
+    template<typename T>
+    void kernelLLAtoWebMercator(const T* in, T* out, size_t num, const Coordinate::WGS84& wgs84)
+    {
+        const double norm = wgs84.radiusEquator * 1.0;
+        for (size_t i = 0; i < num; ++i)
+        {
+            const double lat = in[i * 3], lon = in[i * 3 + 1];
+            out[i * 3 + 0] = (T)(std::log(std::tan(osg::PI_4 + lat / 2.0)) * norm);
+            out[i * 3 + 1] = (T)(lon * norm); out[i * 3 + 2] = in[i * 3 + 2];
+        }
+    }
+
+    template<typename T>
+    void kernelWebMercatorToLLA(const T* in, T* out, size_t num, const Coordinate::WGS84& wgs84)
+    {
+        const double norm = wgs84.radiusEquator * 1.0;
+        for (size_t i = 0; i < num; ++i)
+        {
+            const double y = in[i * 3], x = in[i * 3 + 1];
+            out[i * 3 + 0] = (T)(2.0 * std::atan(std::exp(y / norm)) - osg::PI_2);
+            out[i * 3 + 1] = (T)(x / norm); out[i * 3 + 2] = in[i * 3 + 2];
+        }
+    }
+
+    template<typename T>
+    void kernelLLAtoUTM(const T* in, T* out, size_t num, const UTMParams& params)
+    {
+        const Coordinate::UTM& utm = *params.utm;
+        const double radius = params.wgs84->radiusEquator, offsetN = utm.isNorth ? 0. : 10000000.;
+        for (size_t i = 0; i < num; ++i)
+        {
+            const double lla0 = in[i * 3], lla1 = in[i * 3 + 1], lla2 = in[i * 3 + 2];
+            double gauss = clenshawTrig(utm.cbg, 6, std::sin(2. * lla1), std::cos(2. * lla1)) + lla1;
+            double lam = lla0 - utm.lon0;
+
+            double sinGauss = std::sin(gauss), cosGauss = std::cos(gauss);
+            double sinLam = std::sin(lam), cosLam = std::cos(lam);
+            double Cn = std::atan2(sinGauss, cosLam * cosGauss);
+            double Ce = std::atan2(sinLam * cosGauss, std::hypot(sinGauss, cosGauss * cosLam));
+
+            double dCn = 0.0, dCe = 0.0; Ce = asinh(tan(Ce));
+            Cn += clenshaw2Trig(utm.gtu, 6, std::sin(2 * Cn), std::cos(2 * Cn),
+                                std::sinh(2 * Ce), std::cosh(2 * Ce), dCn, dCe); Ce += dCe;
+            if (std::fabs(Ce) <= 2.623395162778)
+            {
+                out[i * 3 + 0] = (T)((utm.Qn * Ce * radius) + 500000.0);
+                out[i * 3 + 1] = (T)((((utm.Qn * Cn) + utm.Zb) * radius) + offsetN);
+                out[i * 3 + 2] = (T)lla2;
+            }
+            else
+                { out[i * 3] = (T)0; out[i * 3 + 1] = (T)0; out[i * 3 + 2] = (T)0; }
+        }
+    }
+
+    template<typename T>
+    void kernelUTMtoLLA(const T* in, T* out, size_t num, const UTMParams& params)
+    {
+        const Coordinate::UTM& utm = *params.utm;
+        const double radius = params.wgs84->radiusEquator, offsetN = utm.isNorth ? 0. : 10000000.0;
+        for (size_t i = 0; i < num; ++i)
+        {
+            const double c0 = in[i * 3], c1 = in[i * 3 + 1], c2 = in[i * 3 + 2];
+            double Cn = (c1 - offsetN) / radius, Ce = (c0 - 500000.0) / radius;
+            Cn = (Cn - utm.Zb) / utm.Qn; Ce /= utm.Qn;
+            if (std::fabs(Ce) <= 2.623395162778)
+            {
+                double dCn, dCe;
+                Cn += clenshaw2Trig(utm.utg, 6, std::sin(2 * Cn), std::cos(2 * Cn),
+                                    std::sinh(2 * Ce), std::cosh(2 * Ce), dCn, dCe);
+                Ce = std::atan(std::sinh(Ce + dCe));
+
+                double sinCe = std::sin(Ce), cosCe = std::cos(Ce), cosCn = std::cos(Cn);
+                Ce = std::atan2(sinCe, cosCe * cosCn);
+                Cn = std::atan2(std::sin(Cn) * cosCe, std::hypot(sinCe, cosCe * cosCn));
+                out[i * 3 + 0] = (T)(Ce + utm.lon0);
+                out[i * 3 + 1] = (T)(clenshawTrig(utm.cgb, 6, std::sin(2 * Cn), std::cos(2 * Cn)) + Cn);
+                out[i * 3 + 2] = (T)c2;
+            }
+            else
+                { out[i * 3] = (T)0; out[i * 3 + 1] = (T)0; out[i * 3 + 2] = (T)0; }
+        }
+    }
+
+    template<typename T, typename P>
+    void convertInBlocks(void (*kernel)(const T*, T*, size_t, const P&), const T* input, T* output,
+                         size_t num, const P& params, bool parallel)
+    {
+        // Each block is converted by one thread; blocks never overlap so in-place is fine
+        const long long blockSize = 4096, numBlocks = ((long long)num + blockSize - 1) / blockSize;
+        if (!parallel || numBlocks < 2) { kernel(input, output, num, params); return; }
+
+#pragma omp parallel for schedule(static)
+        for (long long b = 0; b < numBlocks; ++b)
+        {
+            size_t start = (size_t)(b * blockSize);
+            size_t count = osg::minimum((size_t)blockSize, num - start);
+            kernel(input + start * 3, output + start * 3, count, params);
+        }
+    }
+
+    CGCS2000Params createCGCS2000Params(const Coordinate::CGCS2000& c2k, bool inverse)
+    {
+        // Same rotation matrices as convertECEFtoCGCS2000() / convertCGCS2000toECEF()
+        double s = inverse ? -1.0 : 1.0; CGCS2000Params params;
+        double rx = s * c2k.paramR[0] * osg::PI / 180.0;
+        double ry = s * c2k.paramR[1] * osg::PI / 180.0;
+        double rz = s * c2k.paramR[2] * osg::PI / 180.0;
+        double cos_rx = std::cos(rx), sin_rx = std::sin(rx);
+        double cos_ry = std::cos(ry), sin_ry = std::sin(ry);
+        double cos_rz = std::cos(rz), sin_rz = std::sin(rz);
+        double* r = params.r;
+        if (inverse)
+        {
+            r[0] = cos_ry * cos_rz; r[1] = -cos_rx * sin_rz + sin_rx * sin_ry * cos_rz;
+            r[2] = sin_rx * sin_rz + cos_rx * sin_ry * cos_rz;
+            r[3] = cos_ry * sin_rz; r[4] = cos_rx * cos_rz + sin_rx * sin_ry * sin_rz;
+            r[5] = -sin_rx * cos_rz + cos_rx * sin_ry * sin_rz;
+            r[6] = -sin_ry; r[7] = sin_rx * cos_ry; r[8] = cos_rx * cos_ry;
+        }
+        else
+        {
+            r[0] = cos_ry * cos_rz; r[1] = cos_rx * sin_rz + sin_rx * sin_ry * cos_rz;
+            r[2] = sin_rx * sin_rz - cos_rx * sin_ry * cos_rz;
+            r[3] = -cos_ry * sin_rz; r[4] = cos_rx * cos_rz - sin_rx * sin_ry * sin_rz;
+            r[5] = sin_rx * cos_rz + cos_rx * sin_ry * sin_rz;
+            r[6] = sin_ry; r[7] = -sin_rx * cos_ry; r[8] = cos_rx * cos_ry;
+        }
+        for (int i = 0; i < 3; ++i) params.t[i] = c2k.paramT[i];
+        params.k = c2k.paramK; params.inverse = inverse; return params;
+    }
+}
+
+#define COORDINATE_BATCH_WGS84(func, kernel, T) \
+    void Coordinate::func(const T* input, T* output, size_t num, const WGS84& wgs84, bool parallel) \
+    { convertInBlocks<T, WGS84>(kernel<T>, input, output, num, wgs84, parallel); }
+#define COORDINATE_BATCH_CGCS2000(func, inverse, T) \
+    void Coordinate::func(const T* input, T* output, size_t num, const CGCS2000& c2k, bool parallel) \
+    { convertInBlocks<T, CGCS2000Params>(kernelCGCS2000<T>, input, output, num, \
+                                         createCGCS2000Params(c2k, inverse), parallel); }
+#define COORDINATE_BATCH_UTM(func, kernel, T) \
+    void Coordinate::func(const T* input, T* output, size_t num, const UTM& utm, \
+                          const WGS84& wgs84, bool parallel) \
+    { UTMParams params = { &utm, &wgs84 }; \
+      convertInBlocks<T, UTMParams>(kernel<T>, input, output, num, params, parallel); }
+
+COORDINATE_BATCH_WGS84(convertLLAtoECEF, kernelLLAtoECEF, double)
+COORDINATE_BATCH_WGS84(convertLLAtoECEF, kernelLLAtoECEF, float)
+COORDINATE_BATCH_WGS84(convertECEFtoLLA, kernelECEFtoLLA, double)
+COORDINATE_BATCH_WGS84(convertECEFtoLLA, kernelECEFtoLLA, float)
+COORDINATE_BATCH_WGS84(convertLLAtoWebMercator, kernelLLAtoWebMercator, double)
+COORDINATE_BATCH_WGS84(convertLLAtoWebMercator, kernelLLAtoWebMercator, float)
+COORDINATE_BATCH_WGS84(convertWebMercatorToLLA, kernelWebMercatorToLLA, double)
+COORDINATE_BATCH_WGS84(convertWebMercatorToLLA, kernelWebMercatorToLLA, float)
+COORDINATE_BATCH_CGCS2000(convertECEFtoCGCS2000, false, double)
+COORDINATE_BATCH_CGCS2000(convertECEFtoCGCS2000, false, float)
+COORDINATE_BATCH_CGCS2000(convertCGCS2000toECEF, true, double)
+COORDINATE_BATCH_CGCS2000(convertCGCS2000toECEF, true, float)
+COORDINATE_BATCH_UTM(convertLLAtoUTM, kernelLLAtoUTM, double)
+COORDINATE_BATCH_UTM(convertLLAtoUTM, kernelLLAtoUTM, float)
+COORDINATE_BATCH_UTM(convertUTMtoLLA, kernelUTMtoLLA, double)
+COORDINATE_BATCH_UTM(convertUTMtoLLA, kernelUTMtoLLA, float)
+
 /* MathExpression */
 
 MathExpression::MathExpression(const std::string& exp)
@@ -192,6 +192,48 @@ namespace osgVerse
         static osg::Vec3d convertUTMtoLLA(const osg::Vec3d& coord,
                                           const UTM& utm, const WGS84& wgs84 = WGS84());
 
+        /// Batch versions of above conversions on contiguous xyz triples (output may be the input).
+        /// They reuse the scalar formulas in double, so results match single-point versions up to
+        /// rounding; speed-up comes from per-batch invariants and concurrent blocks of large inputs.
+        /// Float versions compute in double too, but storing radians and ECEF metres as float loses
+        /// up to about a metre near the earth surface, so prefer double for geo-referenced data
+        static void convertLLAtoECEF(const double* lla, double* ecef, size_t num,
+                                     const WGS84& wgs84 = WGS84(), bool parallel = true);
+        static void convertLLAtoECEF(const float* lla, float* ecef, size_t num,
+                                     const WGS84& wgs84 = WGS84(), bool parallel = true);
+        static void convertECEFtoLLA(const double* ecef, double* lla, size_t num,
+                                     const WGS84& wgs84 = WGS84(), bool parallel = true);
+        static void convertECEFtoLLA(const float* ecef, float* lla, size_t num,
+                                     const WGS84& wgs84 = WGS84(), bool parallel = true);
+        static void convertECEFtoCGCS2000(const double* ecef, double* coord, size_t num,
+                                          const CGCS2000& c2k = CGCS2000(), bool parallel = true);
+        static void convertECEFtoCGCS2000(const float* ecef, float* coord, size_t num,
+                                          const CGCS2000& c2k = CGCS2000(), bool parallel = true);
+        static void convertCGCS2000toECEF(const double* coord, double* ecef, size_t num,
+                                          const CGCS2000& c2k = CGCS2000(), bool parallel = true);
+        static void convertCGCS2000toECEF(const float* coord, float* ecef, size_t num,
+                                          const CGCS2000& c2k = CGCS2000(), bool parallel = true);
+        static void convertLLAtoWebMercator(const double* lla, double* yxz, size_t num,
+                                            const WGS84& wgs84 = WGS84(), bool parallel = true);
+        static void convertLLAtoWebMercator(const float* lla, float* yxz, size_t num,
+                                            const WGS84& wgs84 = WGS84(), bool parallel = true);
+        static void convertWebMercatorToLLA(const double* yxz, double* lla, size_t num,
+                                            const WGS84& wgs84 = WGS84(), bool parallel = true);
+        static void convertWebMercatorToLLA(const float* yxz, float* lla, size_t num,
+                                            const WGS84& wgs84 = WGS84(), bool parallel = true);
+        static void convertLLAtoUTM(const double* lla, double* coord, size_t num,
+                                    const UTM& utm, const WGS84& wgs84 = WGS84(),
+                                    bool parallel = true);
+        static void convertLLAtoUTM(const float* lla, float* coord, size_t num,
+                                    const UTM& utm, const WGS84& wgs84 = WGS84(),
+                                    bool parallel = true);
+        static void convertUTMtoLLA(const double* coord, double* lla, size_t num,
+                                    const UTM& utm, const WGS84& wgs84 = WGS84(),
+                                    bool parallel = true);
+        static void convertUTMtoLLA(const float* coord, float* lla, size_t num,
+                                    const UTM& utm, const WGS84& wgs84 = WGS84(),
+                                    bool parallel = true);
+
         /// Geodetic: latitude and longitude in radius, altitude in metres; ENU: east-north-up
         static osg::Matrix convertLLAtoENU(const osg::Vec3d& lla, const WGS84& wgs84 = WGS84());
 
@@ -9,6 +9,8 @@
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <iostream>
+#include <climits>
+#include <algorithm>
 
 #define STB_RECT_PACK_IMPLEMENTATION
 #define ENABLE_VHACD_IMPLEMENTATION 1
@@ -29,81 +31,91 @@ struct ResortVertexOperator
     std::vector<unsigned int> indices;
 };
 
-struct CollectVertexOperator
+void VertexWeldingMap::reserve(size_t numVertices)
 {
-    void operator()(unsigned int i1, unsigned int i2, unsigned int i3)
-    {
-        if (vertices && vertices->size() <= baseIndex)
-        {
-            std::vector<bool> vertexAddingList;
-            for (size_t i = 0; i < inputV->size(); ++i)
-            {
-                osg::Vec3 v = (*inputV)[i] * matrix;
-                if (vertexMap)
-                {
-                    if (vertexMap->find(v) == vertexMap->end())
-                    {
-                        (*vertexMap)[v] = vertices->size();
-                        vertexAddingList.push_back(true);
-                        vertices->push_back(v);
-                    }
-                    else
-                        vertexAddingList.push_back(false);
-                    indexMap[baseIndex + i] = (*vertexMap)[v] - baseIndex;
-                }
-                else vertices->push_back(v);
-            }
+    size_t capacity = 16; while (capacity < numVertices * 2) capacity <<= 1;
+    if (capacity <= _slots.size()) return;
+
+    std::vector<Slot> oldSlots; oldSlots.swap(_slots);
+    Slot empty = { { 0, 0, 0 }, UINT_MAX };
+    _slots.assign(capacity, empty); _count = 0;
+    for (size_t i = 0; i < oldSlots.size(); ++i)
+    { if (oldSlots[i].index != UINT_MAX) insert(oldSlots[i].cell, oldSlots[i].index); }
+}
 
-            if (attributes)
-            {
-                std::vector<osg::Vec4>& na = (*attributes)[MeshCollector::NormalAttr];
-                std::vector<osg::Vec4>& ca = (*attributes)[MeshCollector::ColorAttr];
-                std::vector<osg::Vec4>& ta = (*attributes)[MeshCollector::UvAttr];
-                for (size_t i = 0; i < inputV->size(); ++i)
+unsigned int VertexWeldingMap::findOrInsert(const osg::Vec3& v, unsigned int index,
+                                            const std::vector<osg::Vec3>& vertices)
+{
+    if ((_count + 1) * 2 > _slots.size()) reserve((_count + 1) * 2);
+    long long cell[3]; quantize(v, cell);
+
+    size_t mask = _slots.size() - 1;
+    if (_tolerance > 0.0f)
+    {
+        // Welded vertex may fall into any neighbor cell, so check all of them
+        float tolerance2 = _tolerance * _tolerance;
+        for (int dz = -1; dz <= 1; ++dz)
+            for (int dy = -1; dy <= 1; ++dy)
+                for (int dx = -1; dx <= 1; ++dx)
                 {
-                    if (vertexMap && !vertexAddingList[i]) continue;
-                    if (inputN)
+                    long long c[3] = { cell[0] + dx, cell[1] + dy, cell[2] + dz };
+                    for (size_t h = hash(c) & mask; _slots[h].index != UINT_MAX; h = (h + 1) & mask)
                     {
-                        osg::Vec3 n = osg::Matrix::transform3x3(osg::Matrix::inverse(matrix), (*inputN)[i]);
-                        na.push_back(osg::Vec4(n, 0.0));
+                        const Slot& slot = _slots[h];
+                        if (slot.cell[0] != c[0] || slot.cell[1] != c[1] || slot.cell[2] != c[2]) continue;
+                        if ((vertices[slot.index] - v).length2() <= tolerance2) return slot.index;
                     }
-                    if (inputC) ca.push_back((*inputC)[i]);
-                    if (inputT) ta.push_back(osg::Vec4((*inputT)[i].x(),
-                                                       (*inputT)[i].y(), 0.0f, 1.0));
                 }
-            }
+    }
+    else
+    {
+        for (size_t h = hash(cell) & mask; _slots[h].index != UINT_MAX; h = (h + 1) & mask)
+        {
+            const Slot& slot = _slots[h];
+            if (slot.cell[0] == cell[0] && slot.cell[1] == cell[1] && slot.cell[2] == cell[2])
+                return slot.index;
         }
+    }
+    insert(cell, index); return index;
+}
 
-        if (indices)
+void VertexWeldingMap::quantize(const osg::Vec3& v, long long* cell) const
+{
+    if (_tolerance > 0.0f)
+    {
+        for (int i = 0; i < 3; ++i)
+            cell[i] = (long long)floor((double)v[i] / (double)_tolerance);
+    }
+    else
+    {   // Exact matching like std::map<osg::Vec3>, except that -0 equals to +0
+        for (int i = 0; i < 3; ++i)
         {
-            if (vertexMap)
-            {
-                i1 = indexMap[baseIndex + i1]; i2 = indexMap[baseIndex + i2];
-                i3 = indexMap[baseIndex + i3];
-            }
-
-            if (i1 == i2 || i2 == i3 || i1 == i3) return;
-            indices->push_back(baseIndex + i1); indices->push_back(baseIndex + i2);
-            indices->push_back(baseIndex + i3);
+            float f = v[i] + 0.0f; unsigned int bits = 0;
+            memcpy(&bits, &f, sizeof(float)); cell[i] = bits;
         }
     }
+}
 
-    CollectVertexOperator()
-    :   inputV(NULL), inputN(NULL), inputT(NULL), inputC(NULL), vertexMap(NULL),
-        vertices(NULL), indices(NULL), attributes(NULL), baseIndex(0) {}
-    osg::Vec3Array *inputV, *inputN;
-    osg::Vec2Array *inputT; osg::Vec4Array *inputC;
-    std::map<osg::Vec3, unsigned int, Vec3MapComparer>* vertexMap;
-    std::map<unsigned int, unsigned int> indexMap;
+void VertexWeldingMap::insert(const long long* cell, unsigned int index)
+{
+    size_t mask = _slots.size() - 1, h = hash(cell) & mask;
+    while (_slots[h].index != UINT_MAX) h = (h + 1) & mask;
+    Slot& slot = _slots[h]; slot.index = index; _count++;
+    slot.cell[0] = cell[0]; slot.cell[1] = cell[1]; slot.cell[2] = cell[2];
+}
 
-    std::vector<osg::Vec3>* vertices; std::vector<unsigned int>* indices;
-    std::map<MeshCollector::VertexAttribute, std::vector<osg::Vec4>>* attributes;
-    osg::Matrix matrix; unsigned int baseIndex;
-};
+size_t VertexWeldingMap::hash(const long long* cell) const
+{
+    unsigned long long h = (unsigned long long)cell[0] * 0x9E3779B97F4A7C15ull;
+    h ^= (unsigned long long)cell[1] * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+    h ^= (unsigned long long)cell[2] * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+    h ^= h >> 33; h *= 0xFF51AFD7ED558CCDull; h ^= h >> 33;
+    return (size_t)h;
+}
 
 MeshCollector::MeshCollector()
 :   osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN), _weldVertices(false), _globalVertices(false),
-    _loadedFineLevels(false), _onlyVertexAndIndices(false) {}
+    _loadedFineLevels(false), _onlyVertexAndIndices(false), _parallelCollecting(false) {}
 
 MeshCollector::NonManifoldType MeshCollector::isManifold() const
 {
@@ -183,10 +195,130 @@ std::vector<osg::ref_ptr<osg::Geometry>> MeshCollector::output(bool mergeAllStat
 void MeshCollector::reset()
 {
     _matrixStack.clear(); _boundingBox.init();
-    _vertexMap.clear(); _attributes.clear();
+    _vertexMap.clear(); _attributes.clear(); _pendingGeometries.clear();
     _vertices.clear(); _indices.clear();
 }
 
+void MeshCollector::finishCollecting()
+{
+    // Transform and weld each geometry with its own table, then merge them in traversal order
+    int numGeometries = (int)_pendingGeometries.size();
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < numGeometries; ++i) collect(_pendingGeometries[i]);
+
+    size_t numVertices = _vertices.size(), numIndices = _indices.size();
+    for (size_t i = 0; i < _pendingGeometries.size(); ++i)
+    {
+        numVertices += _pendingGeometries[i].vertices.size();
+        numIndices += _pendingGeometries[i].indices.size();
+    }
+    _vertices.reserve(numVertices); _indices.reserve(numIndices);
+    if (_weldVertices && _globalVertices) _vertexMap.reserve(numVertices);
+    for (size_t i = 0; i < _pendingGeometries.size(); ++i) merge(_pendingGeometries[i]);
+    _pendingGeometries.clear();
+}
+
+void MeshCollector::collect(CollectedGeometry& cg) const
+{
+    osg::Geometry& geom = *cg.geometry;
+    osg::Vec3Array* inputV = dynamic_cast<osg::Vec3Array*>(geom.getVertexArray());
+    if (!inputV || inputV->empty()) return;
+
+    osg::TriangleIndexFunctor<ResortVertexOperator> functor; geom.accept(functor);
+    if (functor.indices.empty()) return;
+
+    size_t numVertices = inputV->size();
+    osg::Vec2Array* inputT = NULL; osg::Vec3Array* inputN = NULL; osg::Vec4Array* inputC = NULL;
+    if (!_onlyVertexAndIndices)
+    {
+        inputT = dynamic_cast<osg::Vec2Array*>(geom.getTexCoordArray(0));
+        if (geom.getNormalBinding() == osg::Geometry::BIND_PER_VERTEX)
+            inputN = dynamic_cast<osg::Vec3Array*>(geom.getNormalArray());
+        if (geom.getColorBinding() == osg::Geometry::BIND_PER_VERTEX)
+            inputC = dynamic_cast<osg::Vec4Array*>(geom.getColorArray());
+        if (inputT && inputT->size() < numVertices) inputT = NULL;
+        if (inputN && inputN->size() < numVertices) inputN = NULL;
+        if (inputC && inputC->size() < numVertices) inputC = NULL;
+    }
+
+    VertexWeldingMap localMap(_vertexMap.getTolerance());
+    std::vector<unsigned int> remap(numVertices);
+    cg.vertices.reserve(numVertices); if (_weldVertices) localMap.reserve(numVertices);
+    if (inputN) cg.normals.reserve(numVertices);
+    if (inputC) cg.colors.reserve(numVertices);
+    if (inputT) cg.texCoords.reserve(numVertices);
+
+    osg::Matrix normalMatrix = osg::Matrix::inverse(cg.matrix);
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        osg::Vec3 v = (*inputV)[i] * cg.matrix;
+        unsigned int index = cg.vertices.size();
+        remap[i] = _weldVertices ? localMap.findOrInsert(v, index, cg.vertices) : index;
+        if (remap[i] != index) continue;
+
+        cg.vertices.push_back(v);
+        if (inputN)
+        {
+            osg::Vec3 n = osg::Matrix::transform3x3(normalMatrix, (*inputN)[i]);
+            cg.normals.push_back(osg::Vec4(n, 0.0));
+        }
+        if (inputC) cg.colors.push_back((*inputC)[i]);
+        if (inputT) cg.texCoords.push_back(osg::Vec4((*inputT)[i].x(), (*inputT)[i].y(), 0.0f, 1.0));
+    }
+
+    const std::vector<unsigned int>& indices = functor.indices;
+    cg.indices.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        unsigned int i1 = remap[indices[i]], i2 = remap[indices[i + 1]], i3 = remap[indices[i + 2]];
+        if (i1 == i2 || i2 == i3 || i1 == i3) continue;
+        cg.indices.push_back(i1); cg.indices.push_back(i2); cg.indices.push_back(i3);
+    }
+}
+
+void MeshCollector::merge(CollectedGeometry& cg)
+{
+    if (cg.indices.empty()) return;
+    std::vector<osg::Vec4>& na = _attributes[NormalAttr];
+    std::vector<osg::Vec4>& ca = _attributes[ColorAttr];
+    std::vector<osg::Vec4>& ta = _attributes[UvAttr];
+
+    size_t baseIndex = _vertices.size(), numVertices = cg.vertices.size();
+    bool welding = _weldVertices && _globalVertices;
+    std::vector<unsigned int> remap(numVertices);
+    _vertices.reserve(baseIndex + numVertices);
+    if (welding) _vertexMap.reserve(baseIndex + numVertices);
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        unsigned int index = _vertices.size();
+        remap[i] = welding ? _vertexMap.findOrInsert(cg.vertices[i], index, _vertices) : index;
+        if (remap[i] != index) continue;
+
+        _vertices.push_back(cg.vertices[i]);
+        if (!cg.normals.empty()) na.push_back(cg.normals[i]);
+        if (!cg.colors.empty()) ca.push_back(cg.colors[i]);
+        if (!cg.texCoords.empty()) ta.push_back(cg.texCoords[i]);
+    }
+
+    _indices.reserve(_indices.size() + cg.indices.size());
+    for (size_t i = 0; i + 2 < cg.indices.size(); i += 3)
+    {
+        unsigned int i1 = remap[cg.indices[i]], i2 = remap[cg.indices[i + 1]],
+                     i3 = remap[cg.indices[i + 2]];
+        if (i1 == i2 || i2 == i3 || i1 == i3) continue;
+        _indices.push_back(i1); _indices.push_back(i2); _indices.push_back(i3);
+    }
+
+    if (cg.stateSet != NULL)
+    {
+        std::vector<size_t>& vids = _vertexOfStateSetMap[cg.stateSet];
+        for (size_t i = baseIndex; i < _vertices.size(); ++i) vids.push_back(i);
+    }
+    std::vector<osg::Vec3>().swap(cg.vertices); std::vector<unsigned int>().swap(cg.indices);
+    std::vector<osg::Vec4>().swap(cg.normals); std::vector<osg::Vec4>().swap(cg.colors);
+    std::vector<osg::Vec4>().swap(cg.texCoords); cg.geometry = NULL;
+}
+
 void MeshCollector::apply(osg::Node& node)
 {
     if (node.getStateSet()) apply(&node, NULL, *node.getStateSet());
@@ -305,30 +437,10 @@ void MeshCollector::apply(osg::Geometry& geom)
     osg::StateSet* ss = geom.getStateSet();
     if (ss) apply(geom.getNumParents() > 0 ? geom.getParent(0) : NULL, &geom, *ss);
 
-    osg::TriangleIndexFunctor<CollectVertexOperator> functor;
-    functor.inputV = static_cast<osg::Vec3Array*>(geom.getVertexArray());
-    if (!_onlyVertexAndIndices)
-        functor.inputT = static_cast<osg::Vec2Array*>(geom.getTexCoordArray(0));
-    if (!_onlyVertexAndIndices && geom.getNormalBinding() == osg::Geometry::BIND_PER_VERTEX)
-        functor.inputN = static_cast<osg::Vec3Array*>(geom.getNormalArray());
-    if (!_onlyVertexAndIndices && geom.getColorBinding() == osg::Geometry::BIND_PER_VERTEX)
-        functor.inputC = static_cast<osg::Vec4Array*>(geom.getColorArray());
-
-    functor.vertices = &_vertices; functor.attributes = &_attributes;
-    functor.indices = &_indices; functor.matrix = matrix;
-    functor.baseIndex = _vertices.size();
-    if (_weldVertices)
-    {
-        if (!_globalVertices) _vertexMap.clear();
-        functor.vertexMap = &_vertexMap;
-    }
-
-    geom.accept(functor);
-    if (!_stateSetStack.empty())
-    {
-        std::vector<size_t>& vids = _vertexOfStateSetMap[_stateSetStack.back()];
-        for (size_t i = functor.baseIndex; i < _vertices.size(); ++i) vids.push_back(i);
-    }
+    CollectedGeometry cg; cg.geometry = &geom; cg.matrix = matrix;
+    cg.stateSet = _stateSetStack.empty() ? NULL : _stateSetStack.back();
+    if (_parallelCollecting) _pendingGeometries.push_back(cg);
+    else { collect(cg); merge(cg); }
 #if OSG_VERSION_GREATER_THAN(3, 4, 1)
     traverse(geom);
 #endif
@@ -362,7 +474,7 @@ osg::Geometry* BoundingVolumeVisitor::computeVHACD(bool findBestPlane, bool shri
     if (maxConvexHulls > 0) params.m_maxConvexHulls = maxConvexHulls;
     if (maxError > 0.0f) params.m_minimumVolumePercentErrorAllowed = maxError;
     // params.m_maxRecursionDepth; params.m_fillMode; params.m_maxNumVerticesPerCH; params.m_minEdgeLength
-    if (_vertices.empty() || _indices.empty()) return NULL;
+    finishCollecting(); if (_vertices.empty() || _indices.empty()) return NULL;
 
     std::vector<double> points(_vertices.size() * 3);
     for (size_t i = 0; i < _vertices.size(); ++i)
@@ -402,6 +514,7 @@ osg::Geometry* BoundingVolumeVisitor::computeVHACD(bool findBestPlane, bool shri
 
 osg::BoundingBox BoundingVolumeVisitor::computeOBB(osg::Quat& rotation, float relativeExtent, int numSamples)
 {
+    finishCollecting();
     ApproxMVBB::Matrix3Dyn points(3, _vertices.size());
     for (size_t i = 0; i < _vertices.size(); ++i)
     {
@@ -427,13 +540,13 @@ void MeshTopologyVisitor::apply(osg::Node* n, osg::Drawable* d, osg::StateSet& s
 MeshTopology* MeshTopologyVisitor::generate()
 {
     osg::ref_ptr<MeshTopology> mesh = new MeshTopology;
-    mesh->generate(this); return mesh.release();
+    finishCollecting(); mesh->generate(this); return mesh.release();
 }
 
 /// TexturePacker ///
 
 void TexturePacker::clear()
-{ _input.clear(); _result.clear(); _dictIndex = 0; }
+{ _input.clear(); _result.clear(); _resultPages.clear(); _dictIndex = 0; }
 
 size_t TexturePacker::addElement(osg::Image* image)
 { _input[++_dictIndex] = InputPair(image, osg::Vec4()); return _dictIndex; }
@@ -446,49 +559,100 @@ void TexturePacker::removeElement(size_t id)
 
 osg::Image* TexturePacker::pack(size_t& numImages, bool generateResult, bool stopIfFailed)
 {
-    stbrp_context context; int ptr = 0, totalW = 0, totalH = 0;
-    int maxSize = osg::maximum(_maxWidth, _maxHeight) * 2;
-    stbrp_node* nodes = (stbrp_node*)malloc(sizeof(stbrp_node) * maxSize);
-    if (nodes) memset(nodes, 0, sizeof(stbrp_node) * maxSize);
+    std::vector<size_t> elements; int totalW = 0, totalH = 0;
+    for (std::map<size_t, InputPair>::iterator itr = _input.begin(); itr != _input.end(); ++itr)
+        elements.push_back(itr->first);
+    _result.clear(); _resultPages.clear();
 
-    stbrp_rect* rects = (stbrp_rect*)malloc(sizeof(stbrp_rect) * _input.size());
-    for (std::map<size_t, InputPair>::iterator itr = _input.begin();
-         itr != _input.end(); ++itr, ++ptr)
+    bool allPacked = packPage(elements, 0, totalW, totalH);
+    for (size_t i = 0; i < elements.size(); ++i)
     {
-        stbrp_rect& r = rects[ptr];
-        InputPair& pair = itr->second;
-        r.id = itr->first; r.was_packed = 0;
-        r.x = 0; r.w = pair.first.valid() ? pair.first->s() : pair.second[2];
-        r.y = 0; r.h = pair.first.valid() ? pair.first->t() : pair.second[3];
+        InputPair& pair = _input[elements[i]];
+        OSG_NOTICE << "[TexturePacker] Bad packing element: "
+                   << (pair.first.valid() ? pair.first->getFileName() : std::string("(empty)"))
+                   << ", id = " << elements[i] << "/" << _input.size() << std::endl;
     }
 
-    stbrp_init_target(&context, _maxWidth, _maxHeight, nodes, maxSize);
-    stbrp_pack_rects(&context, rects, _input.size());
-    free(nodes); _result.clear(); ptr = 0;
+    numImages = _result.size();
+    if (!allPacked && stopIfFailed) return NULL;
+    if (!generateResult) return NULL;
+    return createPage(0, totalW, totalH);
+}
 
-    osg::observer_ptr<osg::Image> validChild;
-    for (std::map<size_t, InputPair>::iterator itr = _input.begin();
-         itr != _input.end(); ++itr, ++ptr)
-    {
-        InputPair& pair = itr->second;
-        stbrp_rect& r = rects[ptr];
-        osg::Vec4 v(r.x, r.y, r.w, r.h);
+std::vector<osg::ref_ptr<osg::Image>> TexturePacker::packPages(size_t& numImages, bool generateResult,
+                                                               int maxPages)
+{
+    std::vector<size_t> elements; std::vector<osg::ref_ptr<osg::Image>> pages;
+    for (std::map<size_t, InputPair>::iterator itr = _input.begin(); itr != _input.end(); ++itr)
+        elements.push_back(itr->first);
+    _result.clear(); _resultPages.clear();
 
-        if (r.id != itr->first || !r.was_packed)
+    for (int page = 0; !elements.empty() && (maxPages <= 0 || page < maxPages); ++page)
+    {
+        size_t numRemained = elements.size(); int totalW = 0, totalH = 0;
+        packPage(elements, page, totalW, totalH);
+        if (elements.size() == numRemained)
         {
-            OSG_NOTICE << "[TexturePacker] Bad packing element: " << pair.first->getFileName()
-                       << ", order = " << ptr << "/" << _input.size() << ", rect = " << v
-                       << ", packed = " << r.was_packed << std::endl;
-            if (stopIfFailed) return NULL; else continue;
+            // Nothing packed into an empty page: all remained elements exceed the max size
+            for (size_t i = 0; i < elements.size(); ++i)
+                OSG_NOTICE << "[TexturePacker] Element " << elements[i] << " is larger than "
+                           << _maxWidth << "x" << _maxHeight << std::endl;
+            break;
         }
+        pages.push_back(generateResult ? createPage(page, totalW, totalH) : NULL);
+    }
+    numImages = _result.size(); return pages;
+}
+
+bool TexturePacker::packPage(std::vector<size_t>& elements, int page, int& totalW, int& totalH)
+{
+    if (elements.empty()) return true;
+    int maxNodes = osg::maximum(_maxWidth, _maxHeight) * 2;
+    std::vector<stbrp_node> nodes(maxNodes);
+    std::vector<stbrp_rect> rects(elements.size());
+    std::vector<bool> rotatedList(elements.size(), false);
 
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        InputPair& pair = _input[elements[i]];
+        int w = pair.first.valid() ? pair.first->s() : pair.second[2];
+        int h = pair.first.valid() ? pair.first->t() : pair.second[3];
+        if (_rotatable && h > w) { std::swap(w, h); rotatedList[i] = true; }  // lower skyline
+
+        stbrp_rect& r = rects[i]; r.id = (int)i; r.was_packed = 0;
+        r.x = 0; r.w = w + _padding * 2; r.y = 0; r.h = h + _padding * 2;
+    }
+
+    stbrp_context context;
+    stbrp_init_target(&context, _maxWidth, _maxHeight, &nodes[0], maxNodes);
+    stbrp_pack_rects(&context, &rects[0], (int)rects.size());
+
+    std::vector<size_t> remained;
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        const stbrp_rect& r = rects[i]; size_t id = elements[r.id];
+        if (!r.was_packed) { remained.push_back(id); continue; }
         if (totalW < (r.x + r.w)) totalW = r.x + r.w;
         if (totalH < (r.y + r.h)) totalH = r.y + r.h;
-        _result[itr->first] = InputPair(pair.first, v);
-        if (pair.first.valid()) validChild = pair.first;
+
+        PageData pd; pd.page = page; pd.rotated = rotatedList[r.id];
+        _result[id] = InputPair(_input[id].first, osg::Vec4(r.x + _padding, r.y + _padding,
+                                                            r.w - _padding * 2, r.h - _padding * 2));
+        _resultPages[id] = pd;
+    }
+    elements.swap(remained);
+    return elements.empty();
+}
+
+osg::Image* TexturePacker::createPage(int page, int totalW, int totalH)
+{
+    std::vector<size_t> ids; osg::observer_ptr<osg::Image> validChild;
+    for (std::map<size_t, PageData>::iterator itr = _resultPages.begin();
+         itr != _resultPages.end(); ++itr)
+    {
+        if (itr->second.page != page) continue; else ids.push_back(itr->first);
+        osg::Image* child = _result[itr->first].first.get(); if (child) validChild = child;
     }
-    free(rects); numImages = _result.size();
-    if (!generateResult) return NULL;
 
     osg::ref_ptr<osg::Image> total = new osg::Image;
     if (validChild.valid())
@@ -499,21 +663,85 @@ osg::Image* TexturePacker::pack(size_t& numImages, bool generateResult, bool sto
     }
     else
         total->allocateImage(totalW, totalH, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    if (!total->data()) return NULL;
+    memset(total->data(), 0, total->getTotalSizeInBytes());
+
+    // Elements are disjoint (including paddings), so blit them concurrently by rows
+    std::vector<size_t> slowIds; int numIds = (int)ids.size();
+    std::vector<char> blitted(ids.size(), 0);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < numIds; ++i) blitted[i] = blitElement(ids[i], total.get()) ? 1 : 0;
 
-    for (std::map<size_t, InputPair>::iterator itr = _result.begin();
-         itr != _result.end(); ++itr)
+    for (int i = 0; i < numIds; ++i)
     {
-        InputPair& pair = itr->second;
-        const osg::Vec4& r = itr->second.second;
-        if (!pair.first.valid()) continue;
+        InputPair& pair = _result[ids[i]];
+        const osg::Vec4& r = pair.second;
+        if (blitted[i] || !pair.first.valid()) continue;
 
-        if (!osg::copyImage(pair.first.get(), 0, 0, 0, r[2], r[3], 1,
-                            total.get(), r[0], r[1], 0))
-        { OSG_WARN << "[TexturePacker] Failed to copy image " << itr->first << std::endl; }
+        if (_resultPages[ids[i]].rotated)
+        {
+            for (int y = 0; y < (int)r[3]; ++y)
+                for (int x = 0; x < (int)r[2]; ++x)
+                    total->setColor(pair.first->getColor(y, x), r[0] + x, r[1] + y);
+        }
+        else if (!osg::copyImage(pair.first.get(), 0, 0, 0, r[2], r[3], 1,
+                                 total.get(), r[0], r[1], 0))
+        { OSG_WARN << "[TexturePacker] Failed to copy image " << ids[i] << std::endl; }
     }
     return total.release();
 }
 
+bool TexturePacker::blitElement(size_t id, osg::Image* total)
+{
+    // Called concurrently, so only look up (never insert into) the result maps
+    const InputPair& pair = _result.find(id)->second; osg::Image* src = pair.first.get();
+    if (!src) return true;  // empty element, nothing to copy
+    if (src->isCompressed() || total->isCompressed() || src->r() > 1 ||
+        src->getPixelFormat() != total->getPixelFormat() ||
+        src->getDataType() != total->getDataType() ||
+        (total->getPixelSizeInBits() % 8) != 0) return false;
+
+    const osg::Vec4& rect = pair.second;
+    int x0 = (int)rect[0], y0 = (int)rect[1], w = (int)rect[2], h = (int)rect[3];
+    unsigned int pixelSize = total->getPixelSizeInBits() / 8;
+    if (_resultPages.find(id)->second.rotated)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            unsigned char* dst = total->data(x0, y0 + y);
+            for (int x = 0; x < w; ++x) memcpy(dst + x * pixelSize, src->data(y, x), pixelSize);
+        }
+    }
+    else
+    {
+        for (int y = 0; y < h; ++y)
+            memcpy(total->data(x0, y0 + y), src->data(0, y), w * pixelSize);
+    }
+
+    if (_padding > 0 && _bleeding)
+    {
+        // Extend edge pixels into the padding area: left/right of each row, then top/bottom rows
+        for (int y = 0; y < h; ++y)
+        {
+            unsigned char* row = total->data(0, y0 + y);
+            for (int p = 1; p <= _padding; ++p)
+            {
+                memcpy(row + (x0 - p) * pixelSize, row + x0 * pixelSize, pixelSize);
+                memcpy(row + (x0 + w - 1 + p) * pixelSize, row + (x0 + w - 1) * pixelSize, pixelSize);
+            }
+        }
+
+        size_t spanSize = (w + _padding * 2) * pixelSize;
+        for (int p = 1; p <= _padding; ++p)
+        {
+            memcpy(total->data(x0 - _padding, y0 - p), total->data(x0 - _padding, y0), spanSize);
+            memcpy(total->data(x0 - _padding, y0 + h - 1 + p),
+                   total->data(x0 - _padding, y0 + h - 1), spanSize);
+        }
+    }
+    return true;
+}
+
 bool TexturePacker::getPackingData(size_t id, int& x, int& y, int& w, int& h)
 {
     if (_result.find(id) != _result.end())
@@ -525,6 +753,13 @@ bool TexturePacker::getPackingData(size_t id, int& x, int& y, int& w, int& h)
     return false;
 }
 
+bool TexturePacker::getPackingData(size_t id, int& page, int& x, int& y, int& w, int& h, bool& rotated)
+{
+    if (!getPackingData(id, x, y, w, h)) return false;
+    const PageData& pd = _resultPages[id];
+    page = pd.page; rotated = pd.rotated; return true;
+}
+
 namespace osgVerse
 {
 
@@ -577,7 +812,7 @@ namespace osgVerse
                                   osg::PrimitiveSet* p, bool autoNormals, bool useVBO)
     {
         osg::Geometry* geom = createGeometry(va, na, NULL, p, autoNormals, useVBO);
-        osg::Vec4Array* ca = static_cast<osg::Vec4Array*>(geom->getColorArray());
+        osg::Vec4Array* ca = dynamic_cast<osg::Vec4Array*>(geom->getColorArray());
         if (ca) ca->assign(ca->size(), color); return geom;
     }
 
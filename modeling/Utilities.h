@@ -39,12 +39,45 @@ namespace osgVerse
         }
     };
 
+    /** Flat open-addressing hash for welding vertices. Positions are quantized by the tolerance
+        (exact bit patterns if tolerance is 0); with tolerance all neighbor cells are checked */
+    class VertexWeldingMap
+    {
+    public:
+        VertexWeldingMap(float tolerance = 0.0f) : _tolerance(tolerance), _count(0) {}
+        void setTolerance(float t) { _tolerance = t; clear(); }
+        float getTolerance() const { return _tolerance; }
+
+        void reserve(size_t numVertices);
+        void clear() { _slots.clear(); _count = 0; }
+        size_t size() const { return _count; }
+
+        /** Return index of welded vertex in 'vertices', or record v as 'index' and return it */
+        unsigned int findOrInsert(const osg::Vec3& v, unsigned int index,
+                                  const std::vector<osg::Vec3>& vertices);
+
+    protected:
+        struct Slot { long long cell[3]; unsigned int index; };
+        void quantize(const osg::Vec3& v, long long* cell) const;
+        void insert(const long long* cell, unsigned int index);
+        size_t hash(const long long* cell) const;
+
+        std::vector<Slot> _slots;
+        float _tolerance;
+        size_t _count;
+    };
+
     class MeshCollector : public osg::NodeVisitor
     {
     public:
         MeshCollector();
         void setWeldingVertices(bool b) { _weldVertices = b; }
+        void setWeldingTolerance(float t) { _vertexMap.setTolerance(t); }
         void setUseGlobalVertices(bool b) { _globalVertices = b; }
+
+        /** Defer geometries to finishCollecting(), which transforms and welds them in parallel */
+        void setParallelCollecting(bool b) { _parallelCollecting = b; }
+        void finishCollecting();
         void setLoadingFineLevels(bool b) { _loadedFineLevels = b; }
         void setOnlyVertexAndIndices(bool b) { _onlyVertexAndIndices = b; }
 
@@ -81,20 +114,32 @@ namespace osgVerse
         };
         NonManifoldType isManifold() const;
 
+        struct CollectedGeometry
+        {
+            CollectedGeometry() : stateSet(NULL) {}
+            osg::ref_ptr<osg::Geometry> geometry; osg::Matrix matrix; osg::StateSet* stateSet;
+            std::vector<osg::Vec3> vertices; std::vector<unsigned int> indices;
+            std::vector<osg::Vec4> normals, colors, texCoords;
+        };
+
     protected:
+        void collect(CollectedGeometry& cg) const;
+        void merge(CollectedGeometry& cg);
+
         typedef std::vector<osg::Matrix> MatrixStack;
         typedef std::vector<osg::StateSet*> StateSetStack;
         MatrixStack _matrixStack;
         StateSetStack _stateSetStack;
 
-        std::map<osg::Vec3, unsigned int, Vec3MapComparer> _vertexMap;
+        std::vector<CollectedGeometry> _pendingGeometries;
+        VertexWeldingMap _vertexMap;
         std::map<VertexAttribute, std::vector<osg::Vec4>> _attributes;
         StateToVerticesMap _vertexOfStateSetMap;
         std::vector<osg::Vec3> _vertices;
         std::vector<unsigned int> _indices;
         osg::BoundingBoxd _boundingBox;
         bool _weldVertices, _globalVertices;
-        bool _loadedFineLevels, _onlyVertexAndIndices;
+        bool _loadedFineLevels, _onlyVertexAndIndices, _parallelCollecting;
     };
 
     class BoundingVolumeVisitor : public MeshCollector
@@ -130,25 +175,53 @@ namespace osgVerse
         osg::ref_ptr<osg::StateSet> _stateset;
     };
 
-    /** The 2D texture atlaser */
+    /** The 2D texture atlaser, which may spill elements into multiple pages within the max size */
     class TexturePacker : public osg::Referenced
     {
     public:
-        TexturePacker(int maxW, int maxH) : _maxWidth(maxW), _maxHeight(maxH), _dictIndex(0) {}
+        TexturePacker(int maxW, int maxH)
+        :   _maxWidth(maxW), _maxHeight(maxH), _dictIndex(0), _padding(0),
+            _bleeding(false), _rotatable(false) {}
         void setMaxSize(int w, int h) { _maxWidth = w; _maxHeight = h; }
+
+        /** Empty pixels around each element; bleeding fills them with edge pixels of the element */
+        void setPadding(int p, bool bleeding = true) { _padding = p; _bleeding = bleeding; }
+        int getPadding() const { return _padding; }
+
+        /** Allow transposing (rotating) tall elements for higher occupancy */
+        void setAllowRotation(bool b) { _rotatable = b; }
+        bool getAllowRotation() const { return _rotatable; }
         void clear();
 
         size_t addElement(osg::Image* image);
         size_t addElement(int width, int height);
         void removeElement(size_t id);
 
+        /** Pack all elements into one page */
         osg::Image* pack(size_t& numImages, bool generateResult, bool stopIfFailed = false);
+
+        /** Pack all elements into as many pages as needed (0 = no limit). If not generating
+            results, returned pages are NULL and only packing data are computed */
+        std::vector<osg::ref_ptr<osg::Image>> packPages(size_t& numImages, bool generateResult,
+                                                        int maxPages = 0);
+
         bool getPackingData(size_t id, int& x, int& y, int& w, int& h);
 
+        /** Rotated elements are transposed: (u, v) of the element maps to (x + v * w, y + u * h) */
+        bool getPackingData(size_t id, int& page, int& x, int& y, int& w, int& h, bool& rotated);
+
     protected:
         typedef std::pair<osg::observer_ptr<osg::Image>, osg::Vec4> InputPair;
+        struct PageData { int page; bool rotated; PageData() : page(0), rotated(false) {} };
+
+        bool packPage(std::vector<size_t>& elements, int page, int& totalW, int& totalH);
+        osg::Image* createPage(int page, int totalW, int totalH);
+        bool blitElement(size_t id, osg::Image* total);
+
         std::map<size_t, InputPair> _input, _result;
-        int _maxWidth, _maxHeight, _dictIndex;
+        std::map<size_t, PageData> _resultPages;
+        int _maxWidth, _maxHeight, _dictIndex, _padding;
+        bool _bleeding, _rotatable;
     };
 
     /** Create a spline sampler */
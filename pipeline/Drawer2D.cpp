@@ -1,4 +1,5 @@
 #include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
 #include <osg/Version>
 #include <osg/io_utils>
 #include <osg/ImageUtils>
@@ -6,14 +7,86 @@
 #define BL_STATIC
 #include "3rdparty/blend2d/blend2d.h"
 #include "Drawer2D.h"
+#include <unordered_map>
+#include <mutex>
+#include <cfloat>
 
 using namespace osgVerse;
 
+/** Shaped glyph run of a string, shared by all threads drawing it */
+struct ShapedText : public osg::Referenced
+{
+    BLFont font; BLGlyphBuffer buffer; BLBox boundingBox;
+    float ascent, descent, lineGap, size;
+
+    /** Text bounds as computed by drawText() for styling, at given position */
+    osg::Vec4 getBound(const osg::Vec2f& pos) const
+    {
+        const BLBox& bb = boundingBox;
+        return osg::Vec4(bb.x0 + pos[0], bb.y0 + pos[1], bb.x1 - bb.x0 + ascent,
+                         bb.y1 - bb.y0 + lineGap + size);
+    }
+
+    /** Conservative area covered by glyphs at given position (text metrics have no Y range) */
+    osg::Vec4 getExtent(const osg::Vec2f& pos) const
+    {
+        float margin = 1.0f + size * 0.25f;
+        float y0 = osg::minimum((float)boundingBox.y0, -ascent) - margin;
+        float y1 = osg::maximum((float)boundingBox.y1, descent) + margin;
+        return osg::Vec4(boundingBox.x0 + pos[0] - margin, y0 + pos[1],
+                         boundingBox.x1 - boundingBox.x0 + margin * 2.0f, y1 - y0);
+    }
+};
+
 struct BlendCore : public osg::Referenced
 {
     BLImage image;
     BLContext* context;
     std::map<std::string, BLFontFace> fonts;
+    std::map<std::pair<std::string, float>, BLFont> fontCache;
+    std::unordered_map<std::string, osg::ref_ptr<ShapedText>> textCache;
+    std::mutex cacheMutex;
+
+    /** Get or create shaped text, which is thread-safe. Return NULL if no font loaded */
+    osg::ref_ptr<ShapedText> getShapedText(const std::string& fontName, float size,
+                                           const void* text, size_t length, BLTextEncoding enc)
+    {
+        BLFont font; std::string key;
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            if (fonts.empty()) return NULL;
+            std::map<std::string, BLFontFace>::iterator fItr = fonts.find(fontName);
+            if (fItr == fonts.end()) fItr = fonts.begin();
+
+            size_t numBytes = (enc == BL_TEXT_ENCODING_UTF8) ? length
+                            : length * ((enc == BL_TEXT_ENCODING_UTF16) ? 2 : 4);
+            key = fItr->first + '\n' + std::to_string(size) + '\n' + std::to_string((int)enc)
+                + '\n' + std::string((const char*)text, numBytes);
+            std::unordered_map<std::string, osg::ref_ptr<ShapedText>>::iterator itr;
+            itr = textCache.find(key); if (itr != textCache.end()) return itr->second;
+
+            BLFont& cachedFont = fontCache[std::pair<std::string, float>(fItr->first, size)];
+            if (cachedFont.empty()) cachedFont.createFromFace(fItr->second, size);
+            font = cachedFont;
+        }
+
+        // Shaping is done outside the lock so that different texts are shaped in parallel
+        osg::ref_ptr<ShapedText> st = new ShapedText; st->font = font;
+        st->buffer.setText(text, length, enc); font.shape(st->buffer);
+        BLTextMetrics tm; font.getTextMetrics(st->buffer, tm);
+        BLFontMetrics fm = font.metrics(); st->boundingBox = tm.boundingBox;
+        st->ascent = fm.ascent; st->descent = fm.descent; st->lineGap = fm.lineGap; st->size = size;
+
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (textCache.size() > 65536) textCache.clear();
+        textCache[key] = st; return st;
+    }
+
+    void clearCache(bool withFonts)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        textCache.clear(); if (withFonts) fontCache.clear();
+    }
 };
 
 Drawer2D::Drawer2D() : _drawingInThread(0), _drawing(false)
@@ -210,14 +283,14 @@ bool Drawer2D::loadFont(const std::string& name, const std::string& file)
     BlendCore* core = (BlendCore*)_b2dData.get();
     if (core != NULL)
     {
-        BLFontFace& fontFace = core->fonts[name];
+        BLFontFace& fontFace = core->fonts[name];  // not to be called while drawing in threads
         BLArray<uint8_t> dataBuffer;
         if (BLFileSystem::readFile(file.c_str(), dataBuffer) == BL_SUCCESS)
         {
             BLFontData fontData;
             if (fontData.createFromData(dataBuffer) == BL_SUCCESS)
             {
-                fontFace.reset();
+                core->clearCache(true); fontFace.reset();
                 fontFace.createFromData(fontData, 0);
                 return true;
             }
@@ -406,28 +479,17 @@ void Drawer2D::drawText(const osg::Vec2f pos, float size, const std::wstring& te
 {
     osg::Vec4 bbox; VALID_B2D()
     {
-        if (core->fonts.empty())
+        osg::ref_ptr<ShapedText> st = core->getShapedText(
+            fontName, size, text.data(), text.size(), BL_TEXT_ENCODING_WCHAR);
+        if (!st)
         {
             OSG_WARN << "[Drawer2D] Unable to draw text without any font" << std::endl;
             return;
         }
 
-        BLFontFace& fontFace = core->fonts.begin()->second;
-        if (core->fonts.find(fontName) != core->fonts.end())
-            fontFace = core->fonts[fontName];
-
-        BLFont font; font.createFromFace(fontFace, size);
-#if false
-        bbox.set(pos[0], pos[1] - size, size * text.size(), size);
-        STYLE_CASES(osgVerse_Drawer::drawText, core->context, pos, font, text, sd.filled);
-#else
-        BLGlyphBuffer gb; gb.setUtf16Text((uint16_t*)text.data(), text.size());
-        BLTextMetrics tm; BLFontMetrics fm = font.metrics(); font.shape(gb);
-        font.getTextMetrics(gb, tm); float xx = fm.ascent, yy = fm.lineGap + size;
-        const BLBox& bb = tm.boundingBox; bbox.set(bb.x0, bb.y0, bb.x1 - bb.x0 + xx, bb.y1 - bb.y0 + yy);
-        bbox[0] += pos[0]; bbox[1] += pos[1];
-        STYLE_CASES(osgVerse_Drawer::drawTextBuffer, core->context, pos, font, gb, sd.filled);
-#endif
+        bbox = st->getBound(pos);
+        STYLE_CASES(osgVerse_Drawer::drawTextBuffer, core->context, pos,
+                    st->font, st->buffer, sd.filled);
     }
 }
 
@@ -436,44 +498,113 @@ void Drawer2D::drawUtf8Text(const osg::Vec2f pos, float size, const std::string&
 {
     osg::Vec4 bbox; VALID_B2D()
     {
-        if (core->fonts.empty())
+        osg::ref_ptr<ShapedText> st = core->getShapedText(
+            fontName, size, text.data(), text.size(), BL_TEXT_ENCODING_UTF8);
+        if (!st)
+        {
+            OSG_WARN << "[Drawer2D] Unable to draw text without any font" << std::endl;
+            return;
+        }
+
+        bbox = st->getBound(pos);
+        STYLE_CASES(osgVerse_Drawer::drawTextBuffer, core->context, pos,
+                    st->font, st->buffer, sd.filled);
+    }
+}
+
+void Drawer2D::drawTexts(const std::vector<TextData>& texts, int numTiles)
+{
+    VALID_B2D()
+    {
+        int numTexts = (int)texts.size(); if (numTexts == 0) return;
+        std::vector<osg::ref_ptr<ShapedText>> shapes(numTexts);
+        std::vector<osg::Vec4> bounds(numTexts), extents(numTexts);
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int i = 0; i < numTexts; ++i)
+        {
+            const TextData& td = texts[i];
+            shapes[i] = core->getShapedText(td.font, td.size, td.text.data(),
+                                            td.text.size(), BL_TEXT_ENCODING_WCHAR);
+            if (!shapes[i]) continue;
+            bounds[i] = shapes[i]->getBound(td.pos); extents[i] = shapes[i]->getExtent(td.pos);
+        }
+
+        if (!shapes[0])
         {
             OSG_WARN << "[Drawer2D] Unable to draw text without any font" << std::endl;
             return;
         }
 
-        BLFontFace& fontFace = core->fonts.begin()->second;
-        if (core->fonts.find(fontName) != core->fonts.end())
-            fontFace = core->fonts[fontName];
+        // Finish pending commands first, as tiles are drawn to image data directly
+        BLImageData data; core->context->flush(BL_CONTEXT_FLUSH_SYNC);
+        if (core->image.getData(&data) != BL_SUCCESS || data.size.h < 1) return;
+
+        int h = data.size.h; if (numTiles < 1) numTiles = OpenThreads::GetNumberOfProcessors();
+        numTiles = osg::clampBetween(numTiles, 1, osg::maximum(h / 16, 1));
+        int tileH = (h + numTiles - 1) / numTiles;
 
-        BLFont font; font.createFromFace(fontFace, size);
-#if false
-        bbox.set(pos[0], pos[1] - size, size * text.size(), size);
-        STYLE_CASES(osgVerse_Drawer::drawText, core->context, pos, font, text, sd.filled);
-#else
-        BLGlyphBuffer gb; gb.setUtf8Text(text.data(), text.size());
-        BLTextMetrics tm; BLFontMetrics fm = font.metrics(); font.shape(gb);
-        font.getTextMetrics(gb, tm); float xx = fm.ascent, yy = fm.lineGap + size;
-        const BLBox& bb = tm.boundingBox; bbox.set(bb.x0, bb.y0, bb.x1 - bb.x0 + xx, bb.y1 - bb.y0 + yy);
-        bbox[0] += pos[0]; bbox[1] += pos[1];
-        STYLE_CASES(osgVerse_Drawer::drawTextBuffer, core->context, pos, font, gb, sd.filled);
-#endif
+        // Dispatch texts to tiles by their transformed bounds
+        BLMatrix2D transform = core->context->finalTransform();
+        std::vector<std::vector<int>> tileTexts(numTiles);
+        for (int i = 0; i < numTexts; ++i)
+        {
+            if (!shapes[i]) continue; const osg::Vec4& b = extents[i];
+            double yMin = FLT_MAX, yMax = -FLT_MAX;
+            for (int c = 0; c < 4; ++c)
+            {
+                BLPoint pt = transform.mapPoint(b[0] + ((c & 1) ? b[2] : 0.0f),
+                                                b[1] + ((c & 2) ? b[3] : 0.0f));
+                yMin = osg::minimum(yMin, pt.y); yMax = osg::maximum(yMax, pt.y);
+            }
+
+            if (yMax < 0.0 || yMin > (double)h) continue;
+            int t0 = osg::clampBetween((int)floor(yMin) / tileH, 0, numTiles - 1);
+            int t1 = osg::clampBetween((int)ceil(yMax) / tileH, 0, numTiles - 1);
+            for (int t = t0; t <= t1; ++t) tileTexts[t].push_back(i);
+        }
+
+        // Each tile has its own context on part of the image rows
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int t = 0; t < numTiles; ++t)
+        {
+            int y0 = t * tileH, y1 = osg::minimum(y0 + tileH, h);
+            if (y0 >= y1 || tileTexts[t].empty()) continue;
+
+            BLImage tileImage; BLContext context;
+            uint8_t* rows = (uint8_t*)data.pixelData + (intptr_t)y0 * data.stride;
+            if (tileImage.createFromData(data.size.w, y1 - y0, (BLFormat)data.format,
+                                         rows, data.stride) != BL_SUCCESS) continue;
+            if (context.begin(tileImage) != BL_SUCCESS) continue;
+            context.applyTransform(transform); context.postTranslate(0.0, -(double)y0);
+            context.setStrokeWidth(core->context->strokeWidth());
+
+            const std::vector<int>& indices = tileTexts[t];
+            for (size_t n = 0; n < indices.size(); ++n)
+            {
+                int index = indices[n]; const TextData& td = texts[index];
+                const StyleData& sd = td.style; const osg::Vec4& bbox = bounds[index];
+                ShapedText* st = shapes[index].get();
+                STYLE_CASES(osgVerse_Drawer::drawTextBuffer, &context, td.pos,
+                            st->font, st->buffer, sd.filled);
+            }
+            context.end();
+        }
     }
 }
 
+void Drawer2D::clearTextCache()
+{
+    BlendCore* core = (BlendCore*)_b2dData.get();
+    if (core != NULL) core->clearCache(false);
+}
+
 osg::Vec4 Drawer2D::getTextBoundingBox(const std::wstring& text, float size, const std::string& fontName)
 {
     osg::Vec4 bbox; VALID_B2D()
     {
-        if (core->fonts.empty()) return bbox;
-        BLFontFace& fontFace = core->fonts.begin()->second;
-        if (core->fonts.find(fontName) != core->fonts.end()) fontFace = core->fonts[fontName];
-
-        BLFont font; font.createFromFace(fontFace, size);
-        BLGlyphBuffer gb; gb.setUtf16Text((uint16_t*)text.data(), text.size());
-        BLTextMetrics tm; BLFontMetrics fm = font.metrics(); font.shape(gb);
-        font.getTextMetrics(gb, tm); float xx = fm.ascent, yy = fm.lineGap + size;
-        const BLBox& bb = tm.boundingBox; bbox.set(bb.x0, bb.y0, bb.x1 - bb.x0 + xx, bb.y1 - bb.y0 + yy);
+        osg::ref_ptr<ShapedText> st = core->getShapedText(
+            fontName, size, text.data(), text.size(), BL_TEXT_ENCODING_WCHAR);
+        if (st.valid()) bbox = st->getBound(osg::Vec2f());
     }
     return bbox;
 }
@@ -482,15 +613,12 @@ osg::Vec4 Drawer2D::getUtf8TextBoundingBox(const std::string& text, float size,
 {
     osg::Vec4 bbox; VALID_B2D()
     {
-        if (core->fonts.empty()) return bbox;
-        BLFontFace& fontFace = core->fonts.begin()->second;
-        if (core->fonts.find(fontName) != core->fonts.end()) fontFace = core->fonts[fontName];
+        osg::ref_ptr<ShapedText> st = core->getShapedText(
+            fontName, size, text.data(), text.size(), BL_TEXT_ENCODING_UTF8);
+        if (!st) return bbox;
 
-        BLFont font; font.createFromFace(fontFace, size);
-        BLGlyphBuffer gb; gb.setUtf8Text(text.data(), text.size());
-        BLTextMetrics tm; BLFontMetrics fm = font.metrics(); font.shape(gb);
-        font.getTextMetrics(gb, tm); float xx = fm.ascent, yy = fm.lineGap + size;
-        const BLBox& bb = tm.boundingBox; bbox.set(bb.x0, bb.y0 + fm.descent, bb.x1 - bb.x0, bb.y1 - bb.y0 + yy);
+        const BLBox& bb = st->boundingBox;
+        bbox.set(bb.x0, bb.y0 + st->descent, bb.x1 - bb.x0, bb.y1 - bb.y0 + st->lineGap + size);
     }
     return bbox;
 }
@@ -64,6 +64,22 @@ namespace osgVerse
         osg::Vec4 getTextBoundingBox(const std::wstring& text, float size, const std::string& font = std::string());
         osg::Vec4 getUtf8TextBoundingBox(const std::string& text, float size, const std::string& font = std::string());
 
+        struct TextData
+        {
+            TextData(const osg::Vec2f& p, float s, const std::wstring& t,
+                     const StyleData& d = StyleData(), const std::string& f = std::string())
+            : pos(p), text(t), font(f), style(d), size(s) {}
+
+            osg::Vec2f pos; std::wstring text; std::string font;
+            StyleData style; float size;
+        };
+
+        /** Draw a batch of texts (e.g. label atlas). Texts are shaped in parallel, and the image is
+            split into horizontal tiles rasterized by separate threads (0 = number of CPUs).
+            Shaped texts of all drawText*() functions are cached by font, size and string */
+        void drawTexts(const std::vector<TextData>& texts, int numTiles = 0);
+        void clearTextCache();
+
         void drawLine(const osg::Vec2f pos0, const osg::Vec2f pos1,
                       const StyleData& sd = StyleData());
         void drawPolyline(const std::vector<osg::Vec2f>& points, bool closed,
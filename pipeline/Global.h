@@ -32,6 +32,15 @@ namespace osgVerse
         /*12*/"osg_TexCoord4", /*13*/"osg_TexCoord5", /*14*/"osg_TexCoord6", /*15*/"osg_TexCoord7"
     };
 
+    /** Per-instance matrix rows of instanced drawables (at attribute 12-15, with divisor 1),
+        used by standard shaders when the uniform "InstancedDraw" of the drawable is true */
+    static std::string instanceAttributeNames[] =
+    {
+        /*12*/"osg_InstanceMatrix0", /*13*/"osg_InstanceMatrix1",
+        /*14*/"osg_InstanceMatrix2", /*15*/"osg_InstanceMatrix3"
+    };
+    static const int instanceAttributeLocation = 12;
+
     /** Global-defined texture-map uniform names, for full-featured pipeline use */
     static std::string uniformNames[] =
     {
@@ -3,9 +3,13 @@
 #include <osg/ValueObject>
 #include <osg/Depth>
 #include <osg/Billboard>
+#include <osg/Timer>
 #include <osgDB/ReadFile>
 #include <osgUtil/RenderStage>
 #include <osgViewer/Renderer>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdarg.h>
@@ -89,21 +93,184 @@ struct MyClampProjectionCallback : public osg::CullSettings::ClampProjectionMatr
     osg::observer_ptr<osgVerse::DeferredRenderCallback> _callback;
 };
 
+/** Input stages / forward camera with identical view, projection and cull settings are found at
+    the beginning of each frame's culling. The first one being culled traverses the scene for all,
+    recording visible drawables with bits of stages that accept them; others replay the records
+    with their own camera statesets instead of traversing again. Records keep statesets instead of
+    owner's state graphs, as the owner's render graph is pruned before others replay them */
+class SharedCullingManager : public osg::Referenced
+{
+public:
+    typedef std::vector<osg::ref_ptr<const osg::StateSet>> StateSetChain;
+    struct Record
+    {
+        osg::ref_ptr<osg::Drawable> drawable;
+        osg::ref_ptr<osg::RefMatrix> modelView, projection;
+        float depth; unsigned int stateChain, stageBits;
+    };
+
+    struct Group : public osg::Referenced
+    {
+        std::vector<osg::Camera*> members;
+        std::vector<unsigned int> cullMasks;
+        std::vector<StateSetChain> stateChains;
+        std::vector<Record> records;
+        bool active, ready, complete;
+
+        unsigned int getStageBits(unsigned int mask) const
+        {
+            unsigned int bits = 0;
+            for (size_t i = 0; i < cullMasks.size(); ++i)
+            { if (cullMasks[i] & mask) bits |= (1u << i); }
+            return bits;
+        }
+    };
+
+    SharedCullingManager() : _waitBudget(10.0), _waitedTime(0.0), _frameNumber(0), _enabled(true) {}
+    void setEnabled(bool b) { _enabled = b; }
+    bool getEnabled() const { return _enabled; }
+
+    /** Max time (in milliseconds) of all stages waiting for owners in a frame */
+    void setWaitBudget(double ms) { _waitBudget = ms; }
+    double getWaitBudget() const { return _waitBudget; }
+
+    void addCamera(osg::Camera* cam)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _cameras.push_back(cam);
+    }
+
+    void clear()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _cameras.clear(); _groups.clear();
+    }
+
+    /** Find or create shared group of the camera; returns NULL if it should cull by itself */
+    Group* begin(osg::Camera* cam, unsigned int frameNo, int& index)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        if (!_enabled || isShadowCamera(cam)) return NULL;
+        if (frameNo != _frameNumber)
+        {
+            for (size_t i = 0; i < _groups.size(); ++i) _groups[i]->active = false;
+            _frameNumber = frameNo; _waitedTime = 0.0;
+        }
+
+        for (size_t i = 0; i < _groups.size(); ++i)
+        {
+            Group* g = _groups[i].get(); if (!g->active) continue;
+            std::vector<osg::Camera*>::iterator itr =
+                std::find(g->members.begin(), g->members.end(), cam);
+            if (itr == g->members.end()) continue;
+
+            // Wait for the owner which may be culling in another thread, until the frame budget
+            // is spent; then this stage culls by itself instead
+            osg::Timer_t t0 = osg::Timer::instance()->tick();
+            double remaining = _waitBudget - _waitedTime;
+            while (!g->ready && remaining > 0.0)
+            {
+                _condition.wait(&_mutex, (unsigned long)ceil(remaining));
+                remaining = _waitBudget - _waitedTime -
+                            osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick());
+            }
+            _waitedTime += osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick());
+            index = (int)(itr - g->members.begin());
+            return (g->ready && g->complete) ? g : NULL;
+        }
+
+        // Create a new group with current camera as the owner
+        Group* group = NULL;
+        for (size_t i = 0; i < _groups.size(); ++i)
+        { if (!_groups[i]->active) { group = _groups[i].get(); break; } }
+        if (!group) { group = new Group; _groups.push_back(group); }
+        group->members.clear(); group->cullMasks.clear();
+        group->records.clear(); group->stateChains.clear();
+        group->members.push_back(cam);
+        for (size_t i = 0; i < _cameras.size() && group->members.size() < 32; ++i)
+        {
+            osg::Camera* c = _cameras[i].get();
+            if (c && c != cam && isSameCulling(*cam, *c)) group->members.push_back(c);
+        }
+        if (group->members.size() < 2) return NULL;
+
+        for (size_t i = 0; i < group->members.size(); ++i)
+        {
+            unsigned int cullMask = 0xffffffff;
+            group->members[i]->getUserValue("PipelineCullMask", cullMask);
+            group->cullMasks.push_back(cullMask);
+        }
+        group->active = true; group->ready = false; group->complete = true;
+        index = 0; return group;
+    }
+
+    void finish(Group* g)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        g->ready = true; _condition.broadcast();
+    }
+
+protected:
+    static bool isShadowCamera(osg::Camera* cam)
+    { return dynamic_cast<osgVerse::ShadowModule::ShadowData*>(cam->getUserData()) != NULL; }
+
+    static bool isSameCulling(osg::Camera& c0, osg::Camera& c1)
+    {
+        if (c0.getViewMatrix() != c1.getViewMatrix() ||
+            c0.getProjectionMatrix() != c1.getProjectionMatrix()) return false;
+        if (c0.getReferenceFrame() != c1.getReferenceFrame() || c0.getCullMask() != c1.getCullMask() ||
+            c0.getCullingMode() != c1.getCullingMode() || c0.getLODScale() != c1.getLODScale() ||
+            c0.getSmallFeatureCullingPixelSize() != c1.getSmallFeatureCullingPixelSize() ||
+            c0.getComputeNearFarMode() != c1.getComputeNearFarMode()) return false;
+
+        const osg::Viewport *vp0 = c0.getViewport(), *vp1 = c1.getViewport();
+        if (!vp0 || !vp1 || vp0->width() != vp1->width() || vp0->height() != vp1->height()) return false;
+        if (isShadowCamera(&c1) || c0.getNumChildren() != c1.getNumChildren()) return false;
+        for (unsigned int i = 0; i < c0.getNumChildren(); ++i)
+        { if (c0.getChild(i) != c1.getChild(i)) return false; }
+        return true;
+    }
+
+    std::vector<osg::observer_ptr<osg::Camera>> _cameras;
+    std::vector<osg::ref_ptr<Group>> _groups;
+    OpenThreads::Mutex _mutex;
+    OpenThreads::Condition _condition;
+    double _waitBudget, _waitedTime;
+    unsigned int _frameNumber;
+    bool _enabled;
+};
+
 class MyCullVisitor : public osgUtil::CullVisitor
 {
 public:
     MyCullVisitor()
-    :   osgUtil::CullVisitor(), _cullMask(0xffffffff), _defaultMask(0xffffffff) {}
+    :   osgUtil::CullVisitor(), _cullMask(0xffffffff), _defaultMask(0xffffffff),
+        _sharedBaseStateGraph(NULL), _sharedBaseProjection(NULL), _sharedAllBits(0), _drawableBits(0),
+        _sharedIndex(-1), _sharedReplayed(false) {}
     MyCullVisitor(const MyCullVisitor& v)
     :   osgUtil::CullVisitor(v), _callback(v._callback), _shadowData(v._shadowData),
         _shadowViewport(v._shadowViewport), _pipelineMaskPath(v._pipelineMaskPath),
         _shadowModelViews(v._shadowModelViews), _shadowProjections(v._shadowProjections),
-        _pixelSizeVectorList(v._pixelSizeVectorList), _cullMask(v._cullMask), _defaultMask(v._defaultMask) {}
+        _pixelSizeVectorList(v._pixelSizeVectorList), _cullMask(v._cullMask), _defaultMask(v._defaultMask),
+        _sharedBaseStateGraph(NULL), _sharedBaseProjection(NULL), _sharedAllBits(0), _drawableBits(0),
+        _sharedIndex(-1), _sharedReplayed(false) {}
 
     virtual CullVisitor* clone() const { return new MyCullVisitor(*this); }
     void setDeferredCallback(osgVerse::DeferredRenderCallback* cb) { _callback = cb; }
     osgVerse::DeferredRenderCallback* getDeferredCallback() { return _callback.get(); }
 
+    void setSharedCulling(SharedCullingManager* m) { _sharedCulling = m; }
+    SharedCullingManager* getSharedCulling() { return _sharedCulling.get(); }
+
+    /** Publish recorded drawables if this is the owner of a shared group; call after culling */
+    void finishSharedCulling()
+    {
+        if (_sharedGroup.valid() && _sharedIndex == 0 && _sharedCulling.valid())
+            _sharedCulling->finish(_sharedGroup.get());
+        _sharedGroup = NULL; _sharedIndex = -1; _sharedBitsPath.clear(); _sharedStateChains.clear();
+        _sharedBaseStateGraph = NULL; _sharedBaseProjection = NULL;
+    }
+
     struct PassableData
     {
         PassableData() : maskSet(0) {}
@@ -136,6 +303,21 @@ public:
             }
         }
 
+#if OSG_VERSION_GREATER_THAN(3, 5, 9)
+        // Join shared culling, except the near/far computing mode (which also calls reset())
+        finishSharedCulling(); _sharedReplayed = false;
+        if (cam && _sharedCulling.valid() && this->getUserData() == NULL && !_shadowData &&
+            getFrameStamp() != NULL)
+        {
+            _sharedGroup = _sharedCulling->begin(cam, getFrameStamp()->getFrameNumber(), _sharedIndex);
+            if (_sharedGroup.valid() && _sharedIndex == 0)
+            {
+                size_t numMembers = _sharedGroup->members.size();
+                _sharedAllBits = (numMembers < 32) ? ((1u << numMembers) - 1) : 0xffffffff;
+            }
+        }
+#endif
+
 #if false
         OSG_NOTICE << "F-" << (getFrameStamp() != NULL ? getFrameStamp()->getFrameNumber() : -1)
                    << (getUserData() != NULL ? " (COMPUTING NEAR/FAR): " : ": ")
@@ -148,13 +330,22 @@ public:
     {
         pdata.maskSet = 0; pushM(node, pdata);
         if (this->getUserData() != NULL) return true;  // computing near/far mode
+        if (_sharedGroup.valid())
+        {
+            if (_sharedIndex > 0) { replaySharedDrawables(); return false; }
+            else if (!_sharedBaseStateGraph)
+            {   // Statesets above this are camera's ones, which are not recorded
+                _sharedBaseStateGraph = _currentStateGraph;
+                _sharedBaseProjection = getProjectionMatrix();
+            }
+        }
+
         if (node.getUserDataContainer() != NULL)
         {
             // Use this to replace nodemasks while checking deferred/forward graphs
             unsigned int nodePipMask = 0xffffffff, flags = 0;
-            if (node.getUserValue("PipelineMask", nodePipMask))
+            if (osgVerse::Pipeline::getPipelineMaskAndFlags(node, nodePipMask, flags))
             {
-                node.getUserValue("PipelineFlags", flags);
                 if (!_pipelineMaskPath.empty())
                 {
                     std::pair<unsigned int, unsigned int> lastM = _pipelineMaskPath.back();
@@ -168,14 +359,15 @@ public:
                 if (flags & osg::StateAttribute::ON)
                 {
                     pushMaskPath(nodePipMask, flags); pdata.maskSet |= 1;
-                    if ((_cullMask & nodePipMask) != 0)
-                        return !checkSmallPixelSizeCulling(node.getBound());
-                    return false;
+                    bool accepted = isSharedOwner() ? (_sharedBitsPath.back() != 0)
+                                  : ((_cullMask & nodePipMask) != 0);
+                    return accepted && !checkSmallPixelSizeCulling(node.getBound());
                 }  // otherwise, treat the mask as not set
             }
         }
 
         if (checkSmallPixelSizeCulling(node.getBound())) return false;
+        if (isSharedOwner()) return getSharedBits() != 0;
         if (!_pipelineMaskPath.empty())
         {
             std::pair<unsigned int, unsigned int> maskAndFlags = _pipelineMaskPath.back();
@@ -189,9 +381,9 @@ public:
         unsigned int nodePipMask = 0xffffffff, flags = 0;
         pdata.maskSet = 0; pushM(node, pdata);
         if (this->getUserData() != NULL) return true;  // computing near/far mode
-        if (node.getUserValue("PipelineMask", nodePipMask))
+        if (_sharedGroup.valid() && _sharedIndex > 0) { replaySharedDrawables(); return false; }
+        if (osgVerse::Pipeline::getPipelineMaskAndFlags(node, nodePipMask, flags))
         {
-            node.getUserValue("PipelineFlags", flags);
             if (!_pipelineMaskPath.empty())
             {
                 std::pair<unsigned int, unsigned int> lastM = _pipelineMaskPath.back();
@@ -204,6 +396,11 @@ public:
 
             if (flags & osg::StateAttribute::ON)
             {
+                if (isSharedOwner())
+                {
+                    _drawableBits = getSharedBits() & _sharedGroup->getStageBits(nodePipMask);
+                    return _drawableBits != 0 && !checkSmallPixelSizeCulling(node.getBound());
+                }
                 if ((_cullMask & nodePipMask) != 0)
                     return !checkSmallPixelSizeCulling(node.getBound());
                 return false;
@@ -211,6 +408,12 @@ public:
         }
 
         if (checkSmallPixelSizeCulling(node.getBound())) return false;
+        if (isSharedOwner())
+        {
+            _drawableBits = _pipelineMaskPath.empty()
+                          ? _sharedGroup->getStageBits(_defaultMask) : getSharedBits();
+            return _drawableBits != 0;
+        }
         if (_pipelineMaskPath.empty())
         {
             // Handle drawables which is never been set pipeline masks:
@@ -261,10 +464,26 @@ public:
     { PassableData s; if (passable(node, s)) osgUtil::CullVisitor::apply(node); popM(node, s); }
 
     virtual void apply(osg::Camera& node)
-    { PassableData s; if (passable(node, s)) osgUtil::CullVisitor::apply(node); popM(node, s); }
+    {
+        PassableData s;
+        if (passable(node, s))
+        {   // Nested cameras and billboards are not recorded, so stop sharing results
+            if (isSharedOwner()) _sharedGroup->complete = false;
+            osgUtil::CullVisitor::apply(node);
+        }
+        popM(node, s);
+    }
 
     virtual void apply(osg::Billboard& node)
-    { PassableData s; if (passable(node, s)) osgUtil::CullVisitor::apply(node); popM(node, s); }
+    {
+        PassableData s;
+        if (passable(node, s))
+        {
+            if (isSharedOwner()) _sharedGroup->complete = false;
+            osgUtil::CullVisitor::apply(node);
+        }
+        popM(node, s);
+    }
 
 #if OSG_VERSION_GREATER_THAN(3, 2, 3)
     virtual void apply(osg::Geode& node)
@@ -286,7 +505,10 @@ public:
             }
 
             if (drawable.isCullingActive() && isCulled(bb)) { popM(drawable, s); return; }
-            if (_computeNearFar && bb.valid())
+
+            // As the owner of shared culling, the drawable may be only visible to other stages
+            bool forMe = !isSharedOwner() || (_drawableBits & 1) != 0;
+            if (forMe && _computeNearFar && bb.valid())
                 { if (!updateCalculatedNearFar(matrix, drawable, false)) {popM(drawable, s); return;} }
 
             // push the geoset's state on the geostate stack.
@@ -313,7 +535,11 @@ public:
                            << ", ValidModelView: " << matrix.valid() << std::endl;
             }
             else
-                addDrawableAndDepth(&drawable, &matrix, depth);
+            {
+                if (isSharedOwner() && (_drawableBits & ~1u) != 0)
+                    recordSharedDrawable(drawable, matrix, depth);
+                if (forMe) addDrawableAndDepth(&drawable, &matrix, depth);
+            }
             for (unsigned int i = 0; i < numPopStateSetRequired; ++i) { popStateSet(); }
 #   else
             osgUtil::CullVisitor::apply(drawable);
@@ -414,7 +640,80 @@ protected:
     }
 
     inline void pushMaskPath(unsigned int m, unsigned int f)
-    { _pipelineMaskPath.push_back(std::pair<unsigned int, unsigned int>(m, f)); }
+    {
+        if (isSharedOwner()) _sharedBitsPath.push_back(getSharedBits() & _sharedGroup->getStageBits(m));
+        _pipelineMaskPath.push_back(std::pair<unsigned int, unsigned int>(m, f));
+    }
+
+    /** Shared culling owner works with a bit set of stages instead of its own cull mask */
+    inline bool isSharedOwner() const { return _sharedGroup.valid() && _sharedIndex == 0; }
+    inline unsigned int getSharedBits() const
+    { return _sharedBitsPath.empty() ? _sharedAllBits : _sharedBitsPath.back(); }
+
+    void recordSharedDrawable(osg::Drawable& drawable, osg::RefMatrix& matrix, float depth)
+    {
+        SharedCullingManager::Record r; r.stateChain = getSharedStateChain();
+        if (r.stateChain == (unsigned int)-1) return;  // not under owner's camera
+        r.drawable = &drawable; r.modelView = &matrix; r.depth = depth;
+        r.projection = (getProjectionMatrix() != _sharedBaseProjection) ? getProjectionMatrix() : NULL;
+        r.stageBits = _drawableBits & ~1u; _sharedGroup->records.push_back(r);
+    }
+
+    /** Copy statesets from current state graph up to owner's camera, which are alive only
+        during owner's culling; each state graph is copied once */
+    unsigned int getSharedStateChain()
+    {
+        std::map<const osgUtil::StateGraph*, unsigned int>::iterator itr =
+            _sharedStateChains.find(_currentStateGraph);
+        if (itr != _sharedStateChains.end()) return itr->second;
+
+        SharedCullingManager::StateSetChain chain; const osgUtil::StateGraph* sg = _currentStateGraph;
+        for (; sg != NULL && sg != _sharedBaseStateGraph; sg = sg->_parent)
+            chain.push_back(sg->getStateSet());
+
+        unsigned int index = (unsigned int)-1;
+        if (sg != NULL)
+        {
+            std::reverse(chain.begin(), chain.end());
+            index = (unsigned int)_sharedGroup->stateChains.size();
+            _sharedGroup->stateChains.push_back(chain);
+        }
+        _sharedStateChains[_currentStateGraph] = index; return index;
+    }
+
+    void replaySharedDrawables()
+    {
+        if (_sharedReplayed) return; else _sharedReplayed = true;
+        SharedCullingManager::Group* group = _sharedGroup.get();
+        unsigned int bit = (1u << _sharedIndex);
+
+        std::vector<const osg::StateSet*> pushed;
+        osg::ref_ptr<osg::RefMatrix> modelView; osg::RefMatrix* lastModelView = NULL;
+        for (size_t i = 0; i < group->records.size(); ++i)
+        {
+            const SharedCullingManager::Record& r = group->records[i];
+            if ((r.stageBits & bit) == 0) continue;
+
+            // Only push statesets different from last record
+            const SharedCullingManager::StateSetChain& chain = group->stateChains[r.stateChain];
+            size_t numSame = 0;
+            while (numSame < chain.size() && numSame < pushed.size() &&
+                   chain[numSame].get() == pushed[numSame]) numSame++;
+            for (size_t j = numSame; j < pushed.size(); ++j) popStateSet();
+            pushed.resize(numSame);
+            for (size_t j = numSame; j < chain.size(); ++j)
+            { pushStateSet(chain[j].get()); pushed.push_back(chain[j].get()); }
+
+            if (r.modelView.get() != lastModelView)
+            { modelView = createOrReuseMatrix(*r.modelView); lastModelView = r.modelView.get(); }
+            if (r.projection.valid()) pushProjectionMatrix(createOrReuseMatrix(*r.projection));
+            if (!_computeNearFar || !r.drawable->getBoundingBox().valid() ||
+                updateCalculatedNearFar(*modelView, *r.drawable, false))
+                addDrawableAndDepth(r.drawable.get(), modelView.get(), r.depth);
+            if (r.projection.valid()) popProjectionMatrix();
+        }
+        for (size_t j = 0; j < pushed.size(); ++j) popStateSet();
+    }
 
     template<typename T>
     inline void pushM(T& node, PassableData& pdata)
@@ -434,6 +733,7 @@ protected:
 
         if (pdata.maskSet == 0) return;
         if (!_pipelineMaskPath.empty()) _pipelineMaskPath.pop_back();
+        if (!_sharedBitsPath.empty()) _sharedBitsPath.pop_back();
     }
 
     bool canDisableStateSet(const osg::StateSet& ss) const
@@ -471,6 +771,15 @@ protected:
     MatrixValueStack _shadowModelViews, _shadowProjections;
     std::vector<osg::Vec4> _pixelSizeVectorList;
     unsigned int _cullMask, _defaultMask;
+
+    osg::ref_ptr<SharedCullingManager> _sharedCulling;
+    osg::ref_ptr<SharedCullingManager::Group> _sharedGroup;
+    std::map<const osgUtil::StateGraph*, unsigned int> _sharedStateChains;
+    const osgUtil::StateGraph* _sharedBaseStateGraph;
+    osg::RefMatrix* _sharedBaseProjection;
+    std::vector<unsigned int> _sharedBitsPath;
+    unsigned int _sharedAllBits, _drawableBits;
+    int _sharedIndex; bool _sharedReplayed;
 };
 
 class MySceneView : public osgUtil::SceneView
@@ -495,6 +804,8 @@ public:
         // Do regular culling and apply every input camera's inverse(ViewProj) uniform to all sceneViews
         // This uniform is helpful for deferred passes to rebuild world vertex and normals
         osgUtil::SceneView::cull();
+        MyCullVisitor* cv = dynamic_cast<MyCullVisitor*>(getCullVisitor());
+        if (cv) cv->finishSharedCulling();  // let other stages sharing culling results continue
         if (_callback.valid()) _callback->applyAndUpdateCameraUniforms(this);
 
         // Register RTT camera with depth buffer for later blitting with forward pass
@@ -543,7 +854,7 @@ public:
         osgViewer::Renderer::compile();
     }
 
-    void useCustomSceneViews(osgVerse::DeferredRenderCallback* cb)
+    void useCustomSceneViews(osgVerse::DeferredRenderCallback* cb, SharedCullingManager* sc = NULL)
     {
         unsigned int opt = osgUtil::SceneView::HEADLIGHT;
         osgViewer::View* view = dynamic_cast<osgViewer::View*>(_camera->getView());
@@ -557,8 +868,8 @@ public:
             }
         }
 
-        osg::ref_ptr<osgUtil::SceneView> sceneView0 = useCustomSceneView(0, opt, cb);
-        osg::ref_ptr<osgUtil::SceneView> sceneView1 = useCustomSceneView(1, opt, cb);
+        osg::ref_ptr<osgUtil::SceneView> sceneView0 = useCustomSceneView(0, opt, cb, sc);
+        osg::ref_ptr<osgUtil::SceneView> sceneView1 = useCustomSceneView(1, opt, cb, sc);
         _sceneView[0] = sceneView0; sceneView0->setName("SceneView0");
         _sceneView[1] = sceneView1; sceneView1->setName("SceneView1");
         _availableQueue._queue.clear();
@@ -568,7 +879,8 @@ public:
 
 protected:
     osgUtil::SceneView* useCustomSceneView(unsigned int i, unsigned int flags,
-                                           osgVerse::DeferredRenderCallback* cb)
+                                           osgVerse::DeferredRenderCallback* cb,
+                                           SharedCullingManager* sc)
     {
         osg::ref_ptr<osgUtil::SceneView> newSceneView = new MySceneView(cb);
         newSceneView->setFrameStamp(const_cast<osg::FrameStamp*>(_sceneView[i]->getFrameStamp()));
@@ -588,6 +900,7 @@ protected:
 #if true
         MyCullVisitor* cullVisitor = new MyCullVisitor;
         cullVisitor->setDeferredCallback(cb);
+        cullVisitor->setSharedCulling(sc);
         cullVisitor->setStateGraph(_sceneView[i]->getStateGraph());
         cullVisitor->setRenderStage(_sceneView[i]->getRenderStage());
         newSceneView->setCullVisitor(cullVisitor);
@@ -728,6 +1041,7 @@ namespace osgVerse
     Pipeline::Pipeline(int glContextVer, int glslVer)
     {
         _deferredCallback = new osgVerse::DeferredRenderCallback(true);
+        _sharedCulling = new SharedCullingManager;
         _deferredDepth = new osg::Depth(osg::Depth::LESS, 0.0, 1.0, false);
         _invScreenResolution = new osg::Uniform(
             "InvScreenResolution", osg::Vec2(1.0f / 1920.0f, 1.0f / 1080.0f));
@@ -977,6 +1291,7 @@ namespace osgVerse
             _deferredCallback->getRunners().clear();
             _deferredCallback->setClampCallback(NULL);
         }
+        if (_sharedCulling.valid()) static_cast<SharedCullingManager*>(_sharedCulling.get())->clear();
 
         if (!mainCam) mainCam = view->getCamera();
         mainCam->setGraphicsContext(_stageContext.get());
@@ -1066,6 +1381,12 @@ namespace osgVerse
 #endif
     }
 
+    void Pipeline::setUseSharedCulling(bool b)
+    { static_cast<SharedCullingManager*>(_sharedCulling.get())->setEnabled(b); }
+
+    bool Pipeline::getUseSharedCulling() const
+    { return static_cast<const SharedCullingManager*>(_sharedCulling.get())->getEnabled(); }
+
     Pipeline::Stage* Pipeline::getStage(osg::Camera* camera)
     {
         for (size_t i = 0; i < _stages.size(); ++i)
@@ -1088,8 +1409,12 @@ namespace osgVerse
 
         if (stage != NULL || camera == _forwardCamera.get())
         {
+            SharedCullingManager* sc = static_cast<SharedCullingManager*>(_sharedCulling.get());
+            if (sc && (camera == _forwardCamera.get() || stage->inputStage)) sc->addCamera(camera);
+            else sc = NULL;
+
             MyRenderer* render = new MyRenderer(camera);
-            render->useCustomSceneViews(_deferredCallback.get());
+            render->useCustomSceneViews(_deferredCallback.get(), sc);
             return render;
         }
         else
@@ -1319,7 +1644,10 @@ namespace osgVerse
         {
             prog->addBindAttribLocation(attributeNames[6], 6);
             //prog->addBindAttribLocation(attributeNames[7], 7);
+            for (int i = 0; i < 4; ++i)
+                prog->addBindAttribLocation(instanceAttributeNames[i], instanceAttributeLocation + i);
         }
+        ss.addUniform(new osg::Uniform("InstancedDraw", false));
         return applyDefTextures ? 7 : 0;
     }
 
@@ -1386,12 +1714,31 @@ namespace osgVerse
     void Pipeline::createShaderDefinitionsFromPipeline(osg::Shader* s, const std::vector<std::string>& defs)
     { createShaderDefinitions(s, _glContextVersion, _glslTargetVersion, defs); }
 
+    unsigned int PipelineMaskContainer::addUserObject(osg::Object* obj)
+    { unsigned int i = osg::DefaultUserDataContainer::addUserObject(obj); updateCache(); return i; }
+
+    void PipelineMaskContainer::setUserObject(unsigned int i, osg::Object* obj)
+    { osg::DefaultUserDataContainer::setUserObject(i, obj); updateCache(); }
+
+    void PipelineMaskContainer::removeUserObject(unsigned int i)
+    { osg::DefaultUserDataContainer::removeUserObject(i); updateCache(); }
+
+    void PipelineMaskContainer::updateCache()
+    {
+        unsigned int maskIndex = getUserObjectIndex("PipelineMask");
+        unsigned int flagsIndex = getUserObjectIndex("PipelineFlags");
+        _maskObject = (maskIndex < getNumUserObjects()) ?
+                      dynamic_cast<osg::UIntValueObject*>(getUserObject(maskIndex)) : NULL;
+        _flagsObject = (flagsIndex < getNumUserObjects()) ?
+                       dynamic_cast<osg::UIntValueObject*>(getUserObject(flagsIndex)) : NULL;
+    }
+
     void Pipeline::setPipelineMask(osg::Object& node, unsigned int mask, unsigned int flags)
     {
-        if (node.getUserDataContainer() != NULL)
+        osg::UserDataContainer* udc = node.getUserDataContainer();
+        if (udc != NULL)
         {
-            osg::DefaultUserDataContainer* defUdc =
-                dynamic_cast<osg::DefaultUserDataContainer*>(node.getUserDataContainer());
+            osg::DefaultUserDataContainer* defUdc = dynamic_cast<osg::DefaultUserDataContainer*>(udc);
             if (!defUdc)
             {
                 OSG_NOTICE << "The node already has a user-define data container '"
@@ -1399,23 +1746,37 @@ namespace osgVerse
                            << "' before setting pipeline mask, which may cause overwriting problems. "
                            << "Consider a better way to handle user values!" << std::endl;
             }
+            else if (!dynamic_cast<PipelineMaskContainer*>(defUdc))
+                node.setUserDataContainer(new PipelineMaskContainer(*defUdc));
         }
+        else
+            node.setUserDataContainer(new PipelineMaskContainer);
         node.setUserValue("PipelineMask", mask);  // replacing setNodeMask()
         node.setUserValue("PipelineFlags", flags);
     }
 
+    bool Pipeline::getPipelineMaskAndFlags(const osg::Object& node, unsigned int& mask,
+                                           unsigned int& flags)
+    {
+        const osg::UserDataContainer* udc = node.getUserDataContainer();
+        if (udc == NULL) return false;
+
+        const PipelineMaskContainer* pmc = dynamic_cast<const PipelineMaskContainer*>(udc);
+        if (pmc != NULL) return pmc->getPipelineMask(mask, flags);
+        else if (!node.getUserValue("PipelineMask", mask)) return false;  // e.g., read from file
+        node.getUserValue("PipelineFlags", flags); return true;
+    }
+
     unsigned int Pipeline::getPipelineMask(osg::Object& node)
     {
-        unsigned int mask = 0xffffffff;
-        if (node.getUserDataContainer() != NULL)
-            node.getUserValue("PipelineMask", mask); return mask;
+        unsigned int mask = 0xffffffff, flags = 0xffffffff;
+        getPipelineMaskAndFlags(node, mask, flags); return mask;
     }
 
     unsigned int Pipeline::getPipelineMaskFlags(osg::Object& node)
     {
-        unsigned int flags = 0xffffffff;
-        if (node.getUserDataContainer() != NULL)
-            node.getUserValue("PipelineFlags", flags); return flags;
+        unsigned int mask = 0xffffffff, flags = 0xffffffff;
+        getPipelineMaskAndFlags(node, mask, flags); return flags;
     }
 
     osg::Texture* Pipeline::createTexture(BufferType type, int w, int h, int glVer)
@@ -8,6 +8,8 @@
 #include <osg/Texture2D>
 #include <osg/Group>
 #include <osg/Geode>
+#include <osg/UserDataContainer>
+#include <osg/ValueObject>
 #include <osgViewer/Viewer>
 #include <string>
 #include "DeferredCallback.h"
@@ -79,6 +81,38 @@ namespace osgVerse
         virtual UserInputModule* asUserInputModule() { return NULL; }
     };
 
+    /** User data container created by Pipeline::setPipelineMask(). It keeps typed pointers to
+        the mask & flags value objects, so cull visitors needn't search them by name.
+        className() is inherited, so it is still serialized as a DefaultUserDataContainer */
+    class PipelineMaskContainer : public osg::DefaultUserDataContainer
+    {
+    public:
+        PipelineMaskContainer() : _maskObject(NULL), _flagsObject(NULL) {}
+        PipelineMaskContainer(const osg::DefaultUserDataContainer& udc,
+                              const osg::CopyOp& copyop = osg::CopyOp::SHALLOW_COPY)
+        :   osg::DefaultUserDataContainer(udc, copyop) { updateCache(); }
+
+        virtual osg::Object* cloneType() const { return new PipelineMaskContainer(); }
+        virtual osg::Object* clone(const osg::CopyOp& copyop) const
+        { return new PipelineMaskContainer(*this, copyop); }
+
+        virtual unsigned int addUserObject(osg::Object* obj);
+        virtual void setUserObject(unsigned int i, osg::Object* obj);
+        virtual void removeUserObject(unsigned int i);
+
+        /** Get mask and flags without string comparison; return false if mask not set */
+        bool getPipelineMask(unsigned int& mask, unsigned int& flags) const
+        {
+            if (!_maskObject) return false; mask = _maskObject->getValue();
+            if (_flagsObject) flags = _flagsObject->getValue(); return true;
+        }
+
+    protected:
+        void updateCache();
+        osg::UIntValueObject* _maskObject;
+        osg::UIntValueObject* _flagsObject;
+    };
+
     /** Effect pipeline using a list of slave cameras, without invading main scene graph
         Some uniforms will be set automatically for internal stages:
         - sampler2d DiffuseMap: diffuse/albedo RGB texture of input scene
@@ -185,6 +219,10 @@ namespace osgVerse
         static unsigned int getPipelineMask(osg::Object& node);
         static unsigned int getPipelineMaskFlags(osg::Object& node);
 
+        /** Get pipeline mask and flags together, return false if mask is not set */
+        static bool getPipelineMaskAndFlags(const osg::Object& node, unsigned int& mask,
+                                            unsigned int& flags);
+
         void addStage(Stage* s) { _stages.push_back(s); }
         void removeStage(unsigned int index) { _stages.erase(_stages.begin() + index); }
 
@@ -219,6 +257,11 @@ namespace osgVerse
         /** Use it in a cusom osgViewer::View class! */
         osg::GraphicsOperation* createRenderer(osg::Camera* camera);
 
+        /** Cull scene only once for input stages and forward camera with the same view/projection,
+            and let others reuse the result with their own statesets (default: true) */
+        void setUseSharedCulling(bool b);
+        bool getUseSharedCulling() const;
+
         /** The buffer description */
         struct BufferDescription
         {
@@ -300,6 +343,7 @@ namespace osgVerse
         std::vector<osg::ref_ptr<Stage>> _stages;
         std::map<std::string, osg::ref_ptr<RenderingModuleBase>> _modules;
         osg::ref_ptr<osgVerse::DeferredRenderCallback> _deferredCallback;
+        osg::ref_ptr<osg::Referenced> _sharedCulling;
         osg::ref_ptr<osg::GraphicsContext> _stageContext;
         osg::ref_ptr<osg::Depth> _deferredDepth;
         osg::ref_ptr<osg::Uniform> _invScreenResolution;
@@ -196,6 +196,8 @@ namespace osgVerse
         {
             osg::ref_ptr<ScriptableProgram> prog = new ScriptableProgram;
             prog->setName("ShadowCaster_PROGRAM");
+            for (int i = 0; i < 4; ++i)
+                prog->addBindAttribLocation(instanceAttributeNames[i], instanceAttributeLocation + i);
             for (int i = 0; i < _shadowNumber; ++i)
             {
                 Pipeline::Stage* stage = createShadowCaster(i, prog.get(), casterMask);
@@ -396,6 +398,7 @@ namespace osgVerse
         camera->getOrCreateStateSet()->setAttribute(_polygonOffset.get(), value);
         camera->getOrCreateStateSet()->setMode(GL_POLYGON_OFFSET_FILL, value);
         camera->getOrCreateStateSet()->setMode(GL_DEPTH_CLAMP, value);
+        camera->getOrCreateStateSet()->addUniform(new osg::Uniform("InstancedDraw", false));
         _shadowCameras.push_back(camera.get());
 
         Pipeline::Stage* stage = new Pipeline::Stage;
@@ -663,6 +663,7 @@ osg::Image* SymbolManager::createGrid(int w, int h, int grid, const std::vector<
     float textSize = 30.0f;
     int stepW = w / grid, stepH = h / grid;
     size_t numText = texts.size();
+    std::vector<Drawer2D::TextData> textList;
     for (size_t j = 0; j < numText; ++j)
     {
         int tx = j % grid, ty = j / grid;
@@ -673,10 +674,11 @@ osg::Image* SymbolManager::createGrid(int w, int h, int grid, const std::vector<
         for (size_t i = 0; i < lines.size(); ++i)
         {
             std::wstring t = osgDB::convertUTF8toUTF16(lines[i]);
-            _drawer->drawText(osg::Vec2(x, y + i * stepH), textSize, t, "",
-                              Drawer2D::StyleData(texts[j]->textColor, true));
+            textList.push_back(Drawer2D::TextData(osg::Vec2(x, y + i * stepH), textSize, t,
+                                                  Drawer2D::StyleData(texts[j]->textColor, true)));
         }
     }
+    _drawer->drawTexts(textList);
     _drawer->finish();
     return (osg::Image*)_drawer->clone(osg::CopyOp::DEEP_COPY_ALL);
 }
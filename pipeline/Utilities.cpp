@@ -19,6 +19,8 @@
 #include <iostream>
 #include <array>
 #include <random>
+#include <algorithm>
+#include <cfloat>
 
 #include <backward.hpp>
 #include <mikktspace.h>
@@ -28,6 +30,7 @@
 #ifdef VERSE_WINDOWS
 #   include <windows.h>
 #endif
+#include "modeling/Utilities.h"
 #include "ShaderLibrary.h"
 #include "Pipeline.h"
 #include "Utilities.h"
@@ -86,6 +89,108 @@ static osg::Camera* createImageCamera(osg::Image* image, const osg::BoundingBox&
     return camera.release();
 }
 
+/** Triangle BVH for casting vertical (-Z) rays, used by createHeightFieldCPU() */
+class HeightFieldRayCaster
+{
+public:
+    HeightFieldRayCaster(const std::vector<osg::Vec3>& va, const std::vector<unsigned int>& indices)
+    :   _vertices(va), _indices(indices), _maxDepth(0)
+    {
+        unsigned int numTriangles = (unsigned int)(indices.size() / 3);
+        _order.resize(numTriangles); _centers.resize(numTriangles);
+        for (unsigned int t = 0; t < numTriangles; ++t)
+        {
+            _order[t] = t; _centers[t] = (va[indices[t * 3]] + va[indices[t * 3 + 1]] +
+                                          va[indices[t * 3 + 2]]) / 3.0f;
+        }
+        if (numTriangles > 0) { _nodes.reserve(numTriangles / 2 + 1); build(0, numTriangles, 1); }
+    }
+
+    /** Find the highest intersection of the vertical line at (x, y) */
+    bool castDown(float x, float y, float& hitZ) const
+    {
+        // Depth-first traversal keeps at most (depth + 1) nodes in the stack
+        unsigned int localStack[64], *stack = localStack; std::vector<unsigned int> heapStack;
+        if (_maxDepth + 1 > 64) { heapStack.resize(_maxDepth + 1); stack = &heapStack[0]; }
+
+        int top = 0; bool hit = false;
+        if (!_nodes.empty()) stack[top++] = 0; hitZ = -FLT_MAX;
+        while (top > 0)
+        {
+            const Node& node = _nodes[stack[--top]];
+            const osg::BoundingBox& bb = node.box;
+            if (x < bb.xMin() || x > bb.xMax() || y < bb.yMin() || y > bb.yMax()) continue;
+            if (hit && bb.zMax() <= hitZ) continue;  // nothing higher in this node
+
+            if (node.count > 0)
+            {
+                for (unsigned int i = node.start; i < node.start + node.count; ++i)
+                {
+                    float z = 0.0f;
+                    if (intersect(_order[i], x, y, z) && (!hit || z > hitZ)) { hitZ = z; hit = true; }
+                }
+            }
+            else
+            { stack[top++] = node.right; stack[top++] = node.left; }
+        }
+        return hit;
+    }
+
+protected:
+    struct Node
+    {
+        osg::BoundingBox box;
+        unsigned int start, count, left, right;
+        Node() : start(0), count(0), left(0), right(0) {}
+    };
+
+    unsigned int build(unsigned int start, unsigned int end, unsigned int depth)
+    {
+        unsigned int index = (unsigned int)_nodes.size(); _nodes.push_back(Node());
+        _maxDepth = osg::maximum(_maxDepth, depth);
+        osg::BoundingBox box, centerBox;
+        for (unsigned int i = start; i < end; ++i)
+        {
+            unsigned int t = _order[i]; centerBox.expandBy(_centers[t]);
+            for (int k = 0; k < 3; ++k) box.expandBy(_vertices[_indices[t * 3 + k]]);
+        }
+        _nodes[index].box = box;
+        if (end - start <= 4)
+        { _nodes[index].start = start; _nodes[index].count = end - start; return index; }
+
+        // Median split along the longer horizontal axis, as all rays are vertical
+        int axis = (centerBox.xMax() - centerBox.xMin() >= centerBox.yMax() - centerBox.yMin()) ? 0 : 1;
+        unsigned int mid = (start + end) / 2; const std::vector<osg::Vec3>& centers = _centers;
+        std::nth_element(_order.begin() + start, _order.begin() + mid, _order.begin() + end,
+                         [&centers, axis](unsigned int a, unsigned int b)
+                         { return centers[a][axis] < centers[b][axis]; });
+        unsigned int left = build(start, mid, depth + 1), right = build(mid, end, depth + 1);
+        _nodes[index].left = left; _nodes[index].right = right; return index;
+    }
+
+    bool intersect(unsigned int t, float x, float y, float& z) const
+    {
+        const osg::Vec3& a = _vertices[_indices[t * 3]];
+        const osg::Vec3& b = _vertices[_indices[t * 3 + 1]];
+        const osg::Vec3& c = _vertices[_indices[t * 3 + 2]];
+        double d = (b.y() - c.y()) * (a.x() - c.x()) + (c.x() - b.x()) * (a.y() - c.y());
+        if (fabs(d) < 1e-12) return false;  // vertical triangle
+
+        double w0 = ((b.y() - c.y()) * (x - c.x()) + (c.x() - b.x()) * (y - c.y())) / d;
+        double w1 = ((c.y() - a.y()) * (x - c.x()) + (a.x() - c.x()) * (y - c.y())) / d;
+        double w2 = 1.0 - w0 - w1, eps = -1e-6;
+        if (w0 < eps || w1 < eps || w2 < eps) return false;
+        z = (float)(w0 * a.z() + w1 * b.z() + w2 * c.z()); return true;
+    }
+
+    const std::vector<osg::Vec3>& _vertices;
+    const std::vector<unsigned int>& _indices;
+    std::vector<osg::Vec3> _centers;
+    std::vector<unsigned int> _order;
+    std::vector<Node> _nodes;
+    unsigned int _maxDepth;
+};
+
 class MyReadFileCallback : public osgDB::ReadFileCallback
 {
 public:
@@ -202,6 +307,7 @@ namespace osgVerse
         regObject->loadLibrary(regObject->createLibraryNameForExtension("verse_web"));
         regObject->loadLibrary(regObject->createLibraryNameForExtension("verse_ms"));
         regObject->loadLibrary(regObject->createLibraryNameForExtension("verse_leveldb"));
+        regObject->loadLibrary(regObject->createLibraryNameForExtension("verse_sqlite"));
 #endif
         regObject->addFileExtensionAlias("ept", "verse_ept");
         regObject->addFileExtensionAlias("fbx", "verse_fbx");
@@ -236,9 +342,13 @@ static std::default_random_engine generator;
 struct MikkTSpaceHelper
 {
     std::vector<Vec3ui> _faceList;
-    osg::Vec4Array *tangents;
+    osg::ref_ptr<osg::Vec4Array> tangents;
+    osg::Vec3Array *_vertices, *_normals;
+    osg::Vec2Array* _texCoords;
     osg::Geometry* _geometry;
 
+    /** Prepare the context for genTangSpace(), which only reads the geometry and
+        fills the tangent array. So different geometries may be computed in parallel */
     bool initialize(SMikkTSpaceContext* sc, osg::Geometry* g)
     {
         sc->m_pInterface->m_getNumFaces = MikkTSpaceHelper::mikk_getNumFaces;
@@ -249,19 +359,25 @@ struct MikkTSpaceHelper
         sc->m_pInterface->m_setTSpaceBasic = MikkTSpaceHelper::mikk_setTSpaceBasic;
         sc->m_pInterface->m_setTSpace = NULL; sc->m_pUserData = this; _geometry = g;
 
-        osg::Vec3Array* va = vArray(); osg::Vec3Array* na = nArray();
-        osg::Vec2Array* ta = tArray();
-        if (!va || !na || !ta) return false;
-        if (va->size() != na->size() || va->size() != ta->size()) return false;
-
-        tangents = new osg::Vec4Array(va->size());
-        g->setVertexAttribArray(6, tangents); g->setVertexAttribBinding(6, osg::Geometry::BIND_PER_VERTEX);
+        _vertices = vArray(); _normals = nArray(); _texCoords = tArray();
+        if (!_vertices || !_normals || !_texCoords || _faceList.empty()) return false;
+        if (_vertices->size() != _normals->size() || _vertices->size() != _texCoords->size())
+            return false;
+        tangents = new osg::Vec4Array(_vertices->size());
         return true;
     }
 
-    osg::Vec3Array* vArray() { return static_cast<osg::Vec3Array*>(_geometry->getVertexArray()); }
-    osg::Vec3Array* nArray() { return static_cast<osg::Vec3Array*>(_geometry->getNormalArray()); }
-    osg::Vec2Array* tArray() { return static_cast<osg::Vec2Array*>(_geometry->getTexCoordArray(0)); }
+    /** Set computed tangents to the geometry, not thread-safe as arrays may share VBOs */
+    void attach()
+    {
+        _geometry->setVertexAttribArray(6, tangents.get());
+        _geometry->setVertexAttribBinding(6, osg::Geometry::BIND_PER_VERTEX);
+    }
+
+    // Quantized (non-float) arrays are not supported and will be ignored
+    osg::Vec3Array* vArray() { return dynamic_cast<osg::Vec3Array*>(_geometry->getVertexArray()); }
+    osg::Vec3Array* nArray() { return dynamic_cast<osg::Vec3Array*>(_geometry->getNormalArray()); }
+    osg::Vec2Array* tArray() { return dynamic_cast<osg::Vec2Array*>(_geometry->getTexCoordArray(0)); }
 
     void operator()(unsigned int i0, unsigned int i1, unsigned int i2)
     { _faceList.push_back(Vec3ui{i0, i1, i2}); }
@@ -278,24 +394,21 @@ struct MikkTSpaceHelper
     static void mikk_getPosition(const SMikkTSpaceContext* pContext, float fvPosOut[],
                                  const int iFace, const int iVert)
     {
-        osg::Vec3Array* vArray = me(pContext)->vArray();
-        const osg::Vec3& v = vArray->at(me(pContext)->_faceList[iFace][iVert]);
+        const osg::Vec3& v = me(pContext)->_vertices->at(me(pContext)->_faceList[iFace][iVert]);
         for (int i = 0; i < 3; ++i) fvPosOut[i] = v[i];
     }
 
     static void mikk_getNormal(const SMikkTSpaceContext* pContext, float fvNormOut[],
                                const int iFace, const int iVert)
     {
-        osg::Vec3Array* nArray = me(pContext)->nArray();
-        const osg::Vec3& v = nArray->at(me(pContext)->_faceList[iFace][iVert]);
+        const osg::Vec3& v = me(pContext)->_normals->at(me(pContext)->_faceList[iFace][iVert]);
         for (int i = 0; i < 3; ++i) fvNormOut[i] = v[i];
     }
 
     static void mikk_getTexCoord(const SMikkTSpaceContext* pContext, float fvTexcOut[],
                                  const int iFace, const int iVert)
     {
-        osg::Vec2Array* tArray = me(pContext)->tArray();
-        const osg::Vec2& v = tArray->at(me(pContext)->_faceList[iFace][iVert]);
+        const osg::Vec2& v = me(pContext)->_texCoords->at(me(pContext)->_faceList[iFace][iVert]);
         for (int i = 0; i < 2; ++i) fvTexcOut[i] = v[i];
     }
 
@@ -349,65 +462,138 @@ namespace osgVerse
         return pathID;
     }
 
-    osg::Object* getFromPathID(const std::string& idData, osg::Object* root, char sep)
+    static osg::Node* asPathNode(osg::Object* obj)
     {
-        osgDB::StringList idList; osgDB::split(idData, idList, sep);
-        if (root->getName() != idList[0] && idList[0] != "root") return NULL;
-        
 #if OSG_VERSION_GREATER_THAN(3, 3, 0)
-        osg::Node* node = root ? root->asNode() : NULL;
+        return obj ? obj->asNode() : NULL;
 #else
-        osg::Node* node = dynamic_cast<osg::Node*>(root);
+        return dynamic_cast<osg::Node*>(obj);
 #endif
-        if (node != NULL)
+    }
+
+    static int getPathIndex(const std::string& name, unsigned int numChildren)
+    {
+        if (name == "0") return 0;
+        int index = atoi(name.c_str()); return (index > 0 && index < (int)numChildren) ? index : -1;
+    }
+
+    template<typename T> static bool hasPathParent(T* child, osg::Node* parent)
+    {
+        for (unsigned int i = 0; i < child->getNumParents(); ++i)
+        { if (child->getParent(i) == parent) return true; }
+        return false;
+    }
+
+    static osg::Object* findPathChild(osg::Node* node, const std::string& name)
+    {
+        osg::Group* parent = node->asGroup();
+        if (parent == NULL)
         {
-            for (size_t i = 1; i < idList.size(); ++i)
+            osg::Geode* parentG = node->asGeode(); if (parentG == NULL) return NULL;
+            int index = getPathIndex(name, parentG->getNumDrawables());
+            if (index >= 0)
+                return (index < (int)parentG->getNumDrawables()) ? parentG->getDrawable(index) : NULL;
+            for (size_t j = 0; j < parentG->getNumDrawables(); ++j)
             {
-                const std::string& name = idList[i];
-                osg::Group* parent = node ? node->asGroup() : NULL;
-                if (parent == NULL)
-                {
-                    osg::Geode* parentG = node ? node->asGeode() : NULL;
-                    if (parentG != NULL)
-                    {
-                        int index = atoi(name.c_str());
-                        if (name == "0" && parentG->getNumDrawables() > 0)
-                            return parentG->getDrawable(0);
-                        else if (index > 0 && index < (int)parentG->getNumDrawables())
-                            return parentG->getDrawable(index);
-                        else
-                        {
-                            for (size_t j = 0; j < parentG->getNumDrawables(); ++j)
-                            {
-                                if (parentG->getDrawable(j)->getName() == name)
-                                    return parentG->getDrawable(j);
-                            }
-                        }
-                    }
-                    return NULL;
-                }
-
-                node = NULL;
-                if (name == "0")
-                    { if (parent->getNumChildren() > 0) node = parent->getChild(0); }
-                else
-                {
-                    int index = atoi(name.c_str());
-                    if (index > 0 && index < (int)parent->getNumChildren())
-                        node = parent->getChild(index);
-                    else
-                    {
-                        for (size_t j = 0; j < parent->getNumChildren(); ++j)
-                        {
-                            if (parent->getChild(j)->getName() == name)
-                            { node = parent->getChild(j); break; }
-                        }
-                    }
-                }  // if (name == "0")
+                if (parentG->getDrawable(j)->getName() == name)
+                    return parentG->getDrawable(j);
             }
-            return node;
+            return NULL;
+        }
+
+        int index = getPathIndex(name, parent->getNumChildren());
+        if (index >= 0)
+            return (index < (int)parent->getNumChildren()) ? parent->getChild(index) : NULL;
+        for (size_t j = 0; j < parent->getNumChildren(); ++j)
+        {
+            if (parent->getChild(j)->getName() == name)
+                return parent->getChild(j);
+        }
+        return NULL;
+    }
+
+    /** Cheap check that child is still what findPathChild() returns, without scanning siblings */
+    static bool isPathChild(osg::Node* node, const std::string& name, osg::Object* child)
+    {
+        osg::Group* parent = node->asGroup();
+        if (parent == NULL)
+        {
+            osg::Geode* parentG = node->asGeode(); if (parentG == NULL) return false;
+            int index = getPathIndex(name, parentG->getNumDrawables());
+            if (index >= 0)
+                return index < (int)parentG->getNumDrawables() && parentG->getDrawable(index) == child;
+
+            osg::Drawable* d = static_cast<osg::Drawable*>(child);
+            return d->getName() == name && hasPathParent(d, node);
+        }
+
+        int index = getPathIndex(name, parent->getNumChildren());
+        if (index >= 0)
+            return index < (int)parent->getNumChildren() && parent->getChild(index) == child;
+
+        osg::Node* n = asPathNode(child);
+        return n != NULL && n->getName() == name && hasPathParent(n, node);
+    }
+
+    osg::Object* getFromPathID(const std::string& idData, osg::Object* root, char sep)
+    {
+        osgDB::StringList idList; osgDB::split(idData, idList, sep);
+        if (root->getName() != idList[0] && idList[0] != "root") return NULL;
+
+        osg::Object* obj = root; osg::Node* node = asPathNode(root);
+        for (size_t i = 1; i < idList.size() && node != NULL; ++i)
+        {
+            obj = findPathChild(node, idList[i]);
+            if (obj == NULL) return NULL; else node = asPathNode(obj);
+        }
+        return obj;
+    }
+
+    osg::Object* PathIDIndex::get(const std::string& id, osg::Object* root, bool matchRootName)
+    {
+        if (root == NULL) return NULL;
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::unordered_map<std::string, Entry>::iterator itr = _entries.find(id);
+        if (itr != _entries.end())
+        {
+            osg::Object* obj = validate(itr->second, root);
+            if (obj != NULL) return obj; else _entries.erase(itr);
+        }
+
+        Entry entry; osgDB::split(id, entry.names, _separator);
+        if (entry.names.empty()) return NULL;
+        if (matchRootName && root->getName() != entry.names[0] && entry.names[0] != "root")
+            return NULL;
+
+        osg::Object* obj = root; osg::Node* node = asPathNode(root);
+        entry.chain.push_back(root);
+        for (size_t i = 1; i < entry.names.size() && node != NULL; ++i)
+        {
+            obj = findPathChild(node, entry.names[i]);
+            if (obj == NULL) return NULL; else node = asPathNode(obj);
+            entry.chain.push_back(obj);
+        }
+
+        if (_entries.size() >= _maxEntries) _entries.clear();
+        _entries[id] = entry; return obj;
+    }
+
+    void PathIDIndex::invalidate()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.clear();
+    }
+
+    osg::Object* PathIDIndex::validate(const Entry& entry, osg::Object* root) const
+    {
+        if (entry.chain.empty() || entry.chain[0].get() != root) return NULL;
+        for (size_t i = 1; i < entry.chain.size(); ++i)
+        {
+            osg::Node* parent = asPathNode(entry.chain[i - 1].get());
+            osg::Object* child = entry.chain[i].get();
+            if (!parent || !child || !isPathChild(parent, entry.names[i], child)) return NULL;
         }
-        return root;
+        return entry.chain.back().get();
     }
 
     osg::Texture* generateNoises2D(int numCols, int numRows)
@@ -686,6 +872,14 @@ namespace osgVerse
 
     osg::HeightField* createHeightField(osg::Node* node, int resX, int resY, osg::View* userViewer)
     {
+        osg::GraphicsContext::WindowingSystemInterface* wsi =
+            osg::GraphicsContext::getWindowingSystemInterface();
+        if (!userViewer && (!wsi || wsi->getNumScreens() == 0))
+        {
+            OSG_NOTICE << "[createHeightField] No display found, using CPU ray casting" << std::endl;
+            return createHeightFieldCPU(node, resX, resY);
+        }
+
         osg::ComputeBoundsVisitor cbv; node->accept(cbv);
         osg::BoundingBox bbox = cbv.getBoundingBox();
         osg::ref_ptr<osg::Image> image = new osg::Image;
@@ -743,6 +937,53 @@ namespace osgVerse
         return hf.release();
     }
 
+    osg::HeightField* createHeightFieldCPU(osg::Node* node, int resX, int resY,
+                                           int samples, HeightFieldSampling mode)
+    {
+        if (!node || resX < 2 || resY < 2) return NULL;
+        osg::ComputeBoundsVisitor cbv; node->accept(cbv);
+        osg::BoundingBox bbox = cbv.getBoundingBox();
+
+        MeshCollector collector; collector.setOnlyVertexAndIndices(true);
+        collector.setParallelCollecting(true); node->accept(collector);
+        collector.finishCollecting();
+        HeightFieldRayCaster caster(collector.getVertices(), collector.getTriangles());
+
+        osg::ref_ptr<osg::HeightField> hf = new osg::HeightField;
+        hf->allocate(resX, resY); hf->setOrigin(bbox._min);
+        hf->setXInterval((bbox.xMax() - bbox.xMin()) / (float)(resX - 1));
+        hf->setYInterval((bbox.yMax() - bbox.yMin()) / (float)(resY - 1));
+
+        // Shoot samples x samples rays in a stratified grid of one interval around each
+        // height-field vertex (xMin + x * dx, yMin + y * dy), so single-sample results land
+        // exactly on the vertices. The GPU path samples pixel centers (xMin + (x + 0.5) * W / resX)
+        // instead, so the two results may differ by up to half a pixel
+        float dx = hf->getXInterval(), dy = hf->getYInterval(); int n = osg::maximum(samples, 1);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int y = 0; y < resY; ++y)
+            for (int x = 0; x < resX; ++x)
+            {
+                float result = 0.0f; int numHits = 0;
+                for (int s = 0; s < n * n; ++s)
+                {
+                    float offX = ((s % n) + 0.5f) / n - 0.5f, offY = ((s / n) + 0.5f) / n - 0.5f;
+                    float z = 0.0f;
+                    if (!caster.castDown(bbox.xMin() + (x + offX) * dx,
+                                         bbox.yMin() + (y + offY) * dy, z)) continue;
+
+                    float h = z - bbox.zMin();
+                    if (numHits == 0) result = h;
+                    else if (mode == SAMPLE_MINIMUM) result = osg::minimum(result, h);
+                    else if (mode == SAMPLE_MAXIMUM) result = osg::maximum(result, h);
+                    else result += h;
+                    numHits++;
+                }
+                if (mode == SAMPLE_AVERAGE && numHits > 0) result /= (float)numHits;
+                hf->setHeight(x, y, result);
+            }
+        return hf.release();
+    }
+
     osg::Image* createSnapshot(osg::Node* node, int resX, int resY, osg::View* userViewer)
     {
         osg::ComputeBoundsVisitor cbv; node->accept(cbv);
@@ -766,8 +1007,9 @@ namespace osgVerse
         return image.release();
     }
 
-    TangentSpaceVisitor::TangentSpaceVisitor(const float threshold)
-    :   osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN), _angularThreshold(threshold)
+    TangentSpaceVisitor::TangentSpaceVisitor(const float threshold, bool deferred)
+    :   osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _angularThreshold(threshold), _deferred(deferred)
     {
         _mikkiTSpace = new SMikkTSpaceContext;
         _mikkiTSpace->m_pInterface = new SMikkTSpaceInterface;
@@ -783,6 +1025,15 @@ namespace osgVerse
         }
     }
 
+    bool TangentSpaceVisitor::hasValidTangents(const osg::Geometry& geom)
+    {
+        const osg::Array* tangents = geom.getVertexAttribArray(6);
+        const osg::Array* vertices = geom.getVertexArray();
+        if (tangents == NULL || vertices == NULL) return false;
+        if (geom.getVertexAttribBinding(6) != osg::Geometry::BIND_PER_VERTEX) return false;
+        return tangents->getNumElements() == vertices->getNumElements();
+    }
+
     void TangentSpaceVisitor::apply(osg::Geode& node)
     {
 #if OSG_VERSION_LESS_OR_EQUAL(3, 4, 1)
@@ -797,30 +1048,54 @@ namespace osgVerse
 
     void TangentSpaceVisitor::apply(osg::Geometry& geom)
     {
-#if OSG_VERSION_GREATER_THAN(3, 4, 1)
-        if (geom.getNormalArray() == NULL) { traverse(geom); return; }
-        if (geom.getNormalBinding() != osg::Geometry::BIND_PER_VERTEX) { traverse(geom); return; }
-
-        if (geom.getVertexAttribArray(6) != NULL &&
-            geom.getVertexAttribBinding(6) == osg::Geometry::BIND_PER_VERTEX)
-        { traverse(geom); return; }  // already set
-#else
-        if (geom.getNormalArray() == NULL) return;
-        if (geom.getNormalBinding() != osg::Geometry::BIND_PER_VERTEX) return;
-
-        if (geom.getVertexAttribArray(6) != NULL &&
-            geom.getVertexAttribBinding(6) == osg::Geometry::BIND_PER_VERTEX) return;
-#endif
-
-        osg::TriangleIndexFunctor<MikkTSpaceHelper> functor;
-        geom.accept(functor);
-        if (functor.initialize(_mikkiTSpace, &geom))
-            genTangSpace(_mikkiTSpace, _angularThreshold);
+        bool toCompute = geom.getNormalArray() != NULL && !hasValidTangents(geom) &&
+                         geom.getNormalBinding() == osg::Geometry::BIND_PER_VERTEX;
+        if (toCompute && _deferred)
+        {
+            // Shared geometries are only recorded once
+            if (_geometrySet.insert(&geom).second) _geometries.push_back(&geom);
+        }
+        else if (toCompute)
+        {
+            osg::TriangleIndexFunctor<MikkTSpaceHelper> functor;
+            geom.accept(functor);
+            if (functor.initialize(_mikkiTSpace, &geom) &&
+                genTangSpace(_mikkiTSpace, _angularThreshold)) functor.attach();
+        }
 #if OSG_VERSION_GREATER_THAN(3, 4, 1)
         traverse(geom);
 #endif
     }
 
+    unsigned int TangentSpaceVisitor::generate()
+    {
+        int numGeometries = (int)_geometries.size();
+        typedef osg::TriangleIndexFunctor<MikkTSpaceHelper> MikkTSpaceFunctor;
+        std::vector<MikkTSpaceFunctor*> results(numGeometries, NULL);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < numGeometries; ++i)
+        {
+            // Each thread works with its own MikkTSpace context
+            SMikkTSpaceInterface mikkInterface; SMikkTSpaceContext mikkContext;
+            mikkContext.m_pInterface = &mikkInterface; mikkContext.m_pUserData = NULL;
+
+            MikkTSpaceFunctor* functor = new MikkTSpaceFunctor;
+            _geometries[i]->accept(*functor);
+            if (functor->initialize(&mikkContext, _geometries[i].get()) &&
+                genTangSpace(&mikkContext, _angularThreshold)) results[i] = functor;
+            else delete functor;
+        }
+
+        unsigned int numAttached = 0;
+        for (int i = 0; i < numGeometries; ++i)
+        {
+            if (!results[i]) continue;
+            results[i]->attach(); delete results[i]; numAttached++;
+        }
+        _geometries.clear(); _geometrySet.clear();
+        return numAttached;
+    }
+
     NormalMapGenerator::NormalMapGenerator(double nStrength, double spScale, double spContrast, bool nInvert)
     :   osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
         _nStrength(nStrength), _spScale(spScale), _spContrast(spContrast),
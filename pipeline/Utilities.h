@@ -12,7 +12,10 @@
 #include <osgGA/GUIEventHandler>
 #include "Global.h"
 #include <functional>
+#include <set>
 #include <mutex>
+#include <unordered_map>
+#include <osg/observer_ptr>
 struct SMikkTSpaceContext;
 
 namespace osgVerse
@@ -23,6 +26,37 @@ namespace osgVerse
     /** Get object from root node and path ID */
     extern osg::Object* getFromPathID(const std::string& id, osg::Object* root, char sep = '/');
 
+    /** Path ID to object index, which works like getFromPathID() but remembers resolved nodes.
+        Each lookup only checks that cached nodes are still alive and linked to their parents,
+        so removed or re-ordered children are resolved again automatically.
+        Call invalidate() after renaming nodes or adding siblings with the same name */
+    class PathIDIndex : public osg::Referenced
+    {
+    public:
+        PathIDIndex(char sep = '/', unsigned int maxEntries = 16384)
+        :   _separator(sep), _maxEntries(maxEntries) {}
+
+        /** Get object from root node and path ID. If matchRootName is false,
+            the first path element is not compared with root name (may be an alias) */
+        osg::Object* get(const std::string& id, osg::Object* root, bool matchRootName = true);
+
+        void invalidate();
+        unsigned int getNumEntries() const { return (unsigned int)_entries.size(); }
+
+    protected:
+        struct Entry
+        {
+            std::vector<std::string> names;
+            std::vector<osg::observer_ptr<osg::Object>> chain;
+        };
+        osg::Object* validate(const Entry& entry, osg::Object* root) const;
+
+        std::unordered_map<std::string, Entry> _entries;
+        std::mutex _mutex;
+        char _separator;
+        unsigned int _maxEntries;
+    };
+
     /** Create 2D noises. e.g. for SSAO use */
     extern osg::Texture* generateNoises2D(int numCols, int numRows);
 
@@ -62,24 +96,41 @@ namespace osgVerse
     extern void alignCameraToBox(osg::Camera* camera, const osg::BoundingBoxd& bb, int resW, int resH,
                                  osg::TextureCubeMap::Face face = osg::TextureCubeMap::POSITIVE_Z);
 
-    /** Create heightmap from given scene graph */
+    /** Create heightmap from given scene graph (fall back to CPU if no display available) */
     extern osg::HeightField* createHeightField(osg::Node* node, int resX, int resY, osg::View* viewer = NULL);
 
+    /** Create heightmap by casting vertical rays to the scene on CPU, without any graphics context.
+        Each cell may shoot samples x samples rays, and combine their heights with given mode */
+    enum HeightFieldSampling { SAMPLE_MAXIMUM = 0, SAMPLE_MINIMUM, SAMPLE_AVERAGE };
+    extern osg::HeightField* createHeightFieldCPU(osg::Node* node, int resX, int resY, int samples = 1,
+                                                  HeightFieldSampling mode = SAMPLE_MAXIMUM);
+
     /** Create snapshot from given scene graph, may work as texture part of createHeightField() */
     extern osg::Image* createSnapshot(osg::Node* node, int resX, int resY, osg::View* viewer = NULL);
 
-    /** The tangent/binormal computing visitor */
+    /** The tangent/binormal computing visitor. Geometries with valid tangents are skipped.
+        In deferred mode, traversal only collects unique geometries, and generate() must be
+        called afterwards to compute their tangents in parallel */
     class TangentSpaceVisitor : public osg::NodeVisitor
     {
     public:
-        TangentSpaceVisitor(const float angularThreshold = 180.0f);
+        TangentSpaceVisitor(const float angularThreshold = 180.0f, bool deferred = false);
         virtual ~TangentSpaceVisitor();
         virtual void apply(osg::Geode& node);
         virtual void apply(osg::Geometry& geometry);
 
+        /** Compute tangents of collected geometries. Return number of updated geometries */
+        unsigned int generate();
+
+        /** Check if tangents (attribute 6) are per-vertex and match the vertex array */
+        static bool hasValidTangents(const osg::Geometry& geom);
+
     protected:
+        std::vector<osg::ref_ptr<osg::Geometry>> _geometries;
+        std::set<osg::Geometry*> _geometrySet;
         SMikkTSpaceContext* _mikkiTSpace;
         float _angularThreshold;
+        bool _deferred;
     };
 
     /** The normal-map & specular-map generator */
@@ -250,6 +301,7 @@ namespace osgVerse
     USE_OSGPLUGIN(verse_web) \
     USE_OSGPLUGIN(verse_image) \
     USE_OSGPLUGIN(verse_leveldb) \
+    USE_OSGPLUGIN(verse_sqlite) \
     USE_OSGPLUGIN(verse_tiles) \
     USE_OSGPLUGIN(pbrlayout)
 // Note: plugins depending on external libraries should be called manually
@@ -257,6 +309,7 @@ namespace osgVerse
 //  USE_OSGPLUGIN(verse_ms)
 //  USE_OSGPLUGIN(verse_cesium)
 //  USE_OSGPLUGIN(verse_vdb)
+//  USE_OSGPLUGIN(verse_tiff)
 #else
 #   define USE_VERSE_PLUGINS()
 #endif
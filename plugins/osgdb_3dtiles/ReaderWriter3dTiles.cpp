@@ -9,13 +9,16 @@
 #include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <OpenThreads/ScopedLock>
 
 #include "3rdparty/rapidxml/rapidxml.hpp"
 #include "3rdparty/picojson.h"
 #include "pipeline/Global.h"
+#include "readerwriter/LoadSceneGLTF.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <list>
 #include <limits.h>
 #define WRITE_TO_OSG 0
 
@@ -42,6 +45,168 @@ static std::vector<std::string> split(const std::string& src, const char* sepera
     return slist;
 }
 
+/** Availability bitstreams of an implicit tiling subtree (3D Tiles 1.1), indexed in Morton order */
+class ImplicitSubtree : public osg::Referenced
+{
+public:
+    struct Availability
+    {
+        std::vector<unsigned char> bits; int constant;
+        Availability() : constant(0) {}
+
+        bool get(size_t index) const
+        {
+            if (constant >= 0) return constant > 0;
+            size_t byte = index >> 3; if (byte >= bits.size()) return false;
+            return ((bits[byte] >> (index & 7)) & 1) != 0;
+        }
+    };
+
+    Availability tiles, contents, childSubtrees;
+
+    static size_t morton(int x, int y, int z, bool octree)
+    {
+        size_t index = 0;
+        for (int b = 0; b < 20; ++b)
+        {
+            if (octree)
+            {
+                index |= (size_t)((x >> b) & 1) << (3 * b);
+                index |= (size_t)((y >> b) & 1) << (3 * b + 1);
+                index |= (size_t)((z >> b) & 1) << (3 * b + 2);
+            }
+            else
+            {
+                index |= (size_t)((x >> b) & 1) << (2 * b);
+                index |= (size_t)((y >> b) & 1) << (2 * b + 1);
+            }
+        }
+        return index;
+    }
+
+    /** Index of a tile at local level (relative to subtree root) in tile/content bitstreams */
+    static size_t tileIndex(int localLevel, int x, int y, int z, bool octree)
+    {
+        size_t levelOffset = 0, levelSize = 1;
+        for (int l = 0; l < localLevel; ++l) { levelOffset += levelSize; levelSize *= (octree ? 8 : 4); }
+        return levelOffset + morton(x, y, z, octree);
+    }
+
+    bool read(const std::vector<char>& data, const std::string& dir)
+    {
+        // magic + version + jsonByteLength (uint64) + binaryByteLength (uint64) + JSON + binary
+        if (data.size() < 24 || data[0] != 's' || data[1] != 'u' || data[2] != 'b' || data[3] != 't')
+            return false;
+        unsigned long long jsonLength = 0, binaryLength = 0;
+        memcpy(&jsonLength, &data[8], 8); memcpy(&binaryLength, &data[16], 8);
+        if (24 + jsonLength + binaryLength > data.size()) return false;
+
+        picojson::value root;
+        std::string err = picojson::parse(root, std::string(&data[24], (size_t)jsonLength));
+        if (!err.empty() || !root.is<picojson::object>()) return false;
+
+        std::vector<std::vector<char>> buffers;
+        picojson::value& bufferList = root.get("buffers");
+        if (bufferList.is<picojson::array>())
+        {
+            picojson::array& arr = bufferList.get<picojson::array>();
+            for (size_t i = 0; i < arr.size(); ++i)
+            {
+                std::vector<char> buffer;
+                if (arr[i].get("uri").is<std::string>())
+                {
+                    std::string file = dir + "/" + arr[i].get("uri").get<std::string>();
+                    std::ifstream fin(file.c_str(), std::ios::in | std::ios::binary);
+                    buffer.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+                }
+                else if (binaryLength > 0)
+                {
+                    const char* ptr = &data[24 + (size_t)jsonLength];
+                    buffer.assign(ptr, ptr + (size_t)binaryLength);
+                }
+                buffers.push_back(buffer);
+            }
+        }
+
+        std::vector<std::vector<char>> views;
+        picojson::value& viewList = root.get("bufferViews");
+        if (viewList.is<picojson::array>())
+        {
+            picojson::array& arr = viewList.get<picojson::array>();
+            for (size_t i = 0; i < arr.size(); ++i)
+            {
+                size_t b = (size_t)arr[i].get("buffer").get<double>();
+                picojson::value& offsetV = arr[i].get("byteOffset");
+                size_t offset = offsetV.is<double>() ? (size_t)offsetV.get<double>() : 0;
+                size_t length = (size_t)arr[i].get("byteLength").get<double>();
+                std::vector<char> view;
+                if (b < buffers.size() && offset + length <= buffers[b].size())
+                    view.assign(buffers[b].begin() + offset, buffers[b].begin() + offset + length);
+                views.push_back(view);
+            }
+        }
+
+        // 3D Tiles 1.1 uses an array of content availabilities (one per content)
+        picojson::value& contentValue = root.get("contentAvailability");
+        readAvailability(tiles, root.get("tileAvailability"), views);
+        readAvailability(childSubtrees, root.get("childSubtreeAvailability"), views);
+        if (contentValue.is<picojson::array>() && !contentValue.get<picojson::array>().empty())
+            readAvailability(contents, contentValue.get<picojson::array>()[0], views);
+        else readAvailability(contents, contentValue, views);
+        return true;
+    }
+
+protected:
+    void readAvailability(Availability& av, picojson::value& v,
+                          const std::vector<std::vector<char>>& views)
+    {
+        if (!v.is<picojson::object>()) { av.constant = 0; return; }
+        picojson::value& constant = v.get("constant");
+        picojson::value& bitstream = v.contains("bitstream") ? v.get("bitstream") : v.get("bufferView");
+        if (constant.is<double>()) av.constant = (int)constant.get<double>();
+        else if (bitstream.is<double>())
+        {
+            size_t index = (size_t)bitstream.get<double>(); av.constant = -1;
+            if (index < views.size()) av.bits.assign(views[index].begin(), views[index].end());
+        }
+    }
+};
+
+/** Implicit tiling settings of a tileset root, saved to/restored from options of paged nodes */
+struct ImplicitTiling
+{
+    picojson::value bound; std::string subtreeUri, contentUri, prefix, refine;
+    double geometricError; int subtreeLevels, availableLevels; bool octree;
+
+    ImplicitTiling(const osgDB::Options* opt)
+    {
+        std::string err = picojson::parse(bound, opt->getPluginStringData("implicit_bound"));
+        subtreeUri = opt->getPluginStringData("implicit_subtrees");
+        contentUri = opt->getPluginStringData("implicit_content");
+        prefix = opt->getPluginStringData("implicit_prefix");
+        refine = opt->getPluginStringData("refinement");
+        geometricError = atof(opt->getPluginStringData("implicit_error").c_str());
+        subtreeLevels = osg::maximum(atoi(opt->getPluginStringData("implicit_subtree_levels").c_str()), 1);
+        availableLevels = atoi(opt->getPluginStringData("implicit_available_levels").c_str());
+        octree = (opt->getPluginStringData("implicit_scheme") == "OCTREE");
+    }
+
+    std::string expand(const std::string& uri, int level, int x, int y, int z) const
+    {
+        std::string result = uri; const char* keys[4] = { "{level}", "{x}", "{y}", "{z}" };
+        int values[4] = { level, x, y, z };
+        for (int i = 0; i < 4; ++i)
+        {
+            std::string key(keys[i]), value = std::to_string(values[i]);
+            for (size_t pos = result.find(key); pos != std::string::npos; pos = result.find(key, pos))
+            { result.replace(pos, key.size(), value); pos += value.size(); }
+        }
+        if (!result.empty() && !osgDB::isAbsolutePath(result))
+            result = prefix + osgDB::getNativePathSeparator() + result;
+        return result;
+    }
+};
+
 class ReaderWriter3dtiles : public osgDB::ReaderWriter
 {
 public:
@@ -54,6 +219,14 @@ public:
         supportsExtension("xml", "coordinate file of ContextCapture (metadata.xml)");
         supportsExtension("json", "Decription file of 3dtiles");
         supportsExtension("children", "Internal use of 3dtiles' <children> tag");
+        supportsExtension("implicit", "Internal use of 3dtiles' implicit tiling");
+        supportsExtension("b3dm", "Cesium batch 3D model");
+        supportsExtension("i3dm", "Cesium instanced 3D model");
+        supportsExtension("pnts", "Cesium point cloud");
+        supportsExtension("cmpt", "Cesium composite tiles");
+        supportsOption("MaxScreenSpaceError", "Maximum screen space error of tiles: default=1.6");
+        supportsOption("ScreenHeight", "Screen height in pixels to compute tile ranges: default=1080");
+        supportsOption("FieldOfView", "Vertical field of view in degrees: default=31.44");
     }
 
     virtual const char* className() const
@@ -91,9 +264,18 @@ public:
                          << options->getOptionString() << ": " << err << std::endl;
             return ReadResult::ERROR_IN_READING_FILE;
         }
+        else if (ext == "implicit" && options)
+        {
+            // <level>-<x>-<y>-<z>.implicit: children of an implicit tile, resolved from subtrees
+            osgDB::StringList parts; osgDB::split(osgDB::getStrippedName(fileName), parts, '-');
+            if (parts.size() < 4) return ReadResult::FILE_NOT_HANDLED;
+            return createImplicitChildren(atoi(parts[0].c_str()), atoi(parts[1].c_str()),
+                                          atoi(parts[2].c_str()), atoi(parts[3].c_str()),
+                                          localOptions.get());
+        }
         else
         {
-            std::ifstream fin(fileName.c_str());
+            std::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
             localOptions->setPluginStringData("simple_name", osgDB::getStrippedName(fileName));
             localOptions->setPluginStringData("extension", ext);
             return (!fin) ? ReadResult::FILE_NOT_FOUND : readNode(fin, localOptions.get());
@@ -104,7 +286,14 @@ public:
     {
         std::string ext = options ? options->getPluginStringData("extension") : "";
         std::string prefix = options ? options->getPluginStringData("prefix") : "";
-        if (ext == "xml")
+        if (isTileContent(ext))
+        {
+            // Binary tile formats are decoded directly, without going through GLTF plugin
+            osg::ref_ptr<osg::Node> node = osgVerse::loadTileContent(fin, prefix);
+            if (node.valid()) return node.get();
+            else return ReadResult::ERROR_IN_READING_FILE;
+        }
+        else if (ext == "xml")
         {
             std::string xml_contents((std::istreambuf_iterator<char>(fin)),
                                      std::istreambuf_iterator<char>());
@@ -146,6 +335,15 @@ public:
     }
 
 protected:
+    static bool isTileContent(const std::string& ext)
+    { return ext == "b3dm" || ext == "i3dm" || ext == "pnts" || ext == "cmpt"; }
+
+    std::string getContentFile(const std::string& uri, const std::string& ext) const
+    {
+        if (ext == "json" || isTileContent(ext)) return uri + ".verse_tiles";
+        else return uri + ".verse_gltf";
+    }
+
     osg::Node* createFromMetadata(const std::string& prefix, char* srs, char* origin) const
     {
         std::string dataFolder = prefix + "/Data/";
@@ -202,6 +400,7 @@ protected:
                                   const osgDB::Options* localOptions) const
     {
         osg::ref_ptr<osgDB::Options> opt = _subOptions->cloneOptions();
+        copyRangeOptions(localOptions, opt.get());
         std::string refine = localOptions->getPluginStringData("refinement");
         std::string prefix = localOptions->getPluginStringData("prefix");
 
@@ -227,24 +426,29 @@ protected:
                           const std::string& parentRefine, const osgDB::Options* options) const
     {
         osg::ref_ptr<osgDB::Options> opt = _subOptions->cloneOptions();
+        copyRangeOptions(options, opt.get());
         picojson::value& bound = root.get("boundingVolume");
         picojson::value& content = root.get("content");
         picojson::value& rangeV = root.get("geometricError");
         picojson::value& rangeSt = root.get("refine");
         picojson::value& children = root.get("children");
         picojson::value& trans = root.get("transform");
+        picojson::value& extensions = root.get("extensions");
+        bool implicitExt = extensions.is<picojson::object>() &&
+                           extensions.contains("3DTILES_implicit_tiling");
+        picojson::value& implicit = implicitExt ? extensions.get("3DTILES_implicit_tiling")
+                                  : root.get("implicitTiling");
 
-        double range = rangeV.is<double>() ? rangeV.get<double>() : 0.0;
-        double sseDenominator = 0.5629, height = 1080.0; // FIXME
-        if (range < 0.0 || range > 99999.0) range = FLT_MAX;  // invalid range
-        range = (range * height) / (_maxScreenSpaceError * sseDenominator);
-
+        double range = computeRange(rangeV.is<double>() ? rangeV.get<double>() : 0.0, options);
         osg::BoundingSphered bs = getBoundingSphere(bound);
         std::string st = rangeSt.is<std::string>() ? rangeSt.get<std::string>() : "";
         if (st.empty()) st = parentRefine;
 
-        osg::ref_ptr<osg::Node> tile = createTile(
-            content, children, bs, range, st, prefix, name, opt.get());
+        osg::ref_ptr<osg::Node> tile;
+        if (implicit.is<picojson::object>())
+            tile = createImplicitRoot(root, implicit, st, prefix, options);
+        else
+            tile = createTile(content, children, bs, range, st, prefix, name, opt.get());
         if (trans.is<picojson::array>())
         {
             picojson::array& tArray = trans.get<picojson::array>();
@@ -281,8 +485,7 @@ protected:
         if (children.is<picojson::array>())
         {
             osg::ref_ptr<osg::Node> child0;
-            if (ext == "json") child0 = osgDB::readNodeFile(uri + ".verse_tiles", options);
-            else if (!ext.empty()) child0 = osgDB::readNodeFile(uri + ".verse_gltf", options);
+            if (!ext.empty()) child0 = osgDB::readNodeFile(getContentFile(uri, ext), options);
 
             osg::PagedLOD* plod = new osg::PagedLOD;
             plod->setDatabasePath(prefix);
@@ -297,8 +500,9 @@ protected:
             // Put <children> to a virtual file with options to fit OSG's LOD structure
             osgDB::StringList parts; osgDB::split(name, parts, '-');
             osgDB::Options* childOpt = new osgDB::Options(children.serialize());
-            childOpt->setPluginStringData("fallback", uri + (ext == "json" ? ".verse_tiles" : ".verse_gltf"));
+            childOpt->setPluginStringData("fallback", getContentFile(uri, ext));
             childOpt->setPluginStringData("refinement", st);
+            copyRangeOptions(options, childOpt);
             plod->setDatabaseOptions(childOpt);
             plod->setFileName(1, name + "-" + std::to_string(parts.size()) + ".children.verse_tiles");
 
@@ -340,9 +544,232 @@ protected:
         else
         {
             if (ext.empty()) return new osg::Node;
-            else if (ext == "json") return osgDB::readNodeFile(uri + ".verse_tiles", options);
-            else return osgDB::readNodeFile(uri + ".verse_gltf", options);
+            else return osgDB::readNodeFile(getContentFile(uri, ext), options);
+        }
+    }
+
+    /** Distance at which the geometric error of a tile reaches the maximum screen space error */
+    double computeRange(double geometricError, const osgDB::Options* options) const
+    {
+        double sse = _maxScreenSpaceError, height = 1080.0, sseDenominator = 0.5629;
+        std::string sseV = options ? options->getPluginStringData("MaxScreenSpaceError") : "";
+        std::string heightV = options ? options->getPluginStringData("ScreenHeight") : "";
+        std::string fovV = options ? options->getPluginStringData("FieldOfView") : "";
+        if (!sseV.empty() && atof(sseV.c_str()) > 0.0) sse = atof(sseV.c_str());
+        if (!heightV.empty() && atof(heightV.c_str()) > 0.0) height = atof(heightV.c_str());
+        if (!fovV.empty() && atof(fovV.c_str()) > 0.0)
+            sseDenominator = 2.0 * tan(osg::DegreesToRadians(atof(fovV.c_str())) * 0.5);
+
+        double range = geometricError;
+        if (range < 0.0 || range > 99999.0) range = FLT_MAX;  // invalid range
+        return (range * height) / (sse * sseDenominator);
+    }
+
+    /** Pass range options to options of child tiles, which are otherwise created from scratch */
+    static void copyRangeOptions(const osgDB::Options* src, osgDB::Options* dst)
+    {
+        const char* keys[3] = { "MaxScreenSpaceError", "ScreenHeight", "FieldOfView" };
+        if (!src || !dst) return;
+        for (int i = 0; i < 3; ++i)
+        {
+            std::string value = src->getPluginStringData(keys[i]);
+            if (!value.empty()) dst->setPluginStringData(keys[i], value);
+        }
+    }
+
+    osg::Node* createImplicitRoot(picojson::value& root, picojson::value& implicit,
+                                  const std::string& st, const std::string& prefix,
+                                  const osgDB::Options* options) const
+    {
+        picojson::value& content = root.get("content");
+        picojson::value& contents = root.get("contents");
+        std::string contentUri;
+        if (content.is<picojson::object>())
+            contentUri = content.contains("uri") ? content.get("uri").to_str() : content.get("url").to_str();
+        else if (contents.is<picojson::array>() && !contents.get<picojson::array>().empty())
+            contentUri = contents.get<picojson::array>()[0].get("uri").to_str();
+
+        picojson::value& subtrees = implicit.get("subtrees");
+        picojson::value& rangeV = root.get("geometricError");
+        osg::ref_ptr<osgDB::Options> opt = _subOptions->cloneOptions();
+        opt->setPluginStringData("refinement", st);
+        opt->setPluginStringData("implicit_prefix", prefix);
+        copyRangeOptions(options, opt.get());
+        opt->setPluginStringData("implicit_bound", root.get("boundingVolume").serialize());
+        opt->setPluginStringData("implicit_content", contentUri);
+        opt->setPluginStringData("implicit_subtrees", subtrees.is<picojson::object>()
+                                 ? subtrees.get("uri").to_str() : std::string());
+        opt->setPluginStringData("implicit_scheme", implicit.get("subdivisionScheme").to_str());
+        opt->setPluginStringData("implicit_subtree_levels", implicit.get("subtreeLevels").to_str());
+        // 3D Tiles 1.1 uses 'availableLevels', while 3DTILES_implicit_tiling (1.0) has 'maximumLevel'
+        picojson::value& levelsV = implicit.get("availableLevels");
+        picojson::value& maxLevelV = implicit.get("maximumLevel");
+        int availableLevels = levelsV.is<double>() ? (int)levelsV.get<double>()
+                            : (maxLevelV.is<double>() ? (int)maxLevelV.get<double>() + 1 : 0);
+        opt->setPluginStringData("implicit_available_levels", std::to_string(availableLevels));
+        opt->setPluginStringData("implicit_error", rangeV.is<double>() ? rangeV.to_str() : "0");
+
+        osg::ref_ptr<osg::Node> tile = createImplicitTile(0, 0, 0, 0, opt.get());
+        return tile.valid() ? tile.release() : new osg::Node;
+    }
+
+    osg::Node* createImplicitChildren(int level, int x, int y, int z,
+                                      const osgDB::Options* options) const
+    {
+        ImplicitTiling tiling(options);
+        osg::ref_ptr<osg::Group> group = new osg::Group;
+        for (int k = 0; k < (tiling.octree ? 2 : 1); ++k)
+            for (int j = 0; j < 2; ++j)
+                for (int i = 0; i < 2; ++i)
+                {
+                    osg::Node* child = createImplicitTile(
+                        level + 1, x * 2 + i, y * 2 + j, z * 2 + k, options);
+                    if (child) group->addChild(child);
+                }
+        return group.release();
+    }
+
+    /** Create a tile from subtree availability; children are paged and resolved on demand */
+    osg::Node* createImplicitTile(int level, int x, int y, int z, const osgDB::Options* options) const
+    {
+        ImplicitTiling tiling(options);
+        if (level >= tiling.availableLevels) return NULL;
+
+        size_t index = 0;
+        osg::ref_ptr<ImplicitSubtree> subtree = getImplicitSubtree(tiling, level, x, y, z, index);
+        if (!subtree || !subtree->tiles.get(index)) return NULL;
+
+        osg::ref_ptr<osg::Node> child0;
+        if (subtree->contents.get(index) && !tiling.contentUri.empty())
+        {
+            std::string uri = tiling.expand(tiling.contentUri, level, x, y, z);
+            child0 = osgDB::readNodeFile(getContentFile(uri, osgDB::getFileExtension(uri)),
+                                         _subOptions.get());
+        }
+
+        std::string name = std::to_string(level) + "-" + std::to_string(x) + "-" +
+                           std::to_string(y) + "-" + std::to_string(z);
+        if (!hasImplicitChildren(tiling, subtree.get(), level, x, y, z))
+        {
+            if (!child0) return new osg::Node;
+            child0->setName(name); return child0.release();
+        }
+
+        double range = computeRange(tiling.geometricError / (double)(1 << level), options);
+        picojson::value bv = subdivideBoundingVolume(tiling.bound, level, x, y, z, tiling.octree);
+        osg::BoundingSphered bound = getBoundingSphere(bv);
+        bool additive = (tiling.refine == "ADD" || tiling.refine == "add");
+
+        osg::PagedLOD* plod = new osg::PagedLOD;
+        plod->setName(name);
+        plod->setDatabasePath(tiling.prefix);
+        plod->setDatabaseOptions(const_cast<osgDB::Options*>(options));
+        plod->addChild(child0.valid() ? child0.get() : new osg::Node);
+        plod->setFileName(1, name + ".implicit.verse_tiles");
+        plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+        plod->setCenter(bound.center()); plod->setRadius(bound.radius());
+        plod->setRangeMode(osg::LOD::DISTANCE_FROM_EYE_POINT);
+        if (additive) plod->setRange(0, 0.0f, FLT_MAX);
+        else plod->setRange(0, (float)range * 0.25f, FLT_MAX);
+        plod->setRange(1, 0.0f, (float)range * 0.25f);
+        return plod;
+    }
+
+    bool hasImplicitChildren(const ImplicitTiling& tiling, ImplicitSubtree* subtree,
+                             int level, int x, int y, int z) const
+    {
+        if (level + 1 >= tiling.availableLevels) return false;
+        int rootLevel = level - level % tiling.subtreeLevels, childLevel = level + 1;
+        int shift = childLevel - rootLevel, numZ = tiling.octree ? 2 : 1;
+        for (int k = 0; k < numZ; ++k)
+            for (int j = 0; j < 2; ++j)
+                for (int i = 0; i < 2; ++i)
+                {
+                    int cx = x * 2 + i, cy = y * 2 + j, cz = z * 2 + k;
+                    int lx = cx - ((cx >> shift) << shift), ly = cy - ((cy >> shift) << shift),
+                        lz = cz - ((cz >> shift) << shift);
+                    if (shift < tiling.subtreeLevels)
+                    {   // Children in the same subtree
+                        size_t index = ImplicitSubtree::tileIndex(shift, lx, ly, lz, tiling.octree);
+                        if (subtree->tiles.get(index)) return true;
+                    }
+                    else if (subtree->childSubtrees.get(ImplicitSubtree::morton(lx, ly, lz, tiling.octree)))
+                        return true;  // child subtree is not loaded until children are paged in
+                }
+        return false;
+    }
+
+    osg::ref_ptr<ImplicitSubtree> getImplicitSubtree(const ImplicitTiling& tiling,
+                                                     int level, int x, int y, int z,
+                                                     size_t& index) const
+    {
+        int rootLevel = level - level % tiling.subtreeLevels, shift = level - rootLevel;
+        int sx = x >> shift, sy = y >> shift, sz = z >> shift;
+        index = ImplicitSubtree::tileIndex(shift, x - (sx << shift), y - (sy << shift),
+                                           z - (sz << shift), tiling.octree);
+
+        std::string file = tiling.expand(tiling.subtreeUri, rootLevel, sx, sy, sz);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_subtreeMutex);
+        SubtreeMap::iterator itr = _subtrees.find(file);
+        if (itr != _subtrees.end())
+        {
+            _subtreeOrder.splice(_subtreeOrder.begin(), _subtreeOrder, itr->second.second);
+            return itr->second.first;
+        }
+
+        // Subtrees are shared by many tiles; keep a bounded set of recently used ones
+        std::ifstream fin(file.c_str(), std::ios::in | std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+        osg::ref_ptr<ImplicitSubtree> subtree = new ImplicitSubtree;
+        if (!subtree->read(data, osgDB::getFilePath(file)))
+        {
+            OSG_WARN << "[ReaderWriter3dtiles] Failed to read subtree " << file << std::endl;
+            subtree = NULL;
+        }
+        while (_subtrees.size() >= 1024)
+        { _subtrees.erase(_subtreeOrder.back()); _subtreeOrder.pop_back(); }
+        _subtreeOrder.push_front(file);
+        _subtrees[file] = SubtreeEntry(subtree, _subtreeOrder.begin()); return subtree;
+    }
+
+    picojson::value subdivideBoundingVolume(const picojson::value& bv, int level,
+                                            int x, int y, int z, bool octree) const
+    {
+        double n = (double)(1 << level);
+        picojson::object result;
+        if (bv.contains("box") && bv.get("box").is<picojson::array>())
+        {
+            const picojson::array& b = bv.get("box").get<picojson::array>();
+            if (b.size() < 12) return picojson::value(result);
+            osg::Vec3d c(b[0].get<double>(), b[1].get<double>(), b[2].get<double>());
+            osg::Vec3d a0(b[3].get<double>(), b[4].get<double>(), b[5].get<double>());
+            osg::Vec3d a1(b[6].get<double>(), b[7].get<double>(), b[8].get<double>());
+            osg::Vec3d a2(b[9].get<double>(), b[10].get<double>(), b[11].get<double>());
+            c += a0 * ((2.0 * x + 1.0) / n - 1.0) + a1 * ((2.0 * y + 1.0) / n - 1.0);
+            if (octree) c += a2 * ((2.0 * z + 1.0) / n - 1.0);
+            a0 /= n; a1 /= n; if (octree) a2 /= n;
+
+            picojson::array box; const osg::Vec3d* values[4] = { &c, &a0, &a1, &a2 };
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 3; ++j) box.push_back(picojson::value((*values[i])[j]));
+            result["box"] = picojson::value(box);
+        }
+        else if (bv.contains("region") && bv.get("region").is<picojson::array>())
+        {
+            const picojson::array& r = bv.get("region").get<picojson::array>();
+            if (r.size() < 6) return picojson::value(result);
+            double w = r[0].get<double>(), s = r[1].get<double>(), e = r[2].get<double>();
+            double nn = r[3].get<double>(), h0 = r[4].get<double>(), h1 = r[5].get<double>();
+            double dx = (e - w) / n, dy = (nn - s) / n, dz = (h1 - h0) / n;
+
+            picojson::array region;
+            region.push_back(picojson::value(w + dx * x)); region.push_back(picojson::value(s + dy * y));
+            region.push_back(picojson::value(w + dx * (x + 1))); region.push_back(picojson::value(s + dy * (y + 1)));
+            region.push_back(picojson::value(octree ? h0 + dz * z : h0));
+            region.push_back(picojson::value(octree ? h0 + dz * (z + 1) : h1));
+            result["region"] = picojson::value(region);
         }
+        return picojson::value(result);
     }
 
     osg::BoundingSphered getBoundingSphere(picojson::value& bv) const
@@ -404,6 +831,11 @@ protected:
 
     osg::ref_ptr<osg::EllipsoidModel> _ellipsoid;
     osg::ref_ptr<osgDB::Options> _subOptions;
+    typedef std::pair<osg::ref_ptr<ImplicitSubtree>, std::list<std::string>::iterator> SubtreeEntry;
+    typedef std::map<std::string, SubtreeEntry> SubtreeMap;
+    mutable SubtreeMap _subtrees;
+    mutable std::list<std::string> _subtreeOrder;  // most recently used first
+    mutable OpenThreads::Mutex _subtreeMutex;
     double _maxScreenSpaceError;
 };
 
@@ -149,7 +149,7 @@ bool FFmpegDecoder::open(const std::string & filename, FFmpegParameters* paramet
             m_audio_index = std::numeric_limits<unsigned int>::max();
         }
 
-        m_video_decoder.open(m_video_stream);
+        m_video_decoder.open(m_video_stream, parameters);
 
         try
         {
@@ -307,6 +307,7 @@ bool FFmpegDecoder::readNextPacketNormal()
         {
             if (m_video_queue.timedPush(m_pending_packet, 10)) {
                 m_pending_packet.release();
+                m_video_decoder.wakeup();
                 return true;
             }
         }
@@ -325,7 +326,8 @@ bool FFmpegDecoder::readNextPacketEndOfStream()
     const FFmpegPacket packet(FFmpegPacket::PACKET_END_OF_STREAM);
 
     m_audio_queue.timedPush(packet, 10);
-    m_video_queue.timedPush(packet, 10);
+    if (m_video_queue.timedPush(packet, 10))
+        m_video_decoder.wakeup();
 
     return false;
 }
@@ -335,7 +337,10 @@ bool FFmpegDecoder::readNextPacketRewinding()
     const FFmpegPacket packet(FFmpegPacket::PACKET_FLUSH);
 
     if (m_audio_queue.timedPush(packet, 10) && m_video_queue.timedPush(packet, 10))
+    {
+        m_video_decoder.wakeup();
         m_state = NORMAL;
+    }
 
     return false;
 }
@@ -363,7 +368,10 @@ bool FFmpegDecoder::readNextPacketSeeking()
     const FFmpegPacket packet(FFmpegPacket::PACKET_FLUSH);
 
     if (m_audio_queue.timedPush(packet, 10) && m_video_queue.timedPush(packet, 10))
+    {
+        m_video_decoder.wakeup();
         m_state = NORMAL;
+    }
 
     return false;
 }
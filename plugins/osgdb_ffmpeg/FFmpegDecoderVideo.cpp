@@ -2,16 +2,51 @@
 
 #include <osg/Notify>
 #include <osg/Timer>
+#include <OpenThreads/ScopedLock>
 
+#include <algorithm>
 #include <stdexcept>
+#include <stdlib.h>
 #include <string.h>
 
+#include "3rdparty/xxYUV/yuv2rgb.h"
+
 extern "C" {
 #include <libavutil/imgutils.h>
 }
 
 namespace osgFFmpeg {
 
+// xxYUV only vectorizes 4-component output, and its SIMD loops drop the row tail
+// unless the width is a multiple of the widest vector step (AVX2: 64 pixels)
+static const int XXYUV_SIMD_WIDTH = 64;
+
+static bool isYuv420Format(int pix_fmt)
+{
+    return pix_fmt == AV_PIX_FMT_YUV420P || pix_fmt == AV_PIX_FMT_YUVJ420P ||
+           pix_fmt == AV_PIX_FMT_YUVA420P || pix_fmt == AV_PIX_FMT_NV12;
+}
+
+static bool getBooleanOption(FFmpegParameters* parameters, const char* name)
+{
+    if (parameters == nullptr) return false;
+    AVDictionaryEntry *opt = av_dict_get(*parameters->getOptions(), name, nullptr, 0);
+    if (opt == nullptr || opt->value == nullptr) return false;
+    return atoi(opt->value) != 0 || strcmp(opt->value, "true") == 0;
+}
+
+class FFmpegDecodeTask : public osgVerse::VideoDecodeScheduler::Task
+{
+public:
+    FFmpegDecodeTask(FFmpegDecoderVideo * decoder) : m_decoder(decoder) {}
+
+    virtual double decode(osgVerse::VideoDecodeScheduler::DecodeQuality quality)
+    { return m_decoder->decodeStep(quality); }
+
+protected:
+    FFmpegDecoderVideo * m_decoder;
+};
+
 FFmpegDecoderVideo::FFmpegDecoderVideo(PacketQueue & packets, FFmpegClocks & clocks) :
     m_packets(packets),
     m_clocks(clocks),
@@ -24,12 +59,21 @@ FFmpegDecoderVideo::FFmpegDecoderVideo(PacketQueue & packets, FFmpegClocks & clo
     m_writeBuffer(0),
     m_user_data(nullptr),
     m_publish_func(nullptr),
+    m_alpha_channel(false),
+    m_output_format(OUTPUT_RGB24),
+    m_publish_tick(0),
+    m_publish_pending(false),
+    m_reduced_frames(0),
+    m_quality(osgVerse::VideoDecodeScheduler::DECODE_FULL),
+    m_need_key_frame(false),
+    m_scheduled(false),
     m_paused(true),
     m_exit(false)
 #ifdef USE_SWSCALE
     ,m_swscale_ctx(nullptr)
 #endif
 {
+    m_video_range[0] = m_video_range[1] = true;
 }
 
 FFmpegDecoderVideo::~FFmpegDecoderVideo()
@@ -54,7 +98,7 @@ FFmpegDecoderVideo::~FFmpegDecoderVideo()
     OSG_INFO << "Destructed FFmpegDecoderVideo" << std::endl;
 }
 
-void FFmpegDecoderVideo::open(AVStream * const stream)
+void FFmpegDecoderVideo::open(AVStream * const stream, FFmpegParameters* parameters)
 {
     m_stream = stream;
     m_context = avcodec_alloc_context3(nullptr);
@@ -85,39 +129,133 @@ void FFmpegDecoderVideo::open(AVStream * const stream)
     // Allocate video frame
     m_frame.reset(av_frame_alloc());
 
-    // Allocate converted RGB frame
+    // Choose the published layout: packed NV12 leaves color conversion to the shader,
+    // otherwise 4:2:0 sources are converted by xxYUV and others by swscale
+    const bool yuv_output = getBooleanOption(parameters, "yuv_output");
+
+    m_video_range[0] = m_video_range[1] =
+        (m_context->color_range != AVCOL_RANGE_JPEG && m_context->pix_fmt != AV_PIX_FMT_YUVJ420P);
+    const bool even_size = (width() % 2) == 0 && (height() % 2) == 0;
+    if (m_alpha_channel)
+        m_output_format = OUTPUT_RGBA32;
+    else if (yuv_output && even_size)
+        m_output_format = OUTPUT_NV12;
+    else if (isYuv420Format(m_context->pix_fmt) && even_size && (width() % XXYUV_SIMD_WIDTH) == 0)
+        m_output_format = OUTPUT_RGBA32;
+    else
+        m_output_format = OUTPUT_RGB24;
+
+    if (yuv_output && m_output_format != OUTPUT_NV12)
+        OSG_NOTICE << "FFmpegDecoderVideo: NV12 output needs even size and no alpha, "
+                   << "falling back to RGB conversion" << std::endl;
+
+    const AVPixelFormat dst_pix_fmt = (m_output_format == OUTPUT_NV12) ? AV_PIX_FMT_NV12
+                                    : (m_output_format == OUTPUT_RGBA32) ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
+
+    // Allocate converted frame
     m_frame_rgba.reset(av_frame_alloc());
-    m_buffer_rgba[0].resize(av_image_get_buffer_size(AV_PIX_FMT_RGB24, width(), height(), 1));
+    m_buffer_rgba[0].resize(av_image_get_buffer_size(dst_pix_fmt, width(), height(), 1));
     m_buffer_rgba[1].resize(m_buffer_rgba[0].size());
 
     // Assign appropriate parts of the buffer to image planes in m_frame_rgba
-    av_image_fill_arrays(m_frame_rgba->data, m_frame_rgba->linesize, &(m_buffer_rgba[0])[0], AV_PIX_FMT_RGB24, width(), height(), 1);
+    av_image_fill_arrays(m_frame_rgba->data, m_frame_rgba->linesize, &(m_buffer_rgba[0])[0], dst_pix_fmt, width(), height(), 1);
 
     // Override get_buffer2() from codec context in order to retrieve the PTS of each frame.
     m_context->opaque = this;
     m_context->get_buffer2 = getBuffer;
+
+    // Decode on the shared worker pool instead of an own thread
+    if (getBooleanOption(parameters, "decode_scheduler"))
+    {
+        AVDictionaryEntry *opt_workers = av_dict_get(*parameters->getOptions(), "decode_workers", nullptr, 0);
+        if (opt_workers && opt_workers->value && atoi(opt_workers->value) > 0)
+            osgVerse::VideoDecodeScheduler::instance()->setNumWorkers(atoi(opt_workers->value));
+        m_task = new FFmpegDecodeTask(this);
+    }
 }
 
 void FFmpegDecoderVideo::close(bool waitForThreadToExit)
 {
-    if (isRunning())
     {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_wakeup_mutex);
         m_exit = true;
-        if (waitForThreadToExit)
-            join();
+        m_wakeup_cond.broadcast();
+    }
+
+    if (m_scheduled)
+    {
+        // Waits for a running decodeStep() to finish, which never blocks
+        osgVerse::VideoDecodeScheduler::instance()->removeTask(m_task.get());
+        m_scheduled = false;
     }
+    else if (isRunning() && waitForThreadToExit)
+        join();
 }
 
 void FFmpegDecoderVideo::pause(bool pause)
 {
-    m_paused = pause;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_wakeup_mutex);
+        m_paused = pause;
+        m_wakeup_cond.broadcast();
+    }
+
+    if (m_scheduled)
+        osgVerse::VideoDecodeScheduler::instance()->notify(m_task.get());
+}
+
+void FFmpegDecoderVideo::startDecoding(osg::Image * output)
+{
+    if (m_task.valid())
+    {
+        if (!m_scheduled)
+            osgVerse::VideoDecodeScheduler::instance()->addTask(m_task.get(), output);
+        m_scheduled = true;
+    }
+    else if (!isRunning())
+        start();
+}
+
+bool FFmpegDecoderVideo::isDecoding() const
+{
+    return m_task.valid() ? m_scheduled : const_cast<FFmpegDecoderVideo*>(this)->isRunning();
+}
+
+void FFmpegDecoderVideo::wakeup()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_wakeup_mutex);
+        m_wakeup_cond.broadcast();
+    }
+
+    if (m_scheduled)
+        osgVerse::VideoDecodeScheduler::instance()->notify(m_task.get());
 }
 
 void FFmpegDecoderVideo::run()
 {
     try
     {
-        decodeLoop();
+        while (!m_exit)
+        {
+            const double wait = decodeStep(osgVerse::VideoDecodeScheduler::DECODE_FULL);
+            if (wait == 0.0)
+                continue;
+
+            // Sleep until the next frame is due, or wakeup() / pause(false) / close() is called.
+            // Waiting for packets is also bounded, as the reader may push without notifying
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_wakeup_mutex);
+            if (m_paused)
+            {
+                while (m_paused && !m_exit)
+                    m_wakeup_cond.wait(&m_wakeup_mutex);
+            }
+            else if (!m_exit)
+            {
+                const unsigned long ms = (wait > 0.0) ? static_cast<unsigned long>(wait * 1000.0 + 0.5) : 10;
+                m_wakeup_cond.wait(&m_wakeup_mutex, (std::max)(ms, 1ul));
+            }
+        }
     }
     catch (const std::exception &error)
     {
@@ -129,85 +267,125 @@ void FFmpegDecoderVideo::run()
     }
 }
 
-void FFmpegDecoderVideo::decodeLoop()
+double FFmpegDecoderVideo::decodeStep(osgVerse::VideoDecodeScheduler::DecodeQuality quality)
 {
-    FFmpegPacket packet;
-    double pts;
+    if (m_exit)
+        return -1.0;
 
-    while (!m_exit)
+    // A converted frame is waiting for its display time
+    if (m_publish_pending)
     {
-        // Work on the current packet until we have decoded all of it
-        while (m_bytes_remaining > 0)
-        {
-            // Save global PTS to be stored in m_frame via getBuffer()
-            m_packet_pts = packet.packet.pts;
+        const double remaining = osg::Timer::instance()->delta_s(osg::Timer::instance()->tick(), m_publish_tick);
+        if (remaining > 0.001)
+            return remaining;
 
-            // Decode video frame
-            int frame_finished = 0;
-            const int bytes_decoded = avcodec_receive_frame(m_context, m_frame.get());
+        m_publish_pending = false;
+        m_writeBuffer = 1 - m_writeBuffer;
+        m_publish_func(*this, m_user_data);
+    }
 
-            if (bytes_decoded == 0)
-            {
-                frame_finished = 1;
-                m_bytes_remaining -= bytes_decoded;
-                m_packet_data += bytes_decoded;
-            }
-            else if (bytes_decoded == AVERROR(EAGAIN))
-            {
-                break;
-            }
-            else if (bytes_decoded < 0)
-            {
-                throw std::runtime_error("avcodec_receive_frame() failed");
-            }
+    if (m_paused)
+        return -1.0;
 
-            // Publish the frame if we have decoded a complete frame
-            if (frame_finished)
-            {
-                if (m_frame->pts != AV_NOPTS_VALUE)
-                {
-                    pts = av_q2d(m_stream->time_base) * m_frame->pts;
-                }
-                else
-                {
-                    pts = 0;
-                }
-
-                const double synched_pts = m_clocks.videoSynchClock(m_frame.get(), av_q2d(av_inv_q(m_context->framerate)), pts);
-                const double frame_delay = m_clocks.videoRefreshSchedule(synched_pts);
-
-                publishFrame(frame_delay, m_clocks.audioDisabled());
-            }
-        }
+    applyQuality(quality);
+
+    // Work on the current packet until we have decoded all of it
+    if (m_bytes_remaining > 0)
+    {
+        // Save global PTS to be stored in m_frame via getBuffer()
+        m_packet_pts = m_packet.packet.pts;
+
+        // Decode video frame
+        const int result = avcodec_receive_frame(m_context, m_frame.get());
 
-        while (m_paused && !m_exit)
+        if (result == 0)
+        {
+            const double pts = (m_frame->pts != AV_NOPTS_VALUE) ? av_q2d(m_stream->time_base) * m_frame->pts : 0.0;
+            const double synched_pts = m_clocks.videoSynchClock(m_frame.get(), av_q2d(av_inv_q(m_context->framerate)), pts);
+            const double frame_delay = m_clocks.videoRefreshSchedule(synched_pts);
+
+            // Hidden streams keep clocks running but don't convert or publish anything,
+            // and tiny ones only publish every other frame
+            if (quality == osgVerse::VideoDecodeScheduler::DECODE_HIDDEN)
+                return 0.0;
+            else if (quality == osgVerse::VideoDecodeScheduler::DECODE_REDUCED && (m_reduced_frames++ % 2) != 0)
+                return 0.0;
+
+            return publishFrame(frame_delay, m_clocks.audioDisabled());
+        }
+        else if (result == AVERROR(EAGAIN))
         {
-            OpenThreads::Thread::microSleep(10000);
+            m_bytes_remaining = 0;
         }
+        else
+        {
+            throw std::runtime_error("avcodec_receive_frame() failed");
+        }
+    }
 
-        // Get the next packet
-        pts = 0;
+    // Get the next packet
+    if (m_packet.valid())
+        m_packet.clear();
 
-        if (packet.valid())
-            packet.clear();
+    bool is_empty = true;
+    m_packet = m_packets.tryPop(is_empty);
 
-        bool is_empty = true;
-        packet = m_packets.timedPop(is_empty, 10);
+    if (is_empty)
+        return -1.0;
 
-        if (!is_empty)
+    if (m_packet.type == FFmpegPacket::PACKET_DATA)
+    {
+        // Frames skipped while hidden are missing as references, so visible streams restart
+        // from a key frame with a flushed decoder; packets before it are dropped
+        const bool key_frame = (m_packet.packet.flags & AV_PKT_FLAG_KEY) != 0;
+        if (m_quality == osgVerse::VideoDecodeScheduler::DECODE_HIDDEN)
+            m_need_key_frame = true;
+        else if (m_need_key_frame && !key_frame)
+            return 0.0;
+        else if (m_need_key_frame)
         {
-            if (packet.type == FFmpegPacket::PACKET_DATA)
-            {
-                m_bytes_remaining = packet.packet.size;
-                m_packet_data = packet.packet.data;
-                avcodec_send_packet(m_context, &(packet.packet));
-            }
-            else if (packet.type == FFmpegPacket::PACKET_FLUSH)
-            {
-                avcodec_flush_buffers(m_context);
-            }
+            avcodec_flush_buffers(m_context);
+            m_need_key_frame = false;
         }
+
+        m_bytes_remaining = m_packet.packet.size;
+        m_packet_data = m_packet.packet.data;
+        m_packet_pts = m_packet.packet.pts;
+        avcodec_send_packet(m_context, &(m_packet.packet));
+    }
+    else if (m_packet.type == FFmpegPacket::PACKET_FLUSH)
+    {
+        avcodec_flush_buffers(m_context);
     }
+
+    return 0.0;
+}
+
+void FFmpegDecoderVideo::applyQuality(osgVerse::VideoDecodeScheduler::DecodeQuality quality)
+{
+    if (quality == m_quality)
+        return;
+
+    // Hidden: decode key frames only; tiny: drop non-reference frames and skip deblocking
+    switch (quality)
+    {
+    case osgVerse::VideoDecodeScheduler::DECODE_HIDDEN:
+        m_context->skip_frame = AVDISCARD_NONKEY;
+        m_context->skip_loop_filter = AVDISCARD_ALL;
+        break;
+
+    case osgVerse::VideoDecodeScheduler::DECODE_REDUCED:
+        m_context->skip_frame = AVDISCARD_NONREF;
+        m_context->skip_loop_filter = AVDISCARD_ALL;
+        break;
+
+    default:
+        m_context->skip_frame = AVDISCARD_DEFAULT;
+        m_context->skip_loop_filter = AVDISCARD_DEFAULT;
+        break;
+    }
+
+    m_quality = quality;
 }
 
 void FFmpegDecoderVideo::findAspectRatio()
@@ -228,12 +406,11 @@ int FFmpegDecoderVideo::convert(AVFrame *dst, int dst_pix_fmt, AVFrame *src,
 {
     osg::Timer_t startTick = osg::Timer::instance()->tick();
 #ifdef USE_SWSCALE
-    if (m_swscale_ctx == nullptr)
-    {
-        m_swscale_ctx = sws_getContext(src_width, src_height, (AVPixelFormat)src_pix_fmt,
-                                       src_width, src_height, (AVPixelFormat)dst_pix_fmt,
-                                       SWS_BICUBIC, nullptr, nullptr, nullptr);
-    }
+    // Source format may change between frames (e.g. after a seek), so let swscale re-check it
+    m_swscale_ctx = sws_getCachedContext(m_swscale_ctx,
+                                         src_width, src_height, (AVPixelFormat)src_pix_fmt,
+                                         src_width, src_height, (AVPixelFormat)dst_pix_fmt,
+                                         SWS_BICUBIC, nullptr, nullptr, nullptr);
 
     OSG_DEBUG << "Using sws_scale ";
 
@@ -252,56 +429,130 @@ int FFmpegDecoderVideo::convert(AVFrame *dst, int dst_pix_fmt, AVFrame *src,
     return result;
 }
 
-void FFmpegDecoderVideo::publishFrame(const double delay, bool audio_disabled)
+double FFmpegDecoderVideo::publishFrame(const double delay, bool audio_disabled)
 {
     // If no publishing function, just ignore the frame
     if (m_publish_func == nullptr)
-        return;
+        return 0.0;
 
     // If the display delay is too small, we better skip the frame.
     if (!audio_disabled && delay < -0.010)
-        return;
+        return 0.0;
 
     AVFrame *src = m_frame.get();
     AVFrame *dst = m_frame_rgba.get();
+    uint8_t *dst_data = &(m_buffer_rgba[m_writeBuffer])[0];
+    const int src_pix_fmt = (src->format != AV_PIX_FMT_NONE) ? src->format : m_context->pix_fmt;
+    m_video_range[m_writeBuffer] = (src->color_range != AVCOL_RANGE_JPEG && src_pix_fmt != AV_PIX_FMT_YUVJ420P);
 
-    // Assign appropriate parts of the buffer to image planes in m_frame_rgba
-    av_image_fill_arrays(dst->data, dst->linesize, &(m_buffer_rgba[m_writeBuffer])[0], AV_PIX_FMT_RGB24, width(), height(), 1);
-
-    // Convert YUVA420p (i.e. YUV420p plus alpha channel) using our own routine
-    if (m_context->pix_fmt == AV_PIX_FMT_YUVA420P)
-        yuva420pToRgba(dst, src, width(), height());
+    if (m_output_format == OUTPUT_NV12)
+    {
+        // Publish the planes directly and leave color conversion to the shader
+        if (!packNV12(dst_data, src, width(), height()))
+        {
+            av_image_fill_arrays(dst->data, dst->linesize, dst_data, AV_PIX_FMT_NV12, width(), height(), 1);
+            convert(dst, AV_PIX_FMT_NV12, src, src_pix_fmt, width(), height());
+        }
+    }
     else
-        convert(dst, AV_PIX_FMT_RGB24, src, m_context->pix_fmt, width(), height());
+    {
+        const AVPixelFormat dst_pix_fmt = (m_output_format == OUTPUT_RGBA32) ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
+        if (!convertYuv(dst_data, src, width(), height()))
+        {
+            // Assign appropriate parts of the buffer to image planes in m_frame_rgba
+            av_image_fill_arrays(dst->data, dst->linesize, dst_data, dst_pix_fmt, width(), height(), 1);
+            convert(dst, dst_pix_fmt, src, src_pix_fmt, width(), height());
+        }
 
-    // Wait 'delay' seconds before publishing the picture.
-    int i_delay = static_cast<int>(delay * 1000000 + 0.5);
+        // YUVA420p (i.e. YUV420p plus alpha channel) keeps its own alpha plane
+        if (m_output_format == OUTPUT_RGBA32 && src_pix_fmt == AV_PIX_FMT_YUVA420P)
+            copyAlphaChannel(dst_data, src, width(), height());
+    }
 
-    while (i_delay > 1000)
-    {
-        // Avoid infinite/very long loops
-        if (m_exit)
-            return;
+    // Publish the picture after 'delay' seconds, see decodeStep()
+    m_publish_tick = osg::Timer::instance()->tick() +
+                     static_cast<osg::Timer_t>((std::max)(delay, 0.0) / osg::Timer::instance()->getSecondsPerTick());
+    m_publish_pending = true;
+    return (delay > 0.001) ? delay : 0.0;
+}
+
+bool FFmpegDecoderVideo::convertYuv(uint8_t * const dst, AVFrame * const src, int width, int height)
+{
+    // xxYUV handles 4:2:0 input with even size; everything else goes to swscale
+    const int src_pix_fmt = (src->format != AV_PIX_FMT_NONE) ? src->format : m_context->pix_fmt;
+    if (!isYuv420Format(src_pix_fmt) || (width % 2) != 0 || (height % 2) != 0)
+        return false;
+
+    // xxYUV reads NV12 chroma rows with the luma stride, so other layouts go to swscale
+    const bool nv12 = (src_pix_fmt == AV_PIX_FMT_NV12);
+    if (nv12 && src->linesize[1] != src->linesize[0])
+        return false;
 
-        const int micro_delay = (std::min)(1000000, i_delay);
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    yuv2rgb_parameter parameter;
+    memset(&parameter, 0, sizeof(yuv2rgb_parameter));
+    parameter.width = width;
+    parameter.height = height;
+    parameter.y = src->data[0];
+    parameter.u = src->data[1];
+    parameter.v = nv12 ? src->data[1] + 1 : src->data[2];  // NV12 interleaves U and V
+    parameter.strideY = src->linesize[0];
+    parameter.strideU = src->linesize[1];
+    parameter.strideV = nv12 ? src->linesize[1] : src->linesize[2];
+    parameter.videoRange = m_video_range[m_writeBuffer];
+    parameter.rgb = dst;
+    parameter.componentRGB = (m_output_format == OUTPUT_RGBA32) ? 4 : 3;
+    parameter.strideRGB = parameter.componentRGB * width;
+
+    if (nv12)
+        yuv2rgb_nv12(&parameter);
+    else
+        yuv2rgb_yu12(&parameter);
+
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+    OSG_DEBUG << "Using xxYUV time = " << osg::Timer::instance()->delta_m(startTick, endTick) << "ms" << std::endl;
+    return true;
+}
+
+bool FFmpegDecoderVideo::packNV12(uint8_t * const dst, AVFrame * const src, int width, int height)
+{
+    const int src_pix_fmt = (src->format != AV_PIX_FMT_NONE) ? src->format : m_context->pix_fmt;
+    if (src_pix_fmt != AV_PIX_FMT_YUV420P && src_pix_fmt != AV_PIX_FMT_YUVJ420P &&
+        src_pix_fmt != AV_PIX_FMT_NV12)
+        return false;
 
-        OpenThreads::Thread::microSleep(micro_delay);
+    for (int h = 0; h < height; ++h)
+        memcpy(dst + h * width, src->data[0] + h * src->linesize[0], width);
 
-        i_delay -= micro_delay;
+    uint8_t *uv_dst = dst + width * height;
+    const int half_width = width / 2, half_height = height / 2;
+    if (src_pix_fmt == AV_PIX_FMT_NV12)
+    {
+        for (int h = 0; h < half_height; ++h)
+            memcpy(uv_dst + h * width, src->data[1] + h * src->linesize[1], width);
+        return true;
     }
 
-    m_writeBuffer = 1 - m_writeBuffer;
+    for (int h = 0; h < half_height; ++h)
+    {
+        const uint8_t *u_src = src->data[1] + h * src->linesize[1];
+        const uint8_t *v_src = src->data[2] + h * src->linesize[2];
+        uint8_t *uv_row = uv_dst + h * width;
 
-    m_publish_func(*this, m_user_data);
+        for (int w = 0; w < half_width; ++w)
+        {
+            uv_row[w * 2 + 0] = u_src[w];
+            uv_row[w * 2 + 1] = v_src[w];
+        }
+    }
+    return true;
 }
 
-void FFmpegDecoderVideo::yuva420pToRgba(AVFrame * const dst, AVFrame * const src, int width, int height)
+void FFmpegDecoderVideo::copyAlphaChannel(uint8_t * const dst, AVFrame * const src, int width, int height)
 {
-    convert(dst, AV_PIX_FMT_RGB24, src, m_context->pix_fmt, width, height);
-
     const size_t bpp = 4;
 
-    uint8_t *a_dst = dst->data[0] + 3;
+    uint8_t *a_dst = dst + 3;
 
     for (int h = 0; h < height; ++h)
     {
@@ -6,7 +6,11 @@
 #include "BoundedMessageQueue.hpp"
 #include "FFmpegClocks.hpp"
 #include "FFmpegPacket.hpp"
+#include "FFmpegParameters.hpp"
+#include "readerwriter/VideoDecodeScheduler.h"
 
+#include <OpenThreads/Condition>
+#include <OpenThreads/Mutex>
 #include <OpenThreads/Thread>
 #include <vector>
 
@@ -57,13 +61,36 @@ public:
     typedef BoundedMessageQueue<FFmpegPacket> PacketQueue;
     typedef void (* PublishFunc) (const FFmpegDecoderVideo & decoder, void * user_data);
 
+    /** Layout of the published image buffer:
+        - OUTPUT_RGB24 / OUTPUT_RGBA32: interleaved color, converted on the CPU
+        - OUTPUT_NV12: packed NV12 as a single luminance image of width x (height * 3 / 2),
+          Y rows first and interleaved UV rows after; decode with VERSE_sampleNV12() in shaders
+    */
+    enum OutputFormat
+    {
+        OUTPUT_RGB24,
+        OUTPUT_RGBA32,
+        OUTPUT_NV12
+    };
+
     FFmpegDecoderVideo(PacketQueue & packets, FFmpegClocks & clocks);
     ~FFmpegDecoderVideo();
 
-    void open(AVStream * stream);
+    void open(AVStream * stream, FFmpegParameters* parameters);
     void pause(bool pause);
     void close(bool waitForThreadToExit);
 
+    /** Start own decoding thread, or join the shared VideoDecodeScheduler if "decode_scheduler" is set */
+    void startDecoding(osg::Image * output);
+    bool isDecoding() const;
+
+    /** Notify that new packets are queued */
+    void wakeup();
+
+    /** Decode one packet or frame without blocking. Returns seconds until the next frame is due,
+        or a negative value if waiting for new packets / resuming from pause */
+    double decodeStep(osgVerse::VideoDecodeScheduler::DecodeQuality quality);
+
     virtual void run();
 
     void setUserData(void * user_data);
@@ -76,15 +103,21 @@ public:
     double frameRate() const;
     const uint8_t * image() const;
 
+    OutputFormat outputFormat() const;
+    int imageHeight() const;
+    bool videoRange() const;
+
 private:
 
     typedef std::vector<uint8_t> Buffer;
 
-    void decodeLoop();
     void findAspectRatio();
-    void publishFrame(double delay, bool audio_disabled);
+    void applyQuality(osgVerse::VideoDecodeScheduler::DecodeQuality quality);
+    double publishFrame(double delay, bool audio_disabled);
     double synchronizeVideo(double pts);
-    void yuva420pToRgba(AVFrame* dst, AVFrame* src, int width, int height);
+    void copyAlphaChannel(uint8_t* dst, AVFrame* src, int width, int height);
+    bool convertYuv(uint8_t* dst, AVFrame* src, int width, int height);
+    bool packNV12(uint8_t* dst, AVFrame* src, int width, int height);
 
     int convert(AVFrame* dst, int dst_pix_fmt, AVFrame* src,
                 int src_pix_fmt, int src_width, int src_height);
@@ -100,6 +133,7 @@ private:
     const uint8_t *         m_packet_data;
     int                     m_bytes_remaining;
     int64_t                 m_packet_pts;
+    FFmpegPacket            m_packet;
     
     FramePtr                m_frame;
     FramePtr                m_frame_rgba;
@@ -115,7 +149,20 @@ private:
     int                     m_height;
     size_t                  m_next_frame_index;
     bool                    m_alpha_channel;
+    bool                    m_video_range[2];  // per buffer, so the published one matches image()
+    OutputFormat            m_output_format;
 
+    osg::Timer_t            m_publish_tick;
+    bool                    m_publish_pending;
+    unsigned int            m_reduced_frames;
+
+    osg::ref_ptr<osgVerse::VideoDecodeScheduler::Task> m_task;
+    osgVerse::VideoDecodeScheduler::DecodeQuality m_quality;
+    bool                    m_need_key_frame;
+    bool                    m_scheduled;
+
+    OpenThreads::Mutex      m_wakeup_mutex;
+    OpenThreads::Condition  m_wakeup_cond;
     bool                    m_paused;
     volatile bool           m_exit;
     
@@ -176,6 +223,24 @@ inline const uint8_t * FFmpegDecoderVideo::image() const
 }
 
 
+inline FFmpegDecoderVideo::OutputFormat FFmpegDecoderVideo::outputFormat() const
+{
+    return m_output_format;
+}
+
+
+inline int FFmpegDecoderVideo::imageHeight() const
+{
+    return (m_output_format == OUTPUT_NV12) ? (m_height * 3 / 2) : m_height;
+}
+
+
+inline bool FFmpegDecoderVideo::videoRange() const
+{
+    return m_video_range[1-m_writeBuffer];
+}
+
+
 
 } // namespace osgFFmpeg
 
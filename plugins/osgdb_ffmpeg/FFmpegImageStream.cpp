@@ -71,13 +71,12 @@ bool FFmpegImageStream::open(const std::string & filename, FFmpegParameters* par
     if (! m_decoder->open(filename, parameters))
         return false;
 
-    setImage(
-        m_decoder->video_decoder().width(), m_decoder->video_decoder().height(), 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE,
-        const_cast<unsigned char *>(m_decoder->video_decoder().image()), NO_DELETE
-    );
+    applyDecodedImage();
 
 
     setPixelAspectRatio(m_decoder->video_decoder().pixelAspectRatio());
+    if (m_decoder->video_decoder().outputFormat() == FFmpegDecoderVideo::OUTPUT_NV12)
+        setUserValue("VideoFormat", std::string("NV12"));
 
     OSG_NOTICE<<"ffmpeg::open("<<filename<<") size("<<s()<<", "<<t()<<") aspect ratio "<<m_decoder->video_decoder().pixelAspectRatio()<<std::endl;
 
@@ -300,8 +299,8 @@ void FFmpegImageStream::cmdPlay()
         if (! m_decoder->audio_decoder().isRunning())
             m_decoder->audio_decoder().start();
 
-        if (! m_decoder->video_decoder().isRunning())
-            m_decoder->video_decoder().start();
+        if (! m_decoder->video_decoder().isDecoding())
+            m_decoder->video_decoder().startDecoding(this);
 
         _lastUpdateTS = osg::Timer::instance()->tick();
         
@@ -340,15 +339,43 @@ void FFmpegImageStream::cmdSeek(double time)
 }
 
 
+void FFmpegImageStream::applyDecodedImage()
+{
+    const FFmpegDecoderVideo & video = m_decoder->video_decoder();
+    GLenum format = GL_RGB;
+    switch (video.outputFormat())
+    {
+    case FFmpegDecoderVideo::OUTPUT_RGBA32:
+        format = GL_RGBA;
+        break;
+
+    case FFmpegDecoderVideo::OUTPUT_NV12:
+        // Packed NV12 planes: luma on top, interleaved chroma below
+        format = GL_LUMINANCE;
+        break;
+
+    default:
+        break;
+    }
+
+    setImage(
+        video.width(), video.imageHeight(), 1, format, format, GL_UNSIGNED_BYTE,
+        const_cast<unsigned char *>(video.image()), NO_DELETE
+    );
+
+    // Color range may change between frames, keep it with the image just published
+    bool videoRange = false;
+    if (format == GL_LUMINANCE &&
+        (!getUserValue("VideoRange", videoRange) || videoRange != video.videoRange()))
+        setUserValue("VideoRange", video.videoRange());
+}
+
 void FFmpegImageStream::publishNewFrame(const FFmpegDecoderVideo &, void * user_data)
 {
     FFmpegImageStream * const this_ = reinterpret_cast<FFmpegImageStream*>(user_data);
 
 #if 1
-    this_->setImage(
-        this_->m_decoder->video_decoder().width(), this_->m_decoder->video_decoder().height(), 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE,
-        const_cast<unsigned char *>(this_->m_decoder->video_decoder().image()), NO_DELETE
-    );
+    this_->applyDecodedImage();
 #else
     /** \bug If viewer.realize() hasn't been already called, this doesn't work? */
     this_->dirty();
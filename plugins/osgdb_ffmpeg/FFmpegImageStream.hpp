@@ -71,6 +71,7 @@ namespace osgFFmpeg
         void cmdPause();
         void cmdRewind();
         void cmdSeek(double time);
+        void applyDecodedImage();
 
         static void publishNewFrame(const FFmpegDecoderVideo &, void * user_data);
 
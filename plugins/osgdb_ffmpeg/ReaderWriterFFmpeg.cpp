@@ -88,6 +88,12 @@ public:
         supportsOption("context",           "AVIOContext* for custom IO");
         supportsOption("mad",               "Max analyze duration (seconds)");
         supportsOption("rtsp_transport",    "RTSP transport (udp, tcp, udp_multicast or http)");
+        supportsOption("yuv_output",        "Publish packed NV12 luminance images (height x 1.5) instead of RGB, "
+                                            "decode with VERSE_sampleNV12() in shaders (0 or 1)");
+        supportsOption("decode_scheduler",  "Decode video on the shared osgVerse::VideoDecodeScheduler pool "
+                                            "instead of an own thread per stream (0 or 1). "
+                                            "osgVerse::VideoCullCallback reports on-screen size to it");
+        supportsOption("decode_workers",    "Number of worker threads of the shared decode scheduler");
 
         av_log_set_callback(log_to_osg);
 
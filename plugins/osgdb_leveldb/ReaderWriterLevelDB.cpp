@@ -6,13 +6,82 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 #include <osgDB/Archive>
+#include <osg/Timer>
+#include <OpenThreads/ScopedLock>
+#include <memory>
 #include "3rdparty/leveldb/db.h"
+#include "3rdparty/leveldb/cache.h"
+#include "3rdparty/leveldb/filter_policy.h"
+#include "3rdparty/leveldb/iterator.h"
+#include "3rdparty/leveldb/write_batch.h"
 
 enum LevelDBObjectType { OBJECT, ARCHIVE, IMAGE, HEIGHTFIELD, NODE, SHADER };
+
+/** Opened database with its block cache / bloom filter, and the pending write batch
+    used in bulk import mode (enabled by "BatchWrite" option). A batch is committed when
+    it exceeds the size or age threshold, after a write with "Flush" option, when the archive
+    or plugin is closed, and before any read / existence check of the same database */
+struct LevelDBEntry
+{
+    LevelDBEntry() : db(NULL), cache(NULL), filter(NULL), batchMaxSize(0), batchInterval(0.0),
+                     batchStart(0), batchMode(false) {}
+    ~LevelDBEntry() { flush(); delete db; delete cache; delete filter; }
+
+    bool flush()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(batchMutex);
+        if (!db || batch.ApproximateSize() <= emptyBatchSize) return true;
+        leveldb::WriteOptions wOptions; wOptions.sync = false;
+        leveldb::Status status = db->Write(wOptions, &batch); batch.Clear();
+        if (!status.ok()) OSG_WARN << "[leveldb] Failed to flush batch: " << status.ToString() << std::endl;
+        return status.ok();
+    }
+
+    /** Add to the pending batch, and return true if it should be committed now */
+    bool put(const std::string& key, const std::string& value)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(batchMutex);
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        if (batch.ApproximateSize() <= emptyBatchSize) batchStart = now;
+        batch.Put(key, value);
+        if (batch.ApproximateSize() > batchMaxSize) return true;
+        return batchInterval > 0.0 && osg::Timer::instance()->delta_s(batchStart, now) > batchInterval;
+    }
+
+    leveldb::DB* db; leveldb::Cache* cache;
+    const leveldb::FilterPolicy* filter;
+    leveldb::WriteBatch batch; OpenThreads::Mutex batchMutex;
+    size_t batchMaxSize; double batchInterval;
+    osg::Timer_t batchStart; bool batchMode;
+    static const size_t emptyBatchSize = 12;  // size of the batch header
+};
+
+/** Read-only stream buffer over the value string, to avoid copying it again */
+class LevelDBValueBuffer : public std::streambuf
+{
+public:
+    LevelDBValueBuffer(std::string& value)
+    { char* ptr = value.empty() ? NULL : &value[0]; setg(ptr, ptr, ptr + value.size()); }
+
+protected:
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                             std::ios_base::openmode which = std::ios_base::in)
+    {
+        char* target = (dir == std::ios_base::beg) ? eback() + off
+                     : ((dir == std::ios_base::cur) ? gptr() + off : egptr() + off);
+        if (target < eback() || target > egptr()) return pos_type(off_type(-1));
+        setg(eback(), target, egptr()); return pos_type(target - eback());
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in)
+    { return seekoff(off_type(pos), std::ios_base::beg, which); }
+};
+
 class LevelDBArchive : public osgDB::Archive
 {
 public:
-    LevelDBArchive(const osgDB::ReaderWriter* rw, ArchiveStatus status, const std::string& dbName);
+    LevelDBArchive(const osgDB::ReaderWriter* rw, ArchiveStatus status,
+                   const std::string& dbName, const osgDB::Options* options);
     virtual ~LevelDBArchive() { close(); }
 
     virtual const char* libraryName() const { return "osgVerse"; }
@@ -30,7 +99,7 @@ public:
         else return osgDB::FILE_NOT_FOUND;
     }
 
-    virtual bool getFileNames(osgDB::DirectoryContents& fileNames) const { return false; }
+    virtual bool getFileNames(osgDB::DirectoryContents& fileNames) const;
     //virtual osgDB::DirectoryContents getDirectoryContents(const std::string& dirName) const;
 
     osgDB::ReaderWriter::ReadResult readFile(
@@ -61,7 +130,7 @@ public:
 
 protected:
     osg::observer_ptr<osgDB::ReaderWriter> _readerWriter;
-    leveldb::DB* _db; std::string _dbName;
+    LevelDBEntry* _db; std::string _dbName;
 };
 
 class ReaderWriterLevelDB : public osgDB::ReaderWriter
@@ -70,18 +139,28 @@ public:
     ReaderWriterLevelDB()
     {
         supportsProtocol("leveldb", "Read from LevelDB database.");
-        supportsOption("WriteBufferSize=<s>", "Size in byte, default is 4Mb");
+        supportsOption("WriteBufferSize=<s>", "Size in byte, default is 256Mb");
+        supportsOption("BlockCacheSize=<s>", "Size of LRU block cache in byte, default is 64Mb");
+        supportsOption("BloomFilterBits=<n>", "Bits per key of bloom filter, default is 10; 0 to disable");
+        supportsOption("BatchWrite=<s>", "Bulk import mode: commit writes (sync=false) in batches "
+                       "of given size in byte, default is 0 (disabled)");
+        supportsOption("BatchWriteInterval=<t>", "Also commit a batch older than given seconds, "
+                       "default is 0 (size only); reads commit pending batches first");
+        supportsOption("Flush", "Commit the pending batch right after this write (e.g. the last "
+                       "one of an import): default=0");
 
         // Examples:
         // - Writing: osgconv cessna.osg leveldb://test.db/cessna.osg.verse_leveldb
         // - Reading: osgviewer leveldb://test.db/cessna.osg.verse_leveldb
+        // - Bulk import: write with options "BatchWrite", and set "Flush" for the last write,
+        //   or close the archive from osgDB::openArchive() to commit remaining data
         supportsExtension("verse_leveldb", "Pseudo file extension, used to select DB plugin.");
         supportsExtension("*", "Passes all read files to other plugins to handle actual model loading.");
     }
 
     virtual ~ReaderWriterLevelDB()
     {
-        for (std::map<std::string, leveldb::DB*>::iterator itr = _dbMap.begin();
+        for (DatabaseMap::iterator itr = _dbMap.begin();
              itr != _dbMap.end(); ++itr) { delete itr->second; }
     }
     
@@ -99,7 +178,7 @@ public:
     {
         // Create archive from DB
         std::string dbName = osgDB::getServerAddress(fullFileName);
-        return new LevelDBArchive(this, status, dbName);
+        return new LevelDBArchive(this, status, dbName, options);
     }
 
     virtual ReadResult readObject(const std::string& fileName, const Options* options) const
@@ -171,12 +250,9 @@ public:
         if (scheme == "leveldb")
         {
             std::string dbName = osgDB::getServerAddress(filename);
-            std::string keyName = osgDB::getServerFileName(filename), value;
-            leveldb::DB* db = getOrCreateDatabase(dbName, false);
-            if (!db) return false;
-
-            leveldb::Status status = db->Get(leveldb::ReadOptions(), keyName, &value);
-            return status.ok();
+            std::string keyName = osgDB::getServerFileName(filename);
+            LevelDBEntry* db = getOrCreateDatabase(dbName, false, options);
+            return db ? exists(db, keyName) : false;
         }
         return ReaderWriter::fileExists(filename, options);
     }
@@ -222,18 +298,37 @@ public:
         // Read data from DB
         std::string dbName = osgDB::getServerAddress(fullFileName);
         std::string keyName = osgDB::getServerFileName(fullFileName);
-        leveldb::DB* db = getOrCreateDatabase(dbName, false);
+        LevelDBEntry* db = getOrCreateDatabase(dbName, false, options);
         if (!db) return ReadResult::ERROR_IN_READING_FILE;
         else return read(db, fileName, keyName, objectType, reader, options);
     }
 
-    ReadResult read(leveldb::DB* db, const std::string& fileName, const std::string& keyName,
+    bool exists(LevelDBEntry* db, const std::string& keyName) const
+    {
+        // Get() makes use of the bloom filter to skip tables without the key, which Seek() doesn't
+        std::string value; leveldb::ReadOptions rOptions; rOptions.fill_cache = false;
+        if (db->batchMode) db->flush();
+        return db->db->Get(rOptions, keyName, &value).ok();
+    }
+
+    bool getKeys(LevelDBEntry* db, osgDB::DirectoryContents& keys) const
+    {
+        leveldb::ReadOptions rOptions; rOptions.fill_cache = false;
+        if (db->batchMode) db->flush();
+        std::unique_ptr<leveldb::Iterator> itr(db->db->NewIterator(rOptions));
+        for (itr->SeekToFirst(); itr->Valid(); itr->Next()) keys.push_back(itr->key().ToString());
+        return itr->status().ok();
+    }
+
+    ReadResult read(LevelDBEntry* db, const std::string& fileName, const std::string& keyName,
                     LevelDBObjectType type, osgDB::ReaderWriter* rw, const osgDB::Options* options) const
     {
-        std::stringstream buffer; std::string value;
-        leveldb::Status status = db->Get(leveldb::ReadOptions(), keyName, &value);
+        std::string value; if (db->batchMode) db->flush();
+        leveldb::Status status = db->db->Get(leveldb::ReadOptions(), keyName, &value);
         if (!status.ok()) return ReadResult::FILE_NOT_FOUND;
-        else buffer.write(value.data(), value.length());
+
+        LevelDBValueBuffer valueBuffer(value);
+        std::istream buffer(&valueBuffer);
 
         // Load by other readerwriter
         osg::ref_ptr<Options> lOptions = options ?
@@ -275,7 +370,7 @@ public:
 
         std::string dbName = osgDB::getServerAddress(fullFileName);
         std::string keyName = osgDB::getServerFileName(fullFileName);
-        leveldb::DB* db = getOrCreateDatabase(dbName, true);
+        LevelDBEntry* db = getOrCreateDatabase(dbName, true, options);
         if (!db) return WriteResult::ERROR_IN_WRITING_FILE;
 
         osgDB::ReaderWriter* writer = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
@@ -283,52 +378,90 @@ public:
         else return write(db, obj, keyName, writer, options);
     }
 
-    WriteResult write(leveldb::DB* db, const osg::Object& obj, const std::string& keyName,
+    WriteResult write(LevelDBEntry* db, const osg::Object& obj, const std::string& keyName,
                       osgDB::ReaderWriter* rw, const osgDB::Options* options) const
     {
         std::stringstream requestBuffer;
         osgDB::ReaderWriter::WriteResult result = writeFile(obj, rw, requestBuffer, options);
         if (!result.success()) return result;
 
-        leveldb::Status status = db->Put(leveldb::WriteOptions(), keyName, requestBuffer.str());
+        std::string data = requestBuffer.str();
+        if (db->batchMode)
+        {
+            std::string flushOption = options ? options->getPluginStringData("Flush") : "";
+            bool flushNow = db->put(keyName, data) || atoi(flushOption.c_str()) > 0;
+            if (flushNow && !db->flush()) return WriteResult::ERROR_IN_WRITING_FILE;
+            return WriteResult::FILE_SAVED;
+        }
+
+        leveldb::Status status = db->db->Put(leveldb::WriteOptions(), keyName, data);
         return status.ok() ? WriteResult::FILE_SAVED : WriteResult::FILE_NOT_HANDLED;
     }
 
-    leveldb::DB* getOrCreateDatabase(const std::string& name, bool createdIfMissing) const
+    LevelDBEntry* getOrCreateDatabase(const std::string& name, bool createdIfMissing,
+                                      const osgDB::Options* opt) const
     {
-        leveldb::DB* db = NULL;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dbMutex);
         DatabaseMap& dbMap = const_cast<DatabaseMap&>(_dbMap);
-        if (dbMap.find(name) == dbMap.end())
+        DatabaseMap::iterator itr = dbMap.find(name);
+        if (itr == dbMap.end())
         {
+            std::string writeBufferSize = opt ? opt->getPluginStringData("WriteBufferSize") : "";
+            std::string blockCacheSize = opt ? opt->getPluginStringData("BlockCacheSize") : "";
+            std::string bloomFilterBits = opt ? opt->getPluginStringData("BloomFilterBits") : "";
+            int bloomBits = bloomFilterBits.empty() ? 10 : atoi(bloomFilterBits.c_str());
+
+            LevelDBEntry* entry = new LevelDBEntry;
+            entry->cache = leveldb::NewLRUCache(blockCacheSize.empty()
+                         ? 64 * 1024 * 1024 : (size_t)atoll(blockCacheSize.c_str()));
+            if (bloomBits > 0) entry->filter = leveldb::NewBloomFilterPolicy(bloomBits);
+
             leveldb::Options options;
             options.create_if_missing = createdIfMissing;
-            options.write_buffer_size = 256 * 1024 * 1024;
+            options.write_buffer_size = writeBufferSize.empty()
+                                      ? 256 * 1024 * 1024 : (size_t)atoll(writeBufferSize.c_str());
+            options.block_cache = entry->cache;
+            options.filter_policy = entry->filter;
 
-            leveldb::Status status = leveldb::DB::Open(options, name, &db);
-            if (!status.ok()) return NULL; else dbMap[name] = db;
+            leveldb::Status status = leveldb::DB::Open(options, name, &entry->db);
+            if (!status.ok())
+            {
+                OSG_WARN << "[leveldb] Failed to open " << name << ": "
+                         << status.ToString() << std::endl;
+                delete entry; return NULL;
+            }
+            itr = dbMap.insert(DatabaseMap::value_type(name, entry)).first;
         }
-        else
-            db = dbMap[name];
-        return db;
+
+        // Bulk import mode may be switched on by any later writing options
+        std::string batchSize = opt ? opt->getPluginStringData("BatchWrite") : "";
+        std::string batchInterval = opt ? opt->getPluginStringData("BatchWriteInterval") : "";
+        if (!batchSize.empty() && atoll(batchSize.c_str()) > 0)
+        { itr->second->batchMaxSize = (size_t)atoll(batchSize.c_str()); itr->second->batchMode = true; }
+        if (!batchInterval.empty()) itr->second->batchInterval = atof(batchInterval.c_str());
+        return itr->second;
     }
 
     void closeDatabase(const std::string& name)
     {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dbMutex);
         DatabaseMap::iterator itr = _dbMap.find(name);
         if (itr != _dbMap.end()) { delete itr->second; _dbMap.erase(itr); }
     }
 
 protected:
-    typedef std::map<std::string, leveldb::DB*> DatabaseMap;
+    typedef std::map<std::string, LevelDBEntry*> DatabaseMap;
     DatabaseMap _dbMap;
+    mutable OpenThreads::Mutex _dbMutex;
 };
 
-LevelDBArchive::LevelDBArchive(const osgDB::ReaderWriter* rw, ArchiveStatus status, const std::string& dbName)
+LevelDBArchive::LevelDBArchive(const osgDB::ReaderWriter* rw, ArchiveStatus status,
+                               const std::string& dbName, const osgDB::Options* options)
     : _readerWriter(NULL), _dbName(dbName)
 {
     ReaderWriterLevelDB* rwdb = static_cast<ReaderWriterLevelDB*>(const_cast<ReaderWriter*>(rw));
     if (!rwdb) { _db = NULL; return; } else _readerWriter = rwdb;
-    _db = rwdb->getOrCreateDatabase(dbName, status == ArchiveStatus::CREATE);
+    _db = rwdb->getOrCreateDatabase(dbName, status == ArchiveStatus::CREATE, options);
 }
 
 void LevelDBArchive::close()
@@ -339,9 +472,16 @@ void LevelDBArchive::close()
 
 bool LevelDBArchive::fileExists(const std::string& filename) const
 {
-    std::string value; if (!_db) return false;
-    leveldb::Status status = _db->Get(leveldb::ReadOptions(), filename, &value);
-    return status.ok();
+    ReaderWriterLevelDB* rwdb = static_cast<ReaderWriterLevelDB*>(_readerWriter.get());
+    if (!rwdb || !_db) return false;
+    return rwdb->exists(_db, filename);
+}
+
+bool LevelDBArchive::getFileNames(osgDB::DirectoryContents& fileNames) const
+{
+    ReaderWriterLevelDB* rwdb = static_cast<ReaderWriterLevelDB*>(_readerWriter.get());
+    if (!rwdb || !_db) return false;
+    return rwdb->getKeys(_db, fileNames);
 }
 
 osgDB::ReaderWriter::ReadResult LevelDBArchive::readFile(
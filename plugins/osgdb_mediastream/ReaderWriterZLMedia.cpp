@@ -7,9 +7,11 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 #include <osgDB/Archive>
+#include <OpenThreads/ScopedLock>
 
 #include "pipeline/Global.h"
 #include "pipeline/CudaTexture2D.h"
+#include "readerwriter/VideoDecodeScheduler.h"
 #include "3rdparty/xxYUV/rgb2yuv.h"
 #include <mk_mediakit.h>
 #include <chrono>
@@ -374,9 +376,9 @@ public:
         _reader(copy._reader), _name(copy._name), _done(copy._done) {}
 
     META_Object(osgVerse, ZLMediaPlayer);
-    virtual void play() { _status = PLAYING; }
-    virtual void pause() { _status = PAUSED; }
-    virtual void rewind() { _status = REWINDING; }
+    virtual void play() { setStatus(PLAYING); }
+    virtual void pause() { setStatus(PAUSED); }
+    virtual void rewind() { setStatus(REWINDING); }
 
     void open(osgDB::ReaderWriter* rw, const std::string name)
     {
@@ -387,24 +389,37 @@ public:
     }
 
     virtual void quit(bool waitForThreadToExit = true)
-    { _done = true; if (isRunning() && waitForThreadToExit) join(); }
+    {
+        _statusMutex.lock(); _done = true; _statusChanged.broadcast(); _statusMutex.unlock();
+        if (isRunning() && waitForThreadToExit) join();
+    }
 
 protected:
     virtual ~ZLMediaPlayer() { quit(true); }
     void updateImage();
 
+    void setStatus(StreamStatus s)
+    { _statusMutex.lock(); _status = s; _statusChanged.broadcast(); _statusMutex.unlock(); }
+
     virtual void run()
     {
-        _done = false;
         while (!_done)
         {
+            // Wait for decoded images / status changes instead of spinning
             if (_status == PLAYING) updateImage();
             else if (_status == REWINDING) _status = PLAYING;
-            YieldCurrentThread();
+            else
+            {
+                _statusMutex.lock();
+                if (_status == PAUSED && !_done) _statusChanged.wait(&_statusMutex, 100);
+                _statusMutex.unlock();
+            }
         }
     }
 
     osg::observer_ptr<osgDB::ReaderWriter> _reader;
+    OpenThreads::Mutex _statusMutex;
+    OpenThreads::Condition _statusChanged;
     std::string _name; bool _done;
 };
 
@@ -501,11 +516,24 @@ public:
         if (_players.find(fileName) == _players.end())
         {
             PlayerContext* ctx = PlayerContext::create();
+            if (options && !options->getPluginStringData("decode_scheduler").empty() &&
+                atoi(options->getPluginStringData("decode_scheduler").c_str()) > 0)
+            {
+                // Decode on the shared worker pool instead of a decoder thread per stream
+                std::string workers = options->getPluginStringData("decode_workers");
+                if (!workers.empty() && atoi(workers.c_str()) > 0)
+                    osgVerse::VideoDecodeScheduler::instance()->setNumWorkers(atoi(workers.c_str()));
+                ctx->task = new DecodeTask(ctx);
+                osgVerse::VideoDecodeScheduler::instance()->addTask(ctx->task.get());
+            }
             mk_player_play(ctx->player, fileName.c_str());
             nonconst->_players[fileName] = ctx;
         }
 
         ZLMediaPlayer* player = new ZLMediaPlayer;
+        PlayerContext* ctx = nonconst->_players[fileName];
+        if (ctx->task.valid())
+            osgVerse::VideoDecodeScheduler::instance()->bindImage(player, ctx->task.get());
         player->open(nonconst, fileName);
         return player;
     }
@@ -543,8 +571,16 @@ public:
 
     osg::Image* getPlayerImage(const std::string& fileName, long long* pts)
     {
+        // Decoded images are owned by the list only, so no need to clone them
         PlayerContext* ctx = _players[fileName];
-        return ctx ? ctx->pullFromImageList(pts) : NULL;
+        return ctx ? ctx->pullFromImageList(pts, false) : NULL;
+    }
+
+    bool waitForPlayerImage(const std::string& fileName, unsigned long ms)
+    {
+        PlayerContext* ctx = _players[fileName];
+        if (ctx) return ctx->waitForImage(ms);
+        OpenThreads::Thread::microSleep(ms * 1000); return false;
     }
 
 protected:
@@ -554,6 +590,7 @@ protected:
         typedef std::pair<osg::ref_ptr<osg::Image>, long long> ImagePair;
         std::list<ImagePair> _images;
         OpenThreads::Mutex _mutex;
+        OpenThreads::Condition _imageAdded;
         unsigned int _maxImages;
 
     public:
@@ -565,21 +602,30 @@ protected:
             _mutex.lock();
             _images.push_back(ImagePair(img, pts));
             if (_maxImages < _images.size()) _images.pop_front();
-            _mutex.unlock();
+            _imageAdded.broadcast(); _mutex.unlock();
         }
 
-        osg::Image* pullFromImageList(long long* pts = NULL)
+        osg::Image* pullFromImageList(long long* pts = NULL, bool cloned = true)
         {
             osg::ref_ptr<osg::Image> image; _mutex.lock();
             if (!_images.empty())
             {
                 ImagePair& pair = _images.front();
-                image = (osg::Image*)pair.first->clone(osg::CopyOp::DEEP_COPY_ALL);
+                image = cloned ? (osg::Image*)pair.first->clone(osg::CopyOp::DEEP_COPY_ALL)
+                      : pair.first.get();
                 if (pts) *pts = pair.second; _images.pop_front();
             }
             _mutex.unlock();
             return image.release();
         }
+
+        bool waitForImage(unsigned long ms)
+        {
+            _mutex.lock();
+            if (_images.empty()) _imageAdded.wait(&_mutex, ms);
+            bool hasImage = !_images.empty(); _mutex.unlock();
+            return hasImage;
+        }
     };
     
     class PusherContext : public BaseContext
@@ -663,13 +709,25 @@ protected:
 
         mk_player player;
         mk_decoder decoder;
-        mk_swscale swscale;
+        mk_swscale swscale, reducedSwscale;
+        int pixelFormat, reducedWidth, reducedHeight;
+
+        /// Set if decoding on VideoDecodeScheduler: frames are queued and decoded synchronously
+        osg::ref_ptr<osgVerse::VideoDecodeScheduler::Task> task;
+        osgVerse::VideoDecodeScheduler::DecodeQuality quality;
+        std::deque<mk_frame> frames;
+        OpenThreads::Mutex frameMutex, decoderMutex;  ///< decoder is reset when tracks change
+        unsigned int reducedFrames;
+        bool needKeyFrame;
 
         static PlayerContext* create(int pixelFormat = 3/*AV_PIX_FMT_BGR24*/)
         {
             PlayerContext* ctx = new PlayerContext;
             ctx->player = mk_player_create(); ctx->decoder = NULL;
             ctx->swscale = mk_swscale_create(pixelFormat, 0, 0);
+            ctx->reducedSwscale = NULL; ctx->pixelFormat = pixelFormat;
+            ctx->reducedWidth = ctx->reducedHeight = 0; ctx->reducedFrames = 0;
+            ctx->quality = osgVerse::VideoDecodeScheduler::DECODE_FULL; ctx->needKeyFrame = false;
             mk_player_set_on_result(ctx->player, ReaderWriterZLMedia::onMkPlayerEvent, ctx);
             mk_player_set_on_shutdown(ctx->player, ReaderWriterZLMedia::onMkShutdown, ctx);
             ctx->clear(1); return ctx;
@@ -677,15 +735,63 @@ protected:
 
         void destroy()
         {
+            if (task.valid()) osgVerse::VideoDecodeScheduler::instance()->removeTask(task.get());
             if (player) mk_player_release(player);
             if (decoder) mk_decoder_release(decoder, 1);
             if (swscale) mk_swscale_release(swscale);
+            if (reducedSwscale) mk_swscale_release(reducedSwscale);
+            for (size_t i = 0; i < frames.size(); ++i) mk_frame_unref(frames[i]);
+            frames.clear();
+        }
+
+        void queueFrame(mk_frame frame)
+        {
+            frameMutex.lock();
+            frames.push_back(mk_frame_ref(frame));
+            if (frames.size() > 60)
+            {   // workers can't keep up: drop the backlog and restart from next key frame
+                mk_frame_unref(frames.front()); frames.pop_front(); needKeyFrame = true;
+            }
+            frameMutex.unlock();
+            osgVerse::VideoDecodeScheduler::instance()->notify(task.get());
+        }
+
+        double decodeQueuedFrame(osgVerse::VideoDecodeScheduler::DecodeQuality q)
+        {
+            mk_frame frame = NULL; bool hasMore = false;
+            frameMutex.lock();
+            if (!frames.empty()) { frame = frames.front(); frames.pop_front(); }
+            hasMore = !frames.empty(); frameMutex.unlock();
+            if (!frame) return -1.0;
+
+            // Hidden streams decode key frames only, and visible ones restart from a key frame
+            bool keyFrame = mk_frame_is_key(frame) != 0;
+            if (q == osgVerse::VideoDecodeScheduler::DECODE_HIDDEN) needKeyFrame = true;
+            if (needKeyFrame && !keyFrame) { mk_frame_unref(frame); return hasMore ? 0.0 : -1.0; }
+            if (q != osgVerse::VideoDecodeScheduler::DECODE_HIDDEN) needKeyFrame = false;
+
+            quality = q;  // read by onMkFrameDecoded() in the same thread
+            decoderMutex.lock();
+            if (decoder) mk_decoder_decode(decoder, frame, 0, 1);
+            decoderMutex.unlock();
+            mk_frame_unref(frame); return hasMore ? 0.0 : -1.0;
         }
 
     protected:
         osg::observer_ptr<ZLMediaResourceDemuxer> _demuxer;
     };
 
+    class DecodeTask : public osgVerse::VideoDecodeScheduler::Task
+    {
+    public:
+        DecodeTask(PlayerContext* ctx) : _context(ctx) {}
+        virtual double decode(osgVerse::VideoDecodeScheduler::DecodeQuality q)
+        { return _context->decodeQueuedFrame(q); }
+
+    protected:
+        PlayerContext* _context;
+    };
+
     static void API_CALL onMkRegisterMediaSource(void* userData, mk_media_source sender, int regist)
     {
         PusherContext* ctx = (PusherContext*)userData;
@@ -737,7 +843,8 @@ protected:
             for (int i = 0; i < trackCount; ++i)
             {
                 if (mk_track_is_video(tracks[i]) == 0) continue;
-                if (ctx->decoder) mk_decoder_release(ctx->decoder, 1);
+                ctx->decoderMutex.lock();
+                if (ctx->decoder) { mk_decoder_release(ctx->decoder, 1); ctx->decoder = NULL; }
 
                 mk_track& track = tracks[i];
                 if (ctx->getDemuxer())
@@ -747,9 +854,11 @@ protected:
                 }
                 else
                 {
-                    ctx->decoder = mk_decoder_create(track, 0);
+                    // Pooled decoding uses one thread per decoder, the pool itself is the parallelism
+                    ctx->decoder = mk_decoder_create(track, ctx->task.valid() ? 1 : 0);
                     mk_decoder_set_cb(ctx->decoder, ReaderWriterZLMedia::onMkFrameDecoded, userData);
                 }
+                ctx->decoderMutex.unlock();
                 mk_track_add_delegate(track, ReaderWriterZLMedia::onMkTrackFrameOut, userData);
             }
         }
@@ -760,8 +869,13 @@ protected:
         PlayerContext* ctx = (PlayerContext*)userData;
         if (ctx->getDemuxer())
             ctx->getDemuxer()->addFrame(frame);
+        else if (ctx->task.valid())
+            ctx->queueFrame(frame);
         else
-            mk_decoder_decode(ctx->decoder, frame, 1, 1);
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(ctx->decoderMutex);
+            if (ctx->decoder) mk_decoder_decode(ctx->decoder, frame, 1, 1);
+        }
     }
 
     static void API_CALL onMkFrameDecoded(void* userData, mk_frame_pix frame)
@@ -770,13 +884,31 @@ protected:
         int w = mk_get_av_frame_width(frameData), h = mk_get_av_frame_height(frameData);
         long long pts = mk_get_av_frame_pts(frameData);
 
+        // Scheduled streams: nothing to show if hidden, half size / half rate if tiny
+        PlayerContext* ctx = (PlayerContext*)userData;
+        mk_swscale swscale = ctx->swscale;
+        if (ctx->task.valid())
+        {
+            if (ctx->quality == osgVerse::VideoDecodeScheduler::DECODE_HIDDEN) return;
+            else if (ctx->quality == osgVerse::VideoDecodeScheduler::DECODE_REDUCED)
+            {
+                if ((ctx->reducedFrames++ % 2) != 0) return;
+                if (ctx->reducedWidth != w / 2 || ctx->reducedHeight != h / 2 || !ctx->reducedSwscale)
+                {
+                    if (ctx->reducedSwscale) mk_swscale_release(ctx->reducedSwscale);
+                    ctx->reducedWidth = w / 2; ctx->reducedHeight = h / 2;
+                    ctx->reducedSwscale = mk_swscale_create(ctx->pixelFormat, w / 2, h / 2);
+                }
+                swscale = ctx->reducedSwscale; w = w / 2; h = h / 2;
+            }
+        }
+
         osg::Image* img = new osg::Image;
         img->allocateImage(w, h, 1, GL_BGR, GL_UNSIGNED_BYTE);
         img->setInternalTextureFormat(GL_RGB8);
         img->setFileName(std::to_string(pts));
 
-        PlayerContext* ctx = (PlayerContext*)userData;
-        mk_swscale_input_frame(ctx->swscale, frame, img->data());
+        mk_swscale_input_frame(swscale, frame, img->data());
         ctx->pushToImageList(img, pts);
     }
 
@@ -872,6 +1004,7 @@ void ZLMediaPlayer::updateImage()
     if (!rw || _name.empty()) return;
 
     long long pts = 0;
+    if (!rw->waitForPlayerImage(_name, 50)) return;
     osg::ref_ptr<osg::Image> img = rw->getPlayerImage(_name, &pts);
     if (img.valid())
     {
@@ -1,57 +1,117 @@
 #include <osg/io_utils>
 #include <osg/ValueObject>
-#include <osg/TriangleIndexFunctor>
 #include <osg/Geometry>
 #include <osg/MatrixTransform>
 #include <osg/PagedLOD>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
-#include <osgUtil/Tessellator>
 #include <vtzero/vector_tile.hpp>
+#include <earcut.hpp>
+#include <array>
 
+/** Collects all features of a layer into one shared vertex array and three index lists
+    (points, line segments and earcut triangles). Feature index of each vertex is recorded
+    in a float attribute array, so that picking and styling can find it in shaders */
 struct GeometryVisitor
 {
-    osg::observer_ptr<osg::Geometry> geom;
+    typedef std::array<double, 2> RingPoint;
     osg::ref_ptr<osg::Vec3Array> vertices;
-    osg::ref_ptr<osg::Vec4Array> colors;
-    std::map<int, int> ringTypes;
-    osg::Vec4 defaultColor;
-    unsigned int vStart;
+    osg::ref_ptr<osg::FloatArray> featureIndices;
+    std::vector<unsigned int> points, lines, triangles;
+    std::vector<std::vector<RingPoint>> polygon;
+    unsigned int vStart, polygonStart;
+    float featureIndex;
 
-    GeometryVisitor(osg::Geometry* g) : geom(g), vStart(0)
+    GeometryVisitor() : vStart(0), polygonStart(0), featureIndex(0.0f)
+    { vertices = new osg::Vec3Array; featureIndices = new osg::FloatArray; }
+
+    void addVertex(const vtzero::point& point)
     {
-        vertices = dynamic_cast<osg::Vec3Array*>(geom->getVertexArray());
-        colors = dynamic_cast<osg::Vec4Array*>(geom->getColorArray());
-        defaultColor = osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f);
-        if (!vertices)
-        {
-            vertices = new osg::Vec3Array; colors = new osg::Vec4Array;
-            geom->setVertexArray(vertices.get()); geom->setColorArray(colors.get());
-            geom->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
-        }
+        vertices->push_back(osg::Vec3(point.x, point.y, 0.0f));
+        featureIndices->push_back(featureIndex);
     }
 
-    void points_begin(const uint32_t count) { vStart = vertices->size(); }
+    void removeVerticesFrom(unsigned int start)
+    { vertices->resize(start); featureIndices->resize(start); }
+
+    void points_begin(const uint32_t count) { vertices->reserve(vertices->size() + count); }
     void points_point(const vtzero::point point)
-    { vertices->push_back(osg::Vec3(point.x, point.y, 0.0f)); colors->push_back(defaultColor); }
-    void points_end()
-    { geom->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, vStart, vertices->size() - vStart)); }
+    { points.push_back(vertices->size()); addVertex(point); }
+    void points_end() {}
 
     void linestring_begin(const uint32_t count) { vStart = vertices->size(); }
-    void linestring_point(const vtzero::point point)
-    { vertices->push_back(osg::Vec3(point.x, point.y, 0.0f)); colors->push_back(defaultColor); }
+    void linestring_point(const vtzero::point point) { addVertex(point); }
     void linestring_end()
-    { geom->addPrimitiveSet(new osg::DrawArrays(GL_LINE_STRIP, vStart, vertices->size() - vStart)); }
+    {
+        for (unsigned int i = vStart + 1; i < vertices->size(); ++i)
+        { lines.push_back(i - 1); lines.push_back(i); }
+    }
+
+    void ring_begin(const uint32_t count)
+    {
+        vStart = vertices->size();
+        if (polygon.empty()) polygonStart = vStart;
+        polygon.push_back(std::vector<RingPoint>()); polygon.back().reserve(count);
+    }
 
-    void ring_begin(const uint32_t count) { vStart = vertices->size(); }
     void ring_point(const vtzero::point point)
-    { vertices->push_back(osg::Vec3(point.x, point.y, 0.0f)); colors->push_back(defaultColor); }
+    {
+        RingPoint pt = { (double)point.x, (double)point.y };
+        polygon.back().push_back(pt); addVertex(point);
+    }
+
     void ring_end(const vtzero::ring_type rt)
     {
-        ringTypes[geom->getNumPrimitiveSets()] = (int)rt;
-        if (vertices->at(vStart) == vertices->back()) { vertices->pop_back(); colors->pop_back(); }
-        geom->addPrimitiveSet(new osg::DrawArrays(GL_POLYGON, vStart, vertices->size() - vStart));
+        std::vector<RingPoint>& ring = polygon.back();
+        if (rt == vtzero::ring_type::invalid || ring.size() < 3)
+        { polygon.pop_back(); removeVerticesFrom(vStart); return; }
+        if (ring.size() > 1 && ring.front() == ring.back())
+        { ring.pop_back(); removeVerticesFrom(vertices->size() - 1); }
+
+        // An outer ring starts a new polygon: triangulate previous one with its holes
+        if (rt == vtzero::ring_type::outer && polygon.size() > 1)
+        {
+            std::vector<RingPoint> outer; outer.swap(ring); polygon.pop_back();
+            flushPolygon(); polygonStart = vStart;
+            polygon.push_back(std::vector<RingPoint>()); polygon.back().swap(outer);
+        }
+    }
+
+    void flushPolygon()
+    {
+        if (!polygon.empty())
+        {
+            std::vector<unsigned int> indices = mapbox::earcut<unsigned int>(polygon);
+            for (size_t i = 0; i < indices.size(); ++i)
+                triangles.push_back(polygonStart + indices[i]);
+        }
+        polygon.clear(); polygonStart = vertices->size();
+    }
+
+    osg::PrimitiveSet* createPrimitiveSet(GLenum mode, const std::vector<unsigned int>& indices) const
+    {
+        if (indices.empty()) return NULL;
+        else if (vertices->size() < 65535)
+            return new osg::DrawElementsUShort(mode, indices.begin(), indices.end());
+        else
+            return new osg::DrawElementsUInt(mode, indices.begin(), indices.end());
+    }
+
+    void apply(osg::Geometry& geom) const
+    {
+        if (vertices->empty()) return;
+        osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+        colors->push_back(osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        geom.setVertexArray(vertices.get());
+        geom.setColorArray(colors.get()); geom.setColorBinding(osg::Geometry::BIND_OVERALL);
+        geom.setVertexAttribArray(7, featureIndices.get());
+        geom.setVertexAttribBinding(7, osg::Geometry::BIND_PER_VERTEX);
+
+        osg::PrimitiveSet* p = createPrimitiveSet(GL_TRIANGLES, triangles);
+        if (p) geom.addPrimitiveSet(p);
+        p = createPrimitiveSet(GL_LINES, lines); if (p) geom.addPrimitiveSet(p);
+        p = createPrimitiveSet(GL_POINTS, points); if (p) geom.addPrimitiveSet(p);
     }
 };
 
@@ -110,49 +170,19 @@ public:
                 size_t numKeyValues = osg::minimum(keys.size(), values.size());
                 for (size_t i = 0; i < numKeyValues; ++i) updateProperty(*geode, "", keys[i], values[i]);
 
-                GeometryVisitor gv(geom.get());
+                GeometryVisitor gv;
                 while (vtzero::feature feature = layer.next_feature())
                 {
-                    vtzero::decode_geometry(feature.geometry(), gv);
-                    osg::PrimitiveSet* p = geom->getNumPrimitiveSets() > 0 ?
-                        geom->getPrimitiveSet(geom->getNumPrimitiveSets() - 1) : NULL;
+                    // Feature properties are saved as "<featureIndex>_<key>", where the index
+                    // can be read from vertex attribute 7 of the layer geometry
+                    std::string prefix = std::to_string((int)gv.featureIndex) + "_";
+                    geom->setUserValue(prefix + "id", (unsigned int)feature.id());
+                    vtzero::decode_geometry(feature.geometry(), gv); gv.flushPolygon();
                     while (vtzero::property prop = feature.next_property())
-                    {
-                        std::string id = std::to_string(feature.id());
-                        if (p) { p->setName(id); updateProperty(*p, "", prop.key(), prop.value()); }
-                        else updateProperty(*geom, id + "_", prop.key(), prop.value());
-                    }
-                }
-
-                if (!gv.ringTypes.empty())
-                {
-                    unsigned int lastNumPrimitives = geom->getNumPrimitiveSets();
-                    std::vector<osg::ref_ptr<osg::DrawArrays>> polygonsToTess;
-
-                    osg::ref_ptr<osg::Geometry> geomToTess = new osg::Geometry;
-                    geomToTess->setVertexArray(gv.vertices.get());
-                    for (unsigned int i = 0; i < lastNumPrimitives; ++i)
-                    {
-                        osg::DrawArrays* da = static_cast<osg::DrawArrays*>(geom->getPrimitiveSet(i));
-                        if (da->getMode() != GL_POLYGON) continue;
-
-                        bool outer = (gv.ringTypes[i] == 0);
-                        if (outer && !polygonsToTess.empty())
-                        {   // Handle past data
-                            osg::PrimitiveSet* p = createDelaunayTriangulation(*geomToTess, polygonsToTess);
-                            if (p) geom->addPrimitiveSet(p); polygonsToTess.clear();
-                        }
-                        polygonsToTess.push_back(da);
-                    }
-
-                    if (!polygonsToTess.empty())
-                    {   // Handle past data
-                        osg::ref_ptr<osg::PrimitiveSet> p = createDelaunayTriangulation(*geomToTess, polygonsToTess);
-                        if (p.valid()) geom->addPrimitiveSet(p.get());
-                    }
-                    for (int i = (int)lastNumPrimitives - 1; i >= 0; --i)
-                    { if (geom->getPrimitiveSet(i)->getMode() == GL_POLYGON) geom->removePrimitiveSet(i); }
+                        updateProperty(*geom, prefix, prop.key(), prop.value());
+                    gv.featureIndex += 1.0f;
                 }
+                gv.apply(*geom);
             }  // while (vtzero::layer layer = tile.next_layer())
         }
         catch (const std::exception& e)
@@ -161,33 +191,6 @@ public:
     }
 
 protected:
-    struct TriangleCollector
-    {
-        std::vector<unsigned int> triangles;
-        void operator()(unsigned int i1, unsigned int i2, unsigned int i3)
-        { triangles.push_back(i1); triangles.push_back(i2); triangles.push_back(i3); }
-    };
-
-    osg::PrimitiveSet* createDelaunayTriangulation(
-            osg::Geometry& geom, const std::vector<osg::ref_ptr<osg::DrawArrays>>& primitives) const
-    {
-        geom.removePrimitiveSet(0, geom.getNumPrimitiveSets());
-        for (size_t i = 0; i < primitives.size(); ++i)
-            geom.addPrimitiveSet(primitives[i].get());
-
-        osg::ref_ptr<osgUtil::Tessellator> tscx = new osgUtil::Tessellator;
-        tscx->setWindingType(osgUtil::Tessellator::TESS_WINDING_ODD);
-        tscx->setTessellationType(osgUtil::Tessellator::TESS_TYPE_POLYGONS);
-        tscx->setTessellationNormal(osg::Z_AXIS);
-        tscx->retessellatePolygons(geom);
-
-        osg::TriangleIndexFunctor<TriangleCollector> f; geom.accept(f);
-        if (f.triangles.size() < 65535)
-            return new osg::DrawElementsUShort(GL_TRIANGLES, f.triangles.begin(), f.triangles.end());
-        else
-            return new osg::DrawElementsUInt(GL_TRIANGLES, f.triangles.begin(), f.triangles.end());
-    }
-
     void updateProperty(osg::Object& obj, const std::string& prefix,
                         const vtzero::data_view& key, const vtzero::property_value& v) const
     {
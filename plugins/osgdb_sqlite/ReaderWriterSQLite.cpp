@@ -0,0 +1,584 @@
+#include <osg/io_utils>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/PagedLOD>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/Registry>
+#include <osgDB/Archive>
+#include <osg/observer_ptr>
+#include <OpenThreads/ScopedLock>
+#include <thread>
+#include "3rdparty/sqlite3.h"
+
+enum SQLiteObjectType { OBJECT, ARCHIVE, IMAGE, HEIGHTFIELD, NODE, SHADER };
+
+/** Connection and prepared statements owned by a single thread */
+struct SQLiteConnection
+{
+    SQLiteConnection() : db(NULL), selectStmt(NULL), insertStmt(NULL), listStmt(NULL) {}
+    ~SQLiteConnection()
+    {
+        sqlite3_finalize(selectStmt); sqlite3_finalize(insertStmt);
+        sqlite3_finalize(listStmt); sqlite3_close(db);
+    }
+
+    /** Returns the cached select statement, or a temporary one if the cached statement is
+        still in use, e.g., a nested reading of texture from the model being decoded */
+    sqlite3_stmt* acquireSelect()
+    {
+        if (!sqlite3_stmt_busy(selectStmt)) return selectStmt;
+        sqlite3_stmt* stmt = NULL;
+        sqlite3_prepare_v2(db, "SELECT data FROM files WHERE name = ?", -1, &stmt, NULL);
+        return stmt;
+    }
+
+    void releaseSelect(sqlite3_stmt* stmt)
+    {
+        if (stmt != selectStmt) { sqlite3_finalize(stmt); return; }
+        sqlite3_reset(stmt); sqlite3_clear_bindings(stmt);
+    }
+
+    sqlite3* db; sqlite3_stmt *selectStmt, *insertStmt, *listStmt;
+};
+
+/** Opened database file. SQLite connections can't be shared between threads, so every
+    thread (e.g., each database pager thread) gets its own one at first use. Connections are
+    closed when the thread exits, or when the entry is released by all readers and archives */
+struct SQLiteEntry : public osg::Referenced
+{
+    SQLiteEntry(const std::string& n, bool w, bool im) : name(n), writable(w), immutable(im) {}
+
+    SQLiteConnection* getConnection();
+    void releaseConnection(std::thread::id id)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        ConnectionMap::iterator itr = connections.find(id);
+        if (itr != connections.end()) { delete itr->second; connections.erase(itr); }
+    }
+
+    SQLiteConnection* openConnection()
+    {
+        // Read-only viewers may open a shared (even network) file as immutable, which disables
+        // all locking; otherwise WAL mode allows readers and one writer to work together
+        int flags = SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_URI;
+        if (writable) flags |= SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+        else flags |= SQLITE_OPEN_READONLY;
+
+        std::string uri = "file:" + name;
+        if (!writable && immutable) uri += "?immutable=1";
+
+        SQLiteConnection* conn = new SQLiteConnection;
+        if (sqlite3_open_v2(uri.c_str(), &conn->db, flags, NULL) != SQLITE_OK)
+        {
+            OSG_WARN << "[sqlite] Failed to open " << name << ": "
+                     << sqlite3_errmsg(conn->db) << std::endl;
+            delete conn; return NULL;
+        }
+
+        sqlite3_busy_timeout(conn->db, 5000);
+        if (writable)
+        {
+            const char* sql = "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;"
+                              "CREATE TABLE IF NOT EXISTS files (name TEXT PRIMARY KEY, data BLOB);";
+            char* errMsg = NULL;
+            if (sqlite3_exec(conn->db, sql, NULL, NULL, &errMsg) != SQLITE_OK)
+            {
+                OSG_WARN << "[sqlite] Failed to initialize " << name << ": "
+                         << (errMsg ? errMsg : "") << std::endl;
+                sqlite3_free(errMsg); delete conn; return NULL;
+            }
+            sqlite3_prepare_v2(conn->db, "INSERT OR REPLACE INTO files (name, data) VALUES (?, ?)",
+                               -1, &conn->insertStmt, NULL);
+        }
+
+        sqlite3_prepare_v2(conn->db, "SELECT data FROM files WHERE name = ?",
+                           -1, &conn->selectStmt, NULL);
+        sqlite3_prepare_v2(conn->db, "SELECT name FROM files", -1, &conn->listStmt, NULL);
+        if (!conn->selectStmt || !conn->listStmt)
+        {
+            OSG_WARN << "[sqlite] Invalid database " << name << ": "
+                     << sqlite3_errmsg(conn->db) << std::endl;
+            delete conn; return NULL;
+        }
+        return conn;
+    }
+
+    typedef std::map<std::thread::id, SQLiteConnection*> ConnectionMap;
+    ConnectionMap connections; OpenThreads::Mutex mutex;
+    std::string name; bool writable, immutable;
+
+protected:
+    virtual ~SQLiteEntry()
+    {
+        for (ConnectionMap::iterator itr = connections.begin(); itr != connections.end(); ++itr)
+            delete itr->second;
+    }
+};
+
+/** Entries having connections of current thread, to close them when the thread exits */
+struct SQLiteThreadConnections
+{
+    ~SQLiteThreadConnections()
+    {
+        std::thread::id id = std::this_thread::get_id();
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            osg::ref_ptr<SQLiteEntry> entry;
+            if (entries[i].lock(entry)) entry->releaseConnection(id);
+        }
+    }
+    std::vector<osg::observer_ptr<SQLiteEntry>> entries;
+};
+static thread_local SQLiteThreadConnections t_threadConnections;
+
+SQLiteConnection* SQLiteEntry::getConnection()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    ConnectionMap::iterator itr = connections.find(std::this_thread::get_id());
+    if (itr != connections.end()) return itr->second;
+
+    SQLiteConnection* conn = openConnection();
+    if (conn)
+    {
+        connections[std::this_thread::get_id()] = conn;
+        t_threadConnections.entries.push_back(this);
+    }
+    return conn;
+}
+
+/** Read-only stream buffer over the blob returned by SQLite, to avoid copying it */
+class SQLiteBlobBuffer : public std::streambuf
+{
+public:
+    SQLiteBlobBuffer(const void* data, int size)
+    {
+        char* ptr = (char*)data;
+        setg(ptr, ptr, ptr ? ptr + size : ptr);
+    }
+
+protected:
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                             std::ios_base::openmode which = std::ios_base::in)
+    {
+        char* target = (dir == std::ios_base::beg) ? eback() + off
+                     : ((dir == std::ios_base::cur) ? gptr() + off : egptr() + off);
+        if (target < eback() || target > egptr()) return pos_type(off_type(-1));
+        setg(eback(), target, egptr()); return pos_type(target - eback());
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in)
+    { return seekoff(off_type(pos), std::ios_base::beg, which); }
+};
+
+class SQLiteArchive : public osgDB::Archive
+{
+public:
+    SQLiteArchive(const osgDB::ReaderWriter* rw, ArchiveStatus status,
+                  const std::string& dbName, const osgDB::Options* options);
+    virtual ~SQLiteArchive() { close(); }
+
+    virtual const char* libraryName() const { return "osgVerse"; }
+    virtual const char* className() const { return "SQLiteArchive"; }
+    virtual bool acceptsExtension(const std::string& /*ext*/) const { return true; }
+
+    virtual void close();
+    virtual bool fileExists(const std::string& filename) const;
+    virtual std::string getArchiveFileName() const { return _dbName; }
+    virtual std::string getMasterFileName() const { return "sqlite://" + _dbName + "/"; }
+
+    virtual osgDB::FileType getFileType(const std::string& filename) const
+    {
+        if (fileExists(filename)) return osgDB::REGULAR_FILE;
+        else return osgDB::FILE_NOT_FOUND;
+    }
+
+    virtual bool getFileNames(osgDB::DirectoryContents& fileNames) const;
+
+    osgDB::ReaderWriter::ReadResult readFile(
+        SQLiteObjectType type, const std::string& f, const osgDB::Options* o) const;
+    osgDB::ReaderWriter::WriteResult writeFile(const osg::Object& obj,
+        SQLiteObjectType type, const std::string& f, const osgDB::Options* o) const;
+
+    virtual ReadResult readObject(
+        const std::string& f, const osgDB::Options* o  = NULL) const { return readFile(OBJECT, f, o); }
+    virtual ReadResult readImage(
+        const std::string& f, const osgDB::Options* o  = NULL) const { return readFile(IMAGE, f, o); }
+    virtual ReadResult readHeightField(
+        const std::string& f, const osgDB::Options* o  = NULL) const { return readFile(HEIGHTFIELD, f, o); }
+    virtual ReadResult readNode(
+        const std::string& f, const osgDB::Options* o  = NULL) const { return readFile(NODE, f, o); }
+    virtual ReadResult readShader(
+        const std::string& f, const osgDB::Options* o  = NULL) const { return readFile(SHADER, f, o); }
+    virtual WriteResult writeObject(const osg::Object& obj,
+        const std::string& f, const osgDB::Options* o = NULL) const { return writeFile(obj, OBJECT, f, o); }
+    virtual WriteResult writeImage(const osg::Image& obj,
+        const std::string& f, const osgDB::Options* o = NULL) const { return writeFile(obj, IMAGE, f, o); }
+    virtual WriteResult writeHeightField(const osg::HeightField& obj,
+        const std::string& f, const osgDB::Options* o = NULL) const { return writeFile(obj, HEIGHTFIELD, f, o); }
+    virtual WriteResult writeNode(const osg::Node& obj,
+        const std::string& f, const osgDB::Options* o = NULL) const { return writeFile(obj, NODE, f, o); }
+    virtual WriteResult writeShader(const osg::Shader& obj,
+        const std::string& f, const osgDB::Options* o = NULL) const { return writeFile(obj, SHADER, f, o); }
+
+protected:
+    osg::observer_ptr<osgDB::ReaderWriter> _readerWriter;
+    osg::ref_ptr<SQLiteEntry> _db; std::string _dbName;
+};
+
+class ReaderWriterSQLite : public osgDB::ReaderWriter
+{
+public:
+    ReaderWriterSQLite()
+    {
+        supportsProtocol("sqlite", "Read from SQLite database.");
+        supportsOption("Immutable", "Open the database read-only without any locking, so that "
+                       "multiple processes/hosts can share a file which is never changed");
+
+        // Examples:
+        // - Writing: osgconv cessna.osg sqlite://test.db/cessna.osg.verse_sqlite
+        // - Reading: osgviewer sqlite://test.db/cessna.osg.verse_sqlite
+        supportsExtension("verse_sqlite", "Pseudo file extension, used to select DB plugin.");
+        supportsExtension("*", "Passes all read files to other plugins to handle actual model loading.");
+    }
+
+    bool acceptsProtocol(const std::string& protocol) const
+    {
+        std::string lowercase_protocol = osgDB::convertToLowerCase(protocol);
+        return (_supportedProtocols.count(lowercase_protocol) != 0);
+    }
+
+    virtual const char* className() const
+    { return "[osgVerse] Scene reader/writer from SQLite database"; }
+
+    virtual ReadResult openArchive(const std::string& fullFileName, ArchiveStatus status,
+                                   unsigned int, const Options* options) const
+    {
+        // Create archive from DB
+        std::string dbName = osgDB::getServerAddress(fullFileName);
+        return new SQLiteArchive(this, status, dbName, options);
+    }
+
+    virtual ReadResult readObject(const std::string& fileName, const Options* options) const
+    { return readFile(OBJECT, fileName, options); }
+
+    virtual ReadResult readImage(const std::string& fileName, const Options* options) const
+    { return readFile(IMAGE, fileName, options); }
+
+    virtual ReadResult readHeightField(const std::string& fileName, const Options* options) const
+    { return readFile(HEIGHTFIELD, fileName, options); }
+
+    virtual ReadResult readNode(const std::string& fileName, const Options* options) const
+    { return readFile(NODE, fileName, options); }
+
+    virtual ReadResult readShader(const std::string& fileName, const Options* options) const
+    { return readFile(SHADER, fileName, options); }
+
+    virtual WriteResult writeObject(const osg::Object& obj, const std::string& fileName, const Options* options) const
+    { return writeFile(obj, fileName, options); }
+
+    virtual WriteResult writeImage(const osg::Image& image, const std::string& fileName, const Options* options) const
+    { return writeFile(image, fileName, options); }
+
+    virtual WriteResult writeHeightField(const osg::HeightField& heightField, const std::string& fileName, const Options* options) const
+    { return writeFile(heightField, fileName, options); }
+
+    virtual WriteResult writeNode(const osg::Node& node, const std::string& fileName, const Options* options) const
+    { return writeFile(node, fileName, options); }
+
+    virtual WriteResult writeShader(const osg::Shader& s, const std::string& fileName, const Options* options) const
+    { return writeFile(s, fileName, options); }
+
+    ReadResult readFile(SQLiteObjectType objectType, osgDB::ReaderWriter* rw,
+                        std::istream& fin, const Options* options) const
+    {
+        switch (objectType)
+        {
+        case (OBJECT): return rw->readObject(fin, options);
+        case (ARCHIVE): return rw->openArchive(fin, options);
+        case (IMAGE): return rw->readImage(fin, options);
+        case (HEIGHTFIELD): return rw->readHeightField(fin, options);
+        case (NODE): return rw->readNode(fin, options);
+        default: break;
+        }
+        return ReadResult::FILE_NOT_HANDLED;
+    }
+
+    WriteResult writeFile(const osg::Object& obj, osgDB::ReaderWriter* rw,
+                          std::ostream& fout, const Options* options) const
+    {
+        const osg::HeightField* heightField = dynamic_cast<const osg::HeightField*>(&obj);
+        if (heightField) return rw->writeHeightField(*heightField, fout, options);
+
+        const osg::Node* node = dynamic_cast<const osg::Node*>(&obj);
+        if (node) return rw->writeNode(*node, fout, options);
+
+        const osg::Image* image = dynamic_cast<const osg::Image*>(&obj);
+        if (image) return rw->writeImage(*image, fout, options);
+
+        const osg::Shader* shader = dynamic_cast<const osg::Shader*>(&obj);
+        if (shader) return rw->writeShader(*shader, fout, options);
+
+        return rw->writeObject(obj, fout, options);
+    }
+
+    virtual bool fileExists(const std::string& filename, const osgDB::Options* options) const
+    {
+        std::string scheme = osgDB::getServerProtocol(filename);
+        if (scheme == "sqlite")
+        {
+            std::string dbName = osgDB::getServerAddress(filename);
+            std::string keyName = osgDB::getServerFileName(filename);
+            osg::ref_ptr<SQLiteEntry> db = getOrCreateDatabase(dbName, false, options);
+            return db.valid() ? exists(db.get(), keyName) : false;
+        }
+        return ReaderWriter::fileExists(filename, options);
+    }
+
+    ReadResult readFile(SQLiteObjectType objectType, const std::string& fullFileName,
+                        const osgDB::Options* options) const
+    {
+        std::string fileName(fullFileName);
+        std::string ext = osgDB::getFileExtension(fullFileName);
+        std::string scheme = osgDB::getServerProtocol(fullFileName);
+        bool usePseudo = (ext == "verse_sqlite");
+        if (usePseudo)
+        {
+            fileName = osgDB::getNameLessExtension(fullFileName);
+            ext = osgDB::getFileExtension(fileName);
+        }
+
+        if (!acceptsProtocol(scheme))
+        {
+            if (options && !options->getDatabasePathList().empty())
+            {
+                if (osgDB::containsServerAddress(options->getDatabasePathList().front()))
+                {
+                    scheme = osgDB::getServerProtocol(options->getDatabasePathList().front());
+                    if (acceptsProtocol(scheme))
+                    {
+                        std::string newFileName = options->getDatabasePathList().front() + "/" + fileName;
+                        return readFile(objectType, newFileName, options);
+                    }
+                }
+            }
+            return ReadResult::FILE_NOT_HANDLED;
+        }
+
+        osgDB::ReaderWriter* reader =
+            osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+        if (!reader)
+        {
+            OSG_WARN << "[sqlite] No reader/writer plugin for " << fileName << std::endl;
+            return ReadResult::FILE_NOT_HANDLED;
+        }
+
+        // Read data from DB
+        std::string dbName = osgDB::getServerAddress(fullFileName);
+        std::string keyName = osgDB::getServerFileName(fullFileName);
+        osg::ref_ptr<SQLiteEntry> db = getOrCreateDatabase(dbName, false, options);
+        if (!db) return ReadResult::ERROR_IN_READING_FILE;
+        else return read(db.get(), fileName, keyName, objectType, reader, options);
+    }
+
+    bool exists(SQLiteEntry* db, const std::string& keyName) const
+    {
+        SQLiteConnection* conn = db->getConnection(); if (!conn) return false;
+        sqlite3_stmt* stmt = conn->acquireSelect(); if (!stmt) return false;
+        sqlite3_bind_text(stmt, 1, keyName.c_str(), (int)keyName.size(), SQLITE_STATIC);
+        bool found = (sqlite3_step(stmt) == SQLITE_ROW);
+        conn->releaseSelect(stmt); return found;
+    }
+
+    bool getKeys(SQLiteEntry* db, osgDB::DirectoryContents& keys) const
+    {
+        SQLiteConnection* conn = db->getConnection(); if (!conn) return false;
+        sqlite3_stmt* stmt = conn->listStmt; int result = SQLITE_OK;
+        while ((result = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            const unsigned char* text = sqlite3_column_text(stmt, 0);
+            if (text) keys.push_back(std::string((const char*)text, sqlite3_column_bytes(stmt, 0)));
+        }
+        sqlite3_reset(stmt); return result == SQLITE_DONE;
+    }
+
+    ReadResult read(SQLiteEntry* db, const std::string& fileName, const std::string& keyName,
+                    SQLiteObjectType type, osgDB::ReaderWriter* rw, const osgDB::Options* options) const
+    {
+        SQLiteConnection* conn = db->getConnection();
+        if (!conn) return ReadResult::ERROR_IN_READING_FILE;
+
+        sqlite3_stmt* stmt = conn->acquireSelect();
+        if (!stmt) return ReadResult::ERROR_IN_READING_FILE;
+        sqlite3_bind_text(stmt, 1, keyName.c_str(), (int)keyName.size(), SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_ROW)
+        { conn->releaseSelect(stmt); return ReadResult::FILE_NOT_FOUND; }
+
+        // Blob is valid until the statement is reset, so decode it in place
+        SQLiteBlobBuffer blobBuffer(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0));
+        std::istream buffer(&blobBuffer);
+
+        // Load by other readerwriter
+        osg::ref_ptr<Options> lOptions = options ?
+            static_cast<Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new Options;
+        lOptions->getDatabasePathList().push_front(osgDB::getFilePath(fileName));
+        lOptions->setPluginStringData("STREAM_FILENAME", osgDB::getSimpleFileName(fileName));
+        lOptions->setPluginStringData("filename", fileName);
+
+        ReadResult readResult = readFile(type, rw, buffer, lOptions.get());
+        lOptions->getDatabasePathList().pop_front();
+        conn->releaseSelect(stmt);
+        return readResult;
+    }
+
+    virtual WriteResult writeFile(const osg::Object& obj, const std::string& fullFileName,
+                                  const osgDB::Options* options) const
+    {
+        std::string fileName(fullFileName);
+        std::string ext = osgDB::getFileExtension(fullFileName);
+        std::string scheme = osgDB::getServerProtocol(fullFileName);
+        bool usePseudo = (ext == "verse_sqlite");
+        if (usePseudo)
+        {
+            fileName = osgDB::getNameLessExtension(fullFileName);
+            ext = osgDB::getFileExtension(fileName);
+        }
+
+        if (scheme != "sqlite")
+        {
+            if (options && !options->getDatabasePathList().empty())
+            {
+                if (osgDB::containsServerAddress(options->getDatabasePathList().front()))
+                {
+                    std::string newFileName = options->getDatabasePathList().front() + "/" + fileName;
+                    return writeFile(obj, newFileName, options);
+                }
+            }
+            return WriteResult::FILE_NOT_HANDLED;
+        }
+
+        std::string dbName = osgDB::getServerAddress(fullFileName);
+        std::string keyName = osgDB::getServerFileName(fullFileName);
+        osg::ref_ptr<SQLiteEntry> db = getOrCreateDatabase(dbName, true, options);
+        if (!db) return WriteResult::ERROR_IN_WRITING_FILE;
+
+        osgDB::ReaderWriter* writer = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+        if (!writer) return WriteResult::FILE_NOT_HANDLED;
+        else return write(db.get(), obj, keyName, writer, options);
+    }
+
+    WriteResult write(SQLiteEntry* db, const osg::Object& obj, const std::string& keyName,
+                      osgDB::ReaderWriter* rw, const osgDB::Options* options) const
+    {
+        std::stringstream requestBuffer;
+        osgDB::ReaderWriter::WriteResult result = writeFile(obj, rw, requestBuffer, options);
+        if (!result.success()) return result;
+
+        SQLiteConnection* conn = db->getConnection();
+        if (!conn || !conn->insertStmt) return WriteResult::ERROR_IN_WRITING_FILE;
+
+        std::string data = requestBuffer.str();
+        sqlite3_stmt* stmt = conn->insertStmt;
+        sqlite3_bind_text(stmt, 1, keyName.c_str(), (int)keyName.size(), SQLITE_STATIC);
+        sqlite3_bind_blob(stmt, 2, data.data(), (int)data.size(), SQLITE_STATIC);
+        int status = sqlite3_step(stmt);
+        sqlite3_reset(stmt); sqlite3_clear_bindings(stmt);
+        if (status != SQLITE_DONE)
+        {
+            OSG_WARN << "[sqlite] Failed to write " << keyName << ": "
+                     << sqlite3_errmsg(conn->db) << std::endl;
+            return WriteResult::ERROR_IN_WRITING_FILE;
+        }
+        return WriteResult::FILE_SAVED;
+    }
+
+    osg::ref_ptr<SQLiteEntry> getOrCreateDatabase(const std::string& name, bool writable,
+                                                  const osgDB::Options* opt) const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dbMutex);
+        DatabaseMap& dbMap = const_cast<DatabaseMap&>(_dbMap);
+        DatabaseMap::iterator itr = dbMap.find(name);
+        if (itr != dbMap.end())
+        {
+            // A read-only entry is replaced when writing is required later; those still
+            // using the old one keep it alive until they finish
+            if (!writable || itr->second->writable) return itr->second;
+        }
+        else if (!writable && !osgDB::fileExists(name))
+            return NULL;
+
+        bool immutable = opt ? (opt->getOptionString().find("Immutable") != std::string::npos
+                                || !opt->getPluginStringData("Immutable").empty()) : false;
+        osg::ref_ptr<SQLiteEntry> entry = new SQLiteEntry(name, writable, immutable);
+        if (!entry->getConnection()) return NULL;
+        dbMap[name] = entry; return entry;
+    }
+
+    /** Remove the entry, whose connections are closed once no reader is using it */
+    void closeDatabase(const std::string& name)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dbMutex);
+        _dbMap.erase(name);
+    }
+
+protected:
+    typedef std::map<std::string, osg::ref_ptr<SQLiteEntry>> DatabaseMap;
+    DatabaseMap _dbMap;
+    mutable OpenThreads::Mutex _dbMutex;
+};
+
+SQLiteArchive::SQLiteArchive(const osgDB::ReaderWriter* rw, ArchiveStatus status,
+                             const std::string& dbName, const osgDB::Options* options)
+    : _readerWriter(NULL), _dbName(dbName)
+{
+    ReaderWriterSQLite* rwdb = static_cast<ReaderWriterSQLite*>(const_cast<ReaderWriter*>(rw));
+    if (!rwdb) { _db = NULL; return; } else _readerWriter = rwdb;
+    _db = rwdb->getOrCreateDatabase(dbName, status != ArchiveStatus::READ, options);
+}
+
+void SQLiteArchive::close()
+{
+    ReaderWriterSQLite* rwdb = static_cast<ReaderWriterSQLite*>(_readerWriter.get());
+    if (rwdb) rwdb->closeDatabase(_dbName); _db = NULL; _readerWriter = NULL;
+}
+
+bool SQLiteArchive::fileExists(const std::string& filename) const
+{
+    ReaderWriterSQLite* rwdb = static_cast<ReaderWriterSQLite*>(_readerWriter.get());
+    if (!rwdb || !_db) return false;
+    return rwdb->exists(_db.get(), filename);
+}
+
+bool SQLiteArchive::getFileNames(osgDB::DirectoryContents& fileNames) const
+{
+    ReaderWriterSQLite* rwdb = static_cast<ReaderWriterSQLite*>(_readerWriter.get());
+    if (!rwdb || !_db) return false;
+    return rwdb->getKeys(_db.get(), fileNames);
+}
+
+osgDB::ReaderWriter::ReadResult SQLiteArchive::readFile(
+    SQLiteObjectType type, const std::string& fileName, const osgDB::Options* op) const
+{
+    std::string ext = osgDB::getFileExtension(fileName);
+    osgDB::ReaderWriter* reader = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+    if (!reader) return ReadResult::FILE_NOT_HANDLED;
+
+    ReaderWriterSQLite* rwdb = static_cast<ReaderWriterSQLite*>(_readerWriter.get());
+    if (!rwdb || !_db) return ReadResult::FILE_NOT_HANDLED;
+    return rwdb->read(_db.get(), getMasterFileName() + fileName, fileName, type, reader, op);
+}
+
+osgDB::ReaderWriter::WriteResult SQLiteArchive::writeFile(const osg::Object& obj,
+    SQLiteObjectType type, const std::string& fileName, const osgDB::Options* op) const
+{
+    std::string ext = osgDB::getFileExtension(fileName);
+    osgDB::ReaderWriter* writer = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+    if (!writer) return WriteResult::FILE_NOT_HANDLED;
+
+    ReaderWriterSQLite* rwdb = static_cast<ReaderWriterSQLite*>(_readerWriter.get());
+    if (!rwdb || !_db) return WriteResult::FILE_NOT_HANDLED;
+    return rwdb->write(_db.get(), obj, fileName, writer, op);
+}
+
+// Now register with Registry to instantiate the above reader/writer.
+REGISTER_OSGPLUGIN(verse_sqlite, ReaderWriterSQLite)
@@ -2,6 +2,7 @@
 #include <osg/Version>
 #include <osg/Image>
 #include <osg/ImageSequence>
+#include <osg/ValueObject>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
@@ -11,6 +12,8 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <fstream>
+#include <sstream>
 
 static std::string formattedErrorMessage(const char* fmt, va_list ap)
 {
@@ -137,75 +140,14 @@ static void remapRow(unsigned char* ptr, unsigned char* data, int n,
     }
 }
 
-static void interleaveRow(unsigned char *ptr, unsigned char *red, unsigned char *green, unsigned char *blue,
-                          int n, int numSamples, uint16_t bitspersample)
+static void interleaveSamples(unsigned char* ptr, const std::vector<unsigned char*>& planes,
+                              int n, int bytesPerSample)
 {
-    if (bitspersample == 8)
-    {
-        while (n--)
-        {
-            *ptr++ = *red++; *ptr++ = *green++; *ptr++ = *blue++;
-            if (numSamples==4) *ptr++ = 255;
-        }
-    }
-    else if (bitspersample == 16)
-    {
-        unsigned short *ptr1 = (unsigned short *)ptr;
-        unsigned short *red1 = (unsigned short *)red;
-        unsigned short *green1 = (unsigned short *)green;
-        unsigned short *blue1 = (unsigned short *)blue;
-        while (n--)
-        {
-            *ptr1++ = *red1++; *ptr1++ = *green1++; *ptr1++ = *blue1++;
-            if (numSamples==4) *ptr1++ = 65535;
-        }
-    }
-    else if (bitspersample == 32)
-    {
-        float *ptr1 = (float *)ptr; float *red1 = (float *)red;
-        float *green1 = (float *)green; float *blue1 = (float *)blue;
-        while (n--)
-        {
-            *ptr1++ = *red1++; *ptr1++ = *green1++; *ptr1++ = *blue1++;
-            if (numSamples==4) *ptr1++ = 1.0f;
-        }
-    }
-}
-
-static void interleaveRow(unsigned char* ptr, unsigned char* red, unsigned char* green, unsigned char* blue,
-                          unsigned char* alpha, int n, int numSamples, uint16_t bitspersample)
-{
-    if (bitspersample == 8)
-    {
-        while (n--)
-        {
-            *ptr++ = *red++; *ptr++ = *green++; *ptr++ = *blue++;
-            if (numSamples==4) *ptr++ = *alpha++;
-        }
-    }
-    else if (bitspersample == 16)
+    size_t numPlanes = planes.size();
+    for (int i = 0; i < n; ++i)
     {
-        unsigned short *ptr1 = (unsigned short *)ptr;
-        unsigned short *red1 = (unsigned short *)red;
-        unsigned short *green1 = (unsigned short *)green;
-        unsigned short *blue1 = (unsigned short *)blue;
-        unsigned short *alpha1 = (unsigned short *)alpha;
-        while (n--)
-        {
-            *ptr1++ = *red1++; *ptr1++ = *green1++; *ptr1++ = *blue1++;
-            if (numSamples==4) *ptr1++ = *alpha1++;
-        }
-    }
-    else if (bitspersample == 32)
-    {
-        float *ptr1 = (float *)ptr;
-        float *red1 = (float *)red; float *green1 = (float *)green;
-        float *blue1 = (float *)blue; float *alpha1 = (float *)alpha;
-        while (n--)
-        {
-            *ptr1++ = *red1++; *ptr1++ = *green1++; *ptr1++ = *blue1++;
-            if (numSamples==4) *ptr1++ = *alpha1++;
-        }
+        for (size_t s = 0; s < numPlanes; ++s)
+        { memcpy(ptr, planes[s] + i * bytesPerSample, bytesPerSample); ptr += bytesPerSample; }
     }
 }
 
@@ -257,32 +199,54 @@ static unsigned int computeInternalFormat(unsigned int pixelFormat, unsigned int
 }
 
 #define CVT(x)      (((x) * 255L) / ((1L << 16) - 1))
-#define PACK(a, b)  ((a) << 8 | (b))
 
-static osg::ImageSequence* tiffLoad(std::istream& fin, const osgDB::Options* options)
+struct TiffLayout
+{
+    uint32_t width, height, blockWidth, blockHeight;
+    uint16_t photometric, config, samplesPerPixel, bitsPerSample;
+    uint16_t *red, *green, *blue;
+    int format, bytesPerSample; bool tiled;
+};
+
+struct TiffRegion
+{
+    uint32_t x, y, width, height;
+    TiffRegion(uint32_t x0 = 0, uint32_t y0 = 0, uint32_t w = 0, uint32_t h = 0)
+    :   x(x0), y(y0), width(w), height(h) {}
+};
+
+static TIFF* tiffOpen(std::istream& fin)
 {
     TIFFSetErrorHandler(tiffError);
     TIFFSetWarningHandler(tiffWarn);
-    TIFF* in = TIFFClientOpen("inputstream", "r", (thandle_t)&fin,
-                              tiffStreamReadProc, tiffStreamWriteProc,
-                              tiffStreamSeekProc, tiffStreamCloseProc,
-                              tiffStreamSizeProc, tiffStreamMapProc, tiffStreamUnmapProc);
-    if (in == NULL) { OSG_WARN << "[ReaderWriterTiff] Unable to open stream" << std::endl; return NULL; }
+    return TIFFClientOpen("inputstream", "r", (thandle_t)&fin,
+                          tiffStreamReadProc, tiffStreamWriteProc,
+                          tiffStreamSeekProc, tiffStreamCloseProc,
+                          tiffStreamSizeProc, tiffStreamMapProc, tiffStreamUnmapProc);
+}
 
-    uint16_t photometric = 0;
+/** Read layout of current directory, returns false if it is not supported */
+static bool readTiffLayout(TIFF* in, TiffLayout& layout)
+{
+    uint16_t photometric = 0, compression = 0;
     if (TIFFGetField(in, TIFFTAG_PHOTOMETRIC, &photometric) == 1)
     {
+        // Let libjpeg convert YCbCr to RGB, which is common for orthophoto COG files
+        TIFFGetField(in, TIFFTAG_COMPRESSION, &compression);
+        if (photometric == PHOTOMETRIC_YCBCR && compression == COMPRESSION_JPEG)
+        { TIFFSetField(in, TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB); photometric = PHOTOMETRIC_RGB; }
+
         if (photometric != PHOTOMETRIC_RGB && photometric != PHOTOMETRIC_PALETTE &&
             photometric != PHOTOMETRIC_MINISWHITE && photometric != PHOTOMETRIC_MINISBLACK)
         {
             OSG_WARN << "[ReaderWriterTiff] Photometric type " << photometric << " not handled" << std::endl;
-            TIFFClose(in); return NULL;
+            return false;
         }
     }
     else
     {
         OSG_WARN << "[ReaderWriterTiff] Unable to get photometric type" << std::endl;
-        TIFFClose(in); return NULL;
+        return false;
     }
 
     uint16_t samplesperpixel = 0;
@@ -292,13 +256,13 @@ static osg::ImageSequence* tiffLoad(std::istream& fin, const osgDB::Options* opt
             samplesperpixel != 3 && samplesperpixel != 4)
         {
             OSG_WARN << "[ReaderWriterTiff] Bad samples per pixel: " << samplesperpixel << std::endl;
-            TIFFClose(in); return NULL;
+            return false;
         }
     }
     else
     {
         OSG_WARN << "[ReaderWriterTiff] Unable to get samples per pixel" << std::endl;
-        TIFFClose(in); return NULL;
+        return false;
     }
 
     uint16_t bitspersample = 0;
@@ -307,144 +271,282 @@ static osg::ImageSequence* tiffLoad(std::istream& fin, const osgDB::Options* opt
         if (bitspersample != 8 && bitspersample != 16 && bitspersample != 32)
         {
             OSG_WARN << "[ReaderWriterTiff] Can only handle 8, 16 and 32 bit samples" << std::endl;
-            TIFFClose(in); return NULL;
+            return false;
         }
     }
     else
     {
         OSG_WARN << "[ReaderWriterTiff] Unable to get bits per sample" << std::endl;
-        TIFFClose(in); return NULL;
+        return false;
     }
 
-    uint32_t w = 0, h = 0, d = 1; uint16_t config = 0, dataType = 0;
+    uint32_t w = 0, h = 0, d = 1; uint16_t config = 0;
     if (TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &w) != 1 || TIFFGetField(in, TIFFTAG_IMAGELENGTH, &h) != 1 ||
         TIFFGetField(in, TIFFTAG_PLANARCONFIG, &config) != 1)
     {
         OSG_WARN << "[ReaderWriterTiff] Unable to get width / height / depth parameters" << std::endl;
-        TIFFClose(in); return NULL;
+        return false;
     }
 
-    // if it has a palette, data returned is 3 byte rgb
-    int format = (photometric == PHOTOMETRIC_PALETTE) ? 3 : (samplesperpixel * bitspersample / 8);
-    int bytespersample = bitspersample / 8;
-    int bytesperpixel = bytespersample * samplesperpixel;
-    TIFFGetField(in, TIFFTAG_DATATYPE, &dataType);
     TIFFGetField(in, TIFFTAG_IMAGEDEPTH, &d);
-
-    osg::ref_ptr<osg::ImageSequence> seq = new osg::ImageSequence;
     if (d > 1)
     {
         // TODO...
         OSG_WARN << "[ReaderWriterTiff] Unsupported dimension" << std::endl;
+        return false;
+    }
+
+    uint16_t *red = NULL, *green = NULL, *blue = NULL;
+    if (photometric == PHOTOMETRIC_PALETTE)
+    {
+        if (TIFFGetField(in, TIFFTAG_COLORMAP, &red, &green, &blue) != 1)
+        {
+            OSG_WARN << "[ReaderWriterTiff] Unable to get colormap" << std::endl;
+            return false;
+        }
+        else if (bitspersample != 32 && checkColormap(1 << bitspersample, red, green, blue) == 16)
+        {
+            for (int i = (1 << bitspersample) - 1; i >= 0; --i)
+            { red[i] = CVT(red[i]); green[i] = CVT(green[i]); blue[i] = CVT(blue[i]); }
+        }
+    }
+
+    layout.width = w; layout.height = h; layout.tiled = TIFFIsTiled(in) != 0;
+    if (layout.tiled)
+    {
+        TIFFGetField(in, TIFFTAG_TILEWIDTH, &layout.blockWidth);
+        TIFFGetField(in, TIFFTAG_TILELENGTH, &layout.blockHeight);
     }
     else
     {
-        int dirCount = 0, imgSize = w * h * format;
-        do
+        layout.blockWidth = w;
+        TIFFGetFieldDefaulted(in, TIFFTAG_ROWSPERSTRIP, &layout.blockHeight);
+        layout.blockHeight = osg::minimum(layout.blockHeight, h);
+    }
+
+    // if it has a palette, data returned is 3 byte rgb
+    layout.photometric = photometric; layout.config = config;
+    layout.samplesPerPixel = samplesperpixel; layout.bitsPerSample = bitspersample;
+    layout.red = red; layout.green = green; layout.blue = blue;
+    layout.format = (photometric == PHOTOMETRIC_PALETTE) ? 3 : (samplesperpixel * bitspersample / 8);
+    layout.bytesPerSample = bitspersample / 8;
+    return layout.blockWidth > 0 && layout.blockHeight > 0;
+}
+
+/** Decode tiles or strips of current directory and copy the part inside the region to output,
+    which is flipped vertically as OSG images start from the bottom row */
+class TiffBlockDecoder
+{
+public:
+    TiffBlockDecoder(TIFF* in, const TiffLayout& layout, const TiffRegion& region, unsigned char* output)
+    :   _in(in), _layout(layout), _region(region), _output(output)
+    {
+        bool separated = (layout.config == PLANARCONFIG_SEPARATE);
+        size_t numPlanes = separated ? layout.samplesPerPixel : 1;
+        tmsize_t blockSize = layout.tiled ? TIFFTileSize(in) : TIFFStripSize(in);
+        _rowStride = layout.tiled ? TIFFTileRowSize(in) : TIFFScanlineSize(in);
+        _pixelStride = layout.bytesPerSample * (separated ? 1 : layout.samplesPerPixel);
+
+        _planes.resize(numPlanes);
+        for (size_t i = 0; i < numPlanes; ++i) _planes[i].resize(blockSize);
+        if (separated) _row.resize(layout.blockWidth * layout.bytesPerSample * numPlanes);
+    }
+
+    /** Decode the block starting from (x0, y0) in pixels */
+    bool decode(uint32_t x0, uint32_t y0)
+    {
+        for (size_t p = 0; p < _planes.size(); ++p)
         {
-            unsigned char* inBuffer = NULL; bool hasError = false;
-            unsigned char* buffer = new unsigned char[imgSize];
-            memset(buffer, 0, imgSize); dirCount++;
-
-            unsigned char* currPtr = buffer + (h - 1) * w * format;
-            uint16_t *red = NULL, *green = NULL, *blue = NULL;
-            size_t rowSize = TIFFScanlineSize(in);
-            switch (PACK(photometric, config))
+            tmsize_t result = _layout.tiled
+                ? TIFFReadEncodedTile(_in, TIFFComputeTile(_in, x0, y0, 0, (tsample_t)p), &(_planes[p])[0], -1)
+                : TIFFReadEncodedStrip(_in, TIFFComputeStrip(_in, y0, (tsample_t)p), &(_planes[p])[0], -1);
+            if (result < 0) return false;
+        }
+
+        uint32_t colStart = osg::maximum(x0, _region.x), rowStart = osg::maximum(y0, _region.y);
+        uint32_t colEnd = osg::minimum(osg::minimum(x0 + _layout.blockWidth, _layout.width),
+                                       _region.x + _region.width);
+        uint32_t rowEnd = osg::minimum(osg::minimum(y0 + _layout.blockHeight, _layout.height),
+                                       _region.y + _region.height);
+        if (colStart >= colEnd || rowStart >= rowEnd) return true;
+
+        int n = (int)(colEnd - colStart), format = _layout.format;
+        std::vector<unsigned char*> planeRows(_planes.size());
+        for (uint32_t row = rowStart; row < rowEnd; ++row)
+        {
+            size_t offset = (row - y0) * _rowStride + (colStart - x0) * _pixelStride;
+            unsigned char* src = &(_planes[0])[offset];
+            if (!_row.empty())
             {
-            case PACK(PHOTOMETRIC_MINISWHITE, PLANARCONFIG_CONTIG):
-            case PACK(PHOTOMETRIC_MINISBLACK, PLANARCONFIG_CONTIG):
-            case PACK(PHOTOMETRIC_MINISWHITE, PLANARCONFIG_SEPARATE):
-            case PACK(PHOTOMETRIC_MINISBLACK, PLANARCONFIG_SEPARATE):
-                inBuffer = new unsigned char[rowSize];
-                for (uint32_t row = 0; row < h; row++)
-                {
-                    if (TIFFReadScanline(in, inBuffer, row, 0) < 0) { hasError = true; break; }
-                    invertRow(currPtr, inBuffer, samplesperpixel * w,
-                              photometric == PHOTOMETRIC_MINISWHITE, bitspersample);
-                    currPtr -= format * w;
-                }
-                break;
-
-            case PACK(PHOTOMETRIC_PALETTE, PLANARCONFIG_CONTIG):
-            case PACK(PHOTOMETRIC_PALETTE, PLANARCONFIG_SEPARATE):
-                if (TIFFGetField(in, TIFFTAG_COLORMAP, &red, &green, &blue) != 1)
-                { hasError = true; break; }
-                else if (!hasError && bitspersample != 32 && checkColormap(1<<bitspersample, red, green, blue) == 16)
-                {
-                    for (int i = (1 << bitspersample) - 1; i >= 0; --i)
-                    { red[i] = CVT(red[i]); green[i] = CVT(green[i]); blue[i] = CVT(blue[i]); }
-                }
-
-                inBuffer = new unsigned char[rowSize];
-                for (uint32_t row = 0; row < h; row++)
-                {
-                    if (TIFFReadScanline(in, inBuffer, row, 0) < 0) { hasError = true; break; }
-                    remapRow(currPtr, inBuffer, w, red, green, blue); currPtr -= format * w;
-                }
-                break;
-
-            case PACK(PHOTOMETRIC_RGB, PLANARCONFIG_CONTIG):
-                inBuffer = new unsigned char[rowSize];
-                for (uint32_t row = 0; row < h; row++)
-                {
-                    if (TIFFReadScanline(in, inBuffer, row, 0) < 0) { hasError = true; break; }
-                    memcpy(currPtr, inBuffer, format * w); currPtr -= format * w;
-                }
-                break;
-
-            case PACK(PHOTOMETRIC_RGB, PLANARCONFIG_SEPARATE):
-                inBuffer = new unsigned char[format * rowSize];
-                for (uint32_t row = 0; !hasError && row < h; row++)
-                {
-                    for (int s = 0; s < format; s++)
-                    {
-                        if (TIFFReadScanline(in, (tdata_t)(inBuffer + s * rowSize), (uint32_t)row, (tsample_t)s) < 0)
-                        { hasError = true; break; }
-                    }
-
-                    if (!hasError)
-                    {
-                        unsigned char *inBuffer2 = inBuffer + rowSize, *inBuffer3 = inBuffer + 2 * rowSize,
-                                      *inBuffer4 = inBuffer + 3 * rowSize;
-                        if (format == 4) interleaveRow(currPtr, inBuffer, inBuffer2, inBuffer3, inBuffer4, w, format, bitspersample);
-                        else if (format == 3) interleaveRow(currPtr, inBuffer, inBuffer2, inBuffer3, w, format, bitspersample);
-                        currPtr -= format * w;
-                    }
-                }
-                break;
+                for (size_t p = 0; p < _planes.size(); ++p) planeRows[p] = &(_planes[p])[offset];
+                interleaveSamples(&_row[0], planeRows, n, _layout.bytesPerSample); src = &_row[0];
+            }
+
+            unsigned char* dst = _output + ((size_t)(_region.height - 1 - (row - _region.y)) * _region.width
+                                          + (colStart - _region.x)) * format;
+            switch (_layout.photometric)
+            {
+            case PHOTOMETRIC_MINISWHITE: case PHOTOMETRIC_MINISBLACK:
+                invertRow(dst, src, _layout.samplesPerPixel * n,
+                          _layout.photometric == PHOTOMETRIC_MINISWHITE, _layout.bitsPerSample); break;
+            case PHOTOMETRIC_PALETTE:
+                remapRow(dst, src, n, _layout.red, _layout.green, _layout.blue); break;
             default:
-                OSG_WARN << "[ReaderWriterTiff] Unsupported Packing: " << photometric << ", " << config << std::endl;
-                hasError = true; break;
+                memcpy(dst, src, n * format); break;
             }
+        }
+        return true;
+    }
 
-            if (inBuffer) delete[] inBuffer;
-            if (hasError)
+protected:
+    TIFF* _in; TiffLayout _layout; TiffRegion _region;
+    std::vector<std::vector<unsigned char>> _planes;
+    std::vector<unsigned char> _row;
+    unsigned char* _output; tmsize_t _rowStride, _pixelStride;
+};
+
+/** Read a region of current directory. Blocks are decoded in multiple threads if the file name
+    is known, in which case every thread opens its own handle as libtiff ones are not thread-safe */
+static osg::Image* tiffLoadDirectory(TIFF* in, const std::string& fileName, const TiffRegion* window)
+{
+    TiffLayout layout; tdir_t dirIndex = TIFFCurrentDirectory(in);
+    if (!readTiffLayout(in, layout)) return NULL;
+
+    TiffRegion region(0, 0, layout.width, layout.height);
+    if (window != NULL)
+    {
+        region.x = osg::minimum(window->x, layout.width - 1);
+        region.y = osg::minimum(window->y, layout.height - 1);
+        region.width = osg::minimum(window->width, layout.width - region.x);
+        region.height = osg::minimum(window->height, layout.height - region.y);
+    }
+    if (region.width == 0 || region.height == 0) return NULL;
+
+    std::vector<std::pair<uint32_t, uint32_t>> blocks;
+    uint32_t bx0 = (region.x / layout.blockWidth) * layout.blockWidth;
+    uint32_t by0 = (region.y / layout.blockHeight) * layout.blockHeight;
+    for (uint32_t y = by0; y < region.y + region.height; y += layout.blockHeight)
+        for (uint32_t x = bx0; x < region.x + region.width; x += layout.blockWidth)
+            blocks.push_back(std::pair<uint32_t, uint32_t>(x, y));
+
+    size_t imgSize = (size_t)region.width * region.height * layout.format;
+    unsigned char* buffer = new unsigned char[imgSize];
+    memset(buffer, 0, imgSize); bool hasError = false;
+    if (fileName.empty() || blocks.size() < 2)
+    {
+        TiffBlockDecoder decoder(in, layout, region, buffer);
+        for (size_t i = 0; i < blocks.size() && !hasError; ++i)
+            hasError = !decoder.decode(blocks[i].first, blocks[i].second);
+    }
+    else
+    {
+#pragma omp parallel
+        {
+            std::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+            TIFF* localIn = tiffOpen(fin); TiffLayout localLayout;
+            bool valid = localIn && TIFFSetDirectory(localIn, dirIndex) &&
+                         readTiffLayout(localIn, localLayout);
+            TiffBlockDecoder decoder(valid ? localIn : in, valid ? localLayout : layout, region, buffer);
+#pragma omp for schedule(dynamic, 1) reduction(||:hasError)
+            for (int i = 0; i < (int)blocks.size(); ++i)
             {
-                OSG_WARN << "[ReaderWriterTiff] Failed to read with packing: " << photometric << ", " << config << std::endl;
-                if (buffer) delete[] buffer; continue;
+                if (!valid || !decoder.decode(blocks[i].first, blocks[i].second))
+                    hasError = true;
             }
+            if (localIn) TIFFClose(localIn);
+        }
+    }
+
+    if (hasError)
+    {
+        OSG_WARN << "[ReaderWriterTiff] Failed to read with packing: " << layout.photometric
+                 << ", " << layout.config << std::endl;
+        delete[] buffer; return NULL;
+    }
+
+    int numComponents = (layout.photometric == PHOTOMETRIC_PALETTE) ? layout.format : layout.samplesPerPixel;
+    unsigned int pixelFormat =
+        (numComponents) == 1 ? GL_LUMINANCE :
+        (numComponents) == 2 ? GL_LUMINANCE_ALPHA :
+        (numComponents) == 3 ? GL_RGB :
+        (numComponents) == 4 ? GL_RGBA : (GLenum)-1;
+    unsigned int dataType =
+        (layout.bitsPerSample == 8) ? GL_UNSIGNED_BYTE :
+        (layout.bitsPerSample == 16) ? GL_UNSIGNED_SHORT :
+        (layout.bitsPerSample == 32) ? GL_FLOAT : (GLenum)-1;
+    unsigned int internalFormat = computeInternalFormat(pixelFormat, dataType);
+    if (internalFormat <= 0)
+    {
+        OSG_WARN << "[ReaderWriterTiff] Unsupported image format" << std::endl;
+        delete[] buffer; return NULL;
+    }
+
+    osg::Image* image = new osg::Image;
+    image->setImage(region.width, region.height, 1, internalFormat, pixelFormat, dataType,
+                    buffer, osg::Image::USE_NEW_DELETE);
+    return image;
+}
+
+static osg::ImageSequence* tiffLoad(std::istream& fin, const osgDB::Options* options,
+                                    const std::string& fileName)
+{
+    TIFF* in = tiffOpen(fin);
+    if (in == NULL) { OSG_WARN << "[ReaderWriterTiff] Unable to open stream" << std::endl; return NULL; }
+
+    std::string windowString = options ? options->getPluginStringData("Window") : "";
+    std::string resString = options ? options->getPluginStringData("Resolution") : "";
+    osg::ref_ptr<osg::ImageSequence> seq = new osg::ImageSequence;
+    if (!windowString.empty() || !resString.empty())
+    {
+        // Only read first image (or one of its overviews) with a window in full resolution
+        uint32_t w = 0, h = 0, resW = 0, resH = 0;
+        TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &w); TIFFGetField(in, TIFFTAG_IMAGELENGTH, &h);
 
-            int numComponents = (photometric == PHOTOMETRIC_PALETTE) ? format : samplesperpixel;
-            unsigned int pixelFormat =
-                (numComponents) == 1 ? GL_LUMINANCE :
-                (numComponents) == 2 ? GL_LUMINANCE_ALPHA :
-                (numComponents) == 3 ? GL_RGB :
-                (numComponents) == 4 ? GL_RGBA : (GLenum)-1;
-            unsigned int dataType =
-                (bitspersample == 8) ? GL_UNSIGNED_BYTE :
-                (bitspersample == 16) ? GL_UNSIGNED_SHORT :
-                (bitspersample == 32) ? GL_FLOAT : (GLenum)-1;
-            unsigned int internalFormat = computeInternalFormat(pixelFormat, dataType);
-            if (internalFormat <= 0)
+        TiffRegion window(0, 0, w, h);
+        if (!windowString.empty())
+        {
+            std::stringstream ss(windowString);
+            ss >> window.x >> window.y >> window.width >> window.height;
+        }
+        if (!resString.empty()) { std::stringstream ss(resString); ss >> resW >> resH; }
+
+        // Select smallest overview which still provides required resolution of the window
+        tdir_t bestDir = 0; double bestScale = 1.0;
+        for (tdir_t dir = 1; (resW > 0 || resH > 0) && w > 0 && h > 0 && TIFFSetDirectory(in, dir); ++dir)
+        {
+            uint32_t subType = 0, ow = 0, oh = 0;
+            TIFFGetField(in, TIFFTAG_SUBFILETYPE, &subType);
+            if (!(subType & FILETYPE_REDUCEDIMAGE)) break;
+            else if (subType & FILETYPE_MASK) continue;
+
+            TIFFGetField(in, TIFFTAG_IMAGEWIDTH, &ow); TIFFGetField(in, TIFFTAG_IMAGELENGTH, &oh);
+            double scale = (double)ow / (double)w;
+            if (scale < bestScale && window.width * scale >= resW && window.height * scale >= resH)
+            { bestDir = dir; bestScale = scale; }
+        }
+
+        if (TIFFSetDirectory(in, bestDir))
+        {
+            TiffRegion scaled((uint32_t)floor(window.x * bestScale), (uint32_t)floor(window.y * bestScale),
+                              (uint32_t)ceil(window.width * bestScale), (uint32_t)ceil(window.height * bestScale));
+            osg::Image* image = tiffLoadDirectory(in, fileName, &scaled);
+            if (image != NULL)
             {
-                OSG_WARN << "[ReaderWriterTiff] Unsupported image format" << std::endl;
-                continue;
+                image->setUserValue("TiffWindow", osg::Vec4(window.x, window.y, window.width, window.height));
+                image->setUserValue("TiffOverviewLevel", (int)bestDir); seq->addImage(image);
             }
+        }
+    }
+    else
+    {
+        do
+        {
+            // Overviews and masks of the same image (e.g., in COG files) are ignored here
+            uint32_t subType = 0; TIFFGetField(in, TIFFTAG_SUBFILETYPE, &subType);
+            if (subType & (FILETYPE_REDUCEDIMAGE | FILETYPE_MASK)) continue;
 
-            osg::Image* image = new osg::Image;
-            image->setImage(w, h, d, internalFormat, pixelFormat, dataType,
-                            buffer, osg::Image::USE_NEW_DELETE);
-            seq->addImage(image);
+            osg::Image* image = tiffLoadDirectory(in, fileName, NULL);
+            if (image != NULL) seq->addImage(image);
         } while (TIFFReadDirectory(in));
     }
     TIFFClose(in);
@@ -452,7 +554,6 @@ static osg::ImageSequence* tiffLoad(std::istream& fin, const osgDB::Options* opt
 }
 
 #undef CVT
-#undef PACK
 
 class ReaderWriterTiff : public osgDB::ReaderWriter
 {
@@ -462,6 +563,8 @@ public:
         supportsExtension("verse_tiff", "osgVerse pseudo-loader");
         supportsExtension("tiff", "Tiff image format");
         supportsExtension("tif", "Tiff image format");
+        supportsOption("Window", "Read pixels in '<x> <y> <width> <height>' of full resolution image");
+        supportsOption("Resolution", "Read smallest overview of the window not less than '<width> <height>'");
     }
 
     virtual const char* className() const
@@ -482,23 +585,14 @@ public:
             ext = osgDB::getLowerCaseFileExtension(fileName);
         }
 
+        // With a file name, tiles / strips can be decoded in multiple threads
         std::ifstream in(fileName, std::ios::in | std::ios::binary);
-        return readImage(in, options);
+        if (!in) return ReadResult::FILE_NOT_FOUND;
+        return getResult(tiffLoad(in, options, fileName));
     }
 
     virtual ReadResult readImage(std::istream& fin, const Options* options) const
-    {
-        osg::ref_ptr<osg::ImageSequence> seq = tiffLoad(fin, options);
-#if OSG_VERSION_GREATER_THAN(3, 3, 0)
-        osg::ImageSequence::ImageDataList images = seq->getImageDataList();
-        return images.empty() ? NULL : ((images.size() == 1) ?
-                                        images[0]._image.get() : static_cast<osg::Image*>(seq.get()));
-#else
-        std::vector<osg::ref_ptr<osg::Image>> images = seq->getImages();
-        return images.empty() ? NULL : ((images.size() == 1) ?
-                                        images[0].get() : static_cast<osg::Image*>(seq.get()));
-#endif
-    }
+    { return getResult(tiffLoad(fin, options, "")); }
 
     virtual WriteResult writeImage(const osg::Image& image, const std::string& path,
                                    const Options* options) const
@@ -520,6 +614,20 @@ public:
     }
 
 protected:
+    ReadResult getResult(osg::ImageSequence* loaded) const
+    {
+        osg::ref_ptr<osg::ImageSequence> seq = loaded;
+        if (!seq) return ReadResult::ERROR_IN_READING_FILE;
+#if OSG_VERSION_GREATER_THAN(3, 3, 0)
+        osg::ImageSequence::ImageDataList images = seq->getImageDataList();
+        return images.empty() ? NULL : ((images.size() == 1) ?
+                                        images[0]._image.get() : static_cast<osg::Image*>(seq.get()));
+#else
+        std::vector<osg::ref_ptr<osg::Image>> images = seq->getImages();
+        return images.empty() ? NULL : ((images.size() == 1) ?
+                                        images[0].get() : static_cast<osg::Image*>(seq.get()));
+#endif
+    }
 };
 
 // Now register with Registry to instantiate the above reader/writer.
@@ -5,7 +5,95 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
 #include <pipeline/Utilities.h>
+#include <deque>
+
+/** Image requests fetched by a fixed set of I/O threads, so that blocking network reads never
+    occupy more threads than the "MaxConnections" option allows. In-flight requests are also
+    coalesced: a URL being read (e.g., the same tile wanted by two overlapping views) is waited
+    for by others instead of being fetched again */
+class TileImageRequests : public osg::Referenced
+{
+public:
+    struct Request : public osg::Referenced
+    {
+        std::string url; osg::ref_ptr<osg::Image> image; bool done;
+        Request(const std::string& u) : url(u), done(false) {}
+    };
+
+    TileImageRequests() : _maxThreads(4), _quit(false) {}
+
+    void setMaxThreads(int n)
+    { OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex); _maxThreads = osg::maximum(n, 1); }
+
+    /** Queue the URL to be read by I/O threads; the result is obtained with wait() */
+    osg::ref_ptr<Request> request(const std::string& url)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        std::map<std::string, osg::ref_ptr<Request>>::iterator itr = _requests.find(url);
+        if (itr != _requests.end()) return itr->second;
+
+        osg::ref_ptr<Request> request = new Request(url);
+        _requests[url] = request; _queue.push_back(request);
+        if ((int)_threads.size() < _maxThreads)
+        {
+            IOThread* thread = new IOThread(this); thread->start();
+            _threads.push_back(thread);
+        }
+        _condition.broadcast(); return request;
+    }
+
+    osg::ref_ptr<osg::Image> wait(Request* request)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        while (!request->done) _condition.wait(&_mutex);
+        return request->image;
+    }
+
+protected:
+    virtual ~TileImageRequests()
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            _quit = true; _condition.broadcast();
+        }
+        for (size_t i = 0; i < _threads.size(); ++i) { _threads[i]->join(); delete _threads[i]; }
+    }
+
+    class IOThread : public OpenThreads::Thread
+    {
+    public:
+        IOThread(TileImageRequests* r) : _owner(r) {}
+        virtual void run() { while (_owner->processNext()) {} }
+        TileImageRequests* _owner;
+    };
+
+    bool processNext()
+    {
+        osg::ref_ptr<Request> request;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            while (_queue.empty() && !_quit) _condition.wait(&_mutex);
+            if (_quit) return false;
+            request = _queue.front(); _queue.pop_front();
+        }
+
+        osg::ref_ptr<osg::Image> image = osgDB::readImageFile(request->url);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        request->image = image; request->done = true;
+        _requests.erase(request->url); _condition.broadcast(); return true;
+    }
+
+    std::map<std::string, osg::ref_ptr<Request>> _requests;
+    std::deque<osg::ref_ptr<Request>> _queue;
+    std::vector<IOThread*> _threads;
+    OpenThreads::Mutex _mutex;
+    OpenThreads::Condition _condition;
+    int _maxThreads; bool _quit;
+};
 
 // osgviewer 0-0-0.verse_tms -O "URL=https://webst01.is.autonavi.com/appmaptile?style%3d6&x%3d{x}&y%3d{y}&z%3d{z} UseWebMercator=1"
 // osgviewer 0-0-x.verse_tms -O "URL=E:\testTMS\{z}\{x}\{y}.png OriginBottomLeft=1"
@@ -14,6 +102,7 @@ class ReaderWriterTMS : public osgDB::ReaderWriter
 public:
     ReaderWriterTMS()
     {
+        _requests = new TileImageRequests;
         supportsExtension("verse_tms", "osgVerse pseudo-loader");
         supportsExtension("tms", "TMS tile indices");
         supportsOption("URL", "The TMS server URL with wildcards");
@@ -23,6 +112,7 @@ public:
         supportsOption("FlatExtentMinY", "Flat earth extent Y0: default -90");
         supportsOption("FlatExtentMaxX", "Flat earth extent X1: default 180");
         supportsOption("FlatExtentMaxY", "Flat earth extent Y1: default 90");
+        supportsOption("MaxConnections", "Number of I/O threads fetching tile images: default=4");
     }
 
     virtual const char* className() const
@@ -66,17 +156,31 @@ public:
                 if (z == 0) countY = 1;
             }
 
+            // Queue all child tiles at once, as each one may be a network round-trip
+            std::string maxConnections = options->getPluginStringData("MaxConnections");
+            if (!maxConnections.empty()) _requests->setMaxThreads(atoi(maxConnections.c_str()));
+
+            std::vector<osg::ref_ptr<TileImageRequests::Request>> requests(countY * 2);
+            std::vector<osg::ref_ptr<osg::Node>> tiles(countY * 2);
+            for (int i = 0; i < (int)requests.size(); ++i)
+                requests[i] = _requests->request(createUrl(pseudoAddr, x + (i % 2), y + (i / 2), z));
+            for (int i = 0; i < (int)tiles.size(); ++i)
+            {
+                osg::ref_ptr<osg::Image> image = _requests->wait(requests[i].get());
+                tiles[i] = createTile(image.get(), x + (i % 2), y + (i / 2), z,
+                                      extentMin, extentMax, options);
+            }
+
             osg::ref_ptr<osg::Group> group = new osg::Group;
             for (int yy = 0; yy < countY; ++yy)
                 for (int xx = 0; xx < 2; ++xx)
                 {
-                    osg::ref_ptr<osg::Node> node = createTile(
-                        pseudoAddr, x + xx, y + yy, z, extentMin, extentMax, options);
+                    osg::Node* node = tiles[yy * 2 + xx].get();
                     if (!node) continue;
 
                     osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
                     plod->setDatabaseOptions(options->cloneOptions());
-                    plod->addChild(node.get());
+                    plod->addChild(node);
                     plod->setFileName(1, std::to_string(x + xx) + "-" + std::to_string(y + yy) +
                                          "-" + std::to_string(z) + ".verse_tms");
                     plod->setRangeMode(osg::LOD::PIXEL_SIZE_ON_SCREEN);
@@ -90,9 +194,16 @@ public:
     }
 
 protected:
-    osg::Node* createTile(const std::string& pseudoPath, int x, int y, int z,
+    std::string createUrl(const std::string& pseudoPath, int x, int y, int z) const
+    {
+        std::string url = createPath(pseudoPath, x, y, z);
+        return osgDB::getServerProtocol(url).empty() ? url : (url + ".verse_web");
+    }
+
+    osg::Node* createTile(osg::Image* image, int x, int y, int z,
                           const osg::Vec3d& extentMin, const osg::Vec3d& extentMax, const Options* opt) const
     {
+        if (!image) return NULL;
         std::string botLeft = opt->getPluginStringData("OriginBottomLeft");
         if (!botLeft.empty()) std::transform(botLeft.begin(), botLeft.end(), botLeft.begin(), tolower);
 
@@ -111,20 +222,13 @@ protected:
             tileMax = extentMin + osg::Vec3d(double(x + 1) * tileWidth, double(y + 1) * tileHeight, 1.0);
         }
 
-        std::string url = createPath(pseudoPath, x, y, z);
-        std::string postfix = osgDB::getServerProtocol(url).empty() ? "" : ".verse_web";
-        osg::ref_ptr<osg::Image> image = osgDB::readImageFile(url + postfix);
-        if (image.valid())
-        {
-            osg::ref_ptr<osg::Geometry> geom =
-                osg::createTexturedQuadGeometry(tileMin, osg::X_AXIS * tileWidth, osg::Y_AXIS * tileHeight);
-            geom->getOrCreateStateSet()->setTextureAttributeAndModes(
-                0, osgVerse::createTexture2D(image.get(), osg::Texture::MIRROR));
+        osg::ref_ptr<osg::Geometry> geom =
+            osg::createTexturedQuadGeometry(tileMin, osg::X_AXIS * tileWidth, osg::Y_AXIS * tileHeight);
+        geom->getOrCreateStateSet()->setTextureAttributeAndModes(
+            0, osgVerse::createTexture2D(image, osg::Texture::MIRROR));
 
-            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-            geode->addDrawable(geom.get()); return geode.release();
-        }
-        else return NULL;
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->addDrawable(geom.get()); return geode.release();
     }
 
     std::string createPath(const std::string& pseudoPath, int x, int y, int z) const
@@ -140,6 +244,8 @@ protected:
         size_t levelPos = src.find(match); if (levelPos == std::string::npos) { c = false; return src; }
         src.replace(levelPos, match.length(), v); c = true; return src;
     }
+
+    osg::ref_ptr<TileImageRequests> _requests;
 };
 
 // Now register with Registry to instantiate the above reader/writer.
@@ -4,15 +4,21 @@
 #include <osg/ImageSequence>
 #include <osg/Geometry>
 #include <osg/Geode>
+#include <osg/PagedLOD>
+#include <osg/Texture3D>
+#include <osg/ValueObject>
+#include <OpenThreads/ScopedLock>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <sstream>
 
 #include <pipeline/Global.h>
 #include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
 #include <openvdb/openvdb.h>
+#include <openvdb/io/File.h>
 #include <openvdb/io/Stream.h>
 #include <openvdb/tools/VolumeToMesh.h>
 #include <openvdb/tools/MeshToVolume.h>
@@ -25,8 +31,12 @@ public:
     {
         supportsExtension("verse_vdb", "osgVerse pseudo-loader");
         supportsExtension("vdb", "VDB point cloud and texture file");
-        supportsOption("ReadDataType=<hint>", "Read option: <Mesh/Points>");
+        supportsOption("ReadDataType=<hint>", "Read option: <Mesh/Points/Bricks>");
         supportsOption("DimensionScale=<hint>", "Read option: volume image size scale, default is 1.0");
+        supportsOption("BrickRegion=<x0 y0 z0 x1 y1 z1>", "Read option: index-space region to extract");
+        supportsOption("BrickLevel=<n>", "Read option: brick LOD, each level halves resolution, default 0");
+        supportsOption("BrickBits=<8/16>", "Read option: brick atlas precision, default 8");
+        supportsOption("BrickValueRange=<min max>", "Read option: fixed value range of brick atlases");
         openvdb::initialize();
     }
 
@@ -48,6 +58,12 @@ public:
             ext = osgDB::getFileExtension(fileName);
         }
 
+        // Paged bricks: <file>.vdb.brick_<grid>_<x0>_<y0>_<z0>_<x1>_<y1>_<z1>_<level>.verse_vdb
+        if (ext.find("brick_") == 0)
+            return readBrickNode(osgDB::getNameLessExtension(fileName), ext, options);
+        else if (options && options->getPluginStringData("ReadDataType") == "Bricks")
+            return readBrickHierarchy(fileName, options);
+
         std::ifstream ifile(fileName, std::ios_base::in | std::ios_base::binary);
         if (!ifile) return ReadResult::FILE_NOT_FOUND;
         return readNode(ifile, options);
@@ -86,6 +102,7 @@ public:
                 openvdb::FloatGrid::Ptr g0 = openvdb::gridPtrCast<openvdb::FloatGrid>((*grids)[i]);
                 if (g0)
                 {
+                    preallocate(va.get(), ca.get(), g0->activeVoxelCount());
                     for (openvdb::FloatGrid::ValueOnIter iter = g0->beginValueOn(); iter; ++iter)
                     {
                         openvdb::Vec3d coord = iter.getCoord().asVec3d(); float value = iter.getValue();
@@ -97,6 +114,7 @@ public:
                 openvdb::Int32Grid::Ptr g1 = openvdb::gridPtrCast<openvdb::Int32Grid>((*grids)[i]);
                 if (g1)
                 {
+                    preallocate(va.get(), ca.get(), g1->activeVoxelCount());
                     for (openvdb::Int32Grid::ValueOnIter iter = g1->beginValueOn(); iter; ++iter)
                     {
                         openvdb::Vec3d coord = iter.getCoord().asVec3d(); float value = iter.getValue() / 255.0f;
@@ -108,6 +126,7 @@ public:
                 openvdb::DoubleGrid::Ptr g2 = openvdb::gridPtrCast<openvdb::DoubleGrid>((*grids)[i]);
                 if (g2)
                 {
+                    preallocate(va.get(), ca.get(), g2->activeVoxelCount());
                     for (openvdb::DoubleGrid::ValueOnIter iter = g2->beginValueOn(); iter; ++iter)
                     {
                         openvdb::Vec3d coord = iter.getCoord().asVec3d(); float value = iter.getValue() / 255.0f;
@@ -119,6 +138,7 @@ public:
                 openvdb::Vec3fGrid::Ptr g3 = openvdb::gridPtrCast<openvdb::Vec3fGrid>((*grids)[i]);
                 if (g3)
                 {
+                    preallocate(va.get(), ca.get(), g3->activeVoxelCount());
                     for (openvdb::Vec3fGrid::ValueOnIter iter = g3->beginValueOn(); iter; ++iter)
                     {
                         openvdb::Vec3d coord = iter.getCoord().asVec3d(); openvdb::Vec3f value = iter.getValue();
@@ -166,6 +186,9 @@ public:
             ext = osgDB::getFileExtension(fileName);
         }
 
+        if (options && !options->getPluginStringData("BrickRegion").empty())
+            return readBrickImages(fileName, options);
+
         std::ifstream ifile(fileName, std::ios_base::in | std::ios_base::binary);
         if (!ifile) return ReadResult::FILE_NOT_FOUND;
         return readImage(ifile, options);
@@ -358,12 +381,394 @@ public:
 protected:
     template<typename T> struct ValueRange
     {
-        ValueRange() : _min(std::numeric_limits<T>::max()), _max(std::numeric_limits<T>::min()) {}
-        ValueRange(T min_v, T max_v) : m_min(min_v), m_max(max_v) {}
+        ValueRange() : _min(std::numeric_limits<T>::max()), _max(std::numeric_limits<T>::lowest()) {}
+        ValueRange(T min_v, T max_v) : _min(min_v), _max(max_v) {}
         void addValue(T value) { _min = std::min(_min, value); _max = std::max(_max, value); }
         T _min, _max;
     };
 
+    struct BrickSettings
+    {
+        BrickSettings() : level(0), bits(8), useFixedRange(false) {}
+        osg::Vec2 valueRange; int level, bits; bool useFixedRange;
+    };
+
+    BrickSettings getBrickSettings(const Options* options) const
+    {
+        BrickSettings bs; if (!options) return bs;
+        std::string level = options->getPluginStringData("BrickLevel");
+        std::string bits = options->getPluginStringData("BrickBits");
+        std::string range = options->getPluginStringData("BrickValueRange");
+        if (!level.empty()) bs.level = osg::clampBetween(atoi(level.c_str()), 0, 3);
+        if (!bits.empty()) bs.bits = (atoi(bits.c_str()) > 8) ? 16 : 8;
+        if (!range.empty())
+        {
+            std::stringstream ss(range); ss >> bs.valueRange[0] >> bs.valueRange[1];
+            bs.useFixedRange = true;
+        }
+        return bs;
+    }
+
+    /** Open the file with delayed loading and keep it: only topology is read at once, while leaf
+        buffers stay in the (memory-mapped) file until a brick touches them */
+    openvdb::GridPtrVecPtr getDelayLoadedGrids(const std::string& fileName) const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_cacheMutex);
+        std::map<std::string, openvdb::GridPtrVecPtr>::iterator itr = _gridCache.find(fileName);
+        if (itr != _gridCache.end()) return itr->second;
+
+        openvdb::GridPtrVecPtr grids;
+        try
+        {
+            openvdb::io::File file(fileName);
+            file.open(true); grids = file.getGrids(); file.close();
+        }
+        catch (openvdb::Exception& e)
+        {
+            OSG_WARN << "[ReaderWriterVDB] Failed to open " << fileName
+                     << ": " << e.what() << std::endl;
+        }
+        _gridCache[fileName] = grids; return grids;
+    }
+
+    ReadResult readBrickImages(const std::string& fileName, const Options* options) const
+    {
+        if (!osgDB::fileExists(fileName)) return ReadResult::FILE_NOT_FOUND;
+        openvdb::GridPtrVecPtr grids = getDelayLoadedGrids(fileName);
+        if (!grids) return ReadResult::ERROR_IN_READING_FILE;
+
+        int r[6] = { 0, 0, 0, -1, -1, -1 };
+        std::stringstream ss(options->getPluginStringData("BrickRegion"));
+        ss >> r[0] >> r[1] >> r[2] >> r[3] >> r[4] >> r[5];
+        openvdb::CoordBBox region(openvdb::Coord(r[0], r[1], r[2]), openvdb::Coord(r[3], r[4], r[5]));
+
+        BrickSettings bs = getBrickSettings(options);
+        std::vector<osg::ref_ptr<osg::Image>> images;
+        for (size_t i = 0; i < grids->size(); ++i)
+        {
+            osg::Image* img = createGridBrickAtlas((*grids)[i], region, bs);
+            if (img) images.push_back(img);
+        }
+        if (images.empty()) return ReadResult::FILE_LOADED;
+        else if (images.size() == 1) return images.front().get();
+
+        osg::ref_ptr<osg::ImageSequence> seq = new osg::ImageSequence;
+        for (size_t i = 0; i < images.size(); ++i) seq->addImage(images[i]);
+        return seq.get();
+    }
+
+    ReadResult readBrickHierarchy(const std::string& fileName, const Options* options) const
+    {
+        if (!osgDB::fileExists(fileName)) return ReadResult::FILE_NOT_FOUND;
+        openvdb::GridPtrVecPtr grids = getDelayLoadedGrids(fileName);
+        if (!grids) return ReadResult::ERROR_IN_READING_FILE;
+
+        osg::ref_ptr<Options> dbOptions = options ? options->cloneOptions() : new Options;
+        osg::ref_ptr<osg::Group> root = new osg::Group;
+        for (size_t i = 0; i < grids->size(); ++i)
+        {
+            osg::Group* gridRoot = NULL;
+            openvdb::FloatGrid::Ptr g0 = openvdb::gridPtrCast<openvdb::FloatGrid>((*grids)[i]);
+            if (g0) gridRoot = createBrickHierarchy(*g0, fileName, i, dbOptions.get());
+
+            openvdb::Int32Grid::Ptr g1 = openvdb::gridPtrCast<openvdb::Int32Grid>((*grids)[i]);
+            if (g1) gridRoot = createBrickHierarchy(*g1, fileName, i, dbOptions.get());
+
+            openvdb::DoubleGrid::Ptr g2 = openvdb::gridPtrCast<openvdb::DoubleGrid>((*grids)[i]);
+            if (g2) gridRoot = createBrickHierarchy(*g2, fileName, i, dbOptions.get());
+
+            if (gridRoot != NULL)
+                { gridRoot->setName((*grids)[i]->getName()); root->addChild(gridRoot); }
+            else
+            {
+                OSG_WARN << "[ReaderWriterVDB] Unsupported VDB grid for bricks: "
+                         << (*grids)[i]->getName() << std::endl;
+            }
+        }
+        if (root->getNumChildren() > 0) return root.release();
+        else return ReadResult::ERROR_IN_READING_FILE;
+    }
+
+    ReadResult readBrickNode(const std::string& fileName, const std::string& brickName,
+                             const Options* options) const
+    {
+        std::vector<std::string> parts; std::string part;
+        std::stringstream ss(brickName);
+        while (std::getline(ss, part, '_')) parts.push_back(part);
+        if (parts.size() != 9) return ReadResult::FILE_NOT_HANDLED;
+
+        openvdb::GridPtrVecPtr grids = getDelayLoadedGrids(fileName);
+        size_t index = (size_t)atoi(parts[1].c_str());
+        if (!grids || index >= grids->size()) return ReadResult::ERROR_IN_READING_FILE;
+
+        openvdb::CoordBBox region(
+            openvdb::Coord(atoi(parts[2].c_str()), atoi(parts[3].c_str()), atoi(parts[4].c_str())),
+            openvdb::Coord(atoi(parts[5].c_str()), atoi(parts[6].c_str()), atoi(parts[7].c_str())));
+        BrickSettings bs = getBrickSettings(options);
+        bs.level = osg::clampBetween(atoi(parts[8].c_str()), 0, 3);
+
+        osg::ref_ptr<osg::Image> atlas = createGridBrickAtlas((*grids)[index], region, bs);
+        if (!atlas) return new osg::Group;  // nothing active in this brick
+        return createBrickNode(*(*grids)[index], atlas.get());
+    }
+
+    /** Each level-1 internal node (128^3 voxels) becomes a paged brick, full resolution when
+        near and half resolution when far away. Brick names are resolved in readBrickNode() */
+    template<typename GridType>
+    osg::Group* createBrickHierarchy(const GridType& grid, const std::string& fileName,
+                                     size_t gridIndex, Options* options) const
+    {
+        typedef typename GridType::TreeType TreeType;
+        osg::ref_ptr<osg::Group> group = new osg::Group;
+        typename TreeType::NodeCIter itr = grid.tree().cbeginNode();
+        itr.setMaxDepth(TreeType::NodeCIter::LEAF_DEPTH - 1);
+        for (; itr; ++itr)
+        {
+            if (itr.getLevel() != 1) continue;
+            openvdb::CoordBBox box; itr.getBoundingBox(box);
+            openvdb::BBoxd worldBox = grid.transform().indexToWorld(openvdb::BBoxd(
+                box.min().asVec3d(), (box.max() + openvdb::Coord(1)).asVec3d()));
+            osg::BoundingBoxd bb(worldBox.min().x(), worldBox.min().y(), worldBox.min().z(),
+                                 worldBox.max().x(), worldBox.max().y(), worldBox.max().z());
+
+            std::stringstream ss;
+            ss << fileName << ".brick_" << gridIndex << "_" << box.min().x() << "_" << box.min().y()
+               << "_" << box.min().z() << "_" << box.max().x() << "_" << box.max().y()
+               << "_" << box.max().z();
+
+            osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
+            plod->setCenter(bb.center()); plod->setRadius(bb.radius());
+            plod->setFileName(0, ss.str() + "_1.verse_vdb");
+            plod->setRange(0, bb.radius() * 3.0f, FLT_MAX);
+            plod->setFileName(1, ss.str() + "_0.verse_vdb");
+            plod->setRange(1, 0.0f, bb.radius() * 3.0f);
+            plod->setDatabaseOptions(options); group->addChild(plod.get());
+        }
+        return group->getNumChildren() > 0 ? group.release() : NULL;
+    }
+
+    osg::Image* createGridBrickAtlas(const openvdb::GridBase::Ptr& grid,
+                                     const openvdb::CoordBBox& region, const BrickSettings& bs) const
+    {
+        openvdb::FloatGrid::Ptr g0 = openvdb::gridPtrCast<openvdb::FloatGrid>(grid);
+        if (g0) return createBrickAtlas(*g0, region, bs);
+
+        openvdb::Int32Grid::Ptr g1 = openvdb::gridPtrCast<openvdb::Int32Grid>(grid);
+        if (g1) return createBrickAtlas(*g1, region, bs);
+
+        openvdb::DoubleGrid::Ptr g2 = openvdb::gridPtrCast<openvdb::DoubleGrid>(grid);
+        if (g2) return createBrickAtlas(*g2, region, bs);
+        return NULL;
+    }
+
+    /** Pack active leaves intersecting the region into a compact 8/16-bit 3D atlas. Each leaf is
+        a block of (8 >> level)^3 texels; user object "BrickIndices" maps leaves to atlas blocks */
+    template<typename GridType>
+    osg::Image* createBrickAtlas(const GridType& grid, const openvdb::CoordBBox& region,
+                                 const BrickSettings& bs) const
+    {
+        typedef typename GridType::TreeType::LeafNodeType LeafType;
+        const int leafDim = (int)LeafType::DIM, blockDim = osg::maximum(leafDim >> bs.level, 1);
+        const int step = leafDim / blockDim, blockVoxels = blockDim * blockDim * blockDim;
+        if (region.empty()) return NULL;
+
+        // Probe leaf origins for small regions, or iterate all leaves for large ones
+        std::vector<const LeafType*> leaves; openvdb::CoordBBox leafBounds;
+        openvdb::Index64 numProbes = region.volume() / LeafType::NUM_VOXELS + 1;
+        openvdb::Index64 numLeaves = grid.tree().leafCount();
+        if (numProbes < numLeaves)
+        {
+            typename GridType::ConstAccessor accessor = grid.getConstAccessor();
+            const openvdb::Coord start(region.min().x() & ~(leafDim - 1),
+                                       region.min().y() & ~(leafDim - 1),
+                                       region.min().z() & ~(leafDim - 1));
+            leaves.reserve(numProbes);
+            for (int z = start.z(); z <= region.max().z(); z += leafDim)
+                for (int y = start.y(); y <= region.max().y(); y += leafDim)
+                    for (int x = start.x(); x <= region.max().x(); x += leafDim)
+                    {
+                        const LeafType* leaf = accessor.probeConstLeaf(openvdb::Coord(x, y, z));
+                        if (!leaf || leaf->isEmpty()) continue;
+                        leaves.push_back(leaf); leafBounds.expand(leaf->getNodeBoundingBox());
+                    }
+        }
+        else
+        {
+            leaves.reserve(numLeaves);
+            for (typename GridType::TreeType::LeafCIter itr = grid.tree().cbeginLeaf(); itr; ++itr)
+            {
+                const LeafType& leaf = *itr; openvdb::CoordBBox box = leaf.getNodeBoundingBox();
+                if (leaf.isEmpty() || !region.hasOverlap(box)) continue;
+                leaves.push_back(&leaf); leafBounds.expand(box);
+            }
+        }
+        if (leaves.empty()) return NULL;
+
+        // Reduce leaves to blocks; work on leaf copies so that out-of-core buffers are loaded
+        // into the copies only, and the cached grid doesn't grow with every visited brick
+        const size_t numBlocks = leaves.size();
+        std::vector<float> blockValues(numBlocks * blockVoxels);
+        tbb::enumerable_thread_specific<ValueRange<float>> ranges;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, numBlocks),
+            [&](const tbb::blocked_range<size_t>& range)
+        {
+            typename tbb::enumerable_thread_specific<ValueRange<float>>::reference
+                this_range = ranges.local();
+            for (size_t i = range.begin(); i < range.end(); ++i)
+            {
+                LeafType leaf(*leaves[i]); float* dst = &blockValues[i * blockVoxels];
+                for (int z = 0; z < blockDim; ++z)
+                    for (int y = 0; y < blockDim; ++y)
+                        for (int x = 0; x < blockDim; ++x)
+                        {
+                            double sum = 0.0;
+                            for (int k = 0; k < step; ++k)
+                                for (int j = 0; j < step; ++j)
+                                    for (int n = 0; n < step; ++n)
+                                    {
+                                        openvdb::Coord c(x * step + n, y * step + j, z * step + k);
+                                        sum += (double)leaf.getValue(LeafType::coordToOffset(c));
+                                    }
+                            *(dst++) = (float)(sum / (step * step * step));
+                        }
+                for (typename LeafType::ValueOnCIter v = leaf.cbeginValueOn(); v; ++v)
+                    this_range.addValue((float)*v);
+            }
+        });
+
+        osg::Vec2 valueRange = bs.valueRange;
+        if (!bs.useFixedRange)
+        {
+            ValueRange<float> merged;
+            for (typename tbb::enumerable_thread_specific<ValueRange<float>>::iterator itr =
+                 ranges.begin(); itr != ranges.end(); ++itr)
+            { merged.addValue(itr->_min); merged.addValue(itr->_max); }
+            valueRange.set(merged._min, merged._max);
+        }
+
+        // Blocks are laid out in a near-cubic grid of slots
+        int sx = (int)ceil(pow((double)numBlocks, 1.0 / 3.0));
+        int sy = (int)ceil(sqrt((double)numBlocks / sx));
+        int sz = (int)((numBlocks + sx * sy - 1) / (sx * sy));
+        bool use16 = (bs.bits > 8);
+
+        osg::ref_ptr<osg::Image> atlas = new osg::Image;
+        atlas->allocateImage(sx * blockDim, sy * blockDim, sz * blockDim, GL_LUMINANCE,
+                             use16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE);
+        atlas->setInternalTextureFormat(use16 ? GL_LUMINANCE16 : GL_LUMINANCE8);
+        memset(atlas->data(), 0, atlas->getTotalSizeInBytes());
+
+        // Indices: one texel per leaf of covered bounds, RGB = atlas slot, A = 1 if present
+        const openvdb::Coord cells = leafBounds.dim();
+        osg::ref_ptr<osg::Image> indices = new osg::Image;
+        indices->allocateImage(cells.x() / leafDim, cells.y() / leafDim, cells.z() / leafDim,
+                               GL_RGBA, GL_UNSIGNED_SHORT);
+        indices->setInternalTextureFormat(GL_RGBA16);
+        memset(indices->data(), 0, indices->getTotalSizeInBytes());
+
+        const double invRange = (valueRange[1] > valueRange[0])
+                              ? 1.0 / (double)(valueRange[1] - valueRange[0]) : 0.0;
+        const double maxValue = use16 ? 65535.0 : 255.0;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, numBlocks),
+            [&](const tbb::blocked_range<size_t>& range)
+        {
+            for (size_t i = range.begin(); i < range.end(); ++i)
+            {
+                int bx = (int)i % sx, by = ((int)i / sx) % sy, bz = (int)i / (sx * sy);
+                const float* src = &blockValues[i * blockVoxels];
+                for (int z = 0; z < blockDim; ++z)
+                    for (int y = 0; y < blockDim; ++y)
+                    {
+                        unsigned char* row = atlas->data(bx * blockDim, by * blockDim + y,
+                                                         bz * blockDim + z);
+                        for (int x = 0; x < blockDim; ++x, ++src)
+                        {
+                            double v = osg::clampBetween(
+                                (double)(*src - valueRange[0]) * invRange, 0.0, 1.0) * maxValue;
+                            if (use16) *((unsigned short*)row + x) = (unsigned short)v;
+                            else *(row + x) = (unsigned char)v;
+                        }
+                    }
+
+                openvdb::Coord cell = leaves[i]->origin() - leafBounds.min();
+                unsigned short* index = (unsigned short*)indices->data(
+                    cell.x() / leafDim, cell.y() / leafDim, cell.z() / leafDim);
+                index[0] = bx; index[1] = by; index[2] = bz; index[3] = 1;
+            }
+        });
+
+        const openvdb::Coord& b0 = leafBounds.min(); openvdb::Coord b1 = leafBounds.max();
+        indices->setName("BrickIndices");
+        atlas->getOrCreateUserDataContainer()->addUserObject(indices.get());
+        atlas->setUserValue("BrickBlockSize", blockDim);
+        atlas->setUserValue("BrickAtlasSlots", osg::Vec3(sx, sy, sz));
+        atlas->setUserValue("BrickValueRange", valueRange);
+        atlas->setUserValue("BrickBoundMin", osg::Vec3(b0.x(), b0.y(), b0.z()));
+        atlas->setUserValue("BrickBoundMax", osg::Vec3(b1.x() + 1, b1.y() + 1, b1.z() + 1));
+        return atlas.release();
+    }
+
+    /** Box of the brick bounds, with atlas (unit 0) and indices (unit 1) for a volume shader */
+    osg::Geode* createBrickNode(const openvdb::GridBase& grid, osg::Image* atlas) const
+    {
+        osg::Vec3 b0, b1, slots; osg::Vec2 valueRange; int blockSize = 8;
+        atlas->getUserValue("BrickBoundMin", b0); atlas->getUserValue("BrickBoundMax", b1);
+        atlas->getUserValue("BrickAtlasSlots", slots); atlas->getUserValue("BrickBlockSize", blockSize);
+        atlas->getUserValue("BrickValueRange", valueRange);
+        osg::Image* indices = static_cast<osg::Image*>(
+            atlas->getUserDataContainer()->getUserObject("BrickIndices"));
+
+        openvdb::BBoxd worldBox = grid.transform().indexToWorld(openvdb::BBoxd(
+            openvdb::Vec3d(b0[0], b0[1], b0[2]), openvdb::Vec3d(b1[0], b1[1], b1[2])));
+        osg::Vec3 w0(worldBox.min().x(), worldBox.min().y(), worldBox.min().z());
+        osg::Vec3 w1(worldBox.max().x(), worldBox.max().y(), worldBox.max().z());
+
+        osg::ref_ptr<osg::Vec3Array> va = new osg::Vec3Array(8);
+        osg::ref_ptr<osg::Vec3Array> ta = new osg::Vec3Array(8);
+        for (int i = 0; i < 8; ++i)
+        {
+            osg::Vec3 t((i & 1) ? 1.0f : 0.0f, (i & 2) ? 1.0f : 0.0f, (i & 4) ? 1.0f : 0.0f);
+            (*ta)[i] = t; (*va)[i] = w0 + osg::componentMultiply(t, w1 - w0);
+        }
+
+        static const GLubyte faces[24] = { 0, 2, 3, 1,  4, 5, 7, 6,  0, 1, 5, 4,
+                                           2, 6, 7, 3,  0, 4, 6, 2,  1, 3, 7, 5 };
+        osg::Geometry* geom = new osg::Geometry;
+        geom->setUseDisplayList(false);
+        geom->setUseVertexBufferObjects(true);
+        geom->setVertexArray(va.get());
+        geom->setTexCoordArray(0, ta.get());
+        geom->addPrimitiveSet(new osg::DrawElementsUByte(GL_QUADS, 24, faces));
+
+        osg::Geode* geode = new osg::Geode; geode->addDrawable(geom);
+        osg::StateSet* ss = geode->getOrCreateStateSet();
+        ss->setTextureAttributeAndModes(0, createBrickTexture(atlas));
+        ss->setTextureAttributeAndModes(1, createBrickTexture(indices));
+        ss->addUniform(new osg::Uniform("VolumeTexture", (int)0));
+        ss->addUniform(new osg::Uniform("BrickIndexTexture", (int)1));
+        ss->addUniform(new osg::Uniform("BrickBlockSize", blockSize));
+        ss->addUniform(new osg::Uniform("BrickAtlasSlots", slots));
+        ss->addUniform(new osg::Uniform("BrickValueRange", valueRange));
+        ss->addUniform(new osg::Uniform("BoundingMin", w0));
+        ss->addUniform(new osg::Uniform("BoundingMax", w1));
+        return geode;
+    }
+
+    osg::Texture3D* createBrickTexture(osg::Image* image) const
+    {
+        osg::Texture3D* tex3D = new osg::Texture3D;
+        tex3D->setFilter(osg::Texture3D::MIN_FILTER, osg::Texture3D::NEAREST);
+        tex3D->setFilter(osg::Texture3D::MAG_FILTER, osg::Texture3D::NEAREST);
+        tex3D->setWrap(osg::Texture3D::WRAP_S, osg::Texture3D::CLAMP_TO_EDGE);
+        tex3D->setWrap(osg::Texture3D::WRAP_T, osg::Texture3D::CLAMP_TO_EDGE);
+        tex3D->setWrap(osg::Texture3D::WRAP_R, osg::Texture3D::CLAMP_TO_EDGE);
+        tex3D->setResizeNonPowerOfTwoHint(false);
+        tex3D->setImage(image); return tex3D;
+    }
+
+    void preallocate(osg::Vec3Array* va, osg::Vec4Array* ca, openvdb::Index64 count) const
+    { va->reserve(va->size() + count); ca->reserve(ca->size() + count); }
+
     template<typename GridType, typename T>
     void createImage(GridType& grid, osg::Image* image, const osg::Vec3d& res, int comp) const
     {
@@ -482,6 +887,9 @@ protected:
         }
         catch (openvdb::Exception e) { return openvdb::CoordBBox(); }
     }
+
+    mutable std::map<std::string, openvdb::GridPtrVecPtr> _gridCache;
+    mutable OpenThreads::Mutex _cacheMutex;
 };
 
 // Now register with Registry to instantiate the above reader/writer.
@@ -6,9 +6,175 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 
+#include <osg/Timer>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <ctime>
+#include <fstream>
+#include <functional>
+
 #include "3rdparty/libhv/all/client/requests.h"
 #include <readerwriter/Utilities.h>
 
+/** Keep-alive connections grouped by scheme://host:port. A hv::HttpClient owns one socket and
+    is not thread-safe, so each request takes one client exclusively, and requests exceeding
+    the per-host limit wait until another one returns its client, or fail after a timeout */
+class HttpConnectionPool
+{
+public:
+    HttpConnectionPool() : _maxPerHost(4) {}
+    ~HttpConnectionPool()
+    {
+        for (std::map<std::string, HostEntry>::iterator itr = _hosts.begin();
+             itr != _hosts.end(); ++itr)
+        {
+            std::vector<hv::HttpClient*>& idle = itr->second.idle;
+            for (size_t i = 0; i < idle.size(); ++i) delete idle[i];
+        }
+    }
+
+    void setMaxConnectionsPerHost(int n)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _maxPerHost = osg::maximum(n, 1); _condition.broadcast();
+    }
+
+    /** Take a client of the host, or return NULL if none is available within timeout seconds */
+    hv::HttpClient* acquire(const std::string& host, double timeout)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        HostEntry& entry = _hosts[host]; osg::Timer_t start = osg::Timer::instance()->tick();
+        while (entry.idle.empty() && entry.numActive >= _maxPerHost)
+        {
+            double remaining = timeout - osg::Timer::instance()->delta_s(
+                start, osg::Timer::instance()->tick());
+            if (remaining <= 0.0) return NULL;
+            _condition.wait(&_mutex, (unsigned long)(remaining * 1000.0) + 1);
+        }
+
+        hv::HttpClient* client = NULL; entry.numActive++;
+        if (entry.idle.empty()) client = new hv::HttpClient;
+        else { client = entry.idle.back(); entry.idle.pop_back(); }
+        return client;
+    }
+
+    void release(const std::string& host, hv::HttpClient* client, bool reusable)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        HostEntry& entry = _hosts[host]; entry.numActive--;
+        if (reusable && (int)entry.idle.size() < _maxPerHost) entry.idle.push_back(client);
+        else delete client;
+        _condition.broadcast();  // waiters of different hosts share the condition
+    }
+
+protected:
+    struct HostEntry
+    {
+        std::vector<hv::HttpClient*> idle; int numActive;
+        HostEntry() : numActive(0) {}
+    };
+    std::map<std::string, HostEntry> _hosts;
+    OpenThreads::Mutex _mutex;
+    OpenThreads::Condition _condition;
+    int _maxPerHost;
+};
+
+/** Disk cache of GET responses. Each URL is saved as <dir>/<hash>.webcache, which starts with
+    lines of URL, ETag, Last-Modified, content type and expiring time, followed by the body */
+class WebDiskCache
+{
+public:
+    struct Entry
+    {
+        std::string url, etag, lastModified, contentType, body;
+        time_t expires; Entry() : expires(0) {}
+    };
+
+    WebDiskCache(const std::string& dir) : _directory(dir) {}
+
+    bool read(const std::string& url, Entry& entry) const
+    {
+        std::ifstream in(getCacheFile(url).c_str(), std::ios::in | std::ios::binary);
+        if (!in) return false;
+
+        std::string expires;
+        std::getline(in, entry.url); std::getline(in, entry.etag);
+        std::getline(in, entry.lastModified); std::getline(in, entry.contentType);
+        std::getline(in, expires); if (!in || entry.url != url) return false;
+        entry.expires = (time_t)atoll(expires.c_str());
+
+        std::streampos start = in.tellg(); in.seekg(0, std::ios::end);
+        size_t size = (size_t)(in.tellg() - start); in.seekg(start);
+        entry.body.resize(size); if (size > 0) in.read(&entry.body[0], size);
+        return !in.fail();
+    }
+
+    void write(const Entry& entry, const std::string& body) const
+    {
+        // Concurrent downloads of the same URL must not share one temporary file
+        static OpenThreads::Atomic s_tempCounter;
+        std::string file = getCacheFile(entry.url);
+        std::string tempFile = file + "." + std::to_string((unsigned int)++s_tempCounter) + ".tmp";
+        if (!osgDB::fileExists(_directory)) osgDB::makeDirectory(_directory);
+        {
+            std::ofstream out(tempFile.c_str(), std::ios::out | std::ios::binary);
+            if (!out) { OSG_NOTICE << "[libhv] Failed to write cache " << tempFile << std::endl; return; }
+            out << entry.url << "\n" << entry.etag << "\n" << entry.lastModified << "\n"
+                << entry.contentType << "\n" << (long long)entry.expires << "\n";
+            out.write(body.data(), body.size());
+        }
+        remove(file.c_str());  // another download may have renamed its file just before this one
+        if (rename(tempFile.c_str(), file.c_str()) != 0) remove(tempFile.c_str());
+    }
+
+    /** Read validators and freshness from response; returns false if it must not be stored */
+    static bool update(Entry& entry, HttpResponse& response)
+    {
+        std::string cacheControl = osgDB::convertToLowerCase(response.GetHeader("Cache-Control"));
+        if (cacheControl.find("no-store") != std::string::npos) return false;
+
+        long long maxAge = 0; size_t pos = cacheControl.find("max-age=");
+        if (pos != std::string::npos && cacheControl.find("no-cache") == std::string::npos)
+            maxAge = atoll(cacheControl.c_str() + pos + 8);
+        entry.expires = time(NULL) + (time_t)maxAge;
+
+        std::string etag = response.GetHeader("ETag"), lastModified = response.GetHeader("Last-Modified");
+        if (!etag.empty()) entry.etag = etag;
+        if (!lastModified.empty()) entry.lastModified = lastModified;
+        return maxAge > 0 || !entry.etag.empty() || !entry.lastModified.empty();
+    }
+
+protected:
+    std::string getCacheFile(const std::string& url) const
+    {
+        std::stringstream ss; ss << std::hex << std::hash<std::string>()(url);
+        return _directory + "/" + ss.str() + ".webcache";
+    }
+    std::string _directory;
+};
+
+/** Streambuf reading directly from a response body, so it is not copied before decoding */
+class WebResponseBuffer : public std::streambuf
+{
+public:
+    WebResponseBuffer(std::string& body)
+    { char* ptr = body.empty() ? NULL : &body[0]; setg(ptr, ptr, ptr + body.size()); }
+
+protected:
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                             std::ios_base::openmode which = std::ios_base::in)
+    {
+        char* target = (dir == std::ios_base::beg) ? eback() + off
+                     : ((dir == std::ios_base::cur) ? gptr() + off : egptr() + off);
+        if (target < eback() || target > egptr()) return pos_type(off_type(-1));
+        setg(eback(), target, egptr()); return pos_type(target - eback());
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in)
+    { return seekoff(off_type(pos), std::ios_base::beg, which); }
+};
+
 class ReaderWriterWeb : public osgDB::ReaderWriter
 {
 public:
@@ -16,12 +182,15 @@ public:
     
     ReaderWriterWeb()
     {
-        _client = new hv::HttpClient;
+        _pool = new HttpConnectionPool;
 
         supportsProtocol("http", "Read from http port using libhv.");
         supportsProtocol("https", "Read from https port using libhv.");
         supportsProtocol("ftp", "Read from ftp port using libhv.");
         supportsProtocol("ftps", "Read from ftps port using libhv.");
+        supportsOption("CacheDirectory", "Directory of disk cache of GET responses: default is none");
+        supportsOption("MaxConnectionsPerHost", "Keep-alive connections per host: default=4");
+        supportsOption("ConnectionWaitTimeout", "Seconds to wait for a free connection: default=60");
 
         // Examples:
         // osgviewer --image https://www.baidu.com/img/PCtm_d9c8750bed0b3c7d089fa7d55720d6cf.png.verse_web
@@ -32,7 +201,7 @@ public:
 
     virtual ~ReaderWriterWeb()
     {
-        delete _client;
+        delete _pool;
     }
 
     bool acceptsProtocol(const std::string& protocol) const
@@ -174,27 +343,57 @@ public:
                 contentType = trimString(wf->resHeaders[i + 1]);
         }
 #else
-        HttpRequest req;  // Read data from web
-        req.method = HTTP_GET;
-        req.url = fileName; req.scheme = scheme;
-
-        HttpResponse response;
-        int result = _client->send(&req, &response);
-        if (result != 0)
-        {
-            OSG_WARN << "[libhv] Failed getting " << fileName << ": " << result << std::endl;
-            return ReadResult::ERROR_IN_READING_FILE;
-        }
-        else if (response.status_code > 200 || response.body.empty())
+        // Fresh responses in disk cache are used directly, and stale ones are revalidated
+        std::string cacheDir = options ? options->getPluginStringData("CacheDirectory") : "";
+        std::string maxConnections = options ? options->getPluginStringData("MaxConnectionsPerHost") : "";
+        if (!maxConnections.empty()) _pool->setMaxConnectionsPerHost(atoi(maxConnections.c_str()));
+
+        WebDiskCache::Entry cached; HttpResponse response;
+        bool hasCache = !cacheDir.empty() && WebDiskCache(cacheDir).read(fileName, cached);
+        std::string* body = &response.body;
+        if (hasCache && cached.expires > time(NULL))
+            { body = &cached.body; contentType = cached.contentType; }
+        else
         {
-            OSG_WARN << "[libhv] Failed getting " << fileName << ": Code = "
-                     << response.status_code << ", Size = " << response.body.size() << std::endl;
-            return ReadResult::ERROR_IN_READING_FILE;
+            HttpRequest req;  // Read data from web
+            req.method = HTTP_GET;
+            req.url = fileName; req.scheme = scheme;
+            if (hasCache && !cached.etag.empty()) req.headers["If-None-Match"] = cached.etag;
+            if (hasCache && !cached.lastModified.empty())
+                req.headers["If-Modified-Since"] = cached.lastModified;
+
+            int result = sendRequest(req, response, options);
+            if (result != 0)
+            {
+                OSG_WARN << "[libhv] Failed getting " << fileName << ": " << result << std::endl;
+                return ReadResult::ERROR_IN_READING_FILE;
+            }
+            else if (hasCache && response.status_code == HTTP_STATUS_NOT_MODIFIED)
+            {
+                if (WebDiskCache::update(cached, response))
+                    WebDiskCache(cacheDir).write(cached, cached.body);
+                body = &cached.body; contentType = cached.contentType;
+            }
+            else if (response.status_code > 200 || response.body.empty())
+            {
+                OSG_WARN << "[libhv] Failed getting " << fileName << ": Code = "
+                         << response.status_code << ", Size = " << response.body.size() << std::endl;
+                return ReadResult::ERROR_IN_READING_FILE;
+            }
+            else
+            {
+                contentType = http_content_type_str(response.content_type);
+                if (!cacheDir.empty())
+                {
+                    WebDiskCache::Entry entry; entry.url = fileName; entry.contentType = contentType;
+                    if (WebDiskCache::update(entry, response))
+                        WebDiskCache(cacheDir).write(entry, response.body);
+                }
+            }
         }
 
-        std::stringstream buffer(std::ios::in | std::ios::out | std::ios::binary);
-        buffer.write((char*)response.body.data(), response.body.size());
-        contentType = http_content_type_str(response.content_type);
+        WebResponseBuffer responseBuffer(*body);
+        std::istream buffer(&responseBuffer);
 #endif
 
         // Load by other readerwriter
@@ -274,11 +473,29 @@ public:
         req.headers["Connection"] = connection;
         req.headers["Content-Type"] = mimeType;
 
-        HttpResponse response; int code = _client->send(&req, &response);
+        HttpResponse response; int code = sendRequest(req, response, options);
         return (code != 0) ? WriteResult::ERROR_IN_WRITING_FILE : WriteResult::FILE_SAVED;
     }
 
 protected:
+    int sendRequest(HttpRequest& req, HttpResponse& response, const osgDB::Options* options) const
+    {
+        std::string waitTime = options ? options->getPluginStringData("ConnectionWaitTimeout") : "";
+        double timeout = waitTime.empty() ? 60.0 : atof(waitTime.c_str());
+
+        req.ParseUrl();  // to find host and port for the connection pool
+        std::string host = req.scheme + "://" + req.host + ":" + std::to_string(req.port);
+        hv::HttpClient* client = _pool->acquire(host, timeout);
+        if (!client)
+        {
+            OSG_WARN << "[libhv] No free connection to " << host << " in "
+                     << timeout << " seconds" << std::endl; return -1;
+        }
+        int result = client->send(&req, &response);
+        _pool->release(host, client, result == 0);
+        return result;
+    }
+
     static std::string trimString(const std::string& str)
     {
         if (!str.size()) return str;
@@ -288,7 +505,7 @@ protected:
         return str.substr(first, last - first + 1);
     }
 
-    hv::HttpClient* _client;
+    HttpConnectionPool* _pool;
 };
 
 // Now register with Registry to instantiate the above reader/writer.
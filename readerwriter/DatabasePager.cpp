@@ -0,0 +1,226 @@
+#include <osg/io_utils>
+#include <osg/CullingSet>
+#include <osg/Polytope>
+#include <osg/Transform>
+#include <osg/LOD>
+#include <algorithm>
+#include "DatabasePager.h"
+using namespace osgVerse;
+
+class PrefetchVisitor : public osg::NodeVisitor
+{
+public:
+    struct Candidate
+    {
+        osg::PagedLOD* parent; osg::NodePath path;
+        unsigned int childIndex; float weight;
+        bool operator<(const Candidate& c) const { return weight > c.weight; }
+    };
+    std::vector<Candidate> candidates;
+
+    PrefetchVisitor(const osg::Matrixd& view, const osg::Matrixd& proj,
+                    const osg::Viewport& vp, float lodScale)
+    :   osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN), _lodScale(lodScale)
+    {
+        _eye = osg::Vec3d() * osg::Matrixd::inverse(view);
+        _frustum.setToUnitFrustum(true, true);
+        _frustum.transformProvidingInverse(view * proj);
+        _pixelSizeVector = osg::CullingSet::computePixelSizeVector(vp, proj, view);
+        _matrixStack.push_back(osg::Matrixd());
+    }
+
+    virtual void apply(osg::Node& node)
+    { if (isInFrustum(node)) traverse(node); }
+
+    virtual void apply(osg::Camera& node) {}  // ignore nested cameras like RTT/HUD
+
+    virtual void apply(osg::Transform& node)
+    {
+        if (!isInFrustum(node)) return;
+        osg::Matrixd matrix = _matrixStack.back();
+        node.computeLocalToWorldMatrix(matrix, this);
+        _matrixStack.push_back(matrix); traverse(node);
+        _matrixStack.pop_back();
+    }
+
+    virtual void apply(osg::LOD& node)
+    {
+        if (!isInFrustum(node)) return;
+        float required = computeRequiredRange(node);
+        for (unsigned int i = 0; i < node.getNumChildren() && i < node.getNumRanges(); ++i)
+        {
+            if (node.getMinRange(i) <= required && required < node.getMaxRange(i))
+                node.getChild(i)->accept(*this);
+        }
+    }
+
+    virtual void apply(osg::PagedLOD& node)
+    {
+        if (!isInFrustum(node)) return;
+        float required = computeRequiredRange(node);
+        unsigned int numChildren = node.getNumChildren();
+        int lastChildTraversed = -1; bool needToLoadChild = false;
+        for (unsigned int i = 0; i < node.getNumRanges(); ++i)
+        {
+            float minR = node.getMinRange(i), maxR = node.getMaxRange(i);
+            if (minR <= required && required < maxR)
+            {
+                if (i < numChildren)
+                { node.getChild(i)->accept(*this); lastChildTraversed = (int)i; }
+                else needToLoadChild = true;
+            }
+        }
+
+        if (!needToLoadChild) return;
+        if (numChildren > 0 && ((int)numChildren - 1) != lastChildTraversed)
+            node.getChild(numChildren - 1)->accept(*this);
+        if (node.getDisableExternalChildrenPaging() || numChildren >= node.getNumFileNames()) return;
+        if (node.getFileName(numChildren).empty()) return;
+
+        // Weight is computed in the same way as PagedLOD::traverse() computes request priority
+        float minR = node.getMinRange(numChildren), maxR = node.getMaxRange(numChildren);
+        float weight = (maxR > minR) ? (maxR - required) / (maxR - minR) : 0.0f;
+        if (node.getRangeMode() == osg::LOD::PIXEL_SIZE_ON_SCREEN)
+            weight = (maxR > minR) ? (required - minR) / (maxR - minR) : 0.0f;
+
+        Candidate c; c.parent = &node; c.path = getNodePath();
+        c.childIndex = numChildren; c.weight = osg::clampBetween(weight, 0.0f, 1.0f);
+        candidates.push_back(c);
+    }
+
+protected:
+    osg::BoundingSphere toWorld(const osg::BoundingSphere& bs) const
+    {
+        const osg::Matrixd& m = _matrixStack.back();
+        double sx = osg::Vec3d(m(0, 0), m(0, 1), m(0, 2)).length2();
+        double sy = osg::Vec3d(m(1, 0), m(1, 1), m(1, 2)).length2();
+        double sz = osg::Vec3d(m(2, 0), m(2, 1), m(2, 2)).length2();
+        double scale = sqrt(osg::maximum(sx, osg::maximum(sy, sz)));
+        return osg::BoundingSphere(bs.center() * m, bs.radius() * scale);
+    }
+
+    bool isInFrustum(osg::Node& node)
+    {
+        const osg::BoundingSphere& bs = node.getBound();
+        if (!bs.valid()) return true;
+        return _frustum.contains(toWorld(bs));
+    }
+
+    float computeRequiredRange(osg::LOD& node) const
+    {
+        if (node.getRangeMode() == osg::LOD::DISTANCE_FROM_EYE_POINT)
+        {
+            osg::Vec3d center = osg::Vec3d(node.getCenter()) * _matrixStack.back();
+            return (center - _eye).length() * _lodScale;
+        }
+
+        osg::BoundingSphere bs = toWorld(node.getBound());
+        float pixelSize = bs.radius() / (osg::Vec3(bs.center()) * _pixelSizeVector);
+        return fabs(pixelSize) / _lodScale;
+    }
+
+    std::vector<osg::Matrixd> _matrixStack;
+    osg::Polytope _frustum;
+    osg::Vec4 _pixelSizeVector;
+    osg::Vec3d _eye;
+    float _lodScale;
+};
+
+bool DatabasePager::predictViewMatrix(double lookAhead, osg::Matrixd& predicted) const
+{
+    if (_viewHistory.size() < 2) return false;
+    const std::pair<double, osg::Matrixd>& first = _viewHistory.front();
+    const std::pair<double, osg::Matrixd>& last = _viewHistory.back();
+    double dt = last.first - first.first;
+    if (dt < 1e-4) return false;
+
+    // Constant-velocity model over the recorded history: linear motion of the eye,
+    // and angular motion computed from the relative rotation between first & last
+    osg::Matrixd world0 = osg::Matrixd::inverse(first.second);
+    osg::Matrixd world1 = osg::Matrixd::inverse(last.second);
+    osg::Vec3d velocity = (world1.getTrans() - world0.getTrans()) / dt;
+    osg::Matrixd rot0 = osg::Matrixd::rotate(world0.getRotate());
+    osg::Matrixd rot1 = osg::Matrixd::rotate(world1.getRotate());
+    osg::Quat deltaQ = (osg::Matrixd::inverse(rot0) * rot1).getRotate();
+
+    double angle = 0.0; osg::Vec3d axis;
+    deltaQ.getRotate(angle, axis);
+    if (angle > osg::PI) angle -= osg::PI * 2.0;
+    angle = osg::clampBetween(angle * lookAhead / dt, -osg::PI_2, osg::PI_2);
+
+    osg::Vec3d offset = velocity * lookAhead;
+    double radius = world1.getTrans().length();
+    if (fabs(angle) < 1e-4 && offset.length() < osg::maximum(radius, 1.0) * 1e-6)
+        return false;  // not moving
+
+    osg::Matrixd predictedWorld = rot1 * osg::Matrixd::rotate(angle, axis)
+                                * osg::Matrixd::translate(world1.getTrans() + offset);
+    predicted = osg::Matrixd::inverse(predictedWorld);
+    return true;
+}
+
+void DatabasePager::prefetch(const osg::FrameStamp& frameStamp)
+{
+    osg::ref_ptr<osg::Camera> camera = _prefetchCamera.get();
+    if (!camera || !camera->getViewport()) return;
+
+    _viewHistory.push_back(std::pair<double, osg::Matrixd>(
+        frameStamp.getReferenceTime(), camera->getViewMatrix()));
+    while (_viewHistory.size() > _prefetchHistorySize) _viewHistory.pop_front();
+
+    PrefetchRecordMap lastRecords; lastRecords.swap(_prefetchRecords);
+    osg::Matrixd predictedView;
+    if (predictViewMatrix(_prefetchLookAhead, predictedView))
+    {
+        PrefetchVisitor pv(predictedView, camera->getProjectionMatrix(),
+                           *camera->getViewport(), camera->getLODScale());
+        pv.setTraversalMask(camera->getCullMask());
+        pv.setFrameStamp(const_cast<osg::FrameStamp*>(&frameStamp));
+
+        osg::ref_ptr<osg::Node> root = _prefetchRoot.get();
+        if (root.valid()) root->accept(pv);
+        else
+        {
+            for (unsigned int i = 0; i < camera->getNumChildren(); ++i)
+                camera->getChild(i)->accept(pv);
+        }
+
+        std::vector<PrefetchVisitor::Candidate>& candidates = pv.candidates;
+        std::sort(candidates.begin(), candidates.end());
+        if (candidates.size() > _maxPrefetchRequests) candidates.resize(_maxPrefetchRequests);
+
+        for (size_t i = 0; i < candidates.size(); ++i)
+        {
+            PrefetchVisitor::Candidate& c = candidates[i];
+            osg::PagedLOD* plod = c.parent;
+            osg::ref_ptr<osg::Referenced>& request = plod->getDatabaseRequest(c.childIndex);
+            requestNodeFile(plod->getDatabasePath() + plod->getFileName(c.childIndex), c.path,
+                            _prefetchPriority + c.weight * 0.1f, &frameStamp, request,
+                            plod->getDatabaseOptions());
+
+            PrefetchRecord record;
+            record.parent = plod; record.request = request;
+            record.childIndex = c.childIndex; record.numOfRequests = 0;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dr_mutex);
+                DatabaseRequest* dr = dynamic_cast<DatabaseRequest*>(request.get());
+                if (dr) record.numOfRequests = dr->_numOfRequests;
+            }
+
+            std::pair<osg::PagedLOD*, unsigned int> key(plod, c.childIndex);
+            _prefetchRecords[key] = record; lastRecords.erase(key);
+        }
+    }
+
+    // Cancel previous predictions which are not confirmed by now: neither predicted again
+    // nor requested by the cull traversal since last prefetching
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dr_mutex);
+    for (PrefetchRecordMap::iterator itr = lastRecords.begin(); itr != lastRecords.end(); ++itr)
+    {
+        PrefetchRecord& record = itr->second;
+        DatabaseRequest* dr = dynamic_cast<DatabaseRequest*>(record.request.get());
+        if (!dr || !record.parent.valid() || !dr->valid()) continue;
+        if (dr->_numOfRequests == record.numOfRequests && !dr->_loadedModel)
+            dr->invalidate();
+    }
+}
@@ -3,20 +3,48 @@
 
 #include <osg/ProxyNode>
 #include <osg/PagedLOD>
+#include <osg/Camera>
+#include <osg/observer_ptr>
 #include <osgDB/DatabasePager>
+#include <deque>
 #include "Export.h"
 
 namespace osgVerse
 {
 
-    class DatabasePager : public osgDB::DatabasePager
+    class OSGVERSE_RW_EXPORT DatabasePager : public osgDB::DatabasePager
     {
     public:
-        DatabasePager() : osgDB::DatabasePager()
+        DatabasePager() : osgDB::DatabasePager(), _prefetchLookAhead(0.5), _prefetchPriority(-1.0f),
+                          _maxPrefetchRequests(16), _prefetchHistorySize(8)
         {
             setDrawablePolicy(osgDB::DatabasePager::USE_VERTEX_BUFFER_OBJECTS);
         }
 
+        /** Set camera to predict motion of and request PagedLOD children in advance.
+            Scene graph to prefetch is the camera's children if root is not specified */
+        void setPrefetchCamera(osg::Camera* cam, osg::Node* root = NULL)
+        { _prefetchCamera = cam; _prefetchRoot = root; _viewHistory.clear(); }
+        osg::Camera* getPrefetchCamera() { return _prefetchCamera.get(); }
+
+        /** Time (in seconds) to extrapolate camera trajectory. Set to 0 to disable prefetching */
+        void setPrefetchLookAhead(double t) { _prefetchLookAhead = t; }
+        double getPrefetchLookAhead() const { return _prefetchLookAhead; }
+
+        /** Priority of prefetching requests, should be lower than any normal PagedLOD request */
+        void setPrefetchPriority(float p) { _prefetchPriority = p; }
+        float getPrefetchPriority() const { return _prefetchPriority; }
+
+        void setMaxPrefetchRequests(unsigned int n) { _maxPrefetchRequests = n; }
+        unsigned int getMaxPrefetchRequests() const { return _maxPrefetchRequests; }
+
+        /** Number of recent view matrices used to estimate camera velocity */
+        void setPrefetchHistorySize(unsigned int n) { _prefetchHistorySize = osg::maximum(n, 2u); }
+        unsigned int getPrefetchHistorySize() const { return _prefetchHistorySize; }
+
+        /** Compute predicted view matrix after specified seconds. Return false if not moving */
+        bool predictViewMatrix(double lookAhead, osg::Matrixd& predicted) const;
+
         struct DataMergeCallback : public osg::Referenced
         {
             enum FilterResult
@@ -38,8 +66,12 @@ namespace osgVerse
         {
             removeExpiredSubgraphs(fs);
             addLoadedDataToSceneGraph_Verse(fs);
+            if (_prefetchCamera.valid() && _prefetchLookAhead > 0.0) prefetch(fs);
         }
 
+        /** Record camera and request tiles in the predicted frustum (called in updateSceneGraph) */
+        void prefetch(const osg::FrameStamp& frameStamp);
+
         void addLoadedDataToSceneGraph_Verse(const osg::FrameStamp& frameStamp)
         {
             double timeStamp = frameStamp.getReferenceTime();
@@ -134,6 +166,22 @@ namespace osgVerse
         typedef std::map<osg::ref_ptr<osg::Group>, std::vector<osg::ref_ptr<osg::Node>>> LoadedNodeMap;
         LoadedNodeMap _loadedNodes;
         osg::ref_ptr<DataMergeCallback> _mergeCallback;
+
+        struct PrefetchRecord
+        {
+            osg::observer_ptr<osg::PagedLOD> parent;
+            osg::observer_ptr<osg::Referenced> request;  // pager checks its refcount to requeue
+            unsigned int childIndex, numOfRequests;
+        };
+        typedef std::map<std::pair<osg::PagedLOD*, unsigned int>, PrefetchRecord> PrefetchRecordMap;
+        PrefetchRecordMap _prefetchRecords;
+
+        std::deque<std::pair<double, osg::Matrixd>> _viewHistory;
+        osg::observer_ptr<osg::Camera> _prefetchCamera;
+        osg::observer_ptr<osg::Node> _prefetchRoot;
+        double _prefetchLookAhead;
+        float _prefetchPriority;
+        unsigned int _maxPrefetchRequests, _prefetchHistorySize;
     };
 
 }
@@ -14,6 +14,7 @@
 #include "pipeline/Utilities.h"
 #include "LoadTextureKTX.h"
 #include <libhv/all/client/requests.h>
+#include <meshoptimizer/meshoptimizer.h>
 #include <picojson.h>
 #define DISABLE_SKINNING_DATA 0
 
@@ -276,8 +277,197 @@ namespace osgVerse
         stbi_image_free(data); return true;
     }
 
-    LoaderGLTF::LoaderGLTF(std::istream& in, const std::string& d, bool isBinary, bool pbr)
-        : _usingMaterialPBR(pbr)
+    static bool DeferImageData(tinygltf::Image* image, const int image_idx, std::string* err,
+                               std::string* warn, int req_width, int req_height,
+                               const unsigned char* bytes, int size, void* user_data)
+    {
+        // Only keep encoded data of external images here; images in buffer views can be
+        // found later. All of them will be decoded concurrently in LoaderGLTF::decodeImages()
+        if (image->bufferView < 0) image->image.assign(bytes, bytes + size);
+        return true;
+    }
+
+    void LoaderGLTF::decodeImages()
+    {
+        std::vector<int> pendingImages;
+        for (size_t i = 0; i < _modelDef.images.size(); ++i)
+        {
+            const tinygltf::Image& image = _modelDef.images[i];
+            if (image.width > 0 && image.height > 0) continue;
+            if (image.bufferView >= 0 || !image.image.empty()) pendingImages.push_back((int)i);
+        }
+
+        std::vector<std::string> errors(pendingImages.size());
+        tinygltf::LoadImageDataOption option; option.preserve_channels = true;
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < (int)pendingImages.size(); ++i)
+        {
+            tinygltf::Image& image = _modelDef.images[pendingImages[i]];
+            std::vector<unsigned char> encoded; std::string warn;
+            const unsigned char* bytes = NULL; size_t size = 0;
+            if (image.bufferView >= 0)
+            {
+                const tinygltf::BufferView& view = _modelDef.bufferViews[image.bufferView];
+                if (view.buffer < 0) continue;
+                bytes = &_modelDef.buffers[view.buffer].data[view.byteOffset];
+                size = view.byteLength;
+            }
+            else
+                { encoded.swap(image.image); bytes = encoded.data(); size = encoded.size(); }
+            LoadImageDataEx(&image, pendingImages[i], &errors[i], &warn,
+                            0, 0, bytes, (int)size, &option);
+        }
+
+        for (size_t i = 0; i < errors.size(); ++i)
+        { if (!errors[i].empty()) OSG_WARN << "[LoaderGLTF] " << errors[i]; }
+    }
+
+    void LoaderGLTF::decodeMeshoptBuffers()
+    {
+        // EXT_meshopt_compression: decompress buffer views into their (fallback) buffers,
+        // so that all following accessors can read them as usual
+        std::vector<int> compressedViews;
+        for (size_t i = 0; i < _modelDef.bufferViews.size(); ++i)
+        {
+            tinygltf::BufferView& view = _modelDef.bufferViews[i];
+            if (view.extensions.find("EXT_meshopt_compression") == view.extensions.end()) continue;
+            if (view.buffer < 0 || !_modelDef.buffers[view.buffer].uri.empty()) continue;
+            compressedViews.push_back((int)i);
+        }
+
+        std::vector<std::string> errors(compressedViews.size());
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < (int)compressedViews.size(); ++i)
+        {
+            tinygltf::BufferView& view = _modelDef.bufferViews[compressedViews[i]];
+            const tinygltf::Value& ext = view.extensions.find("EXT_meshopt_compression")->second;
+            if (!ext.Has("buffer") || !ext.Has("byteLength") || !ext.Has("byteStride") ||
+                !ext.Has("count") || !ext.Has("mode"))
+            { errors[i] = "Incomplete EXT_meshopt_compression definition"; continue; }
+
+            int srcBufferID = ext.Get("buffer").GetNumberAsInt();
+            size_t srcOffset = ext.Has("byteOffset") ? ext.Get("byteOffset").GetNumberAsInt() : 0;
+            size_t srcLength = ext.Get("byteLength").GetNumberAsInt();
+            size_t stride = ext.Get("byteStride").GetNumberAsInt();
+            size_t count = ext.Get("count").GetNumberAsInt();
+            std::string mode = ext.Get("mode").Get<std::string>();
+            std::string filter = ext.Has("filter") ? ext.Get("filter").Get<std::string>() : "NONE";
+            if (srcBufferID < 0 || srcBufferID >= (int)_modelDef.buffers.size())
+            { errors[i] = "Invalid compressed buffer " + std::to_string(srcBufferID); continue; }
+
+            const std::vector<unsigned char>& src = _modelDef.buffers[srcBufferID].data;
+            std::vector<unsigned char>& dst = _modelDef.buffers[view.buffer].data;
+            if (srcOffset + srcLength > src.size() || view.byteOffset + stride * count > dst.size())
+            { errors[i] = "Out-of-range compressed buffer view " + view.name; continue; }
+
+            int result = -1; unsigned char* dstPtr = &dst[view.byteOffset];
+            if (mode == "ATTRIBUTES")
+                result = meshopt_decodeVertexBuffer(dstPtr, count, stride, &src[srcOffset], srcLength);
+            else if (mode == "TRIANGLES")
+                result = meshopt_decodeIndexBuffer(dstPtr, count, stride, &src[srcOffset], srcLength);
+            else if (mode == "INDICES")
+                result = meshopt_decodeIndexSequence(dstPtr, count, stride, &src[srcOffset], srcLength);
+            if (result != 0)
+            { errors[i] = "Failed to decode " + mode + " of buffer view " + view.name; continue; }
+
+            if (filter == "OCTAHEDRAL") meshopt_decodeFilterOct(dstPtr, count, stride);
+            else if (filter == "QUATERNION") meshopt_decodeFilterQuat(dstPtr, count, stride);
+            else if (filter == "EXPONENTIAL") meshopt_decodeFilterExp(dstPtr, count, stride);
+            if (view.byteStride == 0 && mode == "ATTRIBUTES") view.byteStride = stride;
+        }
+
+        for (size_t i = 0; i < errors.size(); ++i)
+        { if (!errors[i].empty()) OSG_WARN << "[LoaderGLTF] " << errors[i] << std::endl; }
+    }
+
+    static float readQuantizedComponent(const unsigned char* ptr, int type, bool normalized)
+    {
+        switch (type)
+        {
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+            { float v = *(const char*)ptr; return normalized ? osg::maximum(v / 127.0f, -1.0f) : v; }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            { float v = *ptr; return normalized ? (v / 255.0f) : v; }
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+            { float v = *(const short*)ptr; return normalized ? osg::maximum(v / 32767.0f, -1.0f) : v; }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            { float v = *(const unsigned short*)ptr; return normalized ? (v / 65535.0f) : v; }
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: return *(const float*)ptr;
+        default: return 0.0f;
+        }
+    }
+
+    template<typename ArrayType, int compNum>
+    static ArrayType* dequantizeArray(const tinygltf::Accessor& accessor,
+                                      const unsigned char* src, size_t stride)
+    {
+        int compSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+        size_t elemStride = (stride > 0) ? stride : (compSize * compNum);
+        ArrayType* arr = new ArrayType(accessor.count);
+        for (size_t i = 0; i < accessor.count; ++i)
+        {
+            const unsigned char* ptr = src + i * elemStride;
+            for (int c = 0; c < compNum; ++c) (*arr)[i][c] = readQuantizedComponent(
+                ptr + c * compSize, accessor.componentType, accessor.normalized);
+        }
+        return arr;
+    }
+
+    osg::Array* LoaderGLTF::createDequantizedArray(const tinygltf::Accessor& accessor,
+                                                   const unsigned char* src, size_t stride)
+    {
+        switch (accessor.type)
+        {
+        case TINYGLTF_TYPE_VEC2: return dequantizeArray<osg::Vec2Array, 2>(accessor, src, stride);
+        case TINYGLTF_TYPE_VEC3: return dequantizeArray<osg::Vec3Array, 3>(accessor, src, stride);
+        case TINYGLTF_TYPE_VEC4: return dequantizeArray<osg::Vec4Array, 4>(accessor, src, stride);
+        default: break;
+        }
+        OSG_WARN << "[LoaderGLTF] Unsupported quantized attribute with type "
+                 << accessor.type << std::endl;
+        return NULL;
+    }
+
+    osg::Array* LoaderGLTF::createQuantizedArray(const tinygltf::Accessor& accessor,
+                                                 const unsigned char* src, size_t stride)
+    {
+        // KHR_mesh_quantization: keep 8/16-bit data as they are, and let GPU normalize them
+        size_t count = accessor.count; bool norm = accessor.normalized;
+        int compNum = (accessor.type != TINYGLTF_TYPE_SCALAR) ? accessor.type : 1;
+#if OSG_VERSION_GREATER_THAN(3, 1, 8)
+        switch (accessor.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+            if (compNum == 2) return createArray<osg::Vec2bArray>(src, count, stride, norm);
+            else if (compNum == 3) return createArray<osg::Vec3bArray>(src, count, stride, norm);
+            else if (compNum == 4) return createArray<osg::Vec4bArray>(src, count, stride, norm);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            if (compNum == 2) return createArray<osg::Vec2ubArray>(src, count, stride, norm);
+            else if (compNum == 3) return createArray<osg::Vec3ubArray>(src, count, stride, norm);
+            else if (compNum == 4) return createArray<osg::Vec4ubArray>(src, count, stride, norm);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+            if (compNum == 2) return createArray<osg::Vec2sArray>(src, count, stride, norm);
+            else if (compNum == 3) return createArray<osg::Vec3sArray>(src, count, stride, norm);
+            else if (compNum == 4) return createArray<osg::Vec4sArray>(src, count, stride, norm);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            if (compNum == 2) return createArray<osg::Vec2usArray>(src, count, stride, norm);
+            else if (compNum == 3) return createArray<osg::Vec3usArray>(src, count, stride, norm);
+            else if (compNum == 4) return createArray<osg::Vec4usArray>(src, count, stride, norm);
+            break;
+        default: break;
+        }
+#endif
+        OSG_WARN << "[LoaderGLTF] Unsupported quantized attribute with " << compNum
+                 << "-components and type " << accessor.componentType << std::endl;
+        return NULL;
+    }
+
+    LoaderGLTF::LoaderGLTF(std::istream& in, const std::string& d, bool isBinary, bool pbr,
+                           bool keepQuantized)
+        : _usingMaterialPBR(pbr), _keepQuantized(keepQuantized)
     {
         std::string protocol = osgDB::getServerProtocol(d);
         osgDB::ReaderWriter* rwWeb = (protocol.empty()) ? NULL
@@ -290,12 +480,21 @@ namespace osgVerse
 
         std::string err, warn; bool loaded = false;
         std::istreambuf_iterator<char> eos; osg::Vec3d rtcCenter;
-        std::vector<char> data(std::istreambuf_iterator<char>(in), eos);
+        std::vector<char> data; std::streampos start = in.tellg();
+        if (start >= 0 && in.seekg(0, std::ios::end))
+        {
+            // Read seekable stream at once, which is much faster than iterating large files
+            std::streamoff length = in.tellg() - start; in.seekg(start);
+            if (length > 0)
+            { data.resize((size_t)length); in.read(&data[0], length); data.resize(in.gcount()); }
+        }
+        else
+            { in.clear(); data.assign(std::istreambuf_iterator<char>(in), eos); }
         if (data.empty()) { OSG_WARN << "[LoaderGLTF] Unable to read from stream\n"; return; }
 
         tinygltf::TinyGLTF loader;
         loader.SetStoreOriginalJSONForExtrasAndExtensions(true);
-        loader.SetImageLoader(&LoadImageDataEx, this);
+        loader.SetImageLoader(&DeferImageData, this);
         loader.SetFsCallbacks(fs);
         if (isBinary)
         {
@@ -342,6 +541,7 @@ namespace osgVerse
         if (!err.empty()) OSG_WARN << "[LoaderGLTF] Errors found: " << err << std::endl;
         if (!warn.empty()) OSG_WARN << "[LoaderGLTF] Warnings found: " << warn << std::endl;
         if (!loaded) { OSG_WARN << "[LoaderGLTF] Unable to load GLTF scene" << std::endl; return; }
+        decodeMeshoptBuffers(); decodeImages();
 
         if (rtcCenter.length2() > 0.0)
         {
@@ -552,8 +752,8 @@ namespace osgVerse
             geom->setName(mesh.name + "_" + std::to_string(i));
             geom->setUseDisplayList(false); geom->setUseVertexBufferObjects(true);
 
-            tinygltf::Primitive primitive = mesh.primitives[i];
-            for (std::map<std::string, int>::iterator attrib = primitive.attributes.begin();
+            const tinygltf::Primitive& primitive = mesh.primitives[i];
+            for (std::map<std::string, int>::const_iterator attrib = primitive.attributes.begin();
                 attrib != primitive.attributes.end(); ++attrib)
             {
                 tinygltf::Accessor& attrAccessor = _modelDef.accessors[attrib->second];
@@ -572,8 +772,8 @@ namespace osgVerse
                 //          << ", ComponentBytes = " << compSize << std::endl;
                 if (attrib->first.compare("POSITION") == 0 && compSize == 4 && compNum == 3)
                 {
-                    osg::Vec3Array* va = new osg::Vec3Array(size);
-                    copyBufferData(&(*va)[0], &buffer.data[offset], copySize, stride, size);
+                    osg::Vec3Array* va = new osg::Vec3Array;
+                    assignBufferData(*va, &buffer.data[offset], size, stride);
 #if OSG_VERSION_GREATER_THAN(3, 1, 8)
                     va->setNormalize(attrAccessor.normalized);
 #endif
@@ -581,8 +781,8 @@ namespace osgVerse
                 }
                 else if (attrib->first.compare("NORMAL") == 0 && compSize == 4 && compNum == 3)
                 {
-                    osg::Vec3Array* na = new osg::Vec3Array(size);
-                    copyBufferData(&(*na)[0], &buffer.data[offset], copySize, stride, size);
+                    osg::Vec3Array* na = new osg::Vec3Array;
+                    assignBufferData(*na, &buffer.data[offset], size, stride);
 #if OSG_VERSION_GREATER_THAN(3, 1, 8)
                     na->setNormalize(attrAccessor.normalized);
                     geom->setNormalArray(na, osg::Array::BIND_PER_VERTEX);
@@ -592,8 +792,8 @@ namespace osgVerse
                 }
                 else if (attrib->first.compare("COLOR") == 0 && compNum == 4 && compSize == 4)
                 {
-                    osg::Vec4Array* ca = new osg::Vec4Array(size);
-                    copyBufferData(&(*ca)[0], &buffer.data[offset], copySize, stride, size);
+                    osg::Vec4Array* ca = new osg::Vec4Array;
+                    assignBufferData(*ca, &buffer.data[offset], size, stride);
 #if OSG_VERSION_GREATER_THAN(3, 1, 8)
                     ca->setNormalize(attrAccessor.normalized);
                     geom->setColorArray(ca, osg::Array::BIND_PER_VERTEX);
@@ -603,8 +803,8 @@ namespace osgVerse
                 }
                 else if (attrib->first.compare("TANGENT") == 0 && compSize == 4 && compNum == 4)
                 {
-                    osg::Vec4Array* ta = new osg::Vec4Array(size);
-                    copyBufferData(&(*ta)[0], &buffer.data[offset], copySize, stride, size);
+                    osg::Vec4Array* ta = new osg::Vec4Array;
+                    assignBufferData(*ta, &buffer.data[offset], size, stride);
 #if OSG_VERSION_GREATER_THAN(3, 1, 8)
                     ta->setNormalize(attrAccessor.normalized);
                     geom->setVertexAttribArray(6, ta, osg::Array::BIND_PER_VERTEX);
@@ -614,13 +814,53 @@ namespace osgVerse
                 }
                 else if (attrib->first.find("TEXCOORD_") != std::string::npos && compSize == 4 && compNum == 2)
                 {
-                    osg::Vec2Array* ta = new osg::Vec2Array(size);
-                    copyBufferData(&(*ta)[0], &buffer.data[offset], copySize, stride, size);
+                    osg::Vec2Array* ta = new osg::Vec2Array;
+                    assignBufferData(*ta, &buffer.data[offset], size, stride);
 #if OSG_VERSION_GREATER_THAN(3, 1, 8)
                     ta->setNormalize(attrAccessor.normalized);
 #endif
                     geom->setTexCoordArray(atoi(attrib->first.substr(9).c_str()), ta);
                 }
+                else if (attrib->first.compare("POSITION") == 0 && compSize < 4 && compNum == 3)
+                {   // Quantized positions are expanded, as bounding and intersecting require floats
+                    geom->setVertexArray(
+                        createDequantizedArray(attrAccessor, &buffer.data[offset], stride));
+                }
+                else if (compSize < 4 && (attrib->first.compare("NORMAL") == 0 ||
+                         attrib->first.compare("TANGENT") == 0 || attrib->first.compare("COLOR") == 0 ||
+                         attrib->first.find("TEXCOORD_") != std::string::npos))
+                {
+                    // Keep 8/16-bit normalized arrays only if required (and supported by OSG)
+                    osg::Array* qa = NULL;
+#if OSG_VERSION_GREATER_THAN(3, 1, 8)
+                    if (_keepQuantized)
+                        qa = createQuantizedArray(attrAccessor, &buffer.data[offset], stride);
+#endif
+                    if (!qa) qa = createDequantizedArray(attrAccessor, &buffer.data[offset], stride);
+                    if (!qa) continue;
+#if OSG_VERSION_GREATER_THAN(3, 1, 8)
+                    else if (attrib->first.compare("NORMAL") == 0)
+                        geom->setNormalArray(qa, osg::Array::BIND_PER_VERTEX);
+                    else if (attrib->first.compare("COLOR") == 0)
+                        geom->setColorArray(qa, osg::Array::BIND_PER_VERTEX);
+                    else if (attrib->first.compare("TANGENT") == 0)
+                        geom->setVertexAttribArray(6, qa, osg::Array::BIND_PER_VERTEX);
+                    else
+                        geom->setTexCoordArray(atoi(attrib->first.substr(9).c_str()), qa);
+#else
+                    else if (attrib->first.compare("NORMAL") == 0)
+                    { geom->setNormalArray(qa); geom->setNormalBinding(osg::Geometry::BIND_PER_VERTEX); }
+                    else if (attrib->first.compare("COLOR") == 0)
+                    { geom->setColorArray(qa); geom->setColorBinding(osg::Geometry::BIND_PER_VERTEX); }
+                    else if (attrib->first.compare("TANGENT") == 0)
+                    {
+                        geom->setVertexAttribArray(6, qa);
+                        geom->setVertexAttribBinding(6, osg::Geometry::BIND_PER_VERTEX);
+                    }
+                    else
+                        geom->setTexCoordArray(atoi(attrib->first.substr(9).c_str()), qa);
+#endif
+                }
                 else if (attrib->first.find("JOINTS_") != std::string::npos && compNum == 4)
                 {
                     int jID = atoi(attrib->first.substr(7).c_str());
@@ -654,7 +894,7 @@ namespace osgVerse
             }
 
             // Configure primitive index array
-            tinygltf::Accessor indexAccessor = _modelDef.accessors[primitive.indices];
+            const tinygltf::Accessor& indexAccessor = _modelDef.accessors[primitive.indices];
             const tinygltf::BufferView& indexView = _modelDef.bufferViews[indexAccessor.bufferView];
             osg::Vec3Array* va = static_cast<osg::Vec3Array*>(geom->getVertexArray());
             if (!va || (va && va->empty())) continue;
@@ -675,20 +915,20 @@ namespace osgVerse
                 {
                 case 1:
                     {
-                        osg::DrawElementsUByte* de = new osg::DrawElementsUByte(GL_POINTS, size); p = de;
-                        copyBufferData(&(*de)[0], &indexBuffer.data[offset], size * compSize, stride, size);
+                        osg::DrawElementsUByte* de = new osg::DrawElementsUByte(GL_POINTS); p = de;
+                        assignBufferData(*de, &indexBuffer.data[offset], size, stride);
                     }
                     break;
                 case 2:
                     {
-                        osg::DrawElementsUShort* de = new osg::DrawElementsUShort(GL_POINTS, size); p = de;
-                        copyBufferData(&(*de)[0], &indexBuffer.data[offset], size * compSize, stride, size);
+                        osg::DrawElementsUShort* de = new osg::DrawElementsUShort(GL_POINTS); p = de;
+                        assignBufferData(*de, &indexBuffer.data[offset], size, stride);
                     }
                     break;
                 case 4:
                     {
-                        osg::DrawElementsUInt* de = new osg::DrawElementsUInt(GL_POINTS, size); p = de;
-                        copyBufferData(&(*de)[0], &indexBuffer.data[offset], size * compSize, stride, size);
+                        osg::DrawElementsUInt* de = new osg::DrawElementsUInt(GL_POINTS); p = de;
+                        assignBufferData(*de, &indexBuffer.data[offset], size, stride);
                     }
                     break;
                 default:
@@ -1042,10 +1282,10 @@ namespace osgVerse
         }
     }
 
-    void LoaderGLTF::createBlendshapeData(osg::Geometry* geom, std::map<std::string, int>& target)
+    void LoaderGLTF::createBlendshapeData(osg::Geometry* geom, const std::map<std::string, int>& target)
     {
         osg::Vec3Array *va = NULL, *na = NULL; osg::Vec4Array *ta = NULL;
-        for (std::map<std::string, int>::iterator attrib = target.begin();
+        for (std::map<std::string, int>::const_iterator attrib = target.begin();
              attrib != target.end(); ++attrib)
         {
             tinygltf::Accessor& attrAccessor = _modelDef.accessors[attrib->second];
@@ -1062,16 +1302,16 @@ namespace osgVerse
 
             if (attrib->first.compare("POSITION") == 0 && compSize == 4 && compNum == 3)
             {
-                va = new osg::Vec3Array(size);
-                copyBufferData(&(*va)[0], &buffer.data[offset], copySize, stride, size);
+                va = new osg::Vec3Array;
+                assignBufferData(*va, &buffer.data[offset], size, stride);
 #if OSG_VERSION_GREATER_THAN(3, 1, 8)
                 va->setNormalize(attrAccessor.normalized);
 #endif
             }
             else if (attrib->first.compare("NORMAL") == 0 && compSize == 4 && compNum == 3)
             {
-                na = new osg::Vec3Array(size);
-                copyBufferData(&(*na)[0], &buffer.data[offset], copySize, stride, size);
+                na = new osg::Vec3Array;
+                assignBufferData(*na, &buffer.data[offset], size, stride);
 #if OSG_VERSION_GREATER_THAN(3, 1, 8)
                 na->setNormalize(attrAccessor.normalized);
 #endif
@@ -1124,7 +1364,8 @@ namespace osgVerse
         }
     }
 
-    osg::ref_ptr<osg::Group> loadGltf(const std::string& file, bool isBinary, bool usingPBR)
+    osg::ref_ptr<osg::Group> loadGltf(const std::string& file, bool isBinary, bool usingPBR,
+                                      bool keepQuantized)
     {
         std::string workDir = osgDB::getFilePath(file), http = osgDB::getServerProtocol(file);
         if (!http.empty() && http.find("file") == std::string::npos) return NULL;
@@ -1136,15 +1377,15 @@ namespace osgVerse
             return NULL;
         }
 
-        osg::ref_ptr<LoaderGLTF> loader = new LoaderGLTF(in, workDir, isBinary, usingPBR);
+        osg::ref_ptr<LoaderGLTF> loader = new LoaderGLTF(in, workDir, isBinary, usingPBR, keepQuantized);
         if (loader->getRoot()) loader->getRoot()->setName(file);
         return loader->getRoot();
     }
 
     osg::ref_ptr<osg::Group> loadGltf2(std::istream& in, const std::string& dir,
-                                       bool isBinary, bool usingPBR)
+                                       bool isBinary, bool usingPBR, bool keepQuantized)
     {
-        osg::ref_ptr<LoaderGLTF> loader = new LoaderGLTF(in, dir, isBinary, usingPBR);
+        osg::ref_ptr<LoaderGLTF> loader = new LoaderGLTF(in, dir, isBinary, usingPBR, keepQuantized);
         return loader->getRoot();
     }
 }
@@ -1,3 +1,4 @@
+#include <osg/Version>
 #include <osg/Texture2D>
 #include <osg/Geode>
 #include <osg/MatrixTransform>
@@ -15,7 +16,10 @@ namespace osgVerse
     class LoaderGLTF : public osg::Referenced
     {
     public:
-        LoaderGLTF(std::istream& in, const std::string& d, bool isBinary, bool usingPBR = true);
+        /** Quantized attributes (KHR_mesh_quantization) are expanded to float arrays unless
+            keepQuantized is set, as most CPU-side utilities only work with float arrays */
+        LoaderGLTF(std::istream& in, const std::string& d, bool isBinary, bool usingPBR = true,
+                   bool keepQuantized = false);
 
         osg::Group* getRoot() { return _root.get(); }
         tinygltf::Model& getModelData() { return _modelDef; }
@@ -50,23 +54,78 @@ namespace osgVerse
                                    tinygltf::Accessor& accessor);
         void createAnimationSampler(PlayerAnimation::AnimationData& anim, const std::string& p,
                                     tinygltf::Accessor& in, tinygltf::Accessor& out);
-        void createBlendshapeData(osg::Geometry* geom, std::map<std::string, int>& target);
+        void createBlendshapeData(osg::Geometry* geom, const std::map<std::string, int>& target);
         void applyBlendshapeWeights(osg::Geode* geode, const std::vector<double>& weights,
                                     const tinygltf::Value& targetNames);
 
-        inline void copyBufferData(void* dst, const void* src, size_t size,
+        void decodeImages();
+        void decodeMeshoptBuffers();
+        osg::Array* createQuantizedArray(const tinygltf::Accessor& accessor,
+                                         const unsigned char* src, size_t stride);
+        osg::Array* createDequantizedArray(const tinygltf::Accessor& accessor,
+                                           const unsigned char* src, size_t stride);
+
+        template<size_t N> static void copyStridedData(void* dst, const void* src,
+                                                       size_t stride, size_t count)
+        {
+            struct Element { char bytes[N]; };
+            Element* out = (Element*)dst; const char* in = (const char*)src;
+            for (size_t i = 0; i < count; ++i, in += stride) memcpy(out + i, in, N);
+        }
+
+        static void copyBufferData(void* dst, const void* src, size_t size,
                                    size_t stride, size_t count)
         {
             if (stride > 0 && count > 0)
             {
+                // De-interleave with fixed element sizes, so that per-element copies are inlined
                 size_t elemSize = size / count;
-                for (size_t i = 0; i < count; ++i)
-                    memcpy((char*)dst + i * elemSize, (const char*)src + i * stride, elemSize);
+                switch (elemSize)
+                {
+                case 1: copyStridedData<1>(dst, src, stride, count); break;
+                case 2: copyStridedData<2>(dst, src, stride, count); break;
+                case 4: copyStridedData<4>(dst, src, stride, count); break;
+                case 8: copyStridedData<8>(dst, src, stride, count); break;
+                case 12: copyStridedData<12>(dst, src, stride, count); break;
+                case 16: copyStridedData<16>(dst, src, stride, count); break;
+                case 64: copyStridedData<64>(dst, src, stride, count); break;
+                default:
+                    for (size_t i = 0; i < count; ++i)
+                        memcpy((char*)dst + i * elemSize, (const char*)src + i * stride, elemSize);
+                    break;
+                }
             }
             else
                 memcpy(dst, src, size);
         }
 
+        /** Fill an OSG array (or std::vector) from accessor data. Tightly packed data is assigned
+            directly from the buffer range without zero-filling the array first */
+        template<typename ArrayType>
+        static void assignBufferData(ArrayType& arr, const unsigned char* src,
+                                     size_t count, size_t stride)
+        {
+            typedef typename ArrayType::value_type ValueType;
+            if (stride > 0 && stride != sizeof(ValueType))
+            {
+                arr.resize(count);
+                copyBufferData(&arr[0], src, count * sizeof(ValueType), stride, count);
+            }
+            else
+            { const ValueType* ptr = (const ValueType*)src; arr.assign(ptr, ptr + count); }
+        }
+
+        template<typename ArrayType>
+        static ArrayType* createArray(const unsigned char* src, size_t count,
+                                      size_t stride, bool normalized)
+        {
+            ArrayType* arr = new ArrayType; assignBufferData(*arr, src, count, stride);
+#if OSG_VERSION_GREATER_THAN(3, 1, 8)
+            arr->setNormalize(normalized);
+#endif
+            return arr;
+        }
+
         std::map<int, osg::observer_ptr<osg::Image>> _imageMap;
         std::map<int, osg::Node*> _nodeCreationMap;
         std::vector<DeferredMeshData> _deferredMeshList;
@@ -75,11 +134,20 @@ namespace osgVerse
         osg::ref_ptr<osg::NodeCallback> _rtcCenterCallback;
         tinygltf::Model _modelDef;
         std::string _workingDir;
-        bool _usingMaterialPBR;
+        bool _usingMaterialPBR, _keepQuantized;
     };
 
     OSGVERSE_RW_EXPORT osg::ref_ptr<osg::Group> loadGltf(
-        const std::string& file, bool isBinary, bool usingPBR = true);
+        const std::string& file, bool isBinary, bool usingPBR = true, bool keepQuantized = false);
     OSGVERSE_RW_EXPORT osg::ref_ptr<osg::Group> loadGltf2(
-        std::istream& in, const std::string& dir, bool isBinary, bool usingPBR = true);
+        std::istream& in, const std::string& dir, bool isBinary, bool usingPBR = true,
+        bool keepQuantized = false);
+
+    /** Load 3D Tiles binary content (b3dm, i3dm, pnts or cmpt) from fetched bytes.
+        Batch table of b3dm/i3dm is kept as user values "BatchLength" and "BatchTable" (JSON string).
+        i3dm instances are drawn in one instanced call (uniform "InstancedDraw" of standard shaders) */
+    OSGVERSE_RW_EXPORT osg::ref_ptr<osg::Node> loadTileContent(
+        const char* data, size_t size, const std::string& dir, bool usingPBR = true);
+    OSGVERSE_RW_EXPORT osg::ref_ptr<osg::Node> loadTileContent(
+        std::istream& in, const std::string& dir, bool usingPBR = true);
 }
@@ -0,0 +1,553 @@
+#include <osg/io_utils>
+#include <osg/ValueObject>
+#include <osg/Geometry>
+#include <osg/Geode>
+#include <osg/MatrixTransform>
+#include <osg/CoordinateSystemNode>
+#include <osg/VertexAttribDivisor>
+#include <osgDB/FileNameUtils>
+#include <picojson.h>
+#include <map>
+#include <set>
+#include "pipeline/Global.h"
+#include "LoadSceneGLTF.h"
+
+namespace osgVerse
+{
+    /** Read-only stream buffer over fetched data, avoiding a std::stringstream copy of it.
+        Note that the GLTF loader still copies the body into its own buffer when parsing */
+    class MemoryStreamBuffer : public std::streambuf
+    {
+    public:
+        MemoryStreamBuffer(const char* data, size_t size)
+        { char* ptr = const_cast<char*>(data); setg(ptr, ptr, ptr + size); }
+
+    protected:
+        virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode)
+        {
+            char* ptr = (dir == std::ios_base::beg) ? eback()
+                      : ((dir == std::ios_base::end) ? egptr() : gptr());
+            ptr += off; if (ptr < eback() || ptr > egptr()) return pos_type(off_type(-1));
+            setg(eback(), ptr, egptr()); return pos_type(ptr - eback());
+        }
+
+        virtual pos_type seekpos(pos_type pos, std::ios_base::openmode mode)
+        { return seekoff(off_type(pos), std::ios_base::beg, mode); }
+    };
+
+    /** Header of b3dm / i3dm / pnts, which only differ in the i3dm gltfFormat field */
+    struct TileHeader
+    {
+        unsigned int byteLength, featureJson, featureBinary, batchJson, batchBinary, gltfFormat;
+        size_t headerSize, bodyOffset;
+
+        bool read(const char* data, size_t size, bool withGltfFormat)
+        {
+            unsigned int values[8] = { 0 };
+            headerSize = (withGltfFormat ? 8 : 7) * sizeof(unsigned int);
+            if (size < headerSize) return false; memcpy(values, data, headerSize);
+            byteLength = values[2]; featureJson = values[3]; featureBinary = values[4];
+            batchJson = values[5]; batchBinary = values[6]; gltfFormat = values[7];
+            bodyOffset = headerSize + featureJson + featureBinary + batchJson + batchBinary;
+            return bodyOffset <= size;
+        }
+
+        const char* batchTable(const char* data) const
+        { return data + headerSize + featureJson + featureBinary; }
+    };
+
+    /** Feature table: JSON header with global values, and binary body with per-feature arrays */
+    class TileFeatureTable
+    {
+    public:
+        TileFeatureTable(const char* data, const TileHeader& h)
+        :   _binary((const unsigned char*)data + h.headerSize + h.featureJson),
+            _binarySize(h.featureBinary)
+        {
+            std::string err;
+            if (h.featureJson > 0)
+                err = picojson::parse(_json, std::string(data + h.headerSize, h.featureJson));
+            if (!err.empty()) OSG_WARN << "[LoaderTiles] Bad feature table: " << err << std::endl;
+            if (!_json.is<picojson::object>()) _json = picojson::value(picojson::object());
+        }
+
+        /** Binary property of 'count' elements with 'elementSize' bytes each, or NULL */
+        const unsigned char* getBinary(const std::string& name, size_t elementSize,
+                                       size_t count) const
+        {
+            const picojson::value& v = _json.get(name);
+            if (!v.is<picojson::object>() || !v.get("byteOffset").is<double>()) return NULL;
+            size_t offset = (size_t)v.get("byteOffset").get<double>();
+            if (offset + elementSize * count > _binarySize) return NULL;
+            return _binary + offset;
+        }
+
+        std::string getComponentType(const std::string& name, const std::string& defType) const
+        {
+            const picojson::value& v = _json.get(name);
+            if (!v.is<picojson::object>() || !v.get("componentType").is<std::string>()) return defType;
+            return v.get("componentType").get<std::string>();
+        }
+
+        double getNumber(const std::string& name, double defValue) const
+        {
+            const picojson::value& v = _json.get(name);
+            if (v.is<double>()) return v.get<double>();
+            else if (v.is<bool>()) return v.get<bool>() ? 1.0 : 0.0;
+
+            const unsigned char* ptr = getBinary(name, sizeof(unsigned int), 1);
+            if (ptr) { unsigned int n = 0; memcpy(&n, ptr, sizeof(unsigned int)); return n; }
+            return defValue;
+        }
+
+        bool getVector(const std::string& name, double* values, int num) const
+        {
+            const picojson::value& v = _json.get(name);
+            if (v.is<picojson::array>())
+            {
+                const picojson::array& arr = v.get<picojson::array>();
+                if (arr.size() < (size_t)num) return false;
+                for (int i = 0; i < num; ++i)
+                    values[i] = arr[i].is<double>() ? arr[i].get<double>() : 0.0;
+                return true;
+            }
+
+            const float* ptr = (const float*)getBinary(name, sizeof(float) * num, 1);
+            if (ptr) { for (int i = 0; i < num; ++i) values[i] = ptr[i]; return true; }
+            return false;
+        }
+
+        bool getVec3(const std::string& name, osg::Vec3d& out) const
+        { return getVector(name, out.ptr(), 3); }
+
+        unsigned int getBatchId(const unsigned char* ptr, const std::string& type, size_t i) const
+        {
+            if (type == "UNSIGNED_BYTE") return ptr[i];
+            else if (type == "UNSIGNED_INT") return ((const unsigned int*)ptr)[i];
+            return ((const unsigned short*)ptr)[i];
+        }
+
+    protected:
+        picojson::value _json;
+        const unsigned char* _binary;
+        size_t _binarySize;
+    };
+
+    /** 3D Tiles use Z-up coordinates while the GLTF loader keeps Y-up ones: (x, y, z) -> (x, z, -y) */
+    static const osg::Matrixd zUpToYUp(1.0, 0.0, 0.0, 0.0,  0.0, 0.0, -1.0, 0.0,
+                                       0.0, 1.0, 0.0, 0.0,  0.0, 0.0, 0.0, 1.0);
+    static const osg::Matrixd yUpToZUp(1.0, 0.0, 0.0, 0.0,  0.0, 0.0, 1.0, 0.0,
+                                       0.0, -1.0, 0.0, 0.0,  0.0, 0.0, 0.0, 1.0);
+
+    static osg::Vec3 decodeOctNormal(float x, float y)
+    {
+        // Oct-encoded values in [-1, 1]: https://jcgt.org/published/0003/02/01/
+        osg::Vec3 n(x, y, 1.0f - fabs(x) - fabs(y));
+        if (n.z() < 0.0f)
+        {
+            float ox = n.x();
+            n.x() = (1.0f - fabs(n.y())) * (ox >= 0.0f ? 1.0f : -1.0f);
+            n.y() = (1.0f - fabs(ox)) * (n.y() >= 0.0f ? 1.0f : -1.0f);
+        }
+        n.normalize(); return n;
+    }
+
+    static void applyBatchTable(osg::Node* node, const char* json, size_t size, double length)
+    {
+        if (length > 0.0) node->setUserValue("BatchLength", (int)length);
+        if (size > 0)
+        {
+            std::string batchTable(json, json + size);
+            size_t end = batchTable.find_last_not_of(std::string(" \0", 2));
+            if (end != std::string::npos) batchTable.resize(end + 1);
+            node->setUserValue("BatchTable", batchTable);
+        }
+    }
+
+    static osg::Node* loadB3dm(const char* data, size_t size, const std::string& dir, bool pbr)
+    {
+        TileHeader header; if (!header.read(data, size, false)) return NULL;
+        TileFeatureTable features(data, header);
+        const char* body = data + header.bodyOffset;
+        size_t bodySize = size - header.bodyOffset;
+
+        // GLTF 1.0 bodies are handled by the loader itself (including RTC_CENTER)
+        unsigned int version = 2; bool legacyBody = false;
+        if (bodySize > 8) { memcpy(&version, body + 4, sizeof(int)); legacyBody = (version < 2); }
+
+        MemoryStreamBuffer buffer(legacyBody ? data : body, legacyBody ? size : bodySize);
+        std::istream in(&buffer);
+        osg::ref_ptr<osg::Group> root = loadGltf2(in, dir, true, pbr);
+        if (!root) return NULL;
+
+        osg::Vec3d rtc;
+        if (!legacyBody && features.getVec3("RTC_CENTER", rtc))
+        {
+            osg::MatrixTransform* mt = new osg::MatrixTransform;
+            mt->setMatrix(osg::Matrix::translate(osg::Vec3d(rtc.x(), rtc.z(), -rtc.y())));
+            mt->addChild(root.get()); root = mt;
+        }
+        applyBatchTable(root.get(), header.batchTable(data), header.batchJson,
+                        features.getNumber("BATCH_LENGTH", 0.0));
+        return root.release();
+    }
+
+    /** Makes geometries of the i3dm model instanced, with per-instance matrix rows at attribute
+        12-15. Transforms inside the model are still applied when drawing, so for a geometry
+        under transform N, instance matrix M is set as N * M * N^-1 to keep the original order */
+    class InstancedGeometryVisitor : public osg::NodeVisitor
+    {
+    public:
+        InstancedGeometryVisitor(const std::vector<osg::Matrixd>& matrices)
+        :   osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN), _matrices(matrices) {}
+
+        virtual void apply(osg::Geode& node)
+        {
+            osg::Matrixd parent = osg::computeLocalToWorld(getNodePath());
+            for (unsigned int i = 0; i < node.getNumDrawables(); ++i)
+            {
+                osg::Geometry* geom = node.getDrawable(i)->asGeometry();
+                if (!geom) continue;
+                if (_geometries.find(geom) != _geometries.end())
+                {
+                    // Shared geometry may be under another transform, so it can't share arrays
+                    geom = static_cast<osg::Geometry*>(geom->clone(osg::CopyOp::SHALLOW_COPY));
+                    node.setDrawable(i, geom);
+                }
+                applyInstances(*geom, parent); _geometries.insert(geom);
+            }
+        }
+
+    protected:
+        struct InstanceData
+        {
+            std::vector<osg::Matrixf> matrices;
+            osg::ref_ptr<osg::Vec4Array> rows[4];
+        };
+
+        void applyInstances(osg::Geometry& geom, const osg::Matrixd& parent)
+        {
+            InstanceData& data = _instanceData[parent];
+            if (data.matrices.empty())
+            {
+                osg::Matrixd invParent = osg::Matrixd::inverse(parent);
+                for (int k = 0; k < 4; ++k) data.rows[k] = new osg::Vec4Array(_matrices.size());
+                for (size_t i = 0; i < _matrices.size(); ++i)
+                {
+                    osg::Matrixf m = parent * _matrices[i] * invParent;
+                    data.matrices.push_back(m);
+                    for (int k = 0; k < 4; ++k)
+                        (*data.rows[k])[i].set(m(k, 0), m(k, 1), m(k, 2), m(k, 3));
+                }
+            }
+
+            for (int k = 0; k < 4; ++k)
+            {
+                geom.setVertexAttribArray(instanceAttributeLocation + k, data.rows[k].get());
+                geom.setVertexAttribBinding(instanceAttributeLocation + k,
+                                            osg::Geometry::BIND_PER_VERTEX);
+                geom.setVertexAttribNormalize(instanceAttributeLocation + k, false);
+            }
+
+            for (unsigned int i = 0; i < geom.getNumPrimitiveSets(); ++i)
+            {
+                osg::PrimitiveSet* p = geom.getPrimitiveSet(i);
+                p->setNumInstances(data.matrices.size()); p->dirty();
+            }
+            geom.setUseDisplayList(false);
+            geom.setUseVertexBufferObjects(true);
+
+            // Culling must see all instances, not only the model at the origin
+            osg::BoundingBox bb0 = geom.getBoundingBox(), bb;
+            for (size_t i = 0; i < data.matrices.size(); ++i)
+            {
+                for (int c = 0; c < 8; ++c)
+                    bb.expandBy(bb0.corner(c) * data.matrices[i]);
+            }
+            geom.setInitialBound(bb); geom.dirtyBound();
+        }
+
+        std::vector<osg::Matrixd> _matrices;
+        std::map<osg::Matrixd, InstanceData> _instanceData;
+        std::set<osg::Geometry*> _geometries;
+    };
+
+    static osg::Node* loadI3dm(const char* data, size_t size, const std::string& dir, bool pbr)
+    {
+        TileHeader header; if (!header.read(data, size, true)) return NULL;
+        TileFeatureTable features(data, header);
+        size_t numInstances = (size_t)features.getNumber("INSTANCES_LENGTH", 0.0);
+        if (numInstances == 0) return NULL;
+
+        // The instanced model is loaded once and shared by all instances
+        const char* body = data + header.bodyOffset;
+        size_t bodySize = size - header.bodyOffset;
+        osg::ref_ptr<osg::Group> model;
+        if (header.gltfFormat == 0)
+        {
+            std::string uri(body, body + bodySize);
+            size_t end = uri.find_last_not_of(std::string(" \0", 2));
+            uri = (end != std::string::npos) ? uri.substr(0, end + 1) : "";
+            if (!uri.empty() && !osgDB::isAbsolutePath(uri)) uri = osgDB::concatPaths(dir, uri);
+            model = loadGltf(uri, osgDB::getLowerCaseFileExtension(uri) != "gltf", pbr);
+        }
+        else
+        {
+            MemoryStreamBuffer buffer(body, bodySize); std::istream in(&buffer);
+            model = loadGltf2(in, dir, true, pbr);
+        }
+        if (!model) return NULL;
+
+        osg::Vec3d rtc, qOffset, qScale; features.getVec3("RTC_CENTER", rtc);
+        const float* positions = (const float*)features.getBinary(
+            "POSITION", sizeof(float) * 3, numInstances);
+        const unsigned short* qPositions = (const unsigned short*)features.getBinary(
+            "POSITION_QUANTIZED", sizeof(short) * 3, numInstances);
+        if (!features.getVec3("QUANTIZED_VOLUME_OFFSET", qOffset) ||
+            !features.getVec3("QUANTIZED_VOLUME_SCALE", qScale)) qPositions = NULL;
+        if (!positions && !qPositions)
+        {
+            OSG_WARN << "[LoaderTiles] Missing instance positions in i3dm" << std::endl;
+            return NULL;
+        }
+
+        const float* normalUp = (const float*)features.getBinary(
+            "NORMAL_UP", sizeof(float) * 3, numInstances);
+        const float* normalRight = (const float*)features.getBinary(
+            "NORMAL_RIGHT", sizeof(float) * 3, numInstances);
+        const unsigned short* octUp = (const unsigned short*)features.getBinary(
+            "NORMAL_UP_OCT32P", sizeof(short) * 2, numInstances);
+        const unsigned short* octRight = (const unsigned short*)features.getBinary(
+            "NORMAL_RIGHT_OCT32P", sizeof(short) * 2, numInstances);
+        const float* scales = (const float*)features.getBinary("SCALE", sizeof(float), numInstances);
+        const float* scales3 = (const float*)features.getBinary(
+            "SCALE_NON_UNIFORM", sizeof(float) * 3, numInstances);
+        bool eastNorthUp = features.getNumber("EAST_NORTH_UP", 0.0) > 0.0;
+
+        std::string batchType = features.getComponentType("BATCH_ID", "UNSIGNED_SHORT");
+        size_t batchSize = (batchType == "UNSIGNED_BYTE") ? 1 : ((batchType == "UNSIGNED_INT") ? 4 : 2);
+        const unsigned char* batchIds = features.getBinary("BATCH_ID", batchSize, numInstances);
+
+        // Instance matrices are kept relative to the first instance, to keep float precision
+        std::vector<osg::Matrixd> matrices(numInstances);
+        osg::ref_ptr<osg::UIntArray> batchIdArray = new osg::UIntArray(numInstances);
+        osg::ref_ptr<osg::EllipsoidModel> ellipsoid = new osg::EllipsoidModel;
+        osg::Vec3d center;
+        for (size_t i = 0; i < numInstances; ++i)
+        {
+            osg::Vec3d pos = rtc;
+            if (positions) pos += osg::Vec3d(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+            else pos += qOffset + osg::Vec3d(qPositions[i * 3] * qScale[0], qPositions[i * 3 + 1] * qScale[1],
+                                             qPositions[i * 3 + 2] * qScale[2]) / 65535.0;
+
+            osg::Vec3d up(0.0, 1.0, 0.0), right(1.0, 0.0, 0.0);
+            if (normalUp && normalRight)
+            {
+                up.set(normalUp[i * 3], normalUp[i * 3 + 1], normalUp[i * 3 + 2]);
+                right.set(normalRight[i * 3], normalRight[i * 3 + 1], normalRight[i * 3 + 2]);
+            }
+            else if (octUp && octRight)
+            {
+                up = decodeOctNormal(octUp[i * 2] / 32767.5f - 1.0f, octUp[i * 2 + 1] / 32767.5f - 1.0f);
+                right = decodeOctNormal(octRight[i * 2] / 32767.5f - 1.0f,
+                                        octRight[i * 2 + 1] / 32767.5f - 1.0f);
+            }
+            else if (eastNorthUp)
+            {
+                osg::Matrixd enu;
+                ellipsoid->computeLocalToWorldTransformFromXYZ(pos.x(), pos.y(), pos.z(), enu);
+                right.set(enu(0, 0), enu(0, 1), enu(0, 2)); up.set(enu(1, 0), enu(1, 1), enu(1, 2));
+            }
+
+            osg::Vec3d scale(1.0, 1.0, 1.0), forward = right ^ up;
+            if (scales3) scale.set(scales3[i * 3], scales3[i * 3 + 1], scales3[i * 3 + 2]);
+            if (scales) scale *= scales[i];
+
+            // Instance frame is defined in Z-up space, while the model itself is Y-up
+            if (i == 0) center = pos;
+            osg::Matrixd local = osg::Matrixd::scale(scale) * osg::Matrixd(
+                right.x(), right.y(), right.z(), 0.0, up.x(), up.y(), up.z(), 0.0,
+                forward.x(), forward.y(), forward.z(), 0.0, pos.x(), pos.y(), pos.z(), 1.0);
+            matrices[i] = yUpToZUp * local * osg::Matrixd::translate(-center) * zUpToYUp;
+            (*batchIdArray)[i] = batchIds ? features.getBatchId(batchIds, batchType, i) : (unsigned int)i;
+        }
+
+        // All instances are drawn by one instanced call per geometry of the shared model
+        InstancedGeometryVisitor igv(matrices); model->accept(igv);
+        osg::StateSet* ss = model->getOrCreateStateSet();
+        for (int k = 0; k < 4; ++k)
+            ss->setAttributeAndModes(new osg::VertexAttribDivisor(instanceAttributeLocation + k, 1));
+        ss->addUniform(new osg::Uniform("InstancedDraw", true));
+
+        batchIdArray->setName("BatchId");
+        model->getOrCreateUserDataContainer()->addUserObject(batchIdArray.get());
+
+        osg::ref_ptr<osg::MatrixTransform> root = new osg::MatrixTransform;
+        root->setMatrix(osg::Matrixd::translate(center * zUpToYUp));
+        root->addChild(model.get());
+
+        applyBatchTable(root.get(), header.batchTable(data), header.batchJson,
+                        features.getNumber("BATCH_LENGTH", (double)numInstances));
+        return root.release();
+    }
+
+    static osg::Node* loadPnts(const char* data, size_t size)
+    {
+        TileHeader header; if (!header.read(data, size, false)) return NULL;
+        TileFeatureTable features(data, header);
+        size_t numPoints = (size_t)features.getNumber("POINTS_LENGTH", 0.0);
+        if (numPoints == 0) return NULL;
+
+        // Quantized positions are decoded relative to the volume offset, kept in the transform
+        osg::Vec3d rtc, qOffset, qScale; features.getVec3("RTC_CENTER", rtc);
+        osg::ref_ptr<osg::Vec3Array> va = new osg::Vec3Array(numPoints);
+        const float* positions = (const float*)features.getBinary(
+            "POSITION", sizeof(float) * 3, numPoints);
+        const unsigned short* qPositions = (const unsigned short*)features.getBinary(
+            "POSITION_QUANTIZED", sizeof(short) * 3, numPoints);
+        if (positions)
+            memcpy(&(*va)[0], positions, sizeof(float) * 3 * numPoints);
+        else if (qPositions && features.getVec3("QUANTIZED_VOLUME_OFFSET", qOffset) &&
+                 features.getVec3("QUANTIZED_VOLUME_SCALE", qScale))
+        {
+            osg::Vec3 s = qScale / 65535.0; rtc += qOffset;
+            for (size_t i = 0; i < numPoints; ++i, qPositions += 3)
+                (*va)[i].set(qPositions[0] * s[0], qPositions[1] * s[1], qPositions[2] * s[2]);
+        }
+        else
+        {
+            OSG_WARN << "[LoaderTiles] Missing point positions in pnts" << std::endl;
+            return NULL;
+        }
+
+        osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
+        geom->setUseDisplayList(false);
+        geom->setUseVertexBufferObjects(true);
+        geom->setVertexArray(va.get());
+
+        const unsigned char* rgba = features.getBinary("RGBA", 4, numPoints);
+        const unsigned char* rgb = features.getBinary("RGB", 3, numPoints);
+        const unsigned short* rgb565 = (const unsigned short*)features.getBinary(
+            "RGB565", sizeof(short), numPoints);
+        double constantColor[4] = { 255.0, 255.0, 255.0, 255.0 };
+        if (rgba || rgb || rgb565)
+        {
+            osg::Vec4ubArray* ca = new osg::Vec4ubArray(numPoints);
+            if (rgba) memcpy(&(*ca)[0], rgba, 4 * numPoints);
+            else if (rgb)
+            {
+                for (size_t i = 0; i < numPoints; ++i, rgb += 3)
+                    (*ca)[i].set(rgb[0], rgb[1], rgb[2], 255);
+            }
+            else
+            {
+                for (size_t i = 0; i < numPoints; ++i)
+                {
+                    unsigned short c = rgb565[i];
+                    (*ca)[i].set((unsigned char)(((c >> 11) & 0x1f) * 255 / 31),
+                                 (unsigned char)(((c >> 5) & 0x3f) * 255 / 63),
+                                 (unsigned char)((c & 0x1f) * 255 / 31), 255);
+                }
+            }
+#if OSG_VERSION_GREATER_THAN(3, 1, 8)
+            ca->setNormalize(true);
+#endif
+            geom->setColorArray(ca); geom->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+        }
+        else if (features.getVector("CONSTANT_RGBA", constantColor, 4))
+        {
+            osg::Vec4Array* ca = new osg::Vec4Array(1);
+            (*ca)[0].set(constantColor[0] / 255.0, constantColor[1] / 255.0,
+                         constantColor[2] / 255.0, constantColor[3] / 255.0);
+            geom->setColorArray(ca); geom->setColorBinding(osg::Geometry::BIND_OVERALL);
+        }
+
+        const float* normals = (const float*)features.getBinary("NORMAL", sizeof(float) * 3, numPoints);
+        const unsigned char* octNormals = features.getBinary("NORMAL_OCT16P", 2, numPoints);
+        if (normals || octNormals)
+        {
+            osg::Vec3Array* na = new osg::Vec3Array(numPoints);
+            if (normals) memcpy(&(*na)[0], normals, sizeof(float) * 3 * numPoints);
+            else
+            {
+                for (size_t i = 0; i < numPoints; ++i, octNormals += 2)
+                    (*na)[i] = decodeOctNormal(octNormals[0] / 127.5f - 1.0f, octNormals[1] / 127.5f - 1.0f);
+            }
+            geom->setNormalArray(na); geom->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+        }
+
+        std::string batchType = features.getComponentType("BATCH_ID", "UNSIGNED_SHORT");
+        size_t batchSize = (batchType == "UNSIGNED_BYTE") ? 1 : ((batchType == "UNSIGNED_INT") ? 4 : 2);
+        const unsigned char* batchIds = features.getBinary("BATCH_ID", batchSize, numPoints);
+        if (batchIds)
+        {
+            osg::FloatArray* ba = new osg::FloatArray(numPoints);
+            for (size_t i = 0; i < numPoints; ++i)
+                (*ba)[i] = (float)features.getBatchId(batchIds, batchType, i);
+            ba->setName("BatchId"); geom->setVertexAttribArray(7, ba);
+            geom->setVertexAttribBinding(7, osg::Geometry::BIND_PER_VERTEX);
+        }
+        geom->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, 0, numPoints));
+
+        osg::Geode* geode = new osg::Geode; geode->addDrawable(geom.get());
+        osg::MatrixTransform* root = new osg::MatrixTransform;
+        root->setMatrix(osg::Matrixd::translate(rtc) * zUpToYUp);
+        root->addChild(geode);
+        applyBatchTable(root, header.batchTable(data), header.batchJson,
+                        features.getNumber("BATCH_LENGTH", 0.0));
+        return root;
+    }
+
+    static osg::Node* loadCmpt(const char* data, size_t size, const std::string& dir, bool pbr)
+    {
+        unsigned int header[4] = { 0 };
+        if (size < sizeof(header)) return NULL; memcpy(header, data, sizeof(header));
+
+        osg::ref_ptr<osg::Group> group = new osg::Group;
+        size_t offset = sizeof(header);
+        for (unsigned int t = 0; t < header[3] && offset + 12 <= size; ++t)
+        {
+            unsigned int innerLength = 0; memcpy(&innerLength, data + offset + 8, sizeof(int));
+            if (innerLength < 12 || offset + innerLength > size) break;
+
+            osg::ref_ptr<osg::Node> child = loadTileContent(data + offset, innerLength, dir, pbr);
+            if (child.valid()) group->addChild(child.get());
+            offset += innerLength;
+        }
+        return group->getNumChildren() > 0 ? group.release() : NULL;
+    }
+
+    osg::ref_ptr<osg::Node> loadTileContent(const char* data, size_t size,
+                                            const std::string& dir, bool usingPBR)
+    {
+        if (size < 4) return NULL;
+        std::string magic(data, data + 4);
+        if (magic == "b3dm") return loadB3dm(data, size, dir, usingPBR);
+        else if (magic == "i3dm") return loadI3dm(data, size, dir, usingPBR);
+        else if (magic == "pnts") return loadPnts(data, size);
+        else if (magic == "cmpt") return loadCmpt(data, size, dir, usingPBR);
+        else if (magic == "glTF")
+        {
+            MemoryStreamBuffer buffer(data, size); std::istream in(&buffer);
+            return loadGltf2(in, dir, true, usingPBR).get();
+        }
+
+        OSG_NOTICE << "[LoaderTiles] Unknown tile format: " << magic << std::endl;
+        return NULL;
+    }
+
+    osg::ref_ptr<osg::Node> loadTileContent(std::istream& in, const std::string& dir, bool usingPBR)
+    {
+        std::vector<char> data; std::streampos start = in.tellg();
+        if (start >= 0 && in.seekg(0, std::ios::end))
+        {
+            std::streamoff length = in.tellg() - start; in.seekg(start);
+            if (length > 0)
+            { data.resize((size_t)length); in.read(&data[0], length); data.resize(in.gcount()); }
+        }
+        else
+            { in.clear(); data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()); }
+        if (data.empty()) return NULL;
+        return loadTileContent(&data[0], data.size(), dir, usingPBR);
+    }
+}
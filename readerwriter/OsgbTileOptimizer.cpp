@@ -689,9 +689,11 @@ osg::Node* TileOptimizer::mergeGeometries(const std::vector<std::pair<osg::Geome
         GeometryMerger merger(_withGpuBaker ? GeometryMerger::GPU_BAKING : GeometryMerger::COMBINED_GEOMETRY);
         if (_withGpuBaker) merger.setGpkBaker(new DefaultGpuBaker);
 
-        osg::ref_ptr<osg::Geometry> result = merger.process(geomList, i, 16, highestRes);
-        if (result.valid())
+        std::vector<osg::ref_ptr<osg::Geometry>> results =
+            merger.processPages(geomList, i, 16, highestRes);
+        for (size_t r = 0; r < results.size(); ++r)
         {
+            osg::ref_ptr<osg::Geometry> result = results[r];
             if (simplify && _simplifyRatio > 0.0f)
             {
                 // FIXME: not good to weld vertices, it makes wrong texture mapping
@@ -0,0 +1,275 @@
+#include <osg/Notify>
+#include <osg/ImageStream>
+#include <osg/Geode>
+#include <osg/Texture>
+#include <osgUtil/CullVisitor>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+#include <algorithm>
+#include <stdexcept>
+#include "VideoDecodeScheduler.h"
+using namespace osgVerse;
+
+class VideoDecodeScheduler::Worker : public OpenThreads::Thread
+{
+public:
+    Worker(VideoDecodeScheduler* s) : _scheduler(s) {}
+
+    virtual void run()
+    {
+        bool done = false;
+        while (!done)
+        {
+            Task* task = _scheduler->acquireTask(done);
+            if (!task) continue;
+
+            double waitSeconds = -1.0;
+            try { waitSeconds = task->decode(task->_quality); }
+            catch (const std::exception& e)
+            { OSG_WARN << "[VideoDecodeScheduler] Failed to decode: " << e.what() << std::endl; }
+            _scheduler->releaseTask(task, waitSeconds);
+        }
+    }
+
+protected:
+    VideoDecodeScheduler* _scheduler;
+};
+
+VideoDecodeScheduler::Task::Task()
+:   _dueTick(0), _reportTick(0), _reportFrame(0), _screenSize(0.0f), _quality(DECODE_FULL),
+    _pending(true), _timed(false), _running(false) {}
+
+VideoDecodeScheduler* VideoDecodeScheduler::instance()
+{
+    static osg::ref_ptr<VideoDecodeScheduler> s_instance = new VideoDecodeScheduler;
+    return s_instance.get();
+}
+
+VideoDecodeScheduler::VideoDecodeScheduler()
+:   _roundRobin(0), _tinyScreenSize(64.0f), _hiddenTimeout(0.5), _done(false)
+{
+    _numWorkers = OpenThreads::GetNumberOfProcessors() - 1;
+    if (_numWorkers < 1) _numWorkers = 1;
+}
+
+VideoDecodeScheduler::~VideoDecodeScheduler()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _done = true; _condition.broadcast();
+    }
+
+    for (size_t i = 0; i < _workers.size(); ++i)
+    { _workers[i]->join(); delete _workers[i]; }
+}
+
+void VideoDecodeScheduler::setNumWorkers(int n)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _numWorkers = osg::maximum(n, 1);
+    if (!_workers.empty()) startWorkers();  // grow only, existing workers are kept
+}
+
+void VideoDecodeScheduler::addTask(Task* task, osg::Image* output)
+{
+    if (!task) return;
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    if (std::find(_tasks.begin(), _tasks.end(), task) == _tasks.end())
+        _tasks.push_back(task);
+    if (output != NULL) bindOutput(output, task);
+
+    startWorkers();
+    task->_pending = true; _condition.broadcast();
+}
+
+void VideoDecodeScheduler::bindImage(osg::Image* output, Task* task)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    if (output != NULL) bindOutput(output, task);
+}
+
+void VideoDecodeScheduler::bindOutput(osg::Image* output, Task* task)
+{
+    // Drop entries of deleted images first, they can never be reported again
+    for (OutputMap::iterator itr = _outputs.begin(); itr != _outputs.end();)
+    {
+        if (!itr->first.valid()) _outputs.erase(itr++);
+        else ++itr;
+    }
+    _outputs[osg::observer_ptr<const osg::Image>(output)] = task;
+}
+
+void VideoDecodeScheduler::removeTask(Task* task)
+{
+    if (!task) return;
+    osg::ref_ptr<Task> keeper = task;  // may be the last reference
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    while (task->_running) _condition.wait(&_mutex);
+
+    std::vector<osg::ref_ptr<Task>>::iterator itr = std::find(_tasks.begin(), _tasks.end(), task);
+    if (itr != _tasks.end()) _tasks.erase(itr);
+    for (OutputMap::iterator it2 = _outputs.begin(); it2 != _outputs.end();)
+    {
+        if (it2->second == task) _outputs.erase(it2++);
+        else ++it2;
+    }
+}
+
+void VideoDecodeScheduler::notify(Task* task)
+{
+    if (!task) return;
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    task->_pending = true; _condition.broadcast();
+}
+
+void VideoDecodeScheduler::reportScreenSize(const osg::Image* output, float pixelSize,
+                                            unsigned int frameNumber)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    OutputMap::iterator itr = _outputs.find(osg::observer_ptr<const osg::Image>(output));
+    if (itr == _outputs.end()) return;
+
+    // Keep the largest size from all cameras / instances within the same frame
+    Task* task = itr->second;
+    if (task->_reportTick == 0 || task->_reportFrame != frameNumber) task->_screenSize = pixelSize;
+    else task->_screenSize = osg::maximum(task->_screenSize, pixelSize);
+    task->_reportTick = osg::Timer::instance()->tick(); task->_reportFrame = frameNumber;
+}
+
+VideoDecodeScheduler::DecodeQuality VideoDecodeScheduler::computeQuality(
+        const Task* task, osg::Timer_t now) const
+{
+    if (task->_reportTick == 0) return DECODE_FULL;  // no VideoCullCallback for this stream
+    if (osg::Timer::instance()->delta_s(task->_reportTick, now) > _hiddenTimeout) return DECODE_HIDDEN;
+    return (task->_screenSize < _tinyScreenSize) ? DECODE_REDUCED : DECODE_FULL;
+}
+
+VideoDecodeScheduler::Task* VideoDecodeScheduler::acquireTask(bool& done)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    while (!_done)
+    {
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        Task* best = NULL; double nearestDue = -1.0;
+        size_t numTasks = _tasks.size(), start = numTasks > 0 ? (_roundRobin++ % numTasks) : 0;
+        for (size_t n = 0; n < numTasks; ++n)
+        {
+            // Start from a rotating index so that equal streams are served in turn
+            Task* task = _tasks[(start + n) % numTasks].get();
+            if (task->_running) continue;
+            if (!task->_pending && !(task->_timed && now >= task->_dueTick))
+            {
+                if (task->_timed)
+                {
+                    double due = osg::Timer::instance()->delta_s(now, task->_dueTick);
+                    if (nearestDue < 0.0 || due < nearestDue) nearestDue = due;
+                }
+                continue;
+            }
+
+            task->_quality = computeQuality(task, now);
+            if (!best || task->_quality < best->_quality ||
+                (task->_quality == best->_quality && task->_screenSize > best->_screenSize))
+                best = task;
+        }
+
+        if (best != NULL)
+        {
+            best->_running = true; best->_pending = false; best->_timed = false;
+            return best;
+        }
+        else if (nearestDue < 0.0) _condition.wait(&_mutex);
+        else _condition.wait(&_mutex, (unsigned long)(nearestDue * 1000.0) + 1);
+    }
+    done = true; return NULL;
+}
+
+void VideoDecodeScheduler::releaseTask(Task* task, double waitSeconds)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    task->_running = false;
+    if (waitSeconds >= 0.0)
+    {
+        task->_timed = true; task->_dueTick = osg::Timer::instance()->tick()
+                       + (osg::Timer_t)(waitSeconds / osg::Timer::instance()->getSecondsPerTick());
+    }
+    _condition.broadcast();  // for removeTask() and workers waiting on due time
+}
+
+void VideoDecodeScheduler::startWorkers()
+{
+    while ((int)_workers.size() < _numWorkers)
+    {
+        Worker* worker = new Worker(this);
+        worker->start(); _workers.push_back(worker);
+    }
+}
+
+void VideoCullCallback::operator()(osg::Node* node, osg::NodeVisitor* nv)
+{
+    osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+    if (cv != NULL && !_images.empty())
+    {
+        float pixelSize = cv->clampedPixelSize(node->getBound());
+        VideoDecodeScheduler* scheduler = VideoDecodeScheduler::instance();
+        for (size_t i = 0; i < _images.size(); ++i)
+        {
+            if (_images[i].valid())
+                scheduler->reportScreenSize(_images[i].get(), pixelSize, nv->getTraversalNumber());
+        }
+    }
+    traverse(node, nv);
+}
+
+int VideoCullCallback::attach(osg::Node* root)
+{
+    class AttachVisitor : public osg::NodeVisitor
+    {
+    public:
+        AttachVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN), numAdded(0) {}
+        int numAdded;
+
+        virtual void apply(osg::Node& node)
+        {
+            std::vector<osg::Image*> images; findStreams(node.getStateSet(), images);
+            addCallback(node, images); traverse(node);
+        }
+
+        virtual void apply(osg::Geode& node)
+        {
+            std::vector<osg::Image*> images; findStreams(node.getStateSet(), images);
+            for (unsigned int i = 0; i < node.getNumDrawables(); ++i)
+                findStreams(node.getDrawable(i)->getStateSet(), images);
+            addCallback(node, images); traverse(node);
+        }
+
+    protected:
+        void findStreams(osg::StateSet* ss, std::vector<osg::Image*>& images)
+        {
+            if (!ss) return;
+            for (unsigned int u = 0; u < ss->getNumTextureAttributeLists(); ++u)
+            {
+                osg::Texture* tex = static_cast<osg::Texture*>(
+                    ss->getTextureAttribute(u, osg::StateAttribute::TEXTURE));
+                if (!tex) continue;
+                for (unsigned int i = 0; i < tex->getNumImages(); ++i)
+                {
+                    osg::ImageStream* stream = dynamic_cast<osg::ImageStream*>(tex->getImage(i));
+                    if (stream) images.push_back(stream);
+                }
+            }
+        }
+
+        void addCallback(osg::Node& node, const std::vector<osg::Image*>& images)
+        {
+            if (images.empty()) return;
+            VideoCullCallback* cb = new VideoCullCallback;
+            for (size_t i = 0; i < images.size(); ++i) cb->addImage(images[i]);
+            node.addCullCallback(cb); numAdded++;
+        }
+    };
+
+    if (!root) return 0;
+    AttachVisitor av; root->accept(av);
+    return av.numAdded;
+}
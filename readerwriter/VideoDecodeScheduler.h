@@ -0,0 +1,126 @@
+#ifndef MANA_READERWRITER_VIDEODECODESCHEDULER_HPP
+#define MANA_READERWRITER_VIDEODECODESCHEDULER_HPP
+
+#include <osg/Image>
+#include <osg/NodeCallback>
+#include <osg/Timer>
+#include <osg/observer_ptr>
+#include <OpenThreads/Condition>
+#include <OpenThreads/Mutex>
+#include <map>
+#include <vector>
+#include "Export.h"
+
+namespace osgVerse
+{
+
+    /** Bounded worker pool shared by all video streams (FFmpeg, ZLMedia), replacing their own
+        decoding threads. Streams are served by on-screen size reported from VideoCullCallback:
+        hidden streams only decode key frames, tiny ones are decoded at reduced quality */
+    class OSGVERSE_RW_EXPORT VideoDecodeScheduler : public osg::Referenced
+    {
+    public:
+        static VideoDecodeScheduler* instance();
+
+        enum DecodeQuality
+        {
+            DECODE_FULL = 0,  ///< visible, or visibility never reported
+            DECODE_REDUCED,   ///< smaller than tiny screen size: lower resolution / drop frames
+            DECODE_HIDDEN     ///< not reported for a while: key frames only, nothing published
+        };
+
+        class OSGVERSE_RW_EXPORT Task : public osg::Referenced
+        {
+        public:
+            Task();
+
+            /** Decode a small piece of work (normally one packet or frame). Return seconds to wait
+                before being called again, or a negative value to sleep until notify() */
+            virtual double decode(DecodeQuality quality) = 0;
+
+            DecodeQuality getQuality() const { return _quality; }
+            float getScreenSize() const { return _screenSize; }
+
+        protected:
+            friend class VideoDecodeScheduler;
+            osg::Timer_t _dueTick, _reportTick;
+            unsigned int _reportFrame;
+            float _screenSize;
+            DecodeQuality _quality;
+            bool _pending, _timed, _running;
+        };
+
+        /** Add a stream to the pool. Output images are used to match visibility reports */
+        void addTask(Task* task, osg::Image* output = NULL);
+        void bindImage(osg::Image* output, Task* task);
+
+        /** Remove the stream, waiting until no worker is decoding it any more */
+        void removeTask(Task* task);
+
+        /** Wake up the task (e.g. new packet arrived) so a free worker will decode it */
+        void notify(Task* task);
+
+        /** Report projected size (in pixels) of an output image, normally from cull traversal.
+            Reports of the same frame (several cameras / instances) keep the largest size */
+        void reportScreenSize(const osg::Image* output, float pixelSize, unsigned int frameNumber);
+
+        /** Number of worker threads, default to (CPU cores - 1) */
+        void setNumWorkers(int n);
+        int getNumWorkers() const { return _numWorkers; }
+
+        /** Streams smaller than this size (in pixels) are decoded with DECODE_REDUCED */
+        void setTinyScreenSize(float s) { _tinyScreenSize = s; }
+        float getTinyScreenSize() const { return _tinyScreenSize; }
+
+        /** Streams not reported for this period (in seconds) are decoded with DECODE_HIDDEN */
+        void setHiddenTimeout(double t) { _hiddenTimeout = t; }
+        double getHiddenTimeout() const { return _hiddenTimeout; }
+
+    protected:
+        VideoDecodeScheduler();
+        virtual ~VideoDecodeScheduler();
+
+        class Worker;
+        friend class Worker;
+
+        Task* acquireTask(bool& done);
+        void releaseTask(Task* task, double waitSeconds);
+        DecodeQuality computeQuality(const Task* task, osg::Timer_t now) const;
+        void bindOutput(osg::Image* output, Task* task);
+        void startWorkers();
+
+        std::vector<osg::ref_ptr<Task>> _tasks;
+        /// Keyed by observer so that a new image at the address of a deleted one won't match
+        typedef std::map<osg::observer_ptr<const osg::Image>, Task*> OutputMap;
+        OutputMap _outputs;
+        std::vector<Worker*> _workers;
+        OpenThreads::Mutex _mutex;
+        OpenThreads::Condition _condition;
+        size_t _roundRobin;
+        float _tinyScreenSize;
+        double _hiddenTimeout;
+        int _numWorkers;
+        bool _done;
+    };
+
+    /** Reports projected size of the subgraph to VideoDecodeScheduler for video images it shows.
+        Add it to the node where the image stream is bound (e.g. geode of a video quad) */
+    class OSGVERSE_RW_EXPORT VideoCullCallback : public osg::NodeCallback
+    {
+    public:
+        VideoCullCallback(osg::Image* image = NULL) { if (image) addImage(image); }
+        void addImage(osg::Image* image) { _images.push_back(image); }
+
+        /** Add callbacks to all nodes in the subgraph whose state sets (or drawables' ones)
+            have image streams as textures. Return number of callbacks added */
+        static int attach(osg::Node* root);
+
+        virtual void operator()(osg::Node* node, osg::NodeVisitor* nv);
+
+    protected:
+        std::vector<osg::observer_ptr<osg::Image>> _images;
+    };
+
+}
+
+#endif
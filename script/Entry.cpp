@@ -22,7 +22,7 @@ void LibraryEntry::refresh(const std::string& libName)
     osgDB::ObjectWrapperManager* owm = osgDB::Registry::instance()->getObjectWrapperManager();
     osgDB::ObjectWrapperManager::WrapperMap& wrappers = owm->getWrapperMap();
 
-    _classes.clear(); _libraryName = libName;
+    _classes.clear(); _accessors.clear(); _libraryName = libName;
     for (osgDB::ObjectWrapperManager::WrapperMap::iterator itr = wrappers.begin();
          itr != wrappers.end(); ++itr)
     {
@@ -146,6 +146,34 @@ std::vector<LibraryEntry::Method> LibraryEntry::getMethodNames(const std::string
     return methods;
 }
 
+const LibraryEntry::Accessor* LibraryEntry::getAccessor(const osg::Object* object,
+                                                        const std::string& name)
+{
+    if (object == NULL) return NULL;
+    std::string clsName = object->libraryName() + std::string("::") + object->className();
+    std::map<std::string, osg::ref_ptr<Accessor>>& accessors = _accessors[clsName];
+    std::map<std::string, osg::ref_ptr<Accessor>>::iterator itr = accessors.find(name);
+    if (itr != accessors.end()) return itr->second.get();
+
+    // Resolve only once: unknown names are also recorded as NULL accessors
+    osg::ref_ptr<Accessor> acc; std::vector<Property> properties = getPropertyNames(clsName);
+    for (size_t i = 0; i < properties.size(); ++i)
+    {
+        const Property& prop = properties[i];
+        if (prop.name != name || prop.outdated) continue;
+
+        acc = new Accessor; acc->property = prop;
+        acc->className = object->className(); acc->libraryName = object->libraryName();
+#if OSGVERSE_COMPLETED_SCRIPT
+        osgDB::BaseSerializer::Type type = osgDB::BaseSerializer::RW_UNDEFINED;
+        acc->serializer = _manager.getSerializer(object, name, type);
+        acc->vectorSerializer = dynamic_cast<osgDB::VectorBaseSerializer*>(acc->serializer);
+#endif
+        break;
+    }
+    accessors[name] = acc; return acc.get();
+}
+
 std::string LibraryEntry::getClassName(osg::Object* obj, bool withLibName)
 {
     if (!obj) return ""; else if (!withLibName) return obj->className();
@@ -190,6 +218,27 @@ bool LibraryEntry::setEnumProperty(osg::Object* object, const std::string& name,
     return false;
 }
 
+std::string LibraryEntry::getEnumProperty(const osg::Object* object, const Accessor* acc)
+{
+    int value = 0;
+    if (getProperty<int>(object, acc, value))
+    {
+        osgDB::BaseSerializer* bs = acc->serializer;
+        if (bs && bs->getIntLookup())
+            return bs->getIntLookup()->getString(value);
+    }
+    return std::to_string(value);
+}
+
+bool LibraryEntry::setEnumProperty(osg::Object* object, const Accessor* acc,
+                                   const std::string& value)
+{
+    osgDB::BaseSerializer* bs = acc->serializer;
+    if (bs && bs->getIntLookup())
+        return setProperty(object, acc, bs->getIntLookup()->getValue(value.c_str()));
+    return false;
+}
+
 bool LibraryEntry::callMethod(osg::Object* object, const std::string& name, osg::Object* arg1)
 {
     osg::Parameters args0, args1; args0.push_back(arg1);
@@ -228,6 +277,13 @@ bool LibraryEntry::setEnumProperty(osg::Object* object, const std::string& name,
                                    const std::string& value)
 { OSG_WARN << "[LibraryEntry] setEnumProperty() not implemented" << std::endl; return false; }
 
+std::string LibraryEntry::getEnumProperty(const osg::Object* object, const Accessor* acc)
+{ OSG_WARN << "[LibraryEntry] getEnumProperty() not implemented" << std::endl; return ""; }
+
+bool LibraryEntry::setEnumProperty(osg::Object* object, const Accessor* acc,
+                                   const std::string& value)
+{ OSG_WARN << "[LibraryEntry] setEnumProperty() not implemented" << std::endl; return false; }
+
 bool LibraryEntry::callMethod(osg::Object* object, const std::string& name, osg::Object* arg1)
 { OSG_WARN << "[LibraryEntry] callMethod() not implemented" << std::endl; return false; }
 
@@ -43,6 +43,28 @@ namespace osgVerse
         };
         std::vector<Method> getMethodNames(const std::string& clsName) const;
 
+        /** Property of a class resolved once by getAccessor(), which can be kept and reused
+            for all objects of this class. Only vector properties use the cached serializer
+            directly. Scalar and enum values still go through osgDB::ClassInterface (its stream
+            iterators are private), which looks up the serializer again; for them an accessor
+            only saves the property list checks, and the serializer search of enum names */
+        struct Accessor : public osg::Referenced
+        {
+            Property property; std::string className, libraryName;
+            osgDB::BaseSerializer* serializer;
+#if OSGVERSE_COMPLETED_SCRIPT
+            osgDB::VectorBaseSerializer* vectorSerializer;
+            Accessor() : serializer(NULL), vectorSerializer(NULL) {}
+#else
+            Accessor() : serializer(NULL) {}
+#endif
+            bool accepts(const osg::Object* obj) const
+            { return obj && className == obj->className() && libraryName == obj->libraryName(); }
+        };
+
+        /** Get cached accessor of the object's class, or NULL if property not found */
+        const Accessor* getAccessor(const osg::Object* object, const std::string& name);
+
 #if OSGVERSE_COMPLETED_SCRIPT
         template<typename T>
         bool getProperty(const osg::Object* object, const std::string& name, T& value)
@@ -94,6 +116,52 @@ namespace osgVerse
                 vs->addElement(*object, (void*)value[i].ptr());
             return true;
         }
+
+        // Scalar and enum values: not accelerated, serializer is looked up again by ClassInterface
+        template<typename T>
+        bool getProperty(const osg::Object* object, const Accessor* acc, T& value)
+        { return acc->accepts(object) && _manager.getProperty<T>(object, acc->property.name, value); }
+
+        template<typename T>
+        bool setProperty(osg::Object* object, const Accessor* acc, const T& value)
+        { return acc->accepts(object) && _manager.setProperty<T>(object, acc->property.name, value); }
+
+        template<typename T>
+        bool getProperty(const osg::Object* object, const Accessor* acc, std::vector<T>& value)
+        {
+            osgDB::VectorBaseSerializer* vs = acc->vectorSerializer;
+            if (!vs || !acc->accepts(object)) return false;
+
+            unsigned int size = vs->size(*object); value.reserve(value.size() + size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                const void* ptr = vs->getElement(*object, i);
+                value.push_back(*(T*)ptr);
+            }
+            return true;
+        }
+
+        template<typename T>
+        bool setProperty(osg::Object* object, const Accessor* acc, const std::vector<T>& value)
+        {
+            osgDB::VectorBaseSerializer* vs = acc->vectorSerializer;
+            if (!vs || !acc->accepts(object)) return false; else vs->clear(*object);
+
+            for (size_t i = 0; i < value.size(); ++i)
+                vs->addElement(*object, (void*)&value[i]);
+            return true;
+        }
+
+        template<typename T>
+        bool setVecProperty(osg::Object* object, const Accessor* acc, const std::vector<T>& value)
+        {
+            osgDB::VectorBaseSerializer* vs = acc->vectorSerializer;
+            if (!vs || !acc->accepts(object)) return false; else vs->clear(*object);
+
+            for (size_t i = 0; i < value.size(); ++i)
+                vs->addElement(*object, (void*)value[i].ptr());
+            return true;
+        }
 #else
         template<typename T>
         bool getProperty(const osg::Object* object, const std::string& name, T& value)
@@ -129,11 +197,47 @@ namespace osgVerse
             OSG_WARN << "[LibraryEntry] setVecProperty() not implemented" << std::endl;
             return false;
         }
+
+        template<typename T>
+        bool getProperty(const osg::Object* object, const Accessor* acc, T& value)
+        { return getProperty(object, acc->property.name, value); }
+
+        template<typename T>
+        bool setProperty(osg::Object* object, const Accessor* acc, const T& value)
+        { return setProperty(object, acc->property.name, value); }
+
+        template<typename T>
+        bool setVecProperty(osg::Object* object, const Accessor* acc, const std::vector<T>& value)
+        { return setVecProperty(object, acc->property.name, value); }
 #endif
+
+        /** Get/set the same property of many objects of the accessor's class,
+            returning number of objects successfully handled */
+        template<typename T>
+        unsigned int getProperties(const std::vector<osg::Object*>& objects, const Accessor* acc,
+                                   std::vector<T>& values)
+        {
+            unsigned int num = 0; values.resize(objects.size());
+            for (size_t i = 0; i < objects.size(); ++i)
+            { T v; if (getProperty(objects[i], acc, v)) { values[i] = v; num++; } }
+            return num;
+        }
+
+        template<typename T>
+        unsigned int setProperties(const std::vector<osg::Object*>& objects, const Accessor* acc,
+                                   const std::vector<T>& values)
+        {
+            unsigned int num = 0; size_t size = osg::minimum(objects.size(), values.size());
+            for (size_t i = 0; i < size; ++i)
+            { if (setProperty(objects[i], acc, values[i])) num++; }
+            return num;
+        }
 
         std::vector<std::string> getEnumPropertyItems(const osg::Object* object, const std::string& name);
         std::string getEnumProperty(const osg::Object* object, const std::string& name);
         bool setEnumProperty(osg::Object* object, const std::string& name, const std::string& value);
+        std::string getEnumProperty(const osg::Object* object, const Accessor* acc);
+        bool setEnumProperty(osg::Object* object, const Accessor* acc, const std::string& value);
 
         osg::Object* callMethod(osg::Object* object, const std::string& name);
         bool callMethod(osg::Object* object, const std::string& name, osg::Object* arg1);
@@ -148,6 +252,7 @@ namespace osgVerse
 #if OSGVERSE_COMPLETED_SCRIPT
         osgDB::ClassInterface _manager;
 #endif
+        std::map<std::string, std::map<std::string, osg::ref_ptr<Accessor>>> _accessors;
         std::set<std::string> _classes;
         std::string _libraryName;
     };
@@ -2,9 +2,9 @@
 #include "JsonScript.h"
 using namespace osgVerse;
 
-picojson::value JsonScript::execute(ExecutionType t, picojson::value in)
+static void parseProperties(const picojson::value& in, ScriptBase::PropertyMap& properties,
+                            ScriptBase::ParameterList& params)
 {
-    PropertyMap properties; ParameterList params;
     if (in.contains("properties"))
     {
         const picojson::value& propsVal = in.get("properties");
@@ -34,6 +34,12 @@ picojson::value JsonScript::execute(ExecutionType t, picojson::value in)
             OSG_WARN << "[JsonScript] Unknown properties format: "
                      << propsVal.to_str() << std::endl;
     }
+}
+
+picojson::value JsonScript::execute(ExecutionType t, picojson::value in)
+{
+    PropertyMap properties; ParameterList params;
+    parseProperties(in, properties, params);
 
     Result result; bool valueIsJson = false;
     switch (t)
@@ -58,7 +64,25 @@ picojson::value JsonScript::execute(ExecutionType t, picojson::value in)
         }
         break;
     case EXE_Set:
-        if (in.contains("object"))
+        if (in.contains("batch") && in.get("batch").is<picojson::array>())
+        {
+            const picojson::array& items = in.get("batch").get<picojson::array>();
+            PropertyBatch batch; batch.reserve(items.size());
+            for (size_t i = 0; i < items.size(); ++i)
+            {
+                if (!items[i].contains("object"))
+                {
+                    OSG_WARN << "[JsonScript] Batch item without object: "
+                             << items[i].to_str() << std::endl; continue;
+                }
+
+                ParameterList unused; batch.push_back(PropertyBatch::value_type());
+                batch.back().first = items[i].get("object").to_str();
+                parseProperties(items[i], batch.back().second, unused);
+            }
+            result = setBatch(batch);
+        }
+        else if (in.contains("object"))
         {
             const picojson::value& objVal = in.get("object");
             if (in.contains("method"))
@@ -22,6 +22,7 @@ namespace osgVerse
         *   - EXE_Set
         *     { 'object': ..., 'properties': [{'...': '...'}] }
         *     { 'object': ..., 'method': ..., 'properties': [..., ...] }
+        *     { 'batch': [{ 'object': ..., 'properties': {'...': '...'} }, ...] }
         *   - EXE_Get
         *     { 'object': ..., 'property': ... }
         *   - EXE_Remove
@@ -89,18 +89,17 @@ ScriptBase::Result ScriptBase::set(const std::string& nodePath, const PropertyMa
     osg::Object* obj = getFromPath(nodePath);
     if (obj != NULL)
     {
-        std::string libName = obj->libraryName(), clsName = obj->className();
+        std::string libName = obj->libraryName();
         if (_entries.find(libName) == _entries.end())
             _entries[libName] = new LibraryEntry(libName);
 
         Result result; result.obj = obj;
         LibraryEntry* entry = _entries[libName].get();
-        std::vector<LibraryEntry::Property> names = entry->getPropertyNames(clsName);
-
         for (PropertyMap::const_iterator itr = properties.begin();
             itr != properties.end(); ++itr)
         {
-            if (!setProperty(itr->first, itr->second, entry, obj, names))
+            const LibraryEntry::Accessor* accessor = entry->getAccessor(obj, itr->first);
+            if (!accessor || !setProperty(itr->second, entry, obj, accessor))
             {
                 if (!result.msg.empty()) result.msg += "\n"; else result.code = -2;
                 result.msg += "Can't set property: " + itr->first;
@@ -138,20 +137,47 @@ ScriptBase::Result ScriptBase::call(const std::string& nodePath, const std::stri
         return Result(-1, "Invalid scene object: " + nodePath);
 }
 
+ScriptBase::Result ScriptBase::setBatch(const PropertyBatch& batch)
+{
+    Result result;
+    for (PropertyBatch::const_iterator itr = batch.begin(); itr != batch.end(); ++itr)
+    {
+        osg::Object* obj = getFromPath(itr->first);
+        if (obj == NULL)
+        {
+            if (!result.msg.empty()) result.msg += "\n"; else result.code = -1;
+            result.msg += "Invalid scene object: " + itr->first; continue;
+        }
+
+        const PropertyMap& properties = itr->second;
+        LibraryEntry* entry = getOrCreateEntry(obj->libraryName());
+        for (PropertyMap::const_iterator pItr = properties.begin();
+             pItr != properties.end(); ++pItr)
+        {
+            const LibraryEntry::Accessor* accessor = entry->getAccessor(obj, pItr->first);
+            if (!accessor || !setProperty(pItr->second, entry, obj, accessor))
+            {
+                if (!result.msg.empty()) result.msg += "\n"; else result.code = -2;
+                result.msg += "Can't set property: " + itr->first + "/" + pItr->first;
+            }
+        }
+    }
+    return result;
+}
+
 ScriptBase::Result ScriptBase::get(const std::string& nodePath, const std::string& key)
 {
     osg::Object* obj = getFromPath(nodePath);
     if (obj != NULL)
     {
-        std::string libName = obj->libraryName(), clsName = obj->className();
+        std::string libName = obj->libraryName();
         if (_entries.find(libName) == _entries.end())
             _entries[libName] = new LibraryEntry(libName);
 
         Result result; result.obj = obj;
         LibraryEntry* entry = _entries[libName].get();
-        std::vector<LibraryEntry::Property> names = entry->getPropertyNames(clsName);
-
-        if (!getProperty(key, result.value, entry, obj, names))
+        const LibraryEntry::Accessor* accessor = entry->getAccessor(obj, key);
+        if (!accessor || !getProperty(result.value, entry, obj, accessor))
             return Result(-3, "Can't get property: " + key);
         return result;
     }
@@ -186,50 +212,17 @@ osg::Object* ScriptBase::getFromPath(const std::string& nodePath)
     osg::Object* obj = _rootNode.get();
     if (nodePath.empty() || nodePath == "root")
         return obj;
-    else if (_objects.find(nodePath) != _objects.end())
-        return _objects[nodePath].get();
 
-    osgDB::StringList path;
-    osgDB::split(nodePath, path, '/');
-    if (_objects.find(path[0]) != _objects.end())
-        obj = _objects[path[0]].get();
+    std::map<std::string, osg::ref_ptr<osg::Object>>::iterator itr = _objects.find(nodePath);
+    if (itr != _objects.end()) return itr->second.get();
 
-#if OSG_VERSION_GREATER_THAN(3, 3, 0)
-    osg::Node* node = obj ? obj->asNode() : NULL;
-#else
-    osg::Node* node = dynamic_cast<osg::Node*>(obj);
-#endif
-    if (node != NULL)
+    std::size_t sep = nodePath.find('/');
+    if (sep != std::string::npos)
     {
-        for (size_t i = 1; i < path.size(); ++i)
-        {
-            const std::string& name = path[i];
-            osg::Group* parent = node ? node->asGroup() : NULL;
-            if (parent == NULL) return NULL; node = NULL;
-
-            if (name == "0")
-            {
-                if (parent->getNumChildren() > 0)
-                    node = parent->getChild(0);
-            }
-            else
-            {
-                int index = atoi(name.c_str());
-                if (index > 0 && index < (int)parent->getNumChildren())
-                    node = parent->getChild(index);
-                else
-                {
-                    for (size_t j = 0; j < parent->getNumChildren(); ++j)
-                    {
-                        if (parent->getChild(j)->getName() == name)
-                        { node = parent->getChild(j); break; }
-                    }
-                }
-            }
-        }
-        obj = node;
+        itr = _objects.find(nodePath.substr(0, sep));
+        if (itr != _objects.end()) obj = itr->second.get();
     }
-    return obj;
+    return _pathIndex->get(nodePath, obj, false);
 }
 
 template<typename T> static T getVecValue(const std::string& v)
@@ -278,123 +271,121 @@ template<typename T> static std::vector<T> getVecVector(const std::string& v, ch
     return result;
 }
 
-bool ScriptBase::setProperty(const std::string& key, const std::string& value,
-                             LibraryEntry* entry, osg::Object* object,
-                             const std::vector<LibraryEntry::Property>& names)
+bool ScriptBase::setProperty(const std::string& value, LibraryEntry* entry, osg::Object* object,
+                             const LibraryEntry::Accessor* accessor)
 {
     std::string clsName = object->className();
     std::string value2; char sep = _vecSeparator;
-    for (size_t i = 0; i < names.size(); ++i)
+    if (accessor != NULL)
     {
-        const LibraryEntry::Property& prop = names[i];
-        if (prop.name != key || prop.outdated) continue;
+        const LibraryEntry::Property& prop = accessor->property;
 
 #if OSGVERSE_COMPLETED_SCRIPT
         switch (prop.type)
         {
         case osgDB::BaseSerializer::RW_OBJECT:
         case osgDB::BaseSerializer::RW_IMAGE:
-            return entry->setProperty(object, key, getFromPath(value));
+            return entry->setProperty(object, accessor, getFromPath(value));
         case osgDB::BaseSerializer::RW_BOOL:
             std::transform(value.begin(), value.end(), value2.begin(), tolower);
-            if (value2 == "true") return entry->setProperty(object, key, true);
-            else return entry->setProperty(object, key, atoi(value2.c_str()) > 0);
+            if (value2 == "true") return entry->setProperty(object, accessor, true);
+            else return entry->setProperty(object, accessor, atoi(value2.c_str()) > 0);
         case osgDB::BaseSerializer::RW_CHAR:
-            return entry->setProperty(object, key, (char)atoi(value.c_str()));
+            return entry->setProperty(object, accessor, (char)atoi(value.c_str()));
         case osgDB::BaseSerializer::RW_UCHAR:
-            return entry->setProperty(object, key, (unsigned char)atoi(value.c_str()));
+            return entry->setProperty(object, accessor, (unsigned char)atoi(value.c_str()));
         case osgDB::BaseSerializer::RW_SHORT:
-            return entry->setProperty(object, key, (short)atoi(value.c_str()));
+            return entry->setProperty(object, accessor, (short)atoi(value.c_str()));
         case osgDB::BaseSerializer::RW_USHORT:
-            return entry->setProperty(object, key, (unsigned short)atoi(value.c_str()));
+            return entry->setProperty(object, accessor, (unsigned short)atoi(value.c_str()));
         case osgDB::BaseSerializer::RW_INT:
         case osgDB::BaseSerializer::RW_GLENUM:
-            return entry->setProperty(object, key, (int)atoi(value.c_str()));
+            return entry->setProperty(object, accessor, (int)atoi(value.c_str()));
         case osgDB::BaseSerializer::RW_UINT:
-            return entry->setProperty(object, key, (unsigned int)atoi(value.c_str()));
+            return entry->setProperty(object, accessor, (unsigned int)atoi(value.c_str()));
         case osgDB::BaseSerializer::RW_FLOAT:
-            return entry->setProperty(object, key, (float)atof(value.c_str()));
+            return entry->setProperty(object, accessor, (float)atof(value.c_str()));
         case osgDB::BaseSerializer::RW_DOUBLE:
-            return entry->setProperty(object, key, (double)atof(value.c_str()));
+            return entry->setProperty(object, accessor, (double)atof(value.c_str()));
         case osgDB::BaseSerializer::RW_QUAT:
-            return entry->setProperty(object, key, getQuatValue<osg::Quat>(value));
+            return entry->setProperty(object, accessor, getQuatValue<osg::Quat>(value));
         case osgDB::BaseSerializer::RW_VEC2F:
-            return entry->setProperty(object, key, getVecValue<osg::Vec2f>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec2f>(value));
         case osgDB::BaseSerializer::RW_VEC3F:
-            return entry->setProperty(object, key, getVecValue<osg::Vec3f>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec3f>(value));
         case osgDB::BaseSerializer::RW_VEC4F:
-            return entry->setProperty(object, key, getVecValue<osg::Vec4f>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec4f>(value));
         case osgDB::BaseSerializer::RW_VEC2D:
-            return entry->setProperty(object, key, getVecValue<osg::Vec2d>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec2d>(value));
         case osgDB::BaseSerializer::RW_VEC3D:
-            return entry->setProperty(object, key, getVecValue<osg::Vec3d>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec3d>(value));
         case osgDB::BaseSerializer::RW_VEC4D:
-            return entry->setProperty(object, key, getVecValue<osg::Vec4d>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec4d>(value));
 #if OSG_VERSION_GREATER_THAN(3, 4, 1)
         case osgDB::BaseSerializer::RW_VEC2B:
-            return entry->setProperty(object, key, getVecValue<osg::Vec2b>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec2b>(value));
         case osgDB::BaseSerializer::RW_VEC3B:
-            return entry->setProperty(object, key, getVecValue<osg::Vec3b>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec3b>(value));
         case osgDB::BaseSerializer::RW_VEC4B:
-            return entry->setProperty(object, key, getVecValue<osg::Vec4b>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec4b>(value));
         case osgDB::BaseSerializer::RW_VEC2UB:
-            return entry->setProperty(object, key, getVecValue<osg::Vec2ub>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec2ub>(value));
         case osgDB::BaseSerializer::RW_VEC3UB:
-            return entry->setProperty(object, key, getVecValue<osg::Vec3ub>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec3ub>(value));
         case osgDB::BaseSerializer::RW_VEC4UB:
-            return entry->setProperty(object, key, getVecValue<osg::Vec4ub>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec4ub>(value));
         case osgDB::BaseSerializer::RW_VEC2S:
-            return entry->setProperty(object, key, getVecValue<osg::Vec2s>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec2s>(value));
         case osgDB::BaseSerializer::RW_VEC3S:
-            return entry->setProperty(object, key, getVecValue<osg::Vec3s>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec3s>(value));
         case osgDB::BaseSerializer::RW_VEC4S:
-            return entry->setProperty(object, key, getVecValue<osg::Vec4s>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec4s>(value));
         case osgDB::BaseSerializer::RW_VEC2US:
-            return entry->setProperty(object, key, getVecValue<osg::Vec2us>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec2us>(value));
         case osgDB::BaseSerializer::RW_VEC3US:
-            return entry->setProperty(object, key, getVecValue<osg::Vec3us>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec3us>(value));
         case osgDB::BaseSerializer::RW_VEC4US:
-            return entry->setProperty(object, key, getVecValue<osg::Vec4us>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec4us>(value));
         case osgDB::BaseSerializer::RW_VEC2I:
-            return entry->setProperty(object, key, getVecValue<osg::Vec2i>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec2i>(value));
         case osgDB::BaseSerializer::RW_VEC3I:
-            return entry->setProperty(object, key, getVecValue<osg::Vec3i>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec3i>(value));
         case osgDB::BaseSerializer::RW_VEC4I:
-            return entry->setProperty(object, key, getVecValue<osg::Vec4i>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec4i>(value));
         case osgDB::BaseSerializer::RW_VEC2UI:
-            return entry->setProperty(object, key, getVecValue<osg::Vec2ui>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec2ui>(value));
         case osgDB::BaseSerializer::RW_VEC3UI:
-            return entry->setProperty(object, key, getVecValue<osg::Vec3ui>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec3ui>(value));
         case osgDB::BaseSerializer::RW_VEC4UI:
-            return entry->setProperty(object, key, getVecValue<osg::Vec4ui>(value));
+            return entry->setProperty(object, accessor, getVecValue<osg::Vec4ui>(value));
 #endif
         case osgDB::BaseSerializer::RW_MATRIXF:
-            return entry->setProperty(object, key, getMatrixValue<osg::Matrixf>(value));
+            return entry->setProperty(object, accessor, getMatrixValue<osg::Matrixf>(value));
         case osgDB::BaseSerializer::RW_MATRIXD:
-            return entry->setProperty(object, key, getMatrixValue<osg::Matrixd>(value));
+            return entry->setProperty(object, accessor, getMatrixValue<osg::Matrixd>(value));
         case osgDB::BaseSerializer::RW_MATRIX:
-            return entry->setProperty(object, key, getMatrixValue<osg::Matrix>(value));
+            return entry->setProperty(object, accessor, getMatrixValue<osg::Matrix>(value));
         case osgDB::BaseSerializer::RW_STRING:
-            return entry->setProperty(object, key, value);
+            return entry->setProperty(object, accessor, value);
         case osgDB::BaseSerializer::RW_ENUM:
-            return entry->setEnumProperty(object, key, value);
+            return entry->setEnumProperty(object, accessor, value);
         case osgDB::BaseSerializer::RW_VECTOR:
             if (clsName == "FloatArray")
-                return entry->setProperty(object, key, getVector<float>(value));
+                return entry->setProperty(object, accessor, getVector<float>(value));
             else if (clsName == "Vec2Array")
-                return entry->setVecProperty(object, key, getVecVector<osg::Vec2f>(value, sep));
+                return entry->setVecProperty(object, accessor, getVecVector<osg::Vec2f>(value, sep));
             else if (clsName == "Vec3Array")
-                return entry->setVecProperty(object, key, getVecVector<osg::Vec3f>(value, sep));
+                return entry->setVecProperty(object, accessor, getVecVector<osg::Vec3f>(value, sep));
             else if (clsName == "Vec4Array")
-                return entry->setVecProperty(object, key, getVecVector<osg::Vec4f>(value, sep));
+                return entry->setVecProperty(object, accessor, getVecVector<osg::Vec4f>(value, sep));
             else if (clsName == "DoubleArray")
-                return entry->setProperty(object, key, getVector<double>(value));
+                return entry->setProperty(object, accessor, getVector<double>(value));
             else if (clsName == "Vec2dArray")
-                return entry->setVecProperty(object, key, getVecVector<osg::Vec2d>(value, sep));
+                return entry->setVecProperty(object, accessor, getVecVector<osg::Vec2d>(value, sep));
             else if (clsName == "Vec3dArray")
-                return entry->setVecProperty(object, key, getVecVector<osg::Vec3d>(value, sep));
+                return entry->setVecProperty(object, accessor, getVecVector<osg::Vec3d>(value, sep));
             else if (clsName == "Vec4dArray")
-                return entry->setVecProperty(object, key, getVecVector<osg::Vec4d>(value, sep));
+                return entry->setVecProperty(object, accessor, getVecVector<osg::Vec4d>(value, sep));
             break;
         //RW_PLANE, RW_BOUNDINGBOXF, RW_BOUNDINGBOXD, RW_BOUNDINGSPHEREF, RW_BOUNDINGSPHERED
         }
@@ -445,22 +436,20 @@ template<typename T> static std::string setVecVector(const std::vector<T>& v, ch
     return ss.str();
 }
 
-bool ScriptBase::getProperty(const std::string& key, std::string& value,
-                             LibraryEntry* entry, osg::Object* object,
-                             const std::vector<LibraryEntry::Property>& names)
+bool ScriptBase::getProperty(std::string& value, LibraryEntry* entry, osg::Object* object,
+                             const LibraryEntry::Accessor* accessor)
 {
     std::string clsName = object->className();
     std::string value2; char sep = _vecSeparator;
-    for (size_t i = 0; i < names.size(); ++i)
+    if (accessor != NULL)
     {
-        const LibraryEntry::Property& prop = names[i];
-        if (prop.name != key || prop.outdated) continue;
+        const LibraryEntry::Property& prop = accessor->property;
 
 #define GET_PROP_VALUE(type, func) { \
-    type v; if (!entry->getProperty(object, key, v)) return false; \
+    type v; if (!entry->getProperty(object, accessor, v)) return false; \
     value = func (v); return true; }
 #define GET_PROP_VALUE2(type, func, arg) { \
-    type v; if (!entry->getProperty(object, key, v)) return false; \
+    type v; if (!entry->getProperty(object, accessor, v)) return false; \
     value = func (v, arg); return true; }
 
 #if OSGVERSE_COMPLETED_SCRIPT
@@ -510,7 +499,7 @@ bool ScriptBase::getProperty(const std::string& key, std::string& value,
         case osgDB::BaseSerializer::RW_MATRIX: GET_PROP_VALUE(osg::Matrix, setMatrixValue);
         case osgDB::BaseSerializer::RW_STRING: GET_PROP_VALUE(std::string, std::string);
         case osgDB::BaseSerializer::RW_ENUM:
-            value = entry->getEnumProperty(object, key);
+            value = entry->getEnumProperty(object, accessor);
             return !value.empty();
         case osgDB::BaseSerializer::RW_VECTOR:
             if (clsName == "FloatArray")
@@ -3,6 +3,7 @@
 
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include "pipeline/Utilities.h"
 #include "Entry.h"
 
 namespace osgVerse
@@ -12,6 +13,8 @@ namespace osgVerse
     public:
         typedef std::map<std::string, std::string> PropertyMap;
         typedef std::vector<std::string> ParameterList;
+        typedef std::vector<std::pair<std::string, PropertyMap>> PropertyBatch;
+        ScriptBase() : _pathIndex(new PathIDIndex) {}
 
         struct Result
         {
@@ -30,14 +33,19 @@ namespace osgVerse
         virtual Result call(const std::string& nodePath, const std::string& method,
                             const ParameterList& params);
 
+        /** PUT: set properties of a batch of objects, errors are merged into one result */
+        virtual Result setBatch(const PropertyBatch& batch);
+
         /** GET: find an object and get its property */
         virtual Result get(const std::string& nodePath, const std::string& key);
 
         /** DELETE: delete an object (only from script manager, not scene graph) */
         virtual Result remove(const std::string& nodePath);
 
-        /** Get node path: idXXX, idA/idB, idA/0 (first child), or empty for root node */
+        /** Get node path: idXXX, idA/idB, idA/0 (first child), or empty for root node.
+            Resolved paths are indexed, see PathIDIndex for how they are validated */
         osg::Object* getFromPath(const std::string& nodePath);
+        PathIDIndex* getPathIndex() { return _pathIndex.get(); }
 
         void setRootNode(osg::Group* root) { _rootNode = root; }
         osg::Group* getRootNode() { return _rootNode.get(); }
@@ -46,15 +54,14 @@ namespace osgVerse
         Result createFromObject(osg::Object* obj);
 
     protected:
-        bool setProperty(const std::string& key, const std::string& value,
-                         LibraryEntry* entry, osg::Object* object,
-                         const std::vector<LibraryEntry::Property>& names);
-        bool getProperty(const std::string& key, std::string& value,
-                         LibraryEntry* entry, osg::Object* object,
-                         const std::vector<LibraryEntry::Property>& names);
+        bool setProperty(const std::string& value, LibraryEntry* entry, osg::Object* object,
+                         const LibraryEntry::Accessor* accessor);
+        bool getProperty(std::string& value, LibraryEntry* entry, osg::Object* object,
+                         const LibraryEntry::Accessor* accessor);
 
         std::map<std::string, osg::ref_ptr<osg::Object>> _objects;
         std::map<std::string, osg::ref_ptr<LibraryEntry>> _entries;
+        osg::ref_ptr<PathIDIndex> _pathIndex;
         osg::observer_ptr<osg::Group> _rootNode;
         char _vecSeparator;
     };
@@ -0,0 +1,135 @@
+#include <osg/io_utils>
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <modeling/Math.h>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifndef _DEBUG
+#include <backward.hpp>  // for better debug info
+namespace backward { backward::SignalHandling sh; }
+#endif
+
+typedef osg::Vec3d (*ScalarFunc)(const osg::Vec3d&);
+typedef void (*BatchFunc)(const double*, double*, size_t);
+
+/** Compare batch conversion with the single-point one: angle and metre tolerances per axis */
+static bool checkConversion(const char* name, const std::vector<double>& input,
+                            ScalarFunc scalar, BatchFunc batch, const osg::Vec3d& tolerance)
+{
+    size_t num = input.size() / 3;
+    std::vector<double> expected(input.size()), output(input.size());
+    osg::Timer_t t0 = osg::Timer::instance()->tick();
+    for (size_t i = 0; i < num; ++i)
+    {
+        osg::Vec3d v = scalar(osg::Vec3d(input[i * 3], input[i * 3 + 1], input[i * 3 + 2]));
+        expected[i * 3] = v[0]; expected[i * 3 + 1] = v[1]; expected[i * 3 + 2] = v[2];
+    }
+
+    osg::Timer_t t1 = osg::Timer::instance()->tick();
+    batch(&input[0], &output[0], num);
+    osg::Timer_t t2 = osg::Timer::instance()->tick();
+
+    osg::Vec3d maxError; size_t numFailed = 0;
+    for (size_t i = 0; i < num; ++i)
+    {
+        bool ok = true;
+        for (int k = 0; k < 3; ++k)
+        {
+            double e = fabs(output[i * 3 + k] - expected[i * 3 + k]);
+            if (!(e <= tolerance[k])) ok = false;  // NaN fails too
+            if (e > maxError[k]) maxError[k] = e;
+        }
+        if (!ok) numFailed++;
+    }
+
+    // Batch conversion in-place must give the same result
+    std::vector<double> inplace(input);
+    batch(&inplace[0], &inplace[0], num);
+    bool sameInPlace = (inplace == output);
+
+    osg::Timer* timer = osg::Timer::instance();
+    std::cout << name << ": scalar " << timer->delta_m(t0, t1) << "ms, batch "
+              << timer->delta_m(t1, t2) << "ms, max error (" << maxError << "), "
+              << numFailed << " failed" << (sameInPlace ? "" : ", in-place mismatched") << std::endl;
+    return numFailed == 0 && sameInPlace;
+}
+
+typedef osgVerse::Coordinate Coord;
+static Coord::UTM utm50N(32650);
+static osg::Vec3d scalarLLAtoECEF(const osg::Vec3d& v) { return Coord::convertLLAtoECEF(v); }
+static osg::Vec3d scalarECEFtoLLA(const osg::Vec3d& v) { return Coord::convertECEFtoLLA(v); }
+static osg::Vec3d scalarToC2K(const osg::Vec3d& v) { return Coord::convertECEFtoCGCS2000(v); }
+static osg::Vec3d scalarFromC2K(const osg::Vec3d& v) { return Coord::convertCGCS2000toECEF(v); }
+static osg::Vec3d scalarToWM(const osg::Vec3d& v) { return Coord::convertLLAtoWebMercator(v); }
+static osg::Vec3d scalarFromWM(const osg::Vec3d& v) { return Coord::convertWebMercatorToLLA(v); }
+static osg::Vec3d scalarToUTM(const osg::Vec3d& v) { return Coord::convertLLAtoUTM(v, utm50N); }
+static osg::Vec3d scalarFromUTM(const osg::Vec3d& v) { return Coord::convertUTMtoLLA(v, utm50N); }
+
+static void batchLLAtoECEF(const double* i, double* o, size_t n) { Coord::convertLLAtoECEF(i, o, n); }
+static void batchECEFtoLLA(const double* i, double* o, size_t n) { Coord::convertECEFtoLLA(i, o, n); }
+static void batchToC2K(const double* i, double* o, size_t n) { Coord::convertECEFtoCGCS2000(i, o, n); }
+static void batchFromC2K(const double* i, double* o, size_t n) { Coord::convertCGCS2000toECEF(i, o, n); }
+static void batchToWM(const double* i, double* o, size_t n) { Coord::convertLLAtoWebMercator(i, o, n); }
+static void batchFromWM(const double* i, double* o, size_t n) { Coord::convertWebMercatorToLLA(i, o, n); }
+static void batchToUTM(const double* i, double* o, size_t n) { Coord::convertLLAtoUTM(i, o, n, utm50N); }
+static void batchFromUTM(const double* i, double* o, size_t n) { Coord::convertUTMtoLLA(i, o, n, utm50N); }
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    int numPoints = 1000000; arguments.read("--points", numPoints);
+
+    // Random geodetic points: latitude / longitude in radians, altitude in metres
+    std::mt19937 rng(20240601);
+    std::uniform_real_distribution<double> lat(-osg::PI_2 * 0.95, osg::PI_2 * 0.95);
+    std::uniform_real_distribution<double> lon(-osg::PI, osg::PI), alt(-500.0, 9000.0);
+    std::vector<double> lla(numPoints * 3), ecef(numPoints * 3), lonLatUTM(numPoints * 3);
+    for (int i = 0; i < numPoints; ++i)
+    {
+        lla[i * 3] = lat(rng); lla[i * 3 + 1] = lon(rng); lla[i * 3 + 2] = alt(rng);
+        osg::Vec3d v = scalarLLAtoECEF(osg::Vec3d(lla[i * 3], lla[i * 3 + 1], lla[i * 3 + 2]));
+        ecef[i * 3] = v[0]; ecef[i * 3 + 1] = v[1]; ecef[i * 3 + 2] = v[2];
+
+        // UTM expects (longitude, latitude, altitude) within the zone (114-120 degrees east)
+        lonLatUTM[i * 3] = utm50N.lon0 + (lla[i * 3 + 1] / osg::PI) * osg::DegreesToRadians(3.0);
+        lonLatUTM[i * 3 + 1] = lla[i * 3] * (80.0 / 90.0); lonLatUTM[i * 3 + 2] = lla[i * 3 + 2];
+    }
+
+    std::vector<double> utm(numPoints * 3), webMercator(numPoints * 3), c2k(numPoints * 3);
+    batchToUTM(&lonLatUTM[0], &utm[0], numPoints);
+    batchToWM(&lla[0], &webMercator[0], numPoints);
+    batchToC2K(&ecef[0], &c2k[0], numPoints);
+
+    // Formulas are the same as scalar versions, so only rounding of compiler optimizations is allowed
+    const double angle = 1e-12, metre = 1e-6;
+    bool ok = true;
+    ok &= checkConversion("LLA to ECEF", lla, scalarLLAtoECEF, batchLLAtoECEF,
+                          osg::Vec3d(metre, metre, metre));
+    ok &= checkConversion("ECEF to LLA", ecef, scalarECEFtoLLA, batchECEFtoLLA,
+                          osg::Vec3d(angle, angle, metre));
+    ok &= checkConversion("ECEF to CGCS2000", ecef, scalarToC2K, batchToC2K,
+                          osg::Vec3d(metre, metre, metre));
+    ok &= checkConversion("CGCS2000 to ECEF", c2k, scalarFromC2K, batchFromC2K,
+                          osg::Vec3d(metre, metre, metre));
+    ok &= checkConversion("LLA to Web Mercator", lla, scalarToWM, batchToWM,
+                          osg::Vec3d(metre, metre, metre));
+    ok &= checkConversion("Web Mercator to LLA", webMercator, scalarFromWM, batchFromWM,
+                          osg::Vec3d(angle, angle, metre));
+    ok &= checkConversion("LLA to UTM", lonLatUTM, scalarToUTM, batchToUTM,
+                          osg::Vec3d(metre, metre, metre));
+    ok &= checkConversion("UTM to LLA", utm, scalarFromUTM, batchFromUTM,
+                          osg::Vec3d(angle, angle, metre));
+
+    // Float versions compute in double but store float, so only metre-level precision remains
+    std::vector<float> llaF(lla.begin(), lla.end()), ecefF(llaF.size());
+    Coord::convertLLAtoECEF(&llaF[0], &ecefF[0], numPoints);
+    double maxFloatError = 0.0;
+    for (size_t i = 0; i < ecefF.size(); ++i)
+        maxFloatError = osg::maximum(maxFloatError, fabs((double)ecefF[i] - ecef[i]));
+    std::cout << "LLA to ECEF (float): max error " << maxFloatError << "m" << std::endl;
+    ok &= (maxFloatError < 4.0);
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+#include <osg/io_utils>
+#include <osg/Image>
+#include <osg/ValueObject>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+#include <tiffio.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifndef _DEBUG
+#include <backward.hpp>  // for better debug info
+namespace backward { backward::SignalHandling sh; }
+#endif
+
+#ifdef VERSE_STATIC_BUILD
+USE_OSGPLUGIN(verse_tiff)
+#endif
+
+static const int W = 300, H = 200;
+
+/** Expected RGB of pixel (x, y) of an overview level, counted from the top row as in TIFF */
+static void pixelAt(int level, int x, int y, unsigned char* rgb)
+{
+    x <<= level; y <<= level;
+    rgb[0] = (unsigned char)(x * 7 + y * 3); rgb[1] = (unsigned char)(x ^ y);
+    rgb[2] = (unsigned char)(x + y * 2 + level * 50);
+}
+
+static void setupDirectory(TIFF* out, int w, int h, bool reduced)
+{
+    TIFFSetField(out, TIFFTAG_IMAGEWIDTH, (uint32_t)w);
+    TIFFSetField(out, TIFFTAG_IMAGELENGTH, (uint32_t)h);
+    TIFFSetField(out, TIFFTAG_BITSPERSAMPLE, 8);
+    TIFFSetField(out, TIFFTAG_SAMPLESPERPIXEL, 3);
+    TIFFSetField(out, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+    TIFFSetField(out, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(out, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
+    if (reduced) TIFFSetField(out, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
+}
+
+static bool writeStrips(TIFF* out, int level, int rowsPerStrip)
+{
+    int w = W >> level, h = H >> level;
+    setupDirectory(out, w, h, level > 0);
+    TIFFSetField(out, TIFFTAG_ROWSPERSTRIP, (uint32_t)rowsPerStrip);
+
+    std::vector<unsigned char> row(w * 3);
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x) pixelAt(level, x, y, &row[x * 3]);
+        if (TIFFWriteScanline(out, &row[0], (uint32_t)y, 0) < 0) return false;
+    }
+    return TIFFWriteDirectory(out) != 0;
+}
+
+static bool writeTiles(TIFF* out, int tileSize)
+{
+    setupDirectory(out, W, H, false);
+    TIFFSetField(out, TIFFTAG_TILEWIDTH, (uint32_t)tileSize);
+    TIFFSetField(out, TIFFTAG_TILELENGTH, (uint32_t)tileSize);
+
+    // Edge tiles are padded, and padding is never copied out by the reader
+    std::vector<unsigned char> tile(tileSize * tileSize * 3);
+    for (int ty = 0; ty < H; ty += tileSize)
+        for (int tx = 0; tx < W; tx += tileSize)
+        {
+            std::fill(tile.begin(), tile.end(), 0);
+            for (int y = ty; y < ty + tileSize && y < H; ++y)
+                for (int x = tx; x < tx + tileSize && x < W; ++x)
+                    pixelAt(0, x, y, &tile[((y - ty) * tileSize + (x - tx)) * 3]);
+            if (TIFFWriteTile(out, &tile[0], (uint32_t)tx, (uint32_t)ty, 0, 0) < 0) return false;
+        }
+    return TIFFWriteDirectory(out) != 0;
+}
+
+/** Read with the plugin and compare every pixel with the window (x, y, w, h) of an overview */
+static bool checkRead(const std::string& name, const std::string& file, const std::string& window,
+                      const std::string& resolution, int level, int x0, int y0, int w, int h)
+{
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+    if (!window.empty()) options->setPluginStringData("Window", window);
+    if (!resolution.empty()) options->setPluginStringData("Resolution", resolution);
+
+    osg::ref_ptr<osg::Image> image = osgDB::readImageFile(file + ".verse_tiff", options.get());
+    if (!image || image->s() != w || image->t() != h || image->getPixelFormat() != GL_RGB)
+    {
+        std::cout << name << ": unexpected image " << (image.valid() ? image->s() : 0) << "x"
+                  << (image.valid() ? image->t() : 0) << ", expected " << w << "x" << h << std::endl;
+        return false;
+    }
+
+    int readLevel = 0;
+    bool hasLevel = image->getUserValue("TiffOverviewLevel", readLevel);
+    if (!resolution.empty() && (!hasLevel || readLevel != level))
+    {
+        std::cout << name << ": read overview level " << readLevel << ", expected " << level << std::endl;
+        return false;
+    }
+
+    // Rows of OSG images start from the bottom
+    size_t numFailed = 0; unsigned char expected[3];
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            const unsigned char* ptr = image->data(x, h - 1 - y);
+            pixelAt(level, x0 + x, y0 + y, expected);
+            if (memcmp(ptr, expected, 3) != 0) numFailed++;
+        }
+    std::cout << name << ": " << w << "x" << h << ", " << numFailed << " pixels mismatched" << std::endl;
+    return numFailed == 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::string tiled = "tiff_reader_tiled.tif", striped = "tiff_reader_striped.tif";
+    std::string overview = "tiff_reader_overview.tif";
+    TIFF* out = TIFFOpen(tiled.c_str(), "w");
+    bool written = out && writeTiles(out, 64); if (out) TIFFClose(out);
+
+    out = TIFFOpen(striped.c_str(), "w");
+    written &= out && writeStrips(out, 0, 16); if (out) TIFFClose(out);
+
+    // Full resolution image followed by 1/2 and 1/4 overviews, like COG / GDAL internal ones
+    out = TIFFOpen(overview.c_str(), "w");
+    written &= out && writeStrips(out, 0, 32) && writeStrips(out, 1, 32) && writeStrips(out, 2, 32);
+    if (out) TIFFClose(out);
+    if (!written) { std::cout << "Failed to write test files\nFAILED" << std::endl; return 1; }
+
+    bool ok = true;
+    ok &= checkRead("Tiled", tiled, "", "", 0, 0, 0, W, H);
+    ok &= checkRead("Tiled window", tiled, "70 30 100 90", "", 0, 70, 30, 100, 90);
+    ok &= checkRead("Tiled clipped window", tiled, "250 150 100 100", "", 0, 250, 150, 50, 50);
+    ok &= checkRead("Striped", striped, "", "", 0, 0, 0, W, H);
+    ok &= checkRead("Striped window", striped, "33 17 120 40", "", 0, 33, 17, 120, 40);
+    ok &= checkRead("Overview full", overview, "0 0 300 200", "300 200", 0, 0, 0, W, H);
+    ok &= checkRead("Overview 1/2", overview, "0 0 300 200", "150 100", 1, 0, 0, 150, 100);
+    ok &= checkRead("Overview 1/4 window", overview, "100 40 200 160", "40 30", 2, 25, 10, 50, 40);
+
+    remove(tiled.c_str()); remove(striped.c_str()); remove(overview.c_str());
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
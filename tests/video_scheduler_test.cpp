@@ -0,0 +1,97 @@
+#include <osg/ImageStream>
+#include <osg/Geode>
+#include <osg/Texture2D>
+#include <osg/Timer>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
+#include <readerwriter/VideoDecodeScheduler.h>
+#include <iostream>
+
+#ifndef _DEBUG
+#include <backward.hpp>  // for better debug info
+namespace backward { backward::SignalHandling sh; }
+#endif
+
+typedef osgVerse::VideoDecodeScheduler Scheduler;
+
+/** Dummy stream: records the quality of its latest decoding step */
+class CountingTask : public Scheduler::Task
+{
+public:
+    CountingTask() : _lastQuality(0) {}
+
+    virtual double decode(Scheduler::DecodeQuality quality)
+    { _lastQuality.exchange((unsigned)quality + 1); ++_numDecoded; return 0.005; }
+
+    int lastQuality() const { return (int)(unsigned)_lastQuality - 1; }
+    unsigned numDecoded() const { return _numDecoded; }
+
+protected:
+    OpenThreads::Atomic _lastQuality, _numDecoded;
+};
+
+/** Keep reporting the screen size for a while, like cull traversals of a running viewer */
+static void reportFor(const osg::Image* image, float pixelSize, double seconds)
+{
+    static unsigned int s_frameNumber = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    while (osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()) < seconds)
+    {
+        if (image) Scheduler::instance()->reportScreenSize(image, pixelSize, s_frameNumber);
+        OpenThreads::Thread::microSleep(10000); s_frameNumber++;
+    }
+}
+
+static bool check(const char* name, bool result)
+{
+    std::cout << name << ": " << (result ? "OK" : "failed") << std::endl;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    Scheduler* scheduler = Scheduler::instance();
+    scheduler->setNumWorkers(2);
+    scheduler->setTinyScreenSize(64.0f);
+    scheduler->setHiddenTimeout(0.3);
+
+    osg::ref_ptr<osg::ImageStream> image = new osg::ImageStream;
+    osg::ref_ptr<CountingTask> task = new CountingTask;
+    scheduler->addTask(task.get(), image.get());
+    bool ok = true;
+
+    // Streams without any VideoCullCallback are always decoded in full
+    reportFor(NULL, 0.0f, 0.2);
+    ok &= check("Unreported stream decoded", task->numDecoded() > 0);
+    ok &= check("Unreported stream is full", task->lastQuality() == Scheduler::DECODE_FULL);
+
+    reportFor(image.get(), 256.0f, 0.2);
+    ok &= check("Large stream is full", task->lastQuality() == Scheduler::DECODE_FULL);
+
+    reportFor(image.get(), 16.0f, 0.3);
+    ok &= check("Tiny stream is reduced", task->lastQuality() == Scheduler::DECODE_REDUCED);
+
+    reportFor(NULL, 0.0f, 0.6);
+    ok &= check("Stream not reported is hidden", task->lastQuality() == Scheduler::DECODE_HIDDEN);
+
+    reportFor(image.get(), 256.0f, 0.2);
+    ok &= check("Visible again is full", task->lastQuality() == Scheduler::DECODE_FULL);
+
+    // Removed streams are never decoded again
+    scheduler->removeTask(task.get());
+    unsigned numDecoded = task->numDecoded();
+    reportFor(NULL, 0.0f, 0.1);
+    ok &= check("Removed stream stopped", task->numDecoded() == numDecoded);
+
+    // Callbacks are attached where image streams are used as textures
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->getOrCreateStateSet()->setTextureAttributeAndModes(0, new osg::Texture2D(image.get()));
+    osg::ref_ptr<osg::Geode> plain = new osg::Geode;
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+    root->addChild(geode.get()); root->addChild(plain.get());
+    ok &= check("Cull callback attached", osgVerse::VideoCullCallback::attach(root.get()) == 1 &&
+                geode->getCullCallback() != NULL && plain->getCullCallback() == NULL);
+
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
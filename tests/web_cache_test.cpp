@@ -0,0 +1,128 @@
+#include <osg/io_utils>
+#include <osg/ArgumentParser>
+#include <osg/Image>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+#include <OpenThreads/Atomic>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <libhv/all/server/HttpService.h>
+#include <libhv/all/server/HttpServer.h>
+#ifndef _DEBUG
+#include <backward.hpp>  // for better debug info
+namespace backward { backward::SignalHandling sh; }
+#endif
+
+/** Serves the same BMP image for every /tiles/<name> request, cacheable for one hour */
+class TileHandler
+{
+public:
+    static int get_tile(HttpRequest* req, HttpResponse* resp)
+    {
+        ++numRequests;
+        resp->headers["Cache-Control"] = "max-age=3600";
+        resp->headers["ETag"] = "\"tile\"";
+        if (req->GetHeader("If-None-Match") == "\"tile\"") return HTTP_STATUS_NOT_MODIFIED;
+
+        resp->content_type = IMAGE_BMP;
+        resp->body = imageData; return 200;
+    }
+
+    static OpenThreads::Atomic numRequests;
+    static std::string imageData;
+};
+
+OpenThreads::Atomic TileHandler::numRequests;
+std::string TileHandler::imageData;
+
+static int readTiles(const std::string& server, int numTiles, const osgDB::Options* options)
+{
+    int numFailed = 0;
+    for (int i = 0; i < numTiles; ++i)
+    {
+        std::string url = server + "/tiles/" + std::to_string(i) + ".bmp.verse_web";
+        osg::ref_ptr<osg::Image> image = osgDB::readImageFile(url, options);
+        if (!image || image->s() != 64 || image->t() != 64) numFailed++;
+    }
+    return numFailed;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    int port = 2521, numThreads = 16, numTiles = 8;
+    arguments.read("--port", port); arguments.read("--threads", numThreads);
+    arguments.read("--tiles", numTiles);
+
+    osgDB::ReaderWriter* bmp = osgDB::Registry::instance()->getReaderWriterForExtension("bmp");
+    if (!bmp) { OSG_WARN << "BMP plugin not found" << std::endl; return 1; }
+
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(64, 64, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    for (int i = 0; i < 64 * 64 * 3; ++i) image->data()[i] = (unsigned char)(i % 251);
+    std::stringstream ss; bmp->writeImage(*image, ss);
+    TileHandler::imageData = ss.str();
+
+    hv::HttpServer server;
+    server.worker_processes = 0;
+    server.worker_threads = 4;
+    server.port = port;
+
+    hv::HttpService service;
+    service.GET("/tiles/:name", TileHandler::get_tile);
+    server.registerHttpService(&service);
+    server.start();
+
+    // Start from an empty disk cache, shared by all reading threads
+    std::string cacheDir = "web_cache_test";
+    osgDB::DirectoryContents files = osgDB::getDirectoryContents(cacheDir);
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        std::string ext = osgDB::getFileExtension(files[i]);
+        if (ext == "webcache" || ext == "tmp") remove((cacheDir + "/" + files[i]).c_str());
+    }
+
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+    options->setPluginStringData("CacheDirectory", cacheDir);
+    options->setPluginStringData("MaxConnectionsPerHost", "2");
+    options->setPluginStringData("ConnectionWaitTimeout", "10");
+
+    // 1. Concurrent fetching: more threads than connections, all writing the same cache files
+    std::string address = "http://127.0.0.1:" + std::to_string(port);
+    std::vector<std::thread> threads; OpenThreads::Atomic numFailed;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            int failed = readTiles(address, numTiles, options.get());
+            for (int f = 0; f < failed; ++f) ++numFailed;
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+    unsigned int numRequests = TileHandler::numRequests;
+    std::cout << "Concurrent fetching: " << (unsigned int)numFailed << " of "
+              << numThreads * numTiles << " failed, " << numRequests << " requests" << std::endl;
+
+    // 2. Cached fetching: fresh cache entries must be used without requesting again
+    int numCacheFailed = readTiles(address, numTiles, options.get());
+    unsigned int numCacheRequests = (unsigned int)TileHandler::numRequests - numRequests;
+    std::cout << "Cached fetching: " << numCacheFailed << " of " << numTiles << " failed, "
+              << numCacheRequests << " requests" << std::endl;
+
+    files = osgDB::getDirectoryContents(cacheDir);
+    int numTempFiles = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    { if (osgDB::getFileExtension(files[i]) == "tmp") numTempFiles++; }
+    std::cout << "Temporary files left: " << numTempFiles << std::endl;
+
+    server.stop();
+    bool ok = ((unsigned int)numFailed == 0) && numCacheFailed == 0 &&
+              numCacheRequests == 0 && numTempFiles == 0;
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}